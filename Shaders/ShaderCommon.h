@@ -22,4 +22,53 @@ const static float4x4 M_IdentityMatrix =
 	{ 0, 0, 0, 1 }
 };
 
+#if defined(VSHADER) && defined(INSTANCED)
+//
+// Geometry instancing. BSBatchRenderer draws identical static meshes with one DrawIndexedInstanced() call and the
+// per-object transforms come from here (indexed by SV_InstanceID) instead of World/PreviousWorld in PerGeometry.
+// Layout must match BSLightingShader::GeometryInstance.
+//
+// The Lighting vertex shader has to actually read Instances[SV_InstanceID] under INSTANCED. fxc strips unreferenced
+// buffers, and BSLightingShader::CreateInstancedShaders() only enables instancing when reflection finds this one.
+// Lighting.hlsl isn't part of this repository, so that change has to be made to the local copy in the shader source
+// directory:
+//
+//   struct VS_INPUT                                 // Add the instance index
+//   {
+//       ...
+//   #if defined(INSTANCED)
+//       uint InstanceID : SV_InstanceID;
+//   #endif
+//   };
+//
+//   float3x4 world = GetWorld(input);               // Every read of World/PreviousWorld in main()
+//   float3x4 previousWorld = GetPreviousWorld(input);
+//
+// with GetWorld() returning GetInstanceWorld(input.InstanceID) under INSTANCED and World otherwise. The instanced
+// techniques (BSLightingShader::IsInstancedTechnique) don't use any other per-geometry constant.
+//
+#define MAX_GEOMETRY_INSTANCES 256
+
+struct GeometryInstance
+{
+	row_major float3x4 World;
+	row_major float3x4 PreviousWorld;
+};
+
+cbuffer PerInstance : register(b8)
+{
+	GeometryInstance Instances[MAX_GEOMETRY_INSTANCES];
+};
+
+float3x4 GetInstanceWorld(uint InstanceID)
+{
+	return Instances[InstanceID].World;
+}
+
+float3x4 GetInstancePreviousWorld(uint InstanceID)
+{
+	return Instances[InstanceID].PreviousWorld;
+}
+#endif
+
 // TODO: Validate that only 1 unique technique define is given
\ No newline at end of file
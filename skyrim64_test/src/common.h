@@ -46,6 +46,7 @@ extern __itt_heap_function ITT_FreeCallback;
 #include "ui/ui.h"
 #include "xutil.h"
 #include "dump.h"
+#include "timebase.h"
 #include "profiler.h"
 #include "patches/offsets.h"
 
@@ -8,5 +8,6 @@
 #define SKYRIM64_USE_VTUNE			0	// Enable VTune instrumentation API
 #define SKYRIM64_USE_VFS			0	// Enable virtual file system
 #define SKYRIM64_USE_PROFILER		0	// Enable built-in profiler macros / "profiler.h"
+#define SKYRIM64_USE_PROFILER_TREE	0	// Enable per-thread call tree timers (ProfileScope) / requires SKYRIM64_USE_PROFILER
 #define SKYRIM64_USE_TRACY			0	// Enable tracy client + server / https://bitbucket.org/wolfpld/tracy/overview
 #define SKYRIM64_USE_PAGE_HEAP		0	// Treat every memory allocation as a separate page (4096 bytes) for debugging
\ No newline at end of file
@@ -11,6 +11,7 @@ void ApplyPatches()
 	// The EXE has been unpacked at this point
 	strcpy_s(g_GitVersion, VER_CURRENT_COMMIT_ID);
 	XUtil::SetThreadName(GetCurrentThreadId(), "Main Thread");
+	Timebase::Initialize();
 
 #if SKYRIM64_USE_VTUNE
 	// Check if VTune is already active
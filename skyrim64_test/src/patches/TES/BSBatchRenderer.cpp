@@ -1,3 +1,4 @@
+#include <fstream>
 #include "../rendering/common.h"
 #include "../../common.h"
 #include "BSGraphics/BSGraphicsRenderer.h"
@@ -5,10 +6,16 @@
 #include "BSSpinLock.h"
 #include "BSBatchRenderer.h"
 #include "BSShader/Shaders/BSSkyShader.h"
+#include "BSShader/Shaders/BSLightingShader.h"
+#include "BSShader/Shaders/BSLightingShaderMaterial.h"
+#include "../rendering/FreeNodeCache.h"
 
 AutoPtr(BYTE, byte_1431F54CD, 0x31F54CD);
 AutoPtr(DWORD, dword_141E32FDC, 0x1E32FDC);
 
+PassSortKey::Capture BSBatchRenderer::PassKeyCapture;
+char BSBatchRenderer::LastPassKeyCaptureFile[MAX_PATH];
+
 bool BSBatchRenderer::BeginPass(BSShader *Shader, uint32_t Technique)
 {
 	EndPass();
@@ -47,18 +54,31 @@ void BSBatchRenderer::EndPass()
 	qword_1434B5220 = 0;
 }
 
+// Active pass index nodes go back to the game's pool (a list head followed by a BSSpinLock) through a per-thread cache,
+// so accumulating on several threads takes the pool lock once per 64 nodes instead of once per node. The game's
+// allocator still pops nodes from the same pool one at a time; that code hasn't been reversed.
+void ReturnPassIndexNodes(void *Pool, BSSimpleList<uint32_t> *Head, BSSimpleList<uint32_t> *Tail)
+{
+	BSSpinLock& lock = *(BSSpinLock *)((uintptr_t)Pool + 8);
+
+	lock.Acquire();
+	Tail->m_pkNext = *(BSSimpleList<uint32_t> **)Pool;
+	*(uintptr_t *)Pool = (uintptr_t)Head;
+	lock.Release();
+}
+
+thread_local FreeNodeCache<BSSimpleList<uint32_t>> FreedPassIndexNodes(ReturnPassIndexNodes, 64);
+
 void sub_14131F910(BSSimpleList<uint32_t> *Node, void *UserData)
 {
 	MemoryContextTracker tracker(MemoryContextTracker::RENDER_ACCUMULATOR, "BSBatchRenderer.cpp");
 
 	if (UserData)
 	{
-		BSSpinLock& lock = *(BSSpinLock *)((uintptr_t)UserData + 8);
+		ProfileCounterInc("Pass Node Local Frees");
 
-		lock.Acquire();
-		Node->m_pkNext = *(BSSimpleList<uint32_t> **)UserData;
-		*(uintptr_t *)UserData = (uintptr_t)Node;
-		lock.Release();
+		if (FreedPassIndexNodes.Free(UserData, Node))
+			ProfileCounterInc("Pass Node Pool Returns");
 	}
 	else
 	{
@@ -66,6 +86,12 @@ void sub_14131F910(BSSimpleList<uint32_t> *Node, void *UserData)
 	}
 }
 
+void BSBatchRenderer::FlushFreedPassIndexNodes()
+{
+	if (FreedPassIndexNodes.Flush())
+		ProfileCounterInc("Pass Node Pool Returns");
+}
+
 void BSBatchRenderer::PersistentPassList::Clear()
 {
 	m_Head = nullptr;
@@ -91,6 +117,7 @@ void BSBatchRenderer::GeometryGroup::Render(uint32_t RenderFlags)
 			return;
 
 		m_BatchRenderer->m_ActivePassIndexList.RemoveAllNodes(sub_14131F910, (void *)(g_ModuleBase + 0x34B5230));
+		FlushFreedPassIndexNodes();
 	}
 
 	m_Count = 0;
@@ -228,84 +255,223 @@ bool BSBatchRenderer::sub_14131E7B0(uint32_t& Technique, uint32_t& GroupIndex, B
 	return sub_14131E8F0(m_RenderPassMap.get(Technique), GroupIndex);
 }
 
-bool BSBatchRenderer::RenderBatches(uint32_t& Technique, uint32_t& GroupIndex, BSSimpleList<uint32_t> *&PassIndexList, uint32_t RenderFlags)
+bool SetPassGroupRenderState(uint32_t GroupIndex, uint32_t RenderFlags)
 {
 	auto renderer = BSGraphics::Renderer::QInstance();
 
 	bool alphaTest = false;
 	bool unknownFlag = (RenderFlags & 0x108) != 0;
+	int cullMode = -1;
+	int alphaToCoverage = -1;
+	bool useAlphaTestRef = false;
 
-	// Set pass render state
+	switch (GroupIndex)
 	{
-		int cullMode = -1;
-		int alphaToCoverage = -1;
-		bool useAlphaTestRef = false;
+	case 0:
+		if (!unknownFlag)
+			cullMode = 1;
 
-		switch (GroupIndex)
-		{
-		case 0:
-			if (!unknownFlag)
-				cullMode = 1;
+		useAlphaTestRef = false;
+		alphaToCoverage = 0;
+		break;
 
-			useAlphaTestRef = false;
-			alphaToCoverage = 0;
-			break;
+	case 1:
+		if (!unknownFlag)
+			cullMode = 1;
 
-		case 1:
-			if (!unknownFlag)
-				cullMode = 1;
+		useAlphaTestRef = true;
+		alphaTest = true;
 
-			useAlphaTestRef = true;
-			alphaTest = true;
+		if (byte_1431F54CD)
+			alphaToCoverage = 1;
+		break;
 
-			if (byte_1431F54CD)
-				alphaToCoverage = 1;
-			break;
+	case 2:
+		if (!unknownFlag)
+			cullMode = 0;
 
-		case 2:
-			if (!unknownFlag)
-				cullMode = 0;
+		useAlphaTestRef = false;
+		alphaToCoverage = 0;
+		break;
 
-			useAlphaTestRef = false;
-			alphaToCoverage = 0;
-			break;
+	case 3:
+		if (!unknownFlag)
+			cullMode = 0;
 
-		case 3:
-			if (!unknownFlag)
-				cullMode = 0;
+		useAlphaTestRef = true;
+		alphaTest = true;
 
-			useAlphaTestRef = true;
-			alphaTest = true;
+		if (byte_1431F54CD)
+			alphaToCoverage = 1;
+		break;
 
-			if (byte_1431F54CD)
-				alphaToCoverage = 1;
-			break;
+	case 4:
+		if (!unknownFlag)
+			cullMode = 1;
 
-		case 4:
-			if (!unknownFlag)
-				cullMode = 1;
+		useAlphaTestRef = true;
+		alphaTest = true;
+		alphaToCoverage = 0;
+		break;
+	}
 
-			useAlphaTestRef = true;
-			alphaTest = true;
-			alphaToCoverage = 0;
-			break;
-		}
+	if (cullMode != -1)
+		renderer->RasterStateSetCullMode(cullMode);
 
-		if (cullMode != -1)
-			BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(cullMode);
+	if (alphaToCoverage != -1)
+		renderer->AlphaBlendStateSetAlphaToCoverage(alphaToCoverage);
 
-		if (alphaToCoverage != -1)
-			BSGraphics::Renderer::QInstance()->AlphaBlendStateSetAlphaToCoverage(alphaToCoverage);
+	renderer->SetUseAlphaTestRef(useAlphaTestRef);
+	return alphaTest;
+}
 
-		renderer->SetUseAlphaTestRef(useAlphaTestRef);
+void SetPersistentPassRenderState(BSRenderPass *Pass, uint32_t RenderFlags)
+{
+	if ((RenderFlags & 0x108) == 0)
+	{
+		if (Pass->m_ShaderProperty->GetFlag(BSShaderProperty::BSSP_FLAG_TWO_SIDED))
+			BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(0);
+		else
+			BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(1);
 	}
+}
+
+//
+// Cached shadow maps split casters in two: static ones end up in the snapshot, dynamic ones are drawn every frame.
+// Deferred passes stay valid until the next frame's accumulation since pass lists only hold pointers. Render state is
+// rebuilt from the pass group when they're drawn.
+//
+struct DeferredCaster
+{
+	BSRenderPass *Pass;
+	uint32_t Technique;
+	uint32_t RenderFlags;
+	int GroupIndex;					// -1 for persistent pass lists
+	bool AlphaTest;
+};
+
+thread_local BSBatchRenderer::CasterFilter tls_CasterFilter = BSBatchRenderer::CASTER_FILTER_NONE;
+thread_local std::vector<DeferredCaster> tls_DeferredCasters;
+
+// Returns true if the pass is drawn now
+bool FilterCaster(BSRenderPass *Pass, uint32_t Technique, int GroupIndex, bool AlphaTest, uint32_t RenderFlags)
+{
+	if (tls_CasterFilter == BSBatchRenderer::CASTER_FILTER_NONE)
+		return true;
+
+	bool dynamic = BSBatchRenderer::IsDynamicCaster(Pass);
+
+	if (tls_CasterFilter == BSBatchRenderer::CASTER_FILTER_SKIP_STATIC)
+		return dynamic;
+
+	if (dynamic)
+	{
+		tls_DeferredCasters.push_back({ Pass, Technique, RenderFlags, GroupIndex, AlphaTest });
+		return false;
+	}
+
+	return true;
+}
+
+void FilterCasters(std::vector<BSRenderPass *>& Passes, uint32_t Technique, int GroupIndex, bool AlphaTest, uint32_t RenderFlags)
+{
+	size_t count = 0;
+
+	for (BSRenderPass *pass : Passes)
+	{
+		if (FilterCaster(pass, Technique, GroupIndex, AlphaTest, RenderFlags))
+			Passes[count++] = pass;
+	}
+
+	Passes.resize(count);
+}
+
+void BSBatchRenderer::SetCasterFilter(CasterFilter Filter)
+{
+	AssertMsg(Filter != CASTER_FILTER_DEFER_DYNAMIC || tls_DeferredCasters.empty(), "Deferred casters were never rendered");
+
+	tls_CasterFilter = Filter;
+}
+
+bool BSBatchRenderer::IsDynamicCaster(BSGeometry *Geometry, BSShaderProperty *Property)
+{
+	return Geometry->QSkinInstance() ||
+		Property->GetFlag(BSShaderProperty::BSSP_SKINNED) ||
+		Property->GetFlag(BSShaderProperty::BSSP_FLAG_TREE_ANIM);
+}
+
+bool BSBatchRenderer::IsDynamicCaster(BSRenderPass *Pass)
+{
+	// Grass and effects animate in their vertex shaders. This has to cover at least everything the BSGeometry overload
+	// does, since only static casters are part of the shadow cache signature.
+	return Pass->m_Shader != BSLightingShader::pInstance || IsDynamicCaster(Pass->m_Geometry, Pass->m_ShaderProperty);
+}
+
+void BSBatchRenderer::RenderDeferredCasters()
+{
+	auto& deferred = tls_DeferredCasters;
+
+	if (deferred.empty())
+		return;
+
+	int currentGroup = -2;
+	uint32_t currentFlags = 0;
+
+	for (auto& caster : deferred)
+	{
+		if (caster.GroupIndex < 0)
+			SetPersistentPassRenderState(caster.Pass, caster.RenderFlags);
+		else if (caster.GroupIndex != currentGroup || caster.RenderFlags != currentFlags)
+			SetPassGroupRenderState(caster.GroupIndex, caster.RenderFlags);
+
+		currentGroup = caster.GroupIndex;
+		currentFlags = caster.RenderFlags;
+
+		RenderPassImmediately(caster.Pass, caster.Technique, caster.AlphaTest, caster.RenderFlags);
+	}
+
+	EndPass();
+	BSGraphics::Renderer::QInstance()->AlphaBlendStateSetAlphaToCoverage(0);
+
+	if ((currentFlags & 0x108) == 0)
+		BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(1);
+
+	deferred.clear();
+}
+
+bool BSBatchRenderer::RenderBatches(uint32_t& Technique, uint32_t& GroupIndex, BSSimpleList<uint32_t> *&PassIndexList, uint32_t RenderFlags)
+{
+	bool alphaTest = SetPassGroupRenderState(GroupIndex, RenderFlags);
 
 	// Render this group with a specific render pass list
 	auto group = &m_RenderPass[m_RenderPassMap.get(Technique)];
 	auto currentPass = group->m_Passes[GroupIndex];
 
+	thread_local std::vector<BSRenderPass *> tlsPassBuffer;
+
+	std::vector<BSRenderPass *> passes;
+	passes.swap(tlsPassBuffer);
+	passes.clear();
+
 	for (; currentPass; currentPass = currentPass->m_PassGroupNext)
-		RenderPassImmediately(currentPass, Technique, alphaTest, RenderFlags);
+		passes.push_back(currentPass);
+
+	OrderPasses(passes.data(), (uint32_t)passes.size(), PassSortKey::LIST_BATCH_GROUP);
+
+	if (tls_CasterFilter != CASTER_FILTER_NONE)
+		FilterCasters(passes, Technique, GroupIndex, alphaTest, RenderFlags);
+
+	if (ui::opt::InstanceStaticGeometry)
+	{
+		RenderPassesWithInstancing(passes.data(), (uint32_t)passes.size(), Technique, alphaTest, RenderFlags);
+	}
+	else
+	{
+		for (BSRenderPass *pass : passes)
+			RenderPassImmediately(pass, Technique, alphaTest, RenderFlags);
+	}
+
+	passes.swap(tlsPassBuffer);
 
 	// Zero the pointers only - the memory is freed elsewhere
 	if (m_AutoClearPasses)
@@ -334,6 +500,90 @@ void BSBatchRenderer::ClearRenderPasses()
 	}
 
 	m_ActivePassIndexList.RemoveAllNodes(sub_14131F910, (void *)(g_ModuleBase + 0x34B5230));
+	FlushFreedPassIndexNodes();
+}
+
+PassSortKey::PassState BSBatchRenderer::GetPassState(BSRenderPass *Pass)
+{
+	BSShaderMaterial *material = Pass->m_ShaderProperty ? Pass->m_ShaderProperty->pMaterial : nullptr;
+	NiAlphaProperty *alphaProperty = Pass->m_Geometry->QAlphaProperty();
+
+	PassSortKey::PassState state = {};
+	state.Shader = (uint64_t)Pass->m_Shader;
+	state.Material = (uint64_t)material;
+	state.VertexDesc = Pass->m_Geometry->GetVertexDesc();
+	state.Technique = Pass->m_PassEnum;
+
+	if (material && Pass->m_Shader == BSLightingShader::pInstance)
+		state.TextureSet = (uint64_t)(NiSourceTexture *)static_cast<BSLightingShaderMaterialBase *>(material)->spDiffuseTexture;
+
+	const NiPoint3& eye = BSShaderManager::GetCurrentAccumulator()->m_EyePosition;
+	const NiPoint3& center = Pass->m_Geometry->m_kWorldBound.m_kCenter;
+
+	float dx = center.x - eye.x;
+	float dy = center.y - eye.y;
+	float dz = center.z - eye.z;
+	state.Distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	if (alphaProperty && alphaProperty->GetAlphaBlending())
+		state.Flags |= PassSortKey::PASS_BLENDED;
+
+	return state;
+}
+
+void BSBatchRenderer::OrderPasses(BSRenderPass **Passes, uint32_t Count, PassSortKey::ListType Type)
+{
+	const bool capture = PassKeyCapture.IsActive();
+
+	if (Count == 0 || (!ui::opt::SortBatchedPasses && !capture))
+		return;
+
+	// Passes are linked in submission order. Draw them ordered by state instead so consecutive passes share materials,
+	// textures and input layouts. Blended passes stay where they are. The lists themselves are left untouched.
+	thread_local std::vector<PassSortKey::PassState> tlsStates;
+	thread_local std::vector<RadixSort::KeyValue> tlsKeys;
+	thread_local std::vector<RadixSort::KeyValue> tlsScratch;
+	thread_local std::vector<uint8_t> tlsFixed;
+	thread_local std::vector<BSRenderPass *> tlsSubmitted;
+
+	tlsStates.resize(Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+		tlsStates[i] = GetPassState(Passes[i]);
+
+	PassKeyCapture.RecordList(Type, tlsStates.data(), Count);
+
+	if (!ui::opt::SortBatchedPasses || Count < 2)
+		return;
+
+	tlsKeys.resize(Count);
+	tlsScratch.resize(Count);
+	tlsFixed.resize(Count);
+	tlsSubmitted.assign(Passes, Passes + Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		tlsKeys[i] = { PassSortKey::Pack(tlsStates[i], Type), i };
+		tlsFixed[i] = (tlsStates[i].Flags & PassSortKey::PASS_BLENDED) ? 1 : 0;
+	}
+
+	PassSortKey::SortList(tlsKeys.data(), tlsScratch.data(), tlsFixed.data(), Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+		Passes[i] = tlsSubmitted[tlsKeys[i].Value];
+}
+
+void BSBatchRenderer::EndPassKeyCaptureFrame()
+{
+	if (!PassKeyCapture.EndFrame())
+		return;
+
+	sprintf_s(LastPassKeyCaptureFile, "PassKeys_%llu.bin", GetTickCount64());
+
+	if (std::ofstream file(LastPassKeyCaptureFile, std::ios::binary); file && PassKeyCapture.Write(file))
+		ui::log::Add("Pass keys written to %s (%u frames, %llu lists)\n", LastPassKeyCaptureFile, PassKeyCapture.QFrameCount(), (uint64_t)PassKeyCapture.QLists().size());
+	else
+		ui::log::Add("Unable to write %s\n", LastPassKeyCaptureFile);
 }
 
 void BSBatchRenderer::RenderPersistentPassList(PersistentPassList *PassList, uint32_t RenderFlags)
@@ -343,24 +593,33 @@ void BSBatchRenderer::RenderPersistentPassList(PersistentPassList *PassList, uin
 
 	EndPass();
 
+	thread_local std::vector<BSRenderPass *> tlsPersistentBuffer;
+
+	std::vector<BSRenderPass *> passes;
+	passes.swap(tlsPersistentBuffer);
+	passes.clear();
+
 	for (BSRenderPass *i = PassList->m_Head; i; i = i->m_Next)
 	{
-		if (!i->m_Geometry)
-			continue;
+		if (i->m_Geometry)
+			passes.push_back(i);
+	}
 
-		if ((RenderFlags & 0x108) == 0)
-		{
-			if (i->m_ShaderProperty->GetFlag(BSShaderProperty::BSSP_FLAG_TWO_SIDED))
-				BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(0);
-			else
-				BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(1);
-		}
+	OrderPasses(passes.data(), (uint32_t)passes.size(), PassSortKey::LIST_PERSISTENT);
 
+	for (BSRenderPass *i : passes)
+	{
 		bool alphaTest = i->m_Geometry->QAlphaProperty() && i->m_Geometry->QAlphaProperty()->GetAlphaTesting();
 
+		if (!FilterCaster(i, i->m_PassEnum, -1, alphaTest, RenderFlags))
+			continue;
+
+		SetPersistentPassRenderState(i, RenderFlags);
 		RenderPassImmediately(i, i->m_PassEnum, alphaTest, RenderFlags);
 	}
 
+	passes.swap(tlsPersistentBuffer);
+
 	if ((RenderFlags & 0x108) == 0)
 		BSGraphics::Renderer::QInstance()->RasterStateSetCullMode(1);
 
@@ -368,7 +627,116 @@ void BSBatchRenderer::RenderPersistentPassList(PersistentPassList *PassList, uin
 	EndPass();
 }
 
-void BSBatchRenderer::RenderPassImmediately(BSRenderPass *Pass, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags)
+void BSBatchRenderer::RenderPassesWithInstancing(BSRenderPass **Passes, uint32_t Count, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags)
+{
+	// Every pass in the list uses the same technique, so they're either all lighting shader passes or none are
+	if (Count < 2 || Passes[0]->m_Shader != BSLightingShader::pInstance || !BSLightingShader::pInstance->SupportsInstancing(Technique))
+	{
+		for (uint32_t i = 0; i < Count; i++)
+			RenderPassImmediately(Passes[i], Technique, AlphaTest, RenderFlags);
+
+		return;
+	}
+
+	thread_local std::vector<BSRenderPass *> tlsCandidateBuffer;
+
+	std::vector<BSRenderPass *> candidates;
+	candidates.swap(tlsCandidateBuffer);
+	candidates.clear();
+
+	// Passes that can't be instanced keep their order and are drawn first
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		if (IsInstanceCandidate(Passes[i]))
+			candidates.push_back(Passes[i]);
+		else
+			RenderPassImmediately(Passes[i], Technique, AlphaTest, RenderFlags);
+	}
+
+	// Move passes that are able to share a draw next to each other: same mesh, same material, same orientation.
+	// Groups keep the position of their first pass so the incoming (possibly state sorted) order is preserved.
+	thread_local std::vector<std::pair<uint32_t, BSRenderPass *>> tlsGroupBuffer;
+	thread_local std::unordered_map<uint64_t, uint32_t> tlsGroupMap;
+
+	std::vector<std::pair<uint32_t, BSRenderPass *>> grouped;
+	grouped.swap(tlsGroupBuffer);
+	grouped.clear();
+	tlsGroupMap.clear();
+
+	// A key collision only splits a group, CanInstance() has the final say
+	for (BSRenderPass *pass : candidates)
+	{
+		uint64_t groupKey = XUtil::MurmurHash64A(&pass->m_Geometry->pRendererData, sizeof(void *), (uint64_t)pass->m_ShaderProperty->pMaterial);
+		auto group = tlsGroupMap.try_emplace(groupKey, (uint32_t)grouped.size()).first;
+
+		grouped.emplace_back(group->second, pass);
+	}
+
+	std::stable_sort(grouped.begin(), grouped.end(), [](const auto& A, const auto& B)
+	{
+		if (A.first != B.first)
+			return A.first < B.first;
+
+		const NiTransform& worldA = A.second->m_Geometry->GetWorldTransform();
+		const NiTransform& worldB = B.second->m_Geometry->GetWorldTransform();
+
+		if (int order = memcmp(&worldA.m_Rotate, &worldB.m_Rotate, sizeof(NiMatrix3)); order != 0)
+			return order < 0;
+
+		return memcmp(&worldA.m_fScale, &worldB.m_fScale, sizeof(float)) < 0;
+	});
+
+	for (size_t i = 0; i < grouped.size(); i++)
+		candidates[i] = grouped[i].second;
+
+	grouped.swap(tlsGroupBuffer);
+
+	for (size_t i = 0; i < candidates.size();)
+	{
+		uint32_t instanceCount = 1;
+
+		while (i + instanceCount < candidates.size() &&
+			instanceCount < BSLightingShader::MaxGeometryInstances &&
+			CanInstance(candidates[i], candidates[i + instanceCount]))
+			instanceCount++;
+
+		if (instanceCount > 1)
+			RenderPassImmediately_Instanced(&candidates[i], instanceCount, Technique, AlphaTest, RenderFlags);
+		else
+			RenderPassImmediately(candidates[i], Technique, AlphaTest, RenderFlags);
+
+		i += instanceCount;
+	}
+
+	candidates.swap(tlsCandidateBuffer);
+}
+
+bool BSBatchRenderer::IsInstanceCandidate(BSRenderPass *Pass)
+{
+	BSGeometry *geometry = Pass->m_Geometry;
+
+	// Plain static meshes only
+	if (geometry->QType() != GEOMETRY_TYPE_TRISHAPE || geometry->QSkinInstance())
+		return false;
+
+	if (geometry->QNeedsCustomRender())
+		return false;
+
+	return BSLightingShader::IsInstanceCandidate(Pass);
+}
+
+bool BSBatchRenderer::CanInstance(BSRenderPass *First, BSRenderPass *Pass)
+{
+	auto firstShape = static_cast<BSTriShape *>(First->m_Geometry);
+	auto triShape = static_cast<BSTriShape *>(Pass->m_Geometry);
+
+	if (firstShape->QRendererData() != triShape->QRendererData() || firstShape->m_TriangleCount != triShape->m_TriangleCount)
+		return false;
+
+	return BSLightingShader::IsInstanceCompatible(First, Pass);
+}
+
+bool BSBatchRenderer::SetupPass(BSRenderPass *Pass, uint32_t Technique)
 {
 	auto *GraphicsGlobals = BSGraphics::Renderer::QInstance();
 	uint32_t& dword_1432A8214 = *(uint32_t *)((uintptr_t)GraphicsGlobals + 0x3014);// LastPass
@@ -383,6 +751,8 @@ void BSBatchRenderer::RenderPassImmediately(BSRenderPass *Pass, uint32_t Techniq
 
 	if (!techniqueIsSetup)
 	{
+		ProfileCounterInc("Batch Technique Changes");
+
 		dword_141E32FDC = Technique;// This is written but never read anywhere?
 		techniqueIsSetup = BeginPass(Pass->m_Shader, Technique);
 	}
@@ -397,21 +767,31 @@ void BSBatchRenderer::RenderPassImmediately(BSRenderPass *Pass, uint32_t Techniq
 
 		if (material != qword_1434B5220)
 		{
+			ProfileCounterInc("Batch Material Changes");
+
 			if (material)
 				Pass->m_Shader->SetupMaterial(material);
 
 			qword_1434B5220 = material;
 		}
+	}
 
-		*(BYTE *)((uintptr_t)Pass->m_Geometry + 264) = *(BYTE *)(&Pass->m_LODMode);// WARNING: MT data write hazard. ucCurrentMeshLODLevel?
+	return techniqueIsSetup;
+}
 
-		if (Pass->m_Geometry->QSkinInstance())
-			RenderPassImmediately_Skinned(Pass, AlphaTest, RenderFlags);
-		else if (*(BYTE *)((uintptr_t)Pass->m_Geometry + 265) & 8)// BSGeometry::NeedsCustomRender()?
-			RenderPassImmediately_Custom(Pass, AlphaTest, RenderFlags);
-		else
-			RenderPassImmediately_Standard(Pass, AlphaTest, RenderFlags);
-	}
+void BSBatchRenderer::RenderPassImmediately(BSRenderPass *Pass, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags)
+{
+	if (!SetupPass(Pass, Technique))
+		return;
+
+	Pass->m_Geometry->m_ucCurrentMeshLODLevel = *(BYTE *)(&Pass->m_LODMode);// WARNING: MT data write hazard
+
+	if (Pass->m_Geometry->QSkinInstance())
+		RenderPassImmediately_Skinned(Pass, AlphaTest, RenderFlags);
+	else if (Pass->m_Geometry->QNeedsCustomRender())
+		RenderPassImmediately_Custom(Pass, AlphaTest, RenderFlags);
+	else
+		RenderPassImmediately_Standard(Pass, AlphaTest, RenderFlags);
 }
 
 void BSBatchRenderer::ShaderSetup(BSRenderPass *Pass, BSShader *Shader, bool AlphaTest, uint32_t RenderFlags)
@@ -505,6 +885,34 @@ void BSBatchRenderer::RenderPassImmediately_Custom(BSRenderPass *Pass, bool Alph
 	Pass->m_Shader->RestoreGeometry(Pass, RenderFlags);
 }
 
+void BSBatchRenderer::RenderPassImmediately_Instanced(BSRenderPass **Passes, uint32_t Count, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags)
+{
+	MemoryContextTracker tracker(MemoryContextTracker::RENDER_ACCUMULATOR, "BSBatchRenderer.cpp");
+
+	BSRenderPass *pass = Passes[0];
+
+	if (!SetupPass(pass, Technique))
+		return;
+
+	for (uint32_t i = 0; i < Count; i++)
+		Passes[i]->m_Geometry->m_ucCurrentMeshLODLevel = *(BYTE *)(&Passes[i]->m_LODMode);// WARNING: MT data write hazard
+
+	auto shader = static_cast<BSLightingShader *>(pass->m_Shader);
+	auto triShape = static_cast<BSTriShape *>(pass->m_Geometry);
+
+	// Constants come from the first pass. CanInstance() made sure they're identical for the others.
+	ShaderSetup(pass, shader, AlphaTest || BSGraphics::gState.bUseEarlyZ, RenderFlags);
+	shader->SetupGeometryInstances(Passes, Count, RenderFlags);
+
+	BSGraphics::Renderer::QInstance()->DrawTriShapeInstanced(reinterpret_cast<BSGraphics::TriShape *>(triShape->QRendererData()), 0, triShape->m_TriangleCount, Count);
+
+	shader->RestoreGeometryInstances();
+	shader->RestoreGeometry(pass, RenderFlags);
+
+	ProfileCounterInc("Instanced Draws");
+	ProfileCounterAdd("Instanced Passes", Count);
+}
+
 void BSBatchRenderer::Draw(BSRenderPass *Pass)
 {
 	auto renderer = BSGraphics::Renderer::QInstance();
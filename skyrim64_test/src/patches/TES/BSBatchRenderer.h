@@ -4,6 +4,7 @@
 #include "BSTList.h"
 #include "BSTScatterTable.h"
 #include "BSShader/BSShaderManager.h"
+#include "../rendering/PassSortKey.h"
 
 class BSBatchRenderer
 {
@@ -37,6 +38,13 @@ public:
 		void Clear(bool ReportNotEmpty, bool FreePasses);// Simply zeros this structure
 	};
 
+	enum CasterFilter
+	{
+		CASTER_FILTER_NONE,
+		CASTER_FILTER_SKIP_STATIC,		// Static casters come from a shadow map snapshot
+		CASTER_FILTER_DEFER_DYNAMIC,	// Dynamic casters wait for RenderDeferredCasters()
+	};
+
 	virtual ~BSBatchRenderer();
 	virtual void VFunc01();															// Registers a pass?
 	virtual void VFunc02();															// Registers a pass?
@@ -56,6 +64,19 @@ public:
 
 	static bool BeginPass(BSShader *Shader, uint32_t Technique);
 	static void EndPass();
+	static void FlushFreedPassIndexNodes();
+
+	// Records the pass state of every sorted list for tests/passkey_analyzer. Call once per frame, the file is written
+	// after the last requested frame.
+	static PassSortKey::Capture PassKeyCapture;
+	static char LastPassKeyCaptureFile[MAX_PATH];
+	static void EndPassKeyCaptureFrame();
+
+	// Per thread. Applies to RenderBatches() and persistent pass lists.
+	static void SetCasterFilter(CasterFilter Filter);
+	static bool IsDynamicCaster(BSGeometry *Geometry, BSShaderProperty *Property);
+	static bool IsDynamicCaster(BSRenderPass *Pass);
+	static void RenderDeferredCasters();
 
 	bool QPassesWithinRange(uint32_t StartTech, uint32_t EndTech);
 
@@ -66,12 +87,19 @@ public:
 	bool RenderBatches(uint32_t& Technique, uint32_t& GroupIndex, BSSimpleList<uint32_t> *&PassIndexList, uint32_t RenderFlags);
 	void ClearRenderPasses();
 
+	static PassSortKey::PassState GetPassState(BSRenderPass *Pass);
+	static void OrderPasses(BSRenderPass **Passes, uint32_t Count, PassSortKey::ListType Type);
 	static void RenderPersistentPassList(PersistentPassList *PassList, uint32_t RenderFlags);
+	static void RenderPassesWithInstancing(BSRenderPass **Passes, uint32_t Count, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags);
+	static bool IsInstanceCandidate(BSRenderPass *Pass);
+	static bool CanInstance(BSRenderPass *First, BSRenderPass *Pass);
+	static bool SetupPass(BSRenderPass *Pass, uint32_t Technique);
 	static void RenderPassImmediately(BSRenderPass *Pass, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags);
 	static void ShaderSetup(BSRenderPass *Pass, BSShader *Shader, bool AlphaTest, uint32_t RenderFlags);
 	static void RenderPassImmediately_Standard(BSRenderPass *Pass, bool AlphaTest, uint32_t RenderFlags);
 	static void RenderPassImmediately_Skinned(BSRenderPass *Pass, bool AlphaTest, uint32_t RenderFlags);
 	static void RenderPassImmediately_Custom(BSRenderPass *Pass, bool AlphaTest, uint32_t RenderFlags);
+	static void RenderPassImmediately_Instanced(BSRenderPass **Passes, uint32_t Count, uint32_t Technique, bool AlphaTest, uint32_t RenderFlags);
 	static void Draw(BSRenderPass *Pass);
 };
 static_assert(sizeof(BSBatchRenderer::GeometryGroup) == 0x28);
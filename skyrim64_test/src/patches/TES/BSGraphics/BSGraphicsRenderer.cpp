@@ -1,10 +1,19 @@
 #include "../../../common.h"
 #include <mutex>
 #include "../../rendering/GpuCircularBuffer.h"
+#include "../../rendering/ConstantBufferCache.h"
+#include "../../rendering/DynamicBufferRing.h"
+#include "../../rendering/ShaderCache.h"
+#include "../../rendering/ShaderBytecodeRegistry.h"
+#include "../../rendering/d3d11_deferred.h"
+#include "../../rendering/d3d11_capture.h"
+#include "../../rendering/d3d11_transient.h"
 #include "../NiMain/BSGeometry.h"
 #include "BSGraphicsRenderer.h"
 #include "BSGraphicsRenderTargetManager.h"
 
+#define SHADER_CACHE_PATH "C:\\SA\\ShaderCache"
+
 #define CHECK_RESULT(ReturnVar, Statement) do { (ReturnVar) = (Statement); AssertMsgVa(SUCCEEDED(ReturnVar), "Renderer target '%s' creation failed. HR = 0x%X.", Name, (ReturnVar)); } while (0)
 
 thread_local D3D_PRIMITIVE_TOPOLOGY TopoOverride;
@@ -13,16 +22,43 @@ namespace BSGraphics
 {
 	std::mutex InputLayoutLock;
 	std::unordered_map<uint64_t, ID3D11InputLayout *> InputLayoutMap;
-	std::unordered_map<void *, std::pair<std::unique_ptr<uint8_t[]>, size_t>> ShaderBytecodeMap;
+	ShaderBytecodeRegistry ShaderBytecodes;
 
 	const uint32_t ShaderConstantRingBufferSize = 32 * 1024 * 1024;
-	const uint32_t RingBufferMaxFrames = 4;
-	uint32_t CurrentFrameIndex = 0;
-
-	ID3D11Query *FrameCompletedQueries[RingBufferMaxFrames];
-	bool FrameCompletedQueryPending[RingBufferMaxFrames];
+	const uint32_t ShaderConstantChunkSize = 64 * 1024;
 
 	GpuCircularBuffer *ShaderConstantBuffer;
+	ConstantBufferCache *ShaderConstantCache;
+	DynamicBufferRing DynamicVertexRing;
+	ID3D11Buffer *MainDynamicVertexBuffer;
+
+	//
+	// Draws bind Globals.m_DynamicVertexBuffers[Globals.m_CurrentDynamicVertexBuffer]. The ring can hold more buffers than
+	// the game has slots for, so slot 0 always names the current one and the other slots go unused. Every slot keeps its
+	// own reference, like the game's originals, so nothing dangles when the ring releases buffers.
+	//
+	// Recording threads write to a private copy of the globals that DC_RecordAndExecute() later copies over the main
+	// one. Those copies only borrow the pointer: the ring holds back buffer releases until recording is done, and
+	// EndDeferredDynamicUploads() puts the main block's own reference back.
+	//
+	void PublishDynamicVertexBuffer(ID3D11Buffer **Slots, ID3D11Buffer *Buffer)
+	{
+		if (Slots[0] == Buffer)
+			return;
+
+		if (DC_IsRecordingThread())
+		{
+			Slots[0] = Buffer;
+			return;
+		}
+
+		Buffer->AddRef();
+
+		if (Slots[0])
+			Slots[0]->Release();
+
+		Slots[0] = Buffer;
+	}
 
 	void BeginEvent(const wchar_t *Name)
 	{
@@ -39,50 +75,51 @@ namespace BSGraphics
 
 	void Renderer::Initialize()
 	{
-		for (uint32_t i = 0; i < RingBufferMaxFrames; i++)
-		{
-			D3D11_QUERY_DESC desc;
-			desc.Query = D3D11_QUERY_EVENT;
-			desc.MiscFlags = 0;
-
-			Assert(SUCCEEDED(Data.pDevice->CreateQuery(&desc, &FrameCompletedQueries[i])));
-		}
-
-		ShaderConstantBuffer = new GpuCircularBuffer(Data.pDevice, D3D11_BIND_CONSTANT_BUFFER, ShaderConstantRingBufferSize, RingBufferMaxFrames);
+		ShaderConstantBuffer = new GpuCircularBuffer(Data.pDevice, Data.pContext, D3D11_BIND_CONSTANT_BUFFER, ShaderConstantRingBufferSize, ShaderConstantChunkSize);
+		ShaderConstantCache = new ConstantBufferCache(ShaderConstantBuffer);
 	}
 
 	void Renderer::OnNewFrame()
 	{
-		Assert(!FrameCompletedQueryPending[CurrentFrameIndex]);
+		// Ring memory used by this frame is handed back once the GPU passes the frame's fence
+		ShaderConstantBuffer->EndFrame();
+		ShaderConstantCache->NextFrame();
 
-		// Set a marker for when the GPU is done processing the previous frame
-		Data.pContext->End(FrameCompletedQueries[CurrentFrameIndex]);
-		FrameCompletedQueryPending[CurrentFrameIndex] = true;
+		if (DynamicVertexRing.IsInitialized())
+		{
+			auto context = DC_LockUploadContext(Data.pContext);
+			DynamicVertexRing.EndFrame(context);
 
-		ShaderConstantBuffer->SwapFrame(CurrentFrameIndex);
+			Globals.m_CurrentDynamicVertexBuffer = 0;
+			PublishDynamicVertexBuffer(Globals.m_DynamicVertexBuffers, DynamicVertexRing.QCurrentBuffer());
+			DC_UnlockUploadContext();
+		}
+	}
 
-		// "Pop" the query from the oldest rendered frame
-		int prevQueryIndex = CurrentFrameIndex - (RingBufferMaxFrames - 1);
+	DynamicBufferRing::Stats Renderer::GetDynamicVertexBufferStats() const
+	{
+		return DynamicVertexRing.GetStats();
+	}
 
-		if (prevQueryIndex < 0)
-			prevQueryIndex += RingBufferMaxFrames;
+	void Renderer::BeginDeferredDynamicUploads()
+	{
+		MainDynamicVertexBuffer = Globals.m_DynamicVertexBuffers[0];
+		DynamicVertexRing.BeginDeferredFences();
+	}
 
-		if (FrameCompletedQueryPending[prevQueryIndex])
-		{
-			BOOL data;
-			HRESULT hr = Data.pContext->GetData(FrameCompletedQueries[prevQueryIndex], &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	void Renderer::EndDeferredDynamicUploads()
+	{
+		// The command lists were executed, so fences issued now come after every draw that used the buffers
+		DynamicVertexRing.EndDeferredFences(Data.pContext);
 
-			// Those commands are REQUIRED to be complete by now - no exceptions
-			AssertMsg(SUCCEEDED(hr) && data == TRUE, "DeviceContext::GetData() MUST SUCCEED BY NOW");
+		Globals.m_DynamicVertexBuffers[0] = MainDynamicVertexBuffer;
+		MainDynamicVertexBuffer = nullptr;
 
-			ShaderConstantBuffer->FreeOldFrame(prevQueryIndex);
-			FrameCompletedQueryPending[prevQueryIndex] = false;
+		if (DynamicVertexRing.IsInitialized())
+		{
+			Globals.m_CurrentDynamicVertexBuffer = 0;
+			PublishDynamicVertexBuffer(Globals.m_DynamicVertexBuffers, DynamicVertexRing.QCurrentBuffer());
 		}
-
-		CurrentFrameIndex++;
-
-		if (CurrentFrameIndex >= RingBufferMaxFrames)
-			CurrentFrameIndex = 0;
 	}
 
 	void Renderer::Lock()
@@ -120,6 +157,43 @@ namespace BSGraphics
 		Resource->SetPrivateData(WKPDID_D3DDebugObjectName, len, buffer);
 	}
 
+	static uint32_t GetFormatBitsPerPixel(DXGI_FORMAT Format)
+	{
+		if (Format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && Format <= DXGI_FORMAT_R32G32B32A32_SINT)
+			return 128;
+
+		if (Format >= DXGI_FORMAT_R32G32B32_TYPELESS && Format <= DXGI_FORMAT_R32G32B32_SINT)
+			return 96;
+
+		if (Format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && Format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT)
+			return 64;
+
+		if (Format >= DXGI_FORMAT_R8G8_TYPELESS && Format <= DXGI_FORMAT_R16_SINT)
+			return 16;
+
+		if (Format >= DXGI_FORMAT_R8_TYPELESS && Format <= DXGI_FORMAT_A8_UNORM)
+			return 8;
+
+		return 32;
+	}
+
+	static uint64_t GetRenderTargetKey(const RenderTargetProperties *Properties)
+	{
+		return (uint64_t)Properties->uiWidth |
+			((uint64_t)Properties->uiHeight << 16) |
+			((uint64_t)Properties->eFormat << 32) |
+			((uint64_t)Properties->bSupportUnorderedAccess << 40);
+	}
+
+	static bool IsTransientCandidate(uint32_t TargetIndex, const RenderTargetProperties *Properties)
+	{
+		// Copies and mip chains keep data outside of the texture's own lifetime
+		return TargetIndex != RENDER_TARGET_FRAMEBUFFER &&
+			Properties->iMipLevel == -1 &&
+			!Properties->bCopyable &&
+			!Properties->bAllowMipGeneration;
+	}
+
 	void Renderer::CreateRenderTarget(uint32_t TargetIndex, const char *Name, const RenderTargetProperties *Properties)
 	{
 		Assert(TargetIndex < RENDER_TARGET_COUNT && TargetIndex != RENDER_TARGET_NONE);
@@ -150,7 +224,22 @@ namespace BSGraphics
 			if (Properties->bAllowMipGeneration)
 				texDesc.MiscFlags |= D3D11_RESOURCE_MISC_GENERATE_MIPS;
 
-			CHECK_RESULT(hr, device->CreateTexture2D(&texDesc, nullptr, &target->Texture));
+			uint32_t aliasTarget = TargetIndex;
+
+			if (ui::opt::AliasTransientTargets && IsTransientCandidate(TargetIndex, Properties))
+				aliasTarget = D3D11Transient::QAliasOf(TargetIndex, GetRenderTargetKey(Properties));
+
+			if (aliasTarget != TargetIndex && Data.pRenderTargets[aliasTarget].Texture)
+			{
+				// Lifetimes never overlap within a frame, so both targets can live in the same memory
+				target->Texture = Data.pRenderTargets[aliasTarget].Texture;
+				target->Texture->AddRef();
+			}
+			else
+			{
+				CHECK_RESULT(hr, device->CreateTexture2D(&texDesc, nullptr, &target->Texture));
+			}
+
 			CHECK_RESULT(hr, device->CreateRenderTargetView(target->Texture, nullptr, &target->RTV));
 			CHECK_RESULT(hr, device->CreateShaderResourceView(target->Texture, nullptr, &target->SRV));
 
@@ -384,6 +473,80 @@ namespace BSGraphics
 		SetResourceName(data->Texture, "%s SRV", Name);
 	}
 
+	void Renderer::UpdateTransientTargets()
+	{
+		static ID3D11RenderTargetView *registeredViews[RENDER_TARGET_COUNT];
+		static bool aliasingApplied = false;
+
+		// Render targets are created by game code. Registrations follow whatever is in the table right now.
+		auto syncTargets = [this]()
+		{
+			for (uint32_t i = RENDER_TARGET_FRAMEBUFFER + 1; i < RENDER_TARGET_COUNT; i++)
+			{
+				auto target = &Data.pRenderTargets[i];
+
+				if (target->RTV == registeredViews[i])
+					continue;
+
+				registeredViews[i] = target->RTV;
+
+				if (!target->RTV)
+				{
+					D3D11Transient::UnregisterTarget(i);
+					continue;
+				}
+
+				auto properties = &gRenderTargetManager.pRenderTargetDataA[i];
+				const void *objects[] = { target->Texture, target->RTV, target->SRV, target->UAV };
+
+				// Mip level targets are views of another target's texture
+				uint64_t bytes = 0;
+
+				if (properties->iMipLevel == -1)
+					bytes = (uint64_t)properties->uiWidth * properties->uiHeight * GetFormatBitsPerPixel(properties->eFormat) / 8;
+
+				D3D11Transient::RegisterTarget(i, GetRenderTargetKey(properties), bytes, IsTransientCandidate(i, properties), objects, ARRAYSIZE(objects));
+			}
+		};
+
+		syncTargets();
+
+		if (aliasingApplied == ui::opt::AliasTransientTargets)
+			return;
+
+		// Recreating every planned target in index order converges on one texture per slot, and back to separate
+		// textures when aliasing is turned off
+		aliasingApplied = ui::opt::AliasTransientTargets;
+
+		for (uint32_t i = RENDER_TARGET_FRAMEBUFFER + 1; i < RENDER_TARGET_COUNT; i++)
+		{
+			auto properties = &gRenderTargetManager.pRenderTargetDataA[i];
+
+			if (!Data.pRenderTargets[i].RTV || !IsTransientCandidate(i, properties))
+				continue;
+
+			auto sharesTexture = [this, i]()
+			{
+				for (uint32_t j = RENDER_TARGET_FRAMEBUFFER + 1; j < RENDER_TARGET_COUNT; j++)
+				{
+					if (j != i && Data.pRenderTargets[j].Texture == Data.pRenderTargets[i].Texture)
+						return true;
+				}
+
+				return false;
+			};
+
+			// The plan may have been rebuilt since aliasing was applied, so shared textures are checked directly too
+			if (D3D11Transient::QAliasOf(i, GetRenderTargetKey(properties)) == i && !sharesTexture())
+				continue;
+
+			DestroyRenderTarget(i);
+			CreateRenderTarget(i, RenderTargetManager::GetRenderTargetName(i), properties);
+		}
+
+		syncTargets();
+	}
+
 	void Renderer::DestroyRenderTarget(uint32_t TargetIndex)
 	{
 		auto data = &Data.pRenderTargets[TargetIndex];
@@ -486,6 +649,22 @@ namespace BSGraphics
 		Data.pContext->DrawIndexed(Count * 3, StartIndex, 0);
 	}
 
+	void Renderer::DrawTriShapeInstanced(TriShape *GraphicsTriShape, uint32_t StartIndex, uint32_t Count, uint32_t InstanceCount)
+	{
+		SetVertexDescription(GraphicsTriShape->m_VertexDesc);
+		SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		SetDirtyStates(false);
+
+		uint32_t stride = BSGeometry::CalculateVertexSize(GraphicsTriShape->m_VertexDesc);
+		uint32_t offset = 0;
+
+		// Per-instance data comes from CONSTANT_GROUP_LEVEL_INSTANCE, not a second vertex stream
+		Data.pContext->IASetVertexBuffers(0, 1, &GraphicsTriShape->m_VertexBuffer, &stride, &offset);
+		Data.pContext->IASetIndexBuffer(GraphicsTriShape->m_IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+		Data.pContext->DrawIndexedInstanced(Count * 3, InstanceCount, StartIndex, 0, 0);
+	}
+
 	void Renderer::DrawDynamicTriShapeUnknown(DynamicTriShape *Shape, DynamicTriShapeDrawData *DrawData, uint32_t IndexStartOffset, uint32_t TriangleCount)
 	{
 		DynamicTriShapeData shapeData;
@@ -800,6 +979,21 @@ namespace BSGraphics
 		FlushD3DResources();
 	}
 
+	// Removes the lowest run of consecutive set bits from Bits. Returns false once Bits is empty.
+	bool NextBitRun(uint32_t& Bits, unsigned long *Start, unsigned long *Count)
+	{
+		if (!_BitScanForward(Start, Bits))
+			return false;
+
+		// None of the modified bit masks use bit 31, so there's always a zero bit ending the run
+		unsigned long end;
+		_BitScanForward(&end, ~(Bits >> *Start));
+
+		*Count = end;
+		Bits &= ~(((1u << end) - 1) << *Start);
+		return true;
+	}
+
 	void Renderer::FlushD3DResources()
 	{
 		auto state = Renderer::QInstance()->GetRendererShadowState();
@@ -809,17 +1003,25 @@ namespace BSGraphics
 		// Resource/state setting code. It's been modified to take 1 of 2 paths for each type:
 		//
 		// 1: modifiedBits == 0 { Do nothing }
-		// 2: modifiedBits > 0  { Build minimal state change [X entries] before submitting it to DX }
+		// 2: modifiedBits > 0  { Submit one call per run of consecutive modified slots }
+		//
+		// PSSSR(0, 1, [rsc1]) + PSSSR(1, 1, [rsc2]) becomes PSSSR(0, 2, [rsc1, rsc2]).
 		//
-#define for_each_bit(Iterator, Bits) for (unsigned long Iterator; _BitScanForward(&Iterator, Bits); Bits &= ~(1 << Iterator))
 
 		// Pixel shader samplers
 		if (uint32_t bits = state->m_PSSamplerModifiedBits; bits != 0)
 		{
 			AssertMsg((bits & 0xFFFF0000) == 0, "PSSamplerModifiedBits must not exceed 15th index");
 
-			for_each_bit(i, bits)
-				context->PSSetSamplers(i, 1, &Renderer::Globals.m_SamplerStates[state->m_PSTextureAddressMode[i]][state->m_PSTextureFilterMode[i]]);
+			ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+
+			for (unsigned long i, count; NextBitRun(bits, &i, &count);)
+			{
+				for (unsigned long j = i; j < i + count; j++)
+					samplers[j] = Renderer::Globals.m_SamplerStates[state->m_PSTextureAddressMode[j]][state->m_PSTextureFilterMode[j]];
+
+				context->PSSetSamplers(i, count, &samplers[i]);
+			}
 
 			state->m_PSSamplerModifiedBits = 0;
 		}
@@ -829,17 +1031,8 @@ namespace BSGraphics
 		{
 			AssertMsg((bits & 0xFFFF0000) == 0, "PSResourceModifiedBits must not exceed 15th index");
 
-			for_each_bit(i, bits)
-			{
-				// Combine PSSSR(0, 1, [rsc1]) + PSSSR(1, 1, [rsc2]) into PSSSR(0, 2, [rsc1, rsc2])
-				if (bits & (1 << (i + 1)))
-				{
-					context->PSSetShaderResources(i, 2, &state->m_PSTexture[i]);
-					bits &= ~(1 << (i + 1));
-				}
-				else
-					context->PSSetShaderResources(i, 1, &state->m_PSTexture[i]);
-			}
+			for (unsigned long i, count; NextBitRun(bits, &i, &count);)
+				context->PSSetShaderResources(i, count, &state->m_PSTexture[i]);
 
 			state->m_PSResourceModifiedBits = 0;
 		}
@@ -849,8 +1042,15 @@ namespace BSGraphics
 		{
 			AssertMsg((bits & 0xFFFF0000) == 0, "CSSamplerModifiedBits must not exceed 15th index");
 
-			for_each_bit(i, bits)
-				context->CSSetSamplers(i, 1, &Renderer::Globals.m_SamplerStates[state->m_CSTextureAddressMode[i]][state->m_CSTextureFilterMode[i]]);
+			ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+
+			for (unsigned long i, count; NextBitRun(bits, &i, &count);)
+			{
+				for (unsigned long j = i; j < i + count; j++)
+					samplers[j] = Renderer::Globals.m_SamplerStates[state->m_CSTextureAddressMode[j]][state->m_CSTextureFilterMode[j]];
+
+				context->CSSetSamplers(i, count, &samplers[i]);
+			}
 
 			state->m_CSSamplerModifiedBits = 0;
 		}
@@ -860,8 +1060,8 @@ namespace BSGraphics
 		{
 			AssertMsg((bits & 0xFFFF0000) == 0, "CSResourceModifiedBits must not exceed 15th index");
 
-			for_each_bit(i, bits)
-				context->CSSetShaderResources(i, 1, &state->m_CSTexture[i]);
+			for (unsigned long i, count; NextBitRun(bits, &i, &count);)
+				context->CSSetShaderResources(i, count, &state->m_CSTexture[i]);
 
 			state->m_CSResourceModifiedBits = 0;
 		}
@@ -871,17 +1071,19 @@ namespace BSGraphics
 		{
 			AssertMsg((bits & 0xFFFFFF00) == 0, "CSUAVModifiedBits must not exceed 7th index");
 
-			for_each_bit(i, bits)
-				context->CSSetUnorderedAccessViews(i, 1, &state->m_CSUAV[i], nullptr);
+			for (unsigned long i, count; NextBitRun(bits, &i, &count);)
+				context->CSSetUnorderedAccessViews(i, count, &state->m_CSUAV[i], nullptr);
 
 			state->m_CSUAVModifiedBits = 0;
 		}
-
-#undef for_each_bit
 	}
 
 	RendererShadowState *Renderer::GetRendererShadowState() const
 	{
+		// Threads recording a command list work on their own copy
+		if (auto state = DC_GetThreadShadowState())
+			return state;
+
 		return (RendererShadowState *)(g_ModuleBase + 0x304DEB0);
 	}
 
@@ -1222,43 +1424,94 @@ namespace BSGraphics
 		}
 	}
 
-	ComPtr<ID3DBlob> Renderer::CompileShader(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, const char *ProgramType)
+	ShaderCompileRequest Renderer::BuildShaderRequest(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, const char *ProgramType)
 	{
-		// Build defines (aka convert vector->D3DCONSTANT array)
-		std::vector<D3D_SHADER_MACRO> macros;
+		ShaderCompileRequest request;
+		request.SourcePath = FilePath;
+		request.EntryPoint = "main";
+		request.Target = ProgramType;
 
 		for (auto& i : Defines)
-			macros.push_back({ i.first, i.second });
+			request.Defines.emplace_back(i.first, i.second);
 
 		if (!_stricmp(ProgramType, "ps_5_0"))
-			macros.push_back({ "PIXELSHADER", "" });
+			request.Defines.emplace_back("PIXELSHADER", "");
 		else if (!_stricmp(ProgramType, "vs_5_0"))
-			macros.push_back({ "VERTEXSHADER", "" });
+			request.Defines.emplace_back("VERTEXSHADER", "");
 		else if (!_stricmp(ProgramType, "hs_5_0"))
-			macros.push_back({ "HULLSHADER", "" });
+			request.Defines.emplace_back("HULLSHADER", "");
 		else if (!_stricmp(ProgramType, "ds_5_0"))
-			macros.push_back({ "DOMAINSHADER", "" });
+			request.Defines.emplace_back("DOMAINSHADER", "");
 		else if (!_stricmp(ProgramType, "cs_5_0"))
-			macros.push_back({ "COMPUTESHADER", "" });
+			request.Defines.emplace_back("COMPUTESHADER", "");
 		else
 			Assert(false);
 
-		// Add null terminating entry
-		macros.push_back({ "WINPC", "" });
-		macros.push_back({ "DX11", "" });
-		macros.push_back({ nullptr, nullptr });
+		request.Defines.emplace_back("WINPC", "");
+		request.Defines.emplace_back("DX11", "");
 
 		// Compiler setup
-		uint32_t flags = D3DCOMPILE_DEBUG | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
-		ComPtr<ID3DBlob> shaderBlob;
-		ComPtr<ID3DBlob> shaderErrors;
+		request.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+		return request;
+	}
+
+	ShaderCache& Renderer::GetShaderCache()
+	{
+		static ShaderCache cache(SHADER_CACHE_PATH, [](const ShaderCompileRequest& Request, std::vector<uint8_t>& Bytecode, std::string& Errors)
+		{
+			// Build defines (aka convert vector->D3DCONSTANT array)
+			std::vector<D3D_SHADER_MACRO> macros;
+
+			for (auto& [name, value] : Request.Defines)
+				macros.push_back({ name.c_str(), value.c_str() });
+
+			// Add null terminating entry
+			macros.push_back({ nullptr, nullptr });
+
+			ComPtr<ID3DBlob> shaderBlob;
+			ComPtr<ID3DBlob> shaderErrors;
+
+			if (FAILED(D3DCompileFromFile(Request.SourcePath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, Request.EntryPoint.c_str(), Request.Target.c_str(), Request.Flags, 0, &shaderBlob, &shaderErrors)))
+			{
+				if (shaderErrors)
+					Errors.assign((const char *)shaderErrors->GetBufferPointer(), shaderErrors->GetBufferSize());
+
+				return false;
+			}
+
+			auto data = (const uint8_t *)shaderBlob->GetBufferPointer();
+			Bytecode.assign(data, data + shaderBlob->GetBufferSize());
+			return true;
+		});
 
-		if (FAILED(D3DCompileFromFile(FilePath, macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", ProgramType, flags, 0, &shaderBlob, &shaderErrors)))
+		return cache;
+	}
+
+	void Renderer::PrecompileShaders(const std::vector<ShaderCompileRequest>& Requests)
+	{
+		ProfileTimer("Shader Precompile Time");
+
+		GetShaderCache().Prefetch(Requests);
+	}
+
+	ComPtr<ID3DBlob> Renderer::CompileShader(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, const char *ProgramType)
+	{
+		std::string errors;
+		auto bytecode = GetShaderCache().Get(BuildShaderRequest(FilePath, Defines, ProgramType), &errors);
+
+		if (!bytecode)
 		{
-			AssertMsgVa(false, "Shader compilation failed:\n\n%s", shaderErrors ? (const char *)shaderErrors->GetBufferPointer() : "Unknown error");
+			AssertMsgVa(false, "Shader compilation failed:\n\n%s", errors.c_str());
 			return nullptr;
 		}
 
+		// Callers own a blob, the cache keeps its own copy
+		ComPtr<ID3DBlob> shaderBlob;
+
+		if (FAILED(D3DCreateBlob(bytecode->size(), &shaderBlob)))
+			return nullptr;
+
+		memcpy(shaderBlob->GetBufferPointer(), bytecode->data(), bytecode->size());
 		return shaderBlob;
 	}
 
@@ -1272,20 +1525,17 @@ namespace BSGraphics
 		void *rawPtr = malloc(sizeof(VertexShader) + shaderBlob->GetBufferSize());
 		VertexShader *vs = new (rawPtr) VertexShader;
 
-		// Shader reflection: gather constant buffer variable offsets
-		ComPtr<ID3D11ShaderReflection> reflector;
-		Assert(SUCCEEDED(D3DReflect(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), IID_PPV_ARGS(&reflector))));
-
-		ReflectConstantBuffers(reflector, vs->m_ConstantGroups, ARRAYSIZE(vs->m_ConstantGroups), GetConstant, vs->m_ConstantOffsets, ARRAYSIZE(vs->m_ConstantOffsets));
-
 		// Register shader with the DX runtime itself
 		Assert(SUCCEEDED(Data.pDevice->CreateVertexShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, &vs->m_Shader)));
+		RegisterShaderBytecode(vs->m_Shader, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+
+		// Shader reflection: gather constant buffer variable offsets
+		ReflectConstantBuffers(GetShaderReflection(vs->m_Shader), vs->m_ConstantGroups, ARRAYSIZE(vs->m_ConstantGroups), GetConstant, vs->m_ConstantOffsets, ARRAYSIZE(vs->m_ConstantOffsets));
 
 		// Final step: append raw bytecode to the end of the struct
 		memcpy(vs->m_RawBytecode, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
 		vs->m_ShaderLength = (uint32_t)shaderBlob->GetBufferSize();
 
-		RegisterShaderBytecode(vs->m_Shader, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
 		return vs;
 	}
 
@@ -1298,17 +1548,16 @@ namespace BSGraphics
 
 		PixelShader *ps = new PixelShader;
 
+		// Register shader with the DX runtime itself
+		Assert(SUCCEEDED(Data.pDevice->CreatePixelShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, &ps->m_Shader)));
+		RegisterShaderBytecode(ps->m_Shader, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+
 		// Shader reflection: gather constant buffer variable offsets and check for valid sampler mappings
-		ComPtr<ID3D11ShaderReflection> reflector;
-		Assert(SUCCEEDED(D3DReflect(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), IID_PPV_ARGS(&reflector))));
+		ID3D11ShaderReflection *reflector = GetShaderReflection(ps->m_Shader);
 
 		ReflectConstantBuffers(reflector, ps->m_ConstantGroups, ARRAYSIZE(ps->m_ConstantGroups), GetConstant, ps->m_ConstantOffsets, ARRAYSIZE(ps->m_ConstantOffsets));
 		ReflectSamplers(reflector, GetSampler);
 
-		// Register shader with the DX runtime itself
-		Assert(SUCCEEDED(Data.pDevice->CreatePixelShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, &ps->m_Shader)));
-
-		RegisterShaderBytecode(ps->m_Shader, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
 		return ps;
 	}
 
@@ -1447,20 +1696,26 @@ namespace BSGraphics
 
 	void Renderer::ValidateShaderReplacement(void *Original, void *Replacement, const GUID& Guid)
 	{
+		// First get the shader<->bytecode entry. Identical bytecode shares a blob, nothing to compare.
+		auto oldId = ShaderBytecodes.Find(Original);
+		auto newId = ShaderBytecodes.Find(Replacement);
+
+		if (oldId == newId)
+			return;
+
 #if 0
-		// First get the shader<->bytecode entry
-		const auto& oldData = m_ShaderBytecodeMap.find(Original);
-		const auto& newData = m_ShaderBytecodeMap.find(Replacement);
+		Assert(oldId != ShaderBytecodeRegistry::InvalidBlob && newId != ShaderBytecodeRegistry::InvalidBlob);
 
-		Assert(oldData != m_ShaderBytecodeMap.end() && newData != m_ShaderBytecodeMap.end());
+		auto oldData = ShaderBytecodes.GetBlob(oldId);
+		auto newData = ShaderBytecodes.GetBlob(newId);
 
 		// Disassemble both shaders, then compare the string output (case insensitive)
 		UINT stripFlags = D3DCOMPILER_STRIP_REFLECTION_DATA | D3DCOMPILER_STRIP_DEBUG_INFO | D3DCOMPILER_STRIP_TEST_BLOBS | D3DCOMPILER_STRIP_PRIVATE_DATA;
 		ComPtr<ID3DBlob> oldStrippedBlob;
 		ComPtr<ID3DBlob> newStrippedBlob;
 
-		Assert(SUCCEEDED(D3DStripShader(oldData->second.first, oldData->second.second, stripFlags, &oldStrippedBlob)));
-		Assert(SUCCEEDED(D3DStripShader(newData->second.first, newData->second.second, stripFlags, &newStrippedBlob)));
+		Assert(SUCCEEDED(D3DStripShader(oldData.Data, oldData.Length, stripFlags, &oldStrippedBlob)));
+		Assert(SUCCEEDED(D3DStripShader(newData.Data, newData.Length, stripFlags, &newStrippedBlob)));
 
 		UINT disasmFlags = D3D_DISASM_ENABLE_INSTRUCTION_OFFSET;
 		ComPtr<ID3DBlob> oldDataBlob;
@@ -1516,76 +1771,56 @@ namespace BSGraphics
 
 	void Renderer::RegisterShaderBytecode(void *Shader, const void *Bytecode, size_t BytecodeLength)
 	{
-		// Grab a copy since the pointer isn't going to be valid forever
-		auto codeCopy = std::make_unique<uint8_t[]>(BytecodeLength);
-		memcpy(codeCopy.get(), Bytecode, BytecodeLength);
-
-		ShaderBytecodeMap.emplace(Shader, std::make_pair(std::move(codeCopy), BytecodeLength));
+		// Grab a copy since the pointer isn't going to be valid forever. Duplicates are only stored once.
+		ShaderBytecodes.Register(Shader, Bytecode, BytecodeLength);
 	}
 
-	const std::pair<std::unique_ptr<uint8_t[]>, size_t>& Renderer::GetShaderBytecode(void *Shader)
+	ShaderBytecodeRegistry::Blob Renderer::GetShaderBytecode(void *Shader)
 	{
-		return ShaderBytecodeMap.at(Shader);
+		auto id = ShaderBytecodes.Find(Shader);
+		AssertMsg(id != ShaderBytecodeRegistry::InvalidBlob, "Shader was never registered");
+
+		return ShaderBytecodes.GetBlob(id);
 	}
 
-	void *Renderer::AllocateAndMapDynamicVertexBuffer(uint32_t Size, uint32_t *OutOffset)
+	ID3D11ShaderReflection *Renderer::GetShaderReflection(void *Shader)
 	{
-		AssertMsg(Size > 0, "Size must be > 0");
-
-		uint32_t frameDataOffset = Globals.m_CurrentDynamicVertexBufferOffset;
-		uint32_t frameBufferIndex = Globals.m_CurrentDynamicVertexBuffer;
-		uint32_t newFrameDataSzie = Globals.m_CurrentDynamicVertexBufferOffset + Size;
+		auto id = ShaderBytecodes.Find(Shader);
+		AssertMsg(id != ShaderBytecodeRegistry::InvalidBlob, "Shader was never registered");
 
-		//
-		// Check if this request would exceed the allocated buffer size for the currently executing command list. If it does,
-		// we end the current query and move on to the next buffer.
-		//
-		if (newFrameDataSzie > 0x400000)
-		{
-			AssertMsg(Size <= 0x400000, "Dynamic geometry buffer overflow.");
-
-			newFrameDataSzie = Size;
-			frameDataOffset = 0;
-
-			Globals.m_DynamicEventQueryFinished[Globals.m_CurrentDynamicVertexBuffer] = false;
-			Data.pContext->End(Globals.m_DynamicVertexBufferAvailQuery[Globals.m_CurrentDynamicVertexBuffer]);
-
-			frameBufferIndex++;
-
-			if (frameBufferIndex >= ARRAYSIZE(Globals.m_DynamicVertexBufferAvailQuery))
-				frameBufferIndex = 0;
-		}
+		return ShaderBytecodes.GetReflection(id);
+	}
 
-		//
-		// This will suspend execution until the buffer we want is no longer in use. The query waits on a list of commands
-		// using said buffer.
-		//
-		if (!Globals.m_DynamicEventQueryFinished[frameBufferIndex])
-		{
-			ID3D11Query *query = Globals.m_DynamicVertexBufferAvailQuery[frameBufferIndex];
-			BOOL data;
+	ShaderBytecodeRegistry::Stats Renderer::GetShaderBytecodeStats()
+	{
+		return ShaderBytecodes.GetStats();
+	}
 
-			HRESULT hr = Data.pContext->GetData(query, &data, sizeof(data), 0);
+	void *Renderer::AllocateAndMapDynamicVertexBuffer(uint32_t Size, uint32_t *OutOffset)
+	{
+		AssertMsg(Size > 0, "Size must be > 0");
 
-			for (; FAILED(hr) || data == FALSE; hr = Data.pContext->GetData(query, &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH))
-				Sleep(1);
+		auto context = DC_LockUploadContext(Data.pContext);
 
-			Globals.m_DynamicEventQueryFinished[frameBufferIndex] = (data == TRUE);
-		}
+		// The game's buffers and queries become the ring's initial set on first use
+		if (!DynamicVertexRing.IsInitialized())
+			DynamicVertexRing.Adopt(Data.pDevice, Globals.m_DynamicVertexBuffers, Globals.m_DynamicVertexBufferAvailQuery, ARRAYSIZE(Globals.m_DynamicVertexBuffers));
 
-		D3D11_MAPPED_SUBRESOURCE resource;
-		Data.pContext->Map(Globals.m_DynamicVertexBuffers[frameBufferIndex], 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &resource);
+		void *data = DynamicVertexRing.Allocate(context, Size, OutOffset);
+		D3D11Capture::RecordUpload(DynamicVertexRing.QCurrentBuffer(), Size);
 
-		Globals.m_CurrentDynamicVertexBuffer = frameBufferIndex;
-		Globals.m_CurrentDynamicVertexBufferOffset = newFrameDataSzie;
-		*OutOffset = frameDataOffset;
+		Globals.m_CurrentDynamicVertexBuffer = 0;
+		PublishDynamicVertexBuffer(Globals.m_DynamicVertexBuffers, DynamicVertexRing.QCurrentBuffer());
 
-		return (void *)((uintptr_t)resource.pData + frameDataOffset);
+		DC_UnlockUploadContext();
+		return data;
 	}
 
 	void BSGraphics::Renderer::UnmapDynamicVertexBuffer()
 	{
-		Data.pContext->Unmap(Globals.m_DynamicVertexBuffers[Globals.m_CurrentDynamicVertexBuffer], 0);
+		auto context = DC_LockUploadContext(Data.pContext);
+		DynamicVertexRing.Unmap(context);
+		DC_UnlockUploadContext();
 	}
 
 	void *Renderer::MapDynamicTriShapeDynamicData(BSDynamicTriShape *DynTriShape, DynamicTriShape *TriShape, DynamicTriShapeDrawData *DrawData, uint32_t VertexSize)
@@ -1603,13 +1838,14 @@ namespace BSGraphics
 
 	CustomConstantGroup Renderer::GetShaderConstantGroup(uint32_t Size, ConstantGroupLevel Level)
 	{
+		// Data is staged in CPU memory and only copied to the ring buffer in FlushConstantGroup()
 		CustomConstantGroup temp;
 		temp.m_Buffer = ShaderConstantBuffer->D3DBuffer;
-		temp.m_Map.pData = ShaderConstantBuffer->MapData(Data.pContext, Size, &temp.m_UnifiedByteOffset, false);
+		temp.m_Unified = true;
+		temp.m_Map.pData = ShaderConstantCache->BeginUpload(Size);
 		temp.m_Map.DepthPitch = Size;
 		temp.m_Map.RowPitch = Size;
 
-		memset(temp.m_Map.pData, 0, Size);
 		return temp;
 	}
 
@@ -1677,6 +1913,11 @@ namespace BSGraphics
 
 	void Renderer::FlushConstantGroup(CustomConstantGroup *Group)
 	{
+		if (Group->m_Unified)
+		{
+			Group->m_UnifiedByteOffset = ShaderConstantCache->EndUpload(Group->m_Map.pData, Group->m_Map.RowPitch);
+		}
+
 		// Invalidate the data pointer only - ApplyConstantGroup still needs RowPitch info
 		Group->m_Map.pData = (void *)0xFEFEFEFEFEFEFEFE;
 	}
@@ -1692,8 +1933,9 @@ namespace BSGraphics
 
 	void Renderer::ApplyConstantGroupVS(const CustomConstantGroup *Group, ConstantGroupLevel Level)
 	{
+		// Both must be multiples of 16 constants
 		uint32_t offset = Group->m_UnifiedByteOffset / 16;
-		uint32_t size = Group->m_Map.RowPitch / 16;
+		uint32_t size = ConstantBufferCache::AlignSize(Group->m_Map.RowPitch) / 16;
 
 		Data.pContext->VSSetConstantBuffers1(Level, 1, &Group->m_Buffer, &offset, &size);
 		Data.pContext->DSSetConstantBuffers1(Level, 1, &Group->m_Buffer, &offset, &size);
@@ -1701,8 +1943,9 @@ namespace BSGraphics
 
 	void Renderer::ApplyConstantGroupPS(const CustomConstantGroup *Group, ConstantGroupLevel Level)
 	{
+		// Both must be multiples of 16 constants
 		uint32_t offset = Group->m_UnifiedByteOffset / 16;
-		uint32_t size = Group->m_Map.RowPitch / 16;
+		uint32_t size = ConstantBufferCache::AlignSize(Group->m_Map.RowPitch) / 16;
 
 		Data.pContext->PSSetConstantBuffers1(Level, 1, &Group->m_Buffer, &offset, &size);
 	}
@@ -1716,6 +1959,12 @@ namespace BSGraphics
 			ApplyConstantGroupPS(PixelGroup, Level);
 	}
 
+	uint32_t Renderer::GetConstantGroupGeneration() const
+	{
+		// Flushed groups can be applied again until this changes (next frame)
+		return ShaderConstantCache->QGeneration();
+	}
+
 	void Renderer::IncRef(TriShape *Shape)
 	{
 		InterlockedIncrement(&Shape->m_RefCount);
@@ -8,6 +8,9 @@
 #include "BSGraphicsState.h"
 #include "BSGraphicsTypes.h"
 #include "../BSShader/BSShaderRenderTargets.h"
+#include "../../rendering/DynamicBufferRing.h"
+#include "../../rendering/ShaderCache.h"
+#include "../../rendering/ShaderBytecodeRegistry.h"
 
 namespace BSGraphics
 {
@@ -30,6 +33,8 @@ namespace BSGraphics
 		// is sufficient space. If there's no space left, delay execution until m_DynamicVertexBufferAvailQuery[] says a buffer
 		// is no longer in use.
 		//
+		// Ownership moves to DynamicBufferRing on the first allocation. Afterwards only slot 0 is valid.
+		//
 		ID3D11Buffer		*m_DynamicVertexBuffers[3];			// DYNAMIC (VERTEX | INDEX) CPU_ACCESS_WRITE
 		uint32_t			m_CurrentDynamicVertexBuffer;
 
@@ -209,11 +214,15 @@ namespace BSGraphics
 		void DestroyDepthStencil(uint32_t TargetIndex);
 		void DestroyCubemapRenderTarget(uint32_t TargetIndex);
 
+		// Once per frame. Tracks target (re)creation and applies or reverts transient target aliasing.
+		void UpdateTransientTargets();
+
 		//
 		// Drawing
 		//
 		void DrawLineShape(LineShape *GraphicsLineShape, uint32_t StartIndex, uint32_t Count);
 		void DrawTriShape(TriShape *GraphicsTriShape, uint32_t StartIndex, uint32_t Count);
+		void DrawTriShapeInstanced(TriShape *GraphicsTriShape, uint32_t StartIndex, uint32_t Count, uint32_t InstanceCount);
 		void DrawDynamicTriShapeUnknown(DynamicTriShape *Shape, DynamicTriShapeDrawData *DrawData, uint32_t IndexStartOffset, uint32_t TriangleCount);
 		void DrawDynamicTriShape(DynamicTriShapeData *ShapeData, DynamicTriShapeDrawData *DrawData, uint32_t IndexStartOffset, uint32_t TriangleCount, uint32_t VertexBufferOffset);
 		void DrawParticleShaderTriShape(const void *DynamicData, uint32_t Count);
@@ -274,6 +283,9 @@ namespace BSGraphics
 		//
 		// Shaders
 		//
+		static ShaderCompileRequest BuildShaderRequest(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, const char *ProgramType);
+		static ShaderCache& GetShaderCache();
+		void PrecompileShaders(const std::vector<ShaderCompileRequest>& Requests);
 		ComPtr<ID3DBlob> CompileShader(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, const char *ProgramType);
 		VertexShader *CompileVertexShader(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, std::function<const char *(int Index)> GetConstant);
 		PixelShader *CompilePixelShader(const wchar_t *FilePath, const std::vector<std::pair<const char *, const char *>>& Defines, std::function<const char *(int Index)> GetSampler, std::function<const char *(int Index)> GetConstant);
@@ -287,13 +299,18 @@ namespace BSGraphics
 		void ValidateShaderReplacement(ID3D11ComputeShader *Original, ID3D11ComputeShader *Replacement);
 		void ValidateShaderReplacement(void *Original, void *Replacement, const GUID& Guid);
 		void RegisterShaderBytecode(void *Shader, const void *Bytecode, size_t BytecodeLength);
-		const std::pair<std::unique_ptr<uint8_t[]>, size_t>& GetShaderBytecode(void *Shader);
+		ShaderBytecodeRegistry::Blob GetShaderBytecode(void *Shader);
+		ID3D11ShaderReflection *GetShaderReflection(void *Shader);
+		ShaderBytecodeRegistry::Stats GetShaderBytecodeStats();
 
 		//
 		// Buffers
 		//
 		void *AllocateAndMapDynamicVertexBuffer(uint32_t Size, uint32_t *OutOffset);
 		void UnmapDynamicVertexBuffer();
+		DynamicBufferRing::Stats GetDynamicVertexBufferStats() const;
+		void BeginDeferredDynamicUploads();		// Around DC_RecordAndExecute(), End after the command lists were executed
+		void EndDeferredDynamicUploads();
 		void *MapDynamicTriShapeDynamicData(BSDynamicTriShape *DynTriShape, DynamicTriShape *TriShape, DynamicTriShapeDrawData *DrawData, uint32_t VertexSize);
 		void UnmapDynamicTriShapeDynamicData(DynamicTriShape *TriShape, DynamicTriShapeDrawData *DrawData);
 
@@ -305,6 +322,7 @@ namespace BSGraphics
 		void ApplyConstantGroupVS(const CustomConstantGroup *Group, ConstantGroupLevel Level);
 		void ApplyConstantGroupPS(const CustomConstantGroup *Group, ConstantGroupLevel Level);
 		void ApplyConstantGroupVSPS(const VertexCGroup *VertexGroup, const PixelCGroup *PixelGroup, ConstantGroupLevel Level);
+		uint32_t GetConstantGroupGeneration() const;
 
 		void IncRef(TriShape *Shape);
 		void DecRef(TriShape *Shape);
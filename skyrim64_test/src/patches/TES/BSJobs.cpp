@@ -119,6 +119,8 @@ const std::unordered_map<uintptr_t, std::string> BSJobs::JobNameMap =
 };
 
 std::unordered_map<uintptr_t, BSJobs::TrackingInfo> BSJobs::JobTracker;
+std::array<BSJobs::WorkerInfo, 64> BSJobs::Workers;
+std::atomic_uint32_t BSJobs::WorkerCount;
 #if SKYRIM64_USE_TRACY
 std::unordered_map<uintptr_t, tracy::SourceLocationData> TracySourceMap;
 #endif
@@ -156,9 +158,70 @@ void BSJobs::DispatchJobCallback(void *Parameter, void(*Function)(void *))
 	counterEntry->second.TotalCount++;
 	counterEntry->second.ActiveCount++;
 
+	// Each engine worker thread claims a utilization slot the first time it runs a job
+	thread_local WorkerInfo *worker = []() -> WorkerInfo *
+	{
+		uint32_t index = WorkerCount++;
+
+		if (index >= Workers.size())
+			return nullptr;
+
+		Workers[index].ThreadId = GetCurrentThreadId();
+		return &Workers[index];
+	}();
+
+	uint64_t start = Timebase::ReadTicks();
+
+	{
 #if SKYRIM64_USE_TRACY
-	tracy::ScopedZone ___tracy_scoped_zone(&TracySourceMap[offset]);
+		tracy::ScopedZone ___tracy_scoped_zone(&TracySourceMap[offset]);
 #endif
+		ProfileScope(counterEntry->second.Name.c_str());
+
+		Function(Parameter);
+	}
+
+	if (worker)
+	{
+		worker->BusyTicks += Timebase::ReadTicks() - start;
+		worker->JobCount++;
+	}
+}
+
+void BSJobs::EndFrame()
+{
+	// Called once per Present() so the utilization numbers always cover exactly one frame
+	uint32_t workerCount = std::min<uint32_t>(WorkerCount.load(), (uint32_t)Workers.size());
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		Workers[i].LastBusyTicks.store(Workers[i].BusyTicks.exchange(0));
+		Workers[i].LastJobCount.store(Workers[i].JobCount.exchange(0));
+	}
+}
+
+bool BSJobs::IsSyncJob(JobScheduler::JobFunction Function)
+{
+	// Every "signal/sync" entry in JobNameMap
+	return (uintptr_t)Function - g_ModuleBase == 0x575100;
+}
+
+static void DispatchJobListEntry(void *Parameter)
+{
+	auto entry = (const JobScheduler::JobListEntry *)Parameter;
+	BSJobs::DispatchJobCallback(entry->Parameter, entry->Function);
+}
+
+void BSJobs::RunJobList(const JobScheduler::JobListEntry *Entries, uint32_t Count)
+{
+	static JobScheduler::Scheduler scheduler(std::max(std::thread::hardware_concurrency(), 1u));
+	static std::mutex runLock;
+
+	// Run() takes one graph at a time
+	std::lock_guard<std::mutex> lock(runLock);
+
+	JobScheduler::JobGraph graph;
+	graph.AddJobList(Entries, Count, IsSyncJob, DispatchJobListEntry);
 
-	Function(Parameter);
+	scheduler.Run(graph);
 }
\ No newline at end of file
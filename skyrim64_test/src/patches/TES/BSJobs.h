@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <unordered_map>
+#include "../jobscheduler.h"
 
 class BSJobs
 {
@@ -21,8 +23,25 @@ public:
 		}
 	};
 
+	struct WorkerInfo
+	{
+		uint32_t ThreadId;
+		std::atomic_uint64_t BusyTicks;		// Timebase ticks spent running jobs in the current frame
+		std::atomic_uint64_t JobCount;		// Jobs run in the current frame
+		std::atomic_uint64_t LastBusyTicks;	// Totals of the last completed frame, see EndFrame()
+		std::atomic_uint64_t LastJobCount;
+	};
+
 	const static std::unordered_map<uintptr_t, std::string> JobNameMap;
 	static std::unordered_map<uintptr_t, BSJobs::TrackingInfo> JobTracker;
+	static std::array<WorkerInfo, 64> Workers;
+	static std::atomic_uint32_t WorkerCount;
 
 	static void DispatchJobCallback(void *Parameter, void(*Function)(void *));
+	static void EndFrame();
+
+	// Runs a job list on the work-stealing scheduler instead of the engine's workers. Signal/sync entries wait for
+	// everything before them, and everything after waits for them. Every job still goes through DispatchJobCallback.
+	static bool IsSyncJob(JobScheduler::JobFunction Function);
+	static void RunJobList(const JobScheduler::JobListEntry *Entries, uint32_t Count);
 };
\ No newline at end of file
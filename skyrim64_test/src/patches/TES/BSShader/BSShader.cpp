@@ -1,6 +1,7 @@
 #include "../../../common.h"
 #include "../MemoryContextTracker.h"
 #include "../BSGraphics/BSGraphicsRenderer.h"
+#include "../../rendering/BonePaletteCache.h"
 #include "BSShaderManager.h"
 #include "BSShader.h"
 #include "BSShader_Dumper.h"
@@ -14,6 +15,22 @@
 std::unordered_map<uint32_t, BSGraphics::HullShader *> HullShaders;
 std::unordered_map<uint32_t, BSGraphics::DomainShader *> DomainShaders;
 
+// Bone palettes already uploaded this frame. Skinned shapes are drawn in the depth prepass, main pass and every shadow
+// cascade; only the first one builds and uploads the palette, the rest rebind the same ring offsets. See
+// BonePaletteCache for what the key covers.
+struct BonePaletteCacheEntry
+{
+	BSGraphics::CustomConstantGroup Bones;
+	BSGraphics::CustomConstantGroup PrevBones;
+};
+
+static_assert(sizeof(NiTransform) == sizeof(BonePaletteCache::PaletteKey::Transform));
+static_assert(sizeof(NiPoint3) == sizeof(BonePaletteCache::PaletteKey::PosAdjust));
+
+SRWLOCK BonePaletteLock = SRWLOCK_INIT;
+BonePaletteCache BonePaletteKeys(1024);
+BonePaletteCacheEntry BonePalettes[1024];
+
 bool BSShader::g_ShaderToggles[16][3];
 const ShaderDescriptor *BSShader::ShaderMetadata[BSShaderManager::BSSM_SHADER_COUNT];
 
@@ -66,6 +83,27 @@ void BSShader::SetBoneMatrix(NiSkinInstance *SkinInstance, NiSkinPartition::Part
 
 	GAME_TLS(NiSkinInstance *, 0x2A00) = SkinInstance;
 
+	auto *shadowState = renderer->GetRendererShadowState();
+	BonePaletteCache::PaletteKey key(SkinInstance, renderer->GetConstantGroupGeneration(), Transform, &shadowState->m_PosAdjust, &shadowState->m_PreviousPosAdjust);
+	uint32_t slot = 0;
+
+	if (ui::opt::CacheBonePalettes)
+	{
+		AcquireSRWLockShared(&BonePaletteLock);
+		bool hit = BonePaletteKeys.Lookup(key, slot);
+		BonePaletteCacheEntry cached = BonePalettes[slot];
+		ReleaseSRWLockShared(&BonePaletteLock);
+
+		if (hit)
+		{
+			ProfileCounterInc("Bone Palette Cache Hits");
+
+			renderer->ApplyConstantGroupVS(&cached.Bones, BSGraphics::CONSTANT_GROUP_LEVEL_BONES);
+			renderer->ApplyConstantGroupVS(&cached.PrevBones, BSGraphics::CONSTANT_GROUP_LEVEL_PREVIOUS_BONES);
+			return;
+		}
+	}
+
 	// WARNING: Contains a global variable edit
 	AutoFunc(void(__fastcall *)(NiSkinInstance *, const NiTransform *), sub_140D74600, 0x0D74600);
 	sub_140D74600(SkinInstance, Transform);
@@ -82,6 +120,15 @@ void BSShader::SetBoneMatrix(NiSkinInstance *SkinInstance, NiSkinPartition::Part
 	renderer->FlushConstantGroup(&prevBoneDataConstants);
 	renderer->ApplyConstantGroupVS(&boneDataConstants, BSGraphics::CONSTANT_GROUP_LEVEL_BONES);
 	renderer->ApplyConstantGroupVS(&prevBoneDataConstants, BSGraphics::CONSTANT_GROUP_LEVEL_PREVIOUS_BONES);
+
+	if (ui::opt::CacheBonePalettes)
+	{
+		AcquireSRWLockExclusive(&BonePaletteLock);
+		BonePaletteKeys.Store(slot, key);
+		BonePalettes[slot].Bones = boneDataConstants;
+		BonePalettes[slot].PrevBones = prevBoneDataConstants;
+		ReleaseSRWLockExclusive(&BonePaletteLock);
+	}
 }
 
 void BSShader::CreateVertexShader(uint32_t Technique, const char *SourceFile, const std::vector<std::pair<const char *, const char *>>& Defines, std::function<const char *(int Index)> GetConstant)
@@ -169,28 +216,73 @@ void BSShader::CreateDomainShader(uint32_t Technique, const char *SourceFile, co
 	DomainShaders[Technique] = domainShader;
 }
 
+BSGraphics::VertexShader *BSShader::CreateVertexShaderVariant(uint32_t Technique, const char *SourceFile, const std::vector<std::pair<const char *, const char *>>& Defines, std::function<const char *(int Index)> GetConstant)
+{
+	wchar_t fxpPath[MAX_PATH];
+	swprintf_s(fxpPath, L"C:\\SA\\ShaderSource\\%S.hlsl", SourceFile);
+
+	if (GetFileAttributesW(fxpPath) == INVALID_FILE_ATTRIBUTES)
+		return nullptr;
+
+	auto e = m_VertexShaderTable.find(Technique);
+
+	Assert(e != m_VertexShaderTable.end());
+
+	BSGraphics::VertexShader *vertexShader = BSGraphics::Renderer::QInstance()->CompileVertexShader(fxpPath, Defines, GetConstant);
+
+	if (!vertexShader)
+		return nullptr;
+
+	// Constant layout is shared with the original so the same constant groups can be used for both
+	memcpy(vertexShader->m_ConstantOffsets, e->m_ConstantOffsets, sizeof(e->m_ConstantOffsets));
+	memcpy(vertexShader->m_ConstantGroups, e->m_ConstantGroups, sizeof(e->m_ConstantGroups));
+
+	vertexShader->m_TechniqueID = e->m_TechniqueID;
+	vertexShader->m_VertexDescription = e->m_VertexDescription;
+	return vertexShader;
+}
+
+void BSShader::PrecompileShaders(const char *SourceFile, const std::vector<std::vector<std::pair<const char *, const char *>>>& DefineSets, const char *ProgramType)
+{
+	wchar_t fxpPath[MAX_PATH];
+	swprintf_s(fxpPath, L"C:\\SA\\ShaderSource\\%S.hlsl", SourceFile);
+
+	if (GetFileAttributesW(fxpPath) == INVALID_FILE_ATTRIBUTES)
+		return;
+
+	std::vector<ShaderCompileRequest> requests;
+
+	for (auto& defines : DefineSets)
+		requests.push_back(BSGraphics::Renderer::BuildShaderRequest(fxpPath, defines, ProgramType));
+
+	BSGraphics::Renderer::QInstance()->PrecompileShaders(requests);
+}
+
 void BSShader::hk_Load(BSIStream *Stream)
 {
+	// Reloads (console or the Creation Kit button) end up here again. Source files may have been edited since.
+	BSGraphics::Renderer::GetShaderCache().InvalidateSources();
+
 	// Load original shaders first
 	(this->*Load)(Stream);
 
-	// Dump everything for debugging
+	// Dump everything for debugging. Decoding and file writes happen in the background.
 	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
 	{
-		auto& bytecode = BSGraphics::Renderer::QInstance()->GetShaderBytecode(itr->m_Shader);
+		auto bytecode = BSGraphics::Renderer::QInstance()->GetShaderBytecode(itr->m_Shader);
 
-		VertexShaderDecoder d(m_LoaderType, *itr);
-		d.SetShaderData(bytecode.first.get(), bytecode.second);
-		d.DumpShader();
+		auto d = std::make_unique<VertexShaderDecoder>(m_LoaderType, *itr);
+		d->SetShaderData(bytecode.Data, bytecode.Length);
+		ShaderDumpQueue::Enqueue(std::move(d));
 	}
 
 	for (auto itr = m_PixelShaderTable.begin(); itr != m_PixelShaderTable.end(); itr++)
 	{
-		auto& bytecode = BSGraphics::Renderer::QInstance()->GetShaderBytecode(itr->m_Shader);
+		auto bytecode = BSGraphics::Renderer::QInstance()->GetShaderBytecode(itr->m_Shader);
 
-		PixelShaderDecoder d(m_LoaderType, *itr);
-		d.SetShaderData(bytecode.first.get(), bytecode.second);
-		d.DumpShader();
+		auto d = std::make_unique<PixelShaderDecoder>(m_LoaderType, *itr);
+		d->SetShaderData(bytecode.Data, bytecode.Length);
+		ShaderDumpQueue::Enqueue(std::move(d));
 	}
 
 	/*
@@ -210,6 +302,10 @@ void BSShader::hk_Load(BSIStream *Stream)
 	if (this == BSLightingShader::pInstance)
 		BSLightingShader::pInstance->CreateAllShaders();
 	*/
+
+	// Extra permutations used for geometry instancing. These don't replace anything.
+	if (this == BSLightingShader::pInstance)
+		BSLightingShader::pInstance->CreateInstancedShaders();
 }
 
 bool BSShader::BeginTechnique(uint32_t VertexShaderID, uint32_t PixelShaderID, bool IgnorePixelShader)
@@ -179,6 +179,16 @@ public:
 	void CreateHullShader(uint32_t Technique, const char *SourceFile, const std::vector<std::pair<const char *, const char *>>& Defines);
 	void CreateDomainShader(uint32_t Technique, const char *SourceFile, const std::vector<std::pair<const char *, const char *>>& Defines);
 
+	// Compiles an extra permutation of an existing technique without replacing it. Returns nullptr if there's no source file.
+	BSGraphics::VertexShader *CreateVertexShaderVariant(
+		uint32_t Technique,
+		const char *SourceFile,
+		const std::vector<std::pair<const char *, const char *>>& Defines,
+		std::function<const char *(int Index)> GetConstant);
+
+	// Compiles a batch of permutations in parallel ahead of the Create*Shader calls, which then hit the shader cache
+	void PrecompileShaders(const char *SourceFile, const std::vector<std::vector<std::pair<const char *, const char *>>>& DefineSets, const char *ProgramType);
+
 	void hk_Load(BSIStream *Stream);
 
 	bool BeginTechnique(uint32_t VertexShaderID, uint32_t PixelShaderID, bool IgnorePixelShader);
@@ -1,4 +1,7 @@
 #include "../../rendering/common.h"
+#include "../../rendering/d3d11_deferred.h"
+#include "../../rendering/d3d11_shadowcache.h"
+#include "../../rendering/OpaqueGroupPasses.h"
 #include "../../../common.h"
 #include "../BSGraphics/BSGraphicsRenderer.h"
 #include "../BSBatchRenderer.h"
@@ -6,10 +9,31 @@
 #include "BSShaderAccumulator.h"
 #include "../BSReadWriteLock.h"
 #include "../MOC.h"
+#include "../NiMain/NiCamera.h"
 
 AutoPtr(BSShaderAccumulator *, ZPrePassAccumulator, 0x3257A68);
 AutoPtr(BSShaderAccumulator *, MainPassAccumulator, 0x3257A70);
 
+BSShaderAccumulator::RegistrationStats FrameRegistrationStats;
+BSShaderAccumulator::RegistrationStats LastRegistrationStats;
+
+//
+// Caster signatures for the shadow cache, collected while shadow accumulators register objects. Registration can
+// happen on several threads, so entries are updated with atomics; the sums don't depend on order. Entries belong to
+// an accumulator for the rest of the session. An accumulator that doesn't get one is never cached, which keeps
+// signatures from ever being partial.
+//
+struct ShadowCasterAccumulation
+{
+	std::atomic<BSShaderAccumulator *> Owner;
+	std::atomic_uint64_t StaticHash;
+	std::atomic_uint32_t StaticCount;
+	std::atomic_uint32_t DynamicCount;
+};
+
+const uint32_t ShadowCasterAccumulationCount = 32;
+ShadowCasterAccumulation ShadowCasterAccumulations[ShadowCasterAccumulationCount];
+
 void BSShaderAccumulator::InitCallbackTable()
 {
 	// If the pointer is null, it defaults to the function at index 0
@@ -91,28 +115,138 @@ void BSShaderAccumulator::SetRenderMode(uint32_t RenderMode)
 		FinishAccumulatingCurrent = FinishAccumulatingArray[0];
 }
 
+//
+// Main pass registration stays serial. Only the visibility checks (QRegistrationProperty) are ours. The per-shader
+// registration functions, RegisterObject_Standard included, still jump into engine code. That code builds the passes
+// and links them straight into m_BatchRenderer, and it reads accumulator state that isn't mapped. Running the checks
+// on workers and registering the survivors later in the original order gives identical batch lists, but it saves at
+// most FilterTime, which costs more than the job overhead. Partitioning the pass building itself needs those functions
+// reversed first, so they can build into per-worker lists that are merged in object order.
+//
 bool BSShaderAccumulator::hk_RegisterObjectDispatch(BSGeometry *Geometry, void *Unknown)
+{
+	// Reading the timer costs about as much as the checks themselves, so registration is only timed while the numbers
+	// are shown
+	bool timed = ui::showFrameStatsWindow && this == MainPassAccumulator;
+
+	uint64_t start = timed ? Timebase::ReadTicks() : 0;
+	BSShaderProperty *shaderProperty = QRegistrationProperty(Geometry);
+	uint64_t filtered = timed ? Timebase::ReadTicks() : 0;
+
+	bool result = true;
+
+	if (shaderProperty)
+		result = RegisterFilteredObject(Geometry, shaderProperty, Unknown, m_RenderMode);
+
+	if (this == MainPassAccumulator)
+	{
+		FrameRegistrationStats.Objects++;
+		FrameRegistrationStats.Registered += shaderProperty ? 1 : 0;
+
+		if (timed)
+		{
+			uint64_t end = Timebase::ReadTicks();
+
+			FrameRegistrationStats.FilterTime += Timebase::TicksToMilliseconds(filtered - start);
+			FrameRegistrationStats.RegisterTime += Timebase::TicksToMilliseconds(end - filtered);
+		}
+	}
+
+	return result;
+}
+
+BSShaderProperty *BSShaderAccumulator::QRegistrationProperty(BSGeometry *Geometry)
 {
 	NiSkinInstance *skinInstance = Geometry->QSkinInstance();
 	BSShaderProperty *shaderProperty = Geometry->QShaderProperty();
 
 	if (!shaderProperty)
-		return true;
+		return nullptr;
 
 	// BSDismemberSkinInstance::bVisible
 	if (skinInstance && skinInstance->IsExactKindOf(NiRTTI::ms_BSDismemberSkinInstance) && !*(BYTE *)((__int64)skinInstance + 0x98))
-		return true;
+		return nullptr;
 
 	if (!Geometry->QRendererData() && !skinInstance && !Geometry->IsParticlesGeom() && Geometry->QType() != GEOMETRY_TYPE_PARTICLE_SHADER_DYNAMIC_TRISHAPE)
-		return true;
-	
-	bool result = RegisterObjectArray[m_RenderMode](this, Geometry, shaderProperty, Unknown);
+		return nullptr;
+
+	return shaderProperty;
+}
+
+ShadowCasterAccumulation *GetShadowCasterAccumulation(BSShaderAccumulator *Accumulator, bool Create)
+{
+	for (auto& entry : ShadowCasterAccumulations)
+	{
+		if (entry.Owner.load(std::memory_order_acquire) == Accumulator)
+			return &entry;
+	}
+
+	if (!Create)
+		return nullptr;
+
+	// Entries are never released, so two threads claiming for the same accumulator always meet at the same entry
+	for (auto& entry : ShadowCasterAccumulations)
+	{
+		BSShaderAccumulator *owner = nullptr;
+
+		if (entry.Owner.compare_exchange_strong(owner, Accumulator) || owner == Accumulator)
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+void AddShadowCaster(BSShaderAccumulator *Accumulator, BSGeometry *Geometry, BSShaderProperty *Property)
+{
+	auto entry = GetShadowCasterAccumulation(Accumulator, true);
+
+	if (!entry)
+		return;
+
+	if (BSBatchRenderer::IsDynamicCaster(Geometry, Property))
+	{
+		entry->DynamicCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	uint64_t hash = ShadowCache::HashBytes(&Geometry, sizeof(Geometry));
+	hash = ShadowCache::HashBytes(&Property, sizeof(Property), hash);
+	hash = ShadowCache::HashBytes(&Geometry->m_kWorld, sizeof(Geometry->m_kWorld), hash);
+	hash = ShadowCache::HashBytes(&Geometry->m_kWorldBound, sizeof(Geometry->m_kWorldBound), hash);
+
+	ShadowCasterSignature signature = {};
+	ShadowCache::AddStaticCaster(signature, hash);
+
+	entry->StaticHash.fetch_add(signature.StaticHash, std::memory_order_relaxed);
+	entry->StaticCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Returns false if the accumulator's casters weren't tracked. Resets the signature for the next accumulation.
+bool TakeShadowCasterSignature(BSShaderAccumulator *Accumulator, ShadowCasterSignature& Signature)
+{
+	auto entry = GetShadowCasterAccumulation(Accumulator, false);
+
+	if (!entry)
+		return false;
+
+	Signature.StaticHash = entry->StaticHash.exchange(0);
+	Signature.StaticCount = entry->StaticCount.exchange(0);
+	Signature.DynamicCount = entry->DynamicCount.exchange(0);
+	return true;
+}
+
+bool BSShaderAccumulator::RegisterFilteredObject(BSGeometry *Geometry, BSShaderProperty *Property, void *Unknown, uint32_t RenderMode)
+{
+	bool result = RegisterObjectArray[RenderMode](this, Geometry, Property, Unknown);
+
+	if (ui::opt::CacheStaticShadows && RegisterObjectArray[RenderMode] == RegisterObject_ShadowMapOrMask)
+		AddShadowCaster(this, Geometry, Property);
 
 	uint32_t v9 = *(uint32_t *)((__int64)this + 0x160);
 
 	if (v9 != 0)
 	{
-		__int64 v10 = (__int64)shaderProperty->pLightData;
+		__int64 v10 = (__int64)Property->pLightData;
 
 		if (v10)
 		{
@@ -126,8 +260,26 @@ bool BSShaderAccumulator::hk_RegisterObjectDispatch(BSGeometry *Geometry, void *
 	return result;
 }
 
+void BSShaderAccumulator::FinishMainPassRegistration()
+{
+	// Stats are per main pass, which runs once per frame. Finishing twice must not wipe them.
+	if (FrameRegistrationStats.Objects > 0)
+	{
+		LastRegistrationStats = FrameRegistrationStats;
+		FrameRegistrationStats = {};
+	}
+}
+
+BSShaderAccumulator::RegistrationStats BSShaderAccumulator::GetRegistrationStats()
+{
+	return LastRegistrationStats;
+}
+
 void BSShaderAccumulator::hk_FinishAccumulatingDispatch(uint32_t RenderFlags)
 {
+	if (this == MainPassAccumulator)
+		FinishMainPassRegistration();
+
 	SetRenderMode(m_RenderMode);
 
 	if (m_RenderMode != 0)
@@ -154,6 +306,111 @@ void ResetSceneDepthShift()
 	((void(__fastcall *)())(g_ModuleBase + 0x12F8C70))();
 }
 
+static_assert(OpaqueGroupPasses[0].EndTechnique == BSSM_DISTANTTREE_DEPTH);
+static_assert(OpaqueGroupPasses[1].EndTechnique == BSSM_BLOOD_SPLATTER);
+static_assert(OpaqueGroupPasses[2].StartTechnique == BSSM_GRASS_DIRONLY_LF);
+static_assert(OpaqueGroupNoDependency == DC_NO_DEPENDENCY);
+static_assert(OpaqueGroupPassCount <= DC_MAX_CONTEXTS);
+
+//
+// RenderBatches() keeps its iteration state (m_CurrentPass, m_CurrentBucket, m_CurrentActive) in the accumulator, and
+// shaders read everything else through BSShaderManager::GetCurrentAccumulator(), partly at offsets that haven't been
+// reversed. Every parallel pass therefore renders through a byte snapshot of the whole accumulator. A snapshot is
+// never constructed, destroyed or passed on after its task, and only the iteration state may change while recording:
+// anything else differing from the original afterwards is a pass writing shared state, which the serial path would
+// have seen but the other passes didn't.
+//
+struct alignas(alignof(BSShaderAccumulator)) AccumulatorSnapshot
+{
+	constexpr static size_t IterationStateStart = offsetof(BSShaderAccumulator, m_CurrentPass);
+	constexpr static size_t IterationStateEnd = offsetof(BSShaderAccumulator, m_CurrentActive) + sizeof(bool);
+
+	uint8_t Data[sizeof(BSShaderAccumulator)];
+
+	void Capture(const BSShaderAccumulator *Source)
+	{
+		memcpy(Data, Source, sizeof(Data));
+	}
+
+	BSShaderAccumulator *Get()
+	{
+		return reinterpret_cast<BSShaderAccumulator *>(Data);
+	}
+
+	bool OnlyIterationStateChanged(const BSShaderAccumulator *Source) const
+	{
+		auto source = reinterpret_cast<const uint8_t *>(Source);
+
+		return memcmp(Data, source, IterationStateStart) == 0 &&
+			memcmp(Data + IterationStateEnd, source + IterationStateEnd, sizeof(Data) - IterationStateEnd) == 0;
+	}
+
+	bool SameIterationState(const AccumulatorSnapshot& Other) const
+	{
+		return memcmp(Data + IterationStateStart, Other.Data + IterationStateStart, IterationStateEnd - IterationStateStart) == 0;
+	}
+
+	void ApplyIterationState(BSShaderAccumulator *Target) const
+	{
+		memcpy(reinterpret_cast<uint8_t *>(Target) + IterationStateStart, Data + IterationStateStart, IterationStateEnd - IterationStateStart);
+	}
+};
+
+static_assert(AccumulatorSnapshot::IterationStateStart == 0x138 && AccumulatorSnapshot::IterationStateEnd == 0x141);
+
+void RenderOpaqueGroupsDeferred(BSShaderAccumulator *Accumulator, uint32_t RenderFlags, bool DepthOnly, bool TestEqualDepth)
+{
+	auto renderer = BSGraphics::Renderer::QInstance();
+
+	AccumulatorSnapshot snapshots[OpaqueGroupPassCount];
+	DC_RecordTask tasks[OpaqueGroupPassCount];
+
+	for (uint32_t i = 0; i < OpaqueGroupPassCount; i++)
+	{
+		const OpaqueGroupPass& pass = OpaqueGroupPasses[i];
+		BSShaderAccumulator *accumulator = snapshots[i].Get();
+
+		snapshots[i].Capture(Accumulator);
+
+		tasks[i].Name = pass.Name;
+		tasks[i].DependsOn = pass.DependsOn;
+		tasks[i].Callback = [accumulator, &pass, RenderFlags]()
+		{
+			accumulator->RenderGeometryGroup(pass.StartTechnique, pass.EndTechnique, RenderFlags, pass.GeometryGroup);
+		};
+	}
+
+	// Serially RenderLODLand runs after RenderLODObjects switched the depth mode. The last task's state is what the
+	// immediate context continues with.
+	if (TestEqualDepth)
+	{
+		tasks[OpaqueGroupPassCount - 1].Callback = [renderer, next = std::move(tasks[OpaqueGroupPassCount - 1].Callback)]()
+		{
+			renderer->DepthStencilStateSetDepthMode(BSGraphics::DEPTH_STENCIL_DEPTH_MODE_TEST_WRITE);
+			next();
+		};
+	}
+
+	DC_RecordAndExecute(tasks, OpaqueGroupPassCount);
+	BSShaderManager::SetCurrentAccumulator(Accumulator);
+
+	// Leave the iteration state where the serial path would: as written by the last pass that went through RenderBatches
+	AccumulatorSnapshot initial;
+	initial.Capture(Accumulator);
+
+	for (auto& snapshot : snapshots)
+	{
+		AssertMsg(snapshot.OnlyIterationStateChanged(Accumulator), "A parallel pass changed accumulator state outside of the RenderBatches iteration state");
+
+		if (!snapshot.SameIterationState(initial))
+			snapshot.ApplyIterationState(Accumulator);
+	}
+
+	// Touches globals shared by all tasks, so it can only run once recording is done
+	if (!DepthOnly)
+		ResetSceneDepthShift();
+}
+
 bool BSShaderAccumulator::RegisterObject_Standard(BSShaderAccumulator *Accumulator, BSGeometry *Geometry, BSShaderProperty *Property, void *Unknown)
 {
 	return ((REGISTEROBJECTFUNC)(g_ModuleBase + 0x12E0F90))(Accumulator, Geometry, Property, Unknown);
@@ -183,6 +440,10 @@ void BSShaderAccumulator::FinishAccumulating_Standard_PreResolveDepth(BSShaderAc
 		MOC::Init();
 	}
 
+	// The main pass is also finished through here without going through the dispatcher
+	if (Accumulator == MainPassAccumulator)
+		FinishMainPassRegistration();
+
 	if (!Accumulator->m_pkCamera)
 		return;
 
@@ -224,6 +485,15 @@ void BSShaderAccumulator::FinishAccumulating_Standard_PreResolveDepth(BSShaderAc
 	// BlendedDecals
 	// RenderWaterStencil
 	//
+	if (ui::opt::ParallelCommandRecording && Accumulator == MainPassAccumulator && DC_Available(OpaqueGroupPassCount))
+	{
+		ProfileTimer("RenderBatches");
+
+		renderer->BeginEvent(L"RenderBatches (Deferred)");
+		RenderOpaqueGroupsDeferred(Accumulator, RenderFlags, v7, *(BYTE *)(a1 + 92) && !BSGraphics::gState.bUseEarlyZ);
+		renderer->EndEvent();
+	}
+	else
 	{
 		ProfileTimer("RenderBatches");
 
@@ -390,8 +660,68 @@ void BSShaderAccumulator::FinishAccumulating_Standard_PostResolveDepth(BSShaderA
 	((FINISHACCUMULATINGFUNC)(g_ModuleBase + 0x12E1F70))(Accumulator, RenderFlags);
 }
 
+//
+// Shadow maps are cached per camera and depth stencil slice. Anything that changes the projection (camera transform,
+// frustum, viewport, render flags) ends up in the light hash; the casters themselves are covered by the signature.
+// Returns Render when the current target can't be cached.
+//
+ShadowCache::Action BeginCachedShadowMap(BSShaderAccumulator *Accumulator, uint32_t RenderFlags, const ShadowCasterSignature& Casters, uint32_t& Slot)
+{
+	auto renderer = BSGraphics::Renderer::QInstance();
+	auto state = renderer->GetRendererShadowState();
+
+	if (state->m_DepthStencil == -1)
+		return ShadowCache::Action::Render;
+
+	// A restored snapshot replaces the whole slice, which is only the same as drawing into it after a clear
+	switch (state->m_SetDepthStencilMode)
+	{
+	case BSGraphics::SRTM_CLEAR:
+	case BSGraphics::SRTM_CLEAR_DEPTH:
+	case BSGraphics::SRTM_INIT:
+		break;
+
+	default:
+		return ShadowCache::Action::Render;
+	}
+
+	ID3D11Texture2D *target = renderer->Data.pDepthStencils[state->m_DepthStencil].Texture;
+
+	if (!D3D11ShadowCache::IsEligible(target, state->m_ViewPort))
+		return ShadowCache::Action::Render;
+
+	const NiCamera *camera = Accumulator->m_pkCamera;
+
+	uint64_t key = ShadowCache::HashBytes(&camera, sizeof(camera));
+	key = ShadowCache::HashBytes(&state->m_DepthStencil, sizeof(state->m_DepthStencil), key);
+	key = ShadowCache::HashBytes(&state->m_DepthStencilSlice, sizeof(state->m_DepthStencilSlice), key);
+
+	uint64_t lightHash = ShadowCache::HashBytes(camera->m_aafWorldToCam, sizeof(camera->m_aafWorldToCam));
+	lightHash = ShadowCache::HashBytes(&camera->m_kViewFrustum, sizeof(camera->m_kViewFrustum), lightHash);
+	lightHash = ShadowCache::HashBytes(&camera->m_kPort, sizeof(camera->m_kPort), lightHash);
+	lightHash = ShadowCache::HashBytes(&state->m_ViewPort, sizeof(state->m_ViewPort), lightHash);
+	lightHash = ShadowCache::HashBytes(&RenderFlags, sizeof(RenderFlags), lightHash);
+
+	ShadowCache::Decision decision = D3D11ShadowCache::Begin(key, lightHash, Casters);
+	Slot = decision.Slot;
+
+	if (decision.Type == ShadowCache::Action::Reuse)
+	{
+		// Flush the pending clear first, it would wipe the snapshot otherwise
+		BSGraphics::Renderer::SetDirtyStates(false);
+
+		if (!D3D11ShadowCache::Restore(Slot, renderer->Data.pContext, target, state->m_DepthStencilSlice))
+			return ShadowCache::Action::Render;
+	}
+
+	return decision.Type;
+}
+
 void BSShaderAccumulator::FinishAccumulating_ShadowMapOrMask(BSShaderAccumulator *Accumulator, uint32_t RenderFlags)
 {
+	ShadowCasterSignature casters = {};
+	bool castersTracked = TakeShadowCasterSignature(Accumulator, casters);
+
 	if (!Accumulator->m_pkCamera)
 		return;
 
@@ -413,6 +743,17 @@ void BSShaderAccumulator::FinishAccumulating_ShadowMapOrMask(BSShaderAccumulator
 	}
 	else
 	{
+		auto action = ShadowCache::Action::Render;
+		uint32_t slot = ShadowCache::InvalidSlot;
+
+		if (ui::opt::CacheStaticShadows && castersTracked)
+			action = BeginCachedShadowMap(Accumulator, RenderFlags, casters, slot);
+
+		if (action == ShadowCache::Action::Reuse)
+			BSBatchRenderer::SetCasterFilter(BSBatchRenderer::CASTER_FILTER_SKIP_STATIC);
+		else if (action == ShadowCache::Action::Rebuild)
+			BSBatchRenderer::SetCasterFilter(BSBatchRenderer::CASTER_FILTER_DEFER_DYNAMIC);
+
 		BSGraphics::BeginEvent(L"RenderBatches");
 		Accumulator->RenderGeometryGroup(0x2B, 0x4000002B, RenderFlags, -1);
 		Accumulator->RenderGeometryGroup(BSSM_GRASS_DIRONLY_LF, 0x5C00005C, RenderFlags, -1);
@@ -423,6 +764,22 @@ void BSShaderAccumulator::FinishAccumulating_ShadowMapOrMask(BSShaderAccumulator
 		Accumulator->RenderGeometryGroup(1, BSSM_BLOOD_SPLATTER, RenderFlags, 9);
 		BSGraphics::EndEvent();
 
+		BSBatchRenderer::SetCasterFilter(BSBatchRenderer::CASTER_FILTER_NONE);
+
+		if (action == ShadowCache::Action::Rebuild)
+		{
+			// Only static casters are in the depth map at this point
+			auto renderer = BSGraphics::Renderer::QInstance();
+			auto state = renderer->GetRendererShadowState();
+
+			BSGraphics::Renderer::SetDirtyStates(false);
+			D3D11ShadowCache::Store(slot, renderer->Data.pContext, renderer->Data.pDepthStencils[state->m_DepthStencil].Texture, state->m_DepthStencilSlice);
+
+			BSGraphics::BeginEvent(L"DynamicCasters");
+			BSBatchRenderer::RenderDeferredCasters();
+			BSGraphics::EndEvent();
+		}
+
 		BSGraphics::BeginEvent(L"Decals");
 		((void(__fastcall *)(BSShaderAccumulator *, uint32_t))(g_ModuleBase + 0x12E2950))(Accumulator, RenderFlags);
 		BSGraphics::EndEvent();
@@ -559,5 +916,7 @@ void BSShaderAccumulator::RenderBatches(uint32_t StartTechnique, uint32_t EndTec
 	if (group)
 		group->ClearAndFreePasses();
 
+	// Nodes released one at a time by sub_14131E7B0 would otherwise sit in this thread's cache until the next batch
+	BSBatchRenderer::FlushFreedPassIndexNodes();
 	BSBatchRenderer::EndPass();
 }
\ No newline at end of file
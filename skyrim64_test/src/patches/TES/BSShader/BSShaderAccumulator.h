@@ -62,6 +62,14 @@ public:
 	typedef bool(*REGISTEROBJECTFUNC)(BSShaderAccumulator *Accumulator, BSGeometry *Geometry, BSShaderProperty *Property, void *Unknown);
 	typedef void(*FINISHACCUMULATINGFUNC)(BSShaderAccumulator *Accumulator, uint32_t Flags);
 
+	struct RegistrationStats
+	{
+		uint32_t Objects;		// Dispatched to the main pass accumulator
+		uint32_t Registered;	// Objects that passed the visibility checks
+		double FilterTime;		// Milliseconds spent in the visibility checks, only while Frame Statistics is open
+		double RegisterTime;	// Milliseconds spent in the per-shader registration functions, same
+	};
+
 	virtual ~BSShaderAccumulator();
 	virtual void StartAccumulating(NiCamera const *) override;
 	virtual void FinishAccumulatingDispatch(uint32_t RenderFlags);
@@ -96,6 +104,11 @@ public:
 	bool hk_RegisterObjectDispatch(BSGeometry *Geometry, void *Unknown);
 	void hk_FinishAccumulatingDispatch(uint32_t RenderFlags);
 
+	static BSShaderProperty *QRegistrationProperty(BSGeometry *Geometry);
+	bool RegisterFilteredObject(BSGeometry *Geometry, BSShaderProperty *Property, void *Unknown, uint32_t RenderMode);
+	static void FinishMainPassRegistration();
+	static RegistrationStats GetRegistrationStats();
+
 	static bool IsGrassShadowBlacklist(uint32_t Technique);
 
 	static bool RegisterObject_Standard(BSShaderAccumulator *Accumulator, BSGeometry *Geometry, BSShaderProperty *Property, void *Unknown);
@@ -1,18 +1,51 @@
 #include <direct.h>
+#include <stdarg.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "../../../common.h"
 #include "BSShaderManager.h"
 #include "BSShader_Dumper.h"
 #include "BSShader.h"
 
 #define SHADER_DUMP_PATH "C:\\SA\\ShaderDump"
+#define SHADER_DUMP_THREADS 2
 
-ShaderDecoder::ShaderDecoder(const char *Type, BSSM_SHADER_TYPE CodeType)
+static void AppendFormat(std::string& Out, const char *Format, ...)
+{
+	char buffer[1024];
+
+	va_list va;
+	va_start(va, Format);
+	int len = _vsnprintf_s(buffer, _TRUNCATE, Format, va);
+	va_end(va);
+
+	if (len > 0)
+		Out.append(buffer, len);
+}
+
+ShaderDecoder::ShaderDecoder(const char *Type, BSSM_SHADER_TYPE CodeType, uint32_t TechniqueID, const BSGraphics::Buffer *ConstantGroups)
 {
 	m_HlslData = nullptr;
 	m_HlslDataLen = 0;
 	m_Type = BSShaderManager::BSSM_SHADER_INVALID;
 	strcpy_s(m_LoaderType, Type);
 	m_CodeType = CodeType;
+	m_TechniqueID = TechniqueID;
+
+	// NOTE: Some buffers might be undefined (= unused in shader) but offsets are still valid
+	for (int i = 0; i < ARRAYSIZE(m_BufferSizes); i++)
+	{
+		m_BufferSizes[i] = 0;
+
+		if (ConstantGroups[i].m_Buffer)
+		{
+			D3D11_BUFFER_DESC desc;
+			ConstantGroups[i].m_Buffer->GetDesc(&desc);
+
+			m_BufferSizes[i] = desc.ByteWidth;
+		}
+	}
 
 	// Convert string to enum
 	if (!_stricmp(m_LoaderType, "RunGrass"))
@@ -35,28 +68,16 @@ ShaderDecoder::ShaderDecoder(const char *Type, BSSM_SHADER_TYPE CodeType)
 		m_Type = BSShaderManager::BSSM_SHADER_DISTANTTREE;
 	else if (!_stricmp(m_LoaderType, "Particle"))
 		m_Type = BSShaderManager::BSSM_SHADER_PARTICLE;
-
-	// Guarantee that the sub-folder exists
-	if (m_Type != BSShaderManager::BSSM_SHADER_INVALID)
-	{
-		char buf[1024];
-		sprintf_s(buf, "%s\\%s\\", SHADER_DUMP_PATH, m_LoaderType);
-
-		_mkdir(buf);
-	}
 }
 
 ShaderDecoder::~ShaderDecoder()
 {
-	delete[] m_HlslData;
 }
 
-void ShaderDecoder::SetShaderData(void *Buffer, size_t BufferSize)
+void ShaderDecoder::SetShaderData(const void *Buffer, size_t BufferSize)
 {
-	m_HlslData = new uint8_t[BufferSize];
+	m_HlslData = (const uint8_t *)Buffer;
 	m_HlslDataLen = BufferSize;
-
-	memcpy(m_HlslData, Buffer, BufferSize);
 }
 
 void ShaderDecoder::DumpShader()
@@ -64,6 +85,12 @@ void ShaderDecoder::DumpShader()
 	if (m_Type == BSShaderManager::BSSM_SHADER_INVALID)
 		return;
 
+	// Guarantee that the sub-folder exists
+	char buf[1024];
+	sprintf_s(buf, "%s\\%s\\", SHADER_DUMP_PATH, m_LoaderType);
+
+	_mkdir(buf);
+
 	// Build a list of all constants used
 	std::vector<ParamIndexPair> tecIndexes;
 	std::vector<ParamIndexPair> matIndexes;
@@ -96,7 +123,7 @@ void ShaderDecoder::DumpShader()
 	}
 
 	// Technique name string (delimited by underscores)
-	std::string techName = BSShader::GetAnyTechniqueName(m_Type, GetTechnique());
+	std::string techName = BSShader::GetAnyTechniqueName(m_Type, m_TechniqueID);
 
 	for (int i = 0;; i++)
 	{
@@ -110,18 +137,12 @@ void ShaderDecoder::DumpShader()
 	DumpShaderSpecific(techName.c_str(), geoIndexes, matIndexes, tecIndexes, undefinedIndexes);
 }
 
-void ShaderDecoder::DumpCBuffer(FILE *File, BSGraphics::Buffer *Buffer, std::vector<ParamIndexPair> Params, int GroupIndex)
+void ShaderDecoder::DumpCBuffer(std::string& Out, std::vector<ParamIndexPair> Params, int GroupIndex)
 {
-	// NOTE: Some buffers might be undefined (= unused in shader) but offsets are still valid
-	if (Buffer->m_Buffer)
-	{
-		D3D11_BUFFER_DESC desc;
-		Buffer->m_Buffer->GetDesc(&desc);
-
-		fprintf(File, "// Dynamic buffer: sizeof() = %d (0x%X)\n", desc.ByteWidth, desc.ByteWidth);
-	}
+	if (uint32_t size = m_BufferSizes[GroupIndex]; size != 0)
+		AppendFormat(Out, "// Dynamic buffer: sizeof() = %d (0x%X)\n", size, size);
 
-	fprintf(File, "cbuffer %s : register(%s)\n{\n", GetGroupName(GroupIndex), GetGroupRegister(GroupIndex));
+	AppendFormat(Out, "cbuffer %s : register(%s)\n{\n", GetGroupName(GroupIndex), GetGroupRegister(GroupIndex));
 
 	// Sort each variable by offset
 	std::sort(Params.begin(), Params.end(),
@@ -167,22 +188,33 @@ void ShaderDecoder::DumpCBuffer(FILE *File, BSGraphics::Buffer *Buffer, std::vec
 		default:__debugbreak(); break;
 		}
 
-		fprintf(File, "\t%s", varName);
+		AppendFormat(Out, "\t%s", varName);
 
 		// Add space alignment
-		for (int64_t i = 45 - std::max<int64_t>(0, strlen(varName)); i > 0; i--)
-			fprintf(File, " ");
+		Out.append((size_t)std::max<int64_t>(0, 45 - (int64_t)strlen(varName)), ' ');
 
-		fprintf(File, ": %s;", packOffset);
+		AppendFormat(Out, ": %s;", packOffset);
 
 		// Add space alignment
-		for (int64_t i = 20 - std::max<int64_t>(0, strlen(packOffset)); i > 0; i--)
-			fprintf(File, " ");
+		Out.append((size_t)std::max<int64_t>(0, 20 - (int64_t)strlen(packOffset)), ' ');
 
-		fprintf(File, "// @ %d - 0x%04X\n", cbOffset, cbOffset * 4);
+		AppendFormat(Out, "// @ %d - 0x%04X\n", cbOffset, cbOffset * 4);
 	}
 
-	fprintf(File, "}\n\n");
+	Out.append("}\n\n");
+}
+
+void ShaderDecoder::WriteOutput(const char *TechName, const char *Extension, const void *Data, size_t Length, bool Text)
+{
+	// Output is built in memory first, one write per file instead of hundreds of small ones
+	char buf[1024];
+	sprintf_s(buf, "%s\\%s\\%s_%s_%X.%s", SHADER_DUMP_PATH, m_LoaderType, m_LoaderType, TechName, m_TechniqueID, Extension);
+
+	if (FILE *file; fopen_s(&file, buf, Text ? "w" : "wb") == 0)
+	{
+		fwrite(Data, 1, Length, file);
+		fclose(file);
+	}
 }
 
 const char *ShaderDecoder::GetGroupName(int Index)
@@ -294,147 +326,165 @@ const char *ShaderDecoder::GetVariableType(int Index)
 //
 // VertexShaderDecoder
 //
-VertexShaderDecoder::VertexShaderDecoder(const char *Type, BSGraphics::VertexShader *Shader) : ShaderDecoder(Type, BSSM_SHADER_TYPE::VERTEX)
-{
-	m_Shader = Shader;
-}
-
-uint32_t VertexShaderDecoder::GetTechnique()
+VertexShaderDecoder::VertexShaderDecoder(const char *Type, const BSGraphics::VertexShader *Shader) : ShaderDecoder(Type, BSSM_SHADER_TYPE::VERTEX, Shader->m_TechniqueID, Shader->m_ConstantGroups)
 {
-	return m_Shader->m_TechniqueID;
+	m_VertexDescription = Shader->m_VertexDescription;
+	memcpy(m_ConstantOffsets, Shader->m_ConstantOffsets, sizeof(m_ConstantOffsets));
 }
 
 const uint8_t *VertexShaderDecoder::GetConstantArray()
 {
-	return m_Shader->m_ConstantOffsets;
+	return m_ConstantOffsets;
 }
 
 size_t VertexShaderDecoder::GetConstantArraySize()
 {
-	return ARRAYSIZE(BSGraphics::VertexShader::m_ConstantOffsets);
+	return ARRAYSIZE(m_ConstantOffsets);
 }
 
 void VertexShaderDecoder::DumpShaderSpecific(const char *TechName, std::vector<ParamIndexPair>& PerGeo, std::vector<ParamIndexPair>& PerMat, std::vector<ParamIndexPair>& PerTec, std::vector<ParamIndexPair>& Undefined)
 {
-	char buf[1024];
-	sprintf_s(buf, "%s\\%s\\%s_%s_%X.vs.txt", SHADER_DUMP_PATH, m_LoaderType, m_LoaderType, TechName, m_Shader->m_TechniqueID);
+	std::string out;
+	out.reserve(8192);
 
-	if (FILE *file; fopen_s(&file, buf, "w") == 0)
-	{
-		fprintf(file, "// %s\n", m_LoaderType);
-		fprintf(file, "// TechniqueID: 0x%X\n", m_Shader->m_TechniqueID);
-		fprintf(file, "// Vertex description: 0x%llX\n//\n", m_Shader->m_VertexDescription);
-		fprintf(file, "// Technique: %s\n\n", TechName);
+	AppendFormat(out, "// %s\n", m_LoaderType);
+	AppendFormat(out, "// TechniqueID: 0x%X\n", m_TechniqueID);
+	AppendFormat(out, "// Vertex description: 0x%llX\n//\n", m_VertexDescription);
+	AppendFormat(out, "// Technique: %s\n\n", TechName);
 
-		// Defines
-		if (auto defs = BSShader::GetAnySourceDefines(m_Type, m_Shader->m_TechniqueID); defs.size() > 0)
-		{
-			for (const auto& define : defs)
-				fprintf(file, "#define %s %s\n", define.first, define.second);
+	// Defines
+	if (auto defs = BSShader::GetAnySourceDefines(m_Type, m_TechniqueID); defs.size() > 0)
+	{
+		for (const auto& define : defs)
+			AppendFormat(out, "#define %s %s\n", define.first, define.second);
 
-			fprintf(file, "\n");
-		}
+		out.append("\n");
+	}
 
-		DumpCBuffer(file, &m_Shader->m_PerTechnique, PerTec, 0);// Constant buffer 0 : register(b0)
-		DumpCBuffer(file, &m_Shader->m_PerMaterial, PerMat, 1); // Constant buffer 1 : register(b1)
-		DumpCBuffer(file, &m_Shader->m_PerGeometry, PerGeo, 2); // Constant buffer 2 : register(b2)
+	DumpCBuffer(out, PerTec, 0);// Constant buffer 0 : register(b0)
+	DumpCBuffer(out, PerMat, 1);// Constant buffer 1 : register(b1)
+	DumpCBuffer(out, PerGeo, 2);// Constant buffer 2 : register(b2)
 
-		// Dump undefined variables
-		for (auto& entry : Undefined)
-			fprintf(file, "// UNDEFINED PARAMETER: Index: %02d Offset: 0x%04X Name: %s\n", entry.Index, m_Shader->m_ConstantOffsets[entry.Index] * 4, entry.Name);
+	// Dump undefined variables
+	for (auto& entry : Undefined)
+		AppendFormat(out, "// UNDEFINED PARAMETER: Index: %02d Offset: 0x%04X Name: %s\n", entry.Index, m_ConstantOffsets[entry.Index] * 4, entry.Name);
 
-		fclose(file);
-	}
+	WriteOutput(TechName, "vs.txt", out.data(), out.size(), true);
 
 	// Now write raw HLSL
 	if (m_HlslData)
-	{
-		sprintf_s(buf, "%s\\%s\\%s_%s_%X.vs.bin", SHADER_DUMP_PATH, m_LoaderType, m_LoaderType, TechName, m_Shader->m_TechniqueID);
-
-		if (FILE *file; fopen_s(&file, buf, "wb") == 0)
-		{
-			fwrite(m_HlslData, 1, m_HlslDataLen, file);
-			fclose(file);
-		}
-	}
+		WriteOutput(TechName, "vs.bin", m_HlslData, m_HlslDataLen, false);
 }
 
 //
 // PixelShaderDecoder
 //
-PixelShaderDecoder::PixelShaderDecoder(const char *Type, BSGraphics::PixelShader *Shader) : ShaderDecoder(Type, BSSM_SHADER_TYPE::PIXEL)
+PixelShaderDecoder::PixelShaderDecoder(const char *Type, const BSGraphics::PixelShader *Shader) : ShaderDecoder(Type, BSSM_SHADER_TYPE::PIXEL, Shader->m_TechniqueID, Shader->m_ConstantGroups)
 {
-	m_Shader = Shader;
-}
-
-uint32_t PixelShaderDecoder::GetTechnique()
-{
-	return m_Shader->m_TechniqueID;
+	memcpy(m_ConstantOffsets, Shader->m_ConstantOffsets, sizeof(m_ConstantOffsets));
 }
 
 const uint8_t *PixelShaderDecoder::GetConstantArray()
 {
-	return m_Shader->m_ConstantOffsets;
+	return m_ConstantOffsets;
 }
 
 size_t PixelShaderDecoder::GetConstantArraySize()
 {
-	return ARRAYSIZE(BSGraphics::PixelShader::m_ConstantOffsets);
+	return ARRAYSIZE(m_ConstantOffsets);
 }
 
 void PixelShaderDecoder::DumpShaderSpecific(const char *TechName, std::vector<ParamIndexPair>& PerGeo, std::vector<ParamIndexPair>& PerMat, std::vector<ParamIndexPair>& PerTec, std::vector<ParamIndexPair>& Undefined)
 {
-	char buf[1024];
-	sprintf_s(buf, "%s\\%s\\%s_%s_%X.ps.txt", SHADER_DUMP_PATH, m_LoaderType, m_LoaderType, TechName, m_Shader->m_TechniqueID);
+	std::string out;
+	out.reserve(8192);
 
-	if (FILE *file; fopen_s(&file, buf, "w") == 0)
-	{
-		fprintf(file, "// %s\n", m_LoaderType);
-		fprintf(file, "// TechniqueID: 0x%X\n//\n", m_Shader->m_TechniqueID);
-		fprintf(file, "// Technique: %s\n\n", TechName);
+	AppendFormat(out, "// %s\n", m_LoaderType);
+	AppendFormat(out, "// TechniqueID: 0x%X\n//\n", m_TechniqueID);
+	AppendFormat(out, "// Technique: %s\n\n", TechName);
 
-		// Defines
-		if (auto defs = BSShader::GetAnySourceDefines(m_Type, m_Shader->m_TechniqueID); defs.size() > 0)
-		{
-			for (auto& define : defs)
-				fprintf(file, "#define %s %s\n", define.first, define.second);
+	// Defines
+	if (auto defs = BSShader::GetAnySourceDefines(m_Type, m_TechniqueID); defs.size() > 0)
+	{
+		for (auto& define : defs)
+			AppendFormat(out, "#define %s %s\n", define.first, define.second);
 
-			fprintf(file, "\n");
-		}
+		out.append("\n");
+	}
 
-		// Samplers
-		for (int i = 0;; i++)
-		{
-			const char *name = BSShader::GetPSSamplerName(m_Type, i, m_Shader->m_TechniqueID);
+	// Samplers
+	for (int i = 0;; i++)
+	{
+		const char *name = BSShader::GetPSSamplerName(m_Type, i, m_TechniqueID);
 
-			if (!name || strstr(name, "Add-your-"))
-				break;
+		if (!name || strstr(name, "Add-your-"))
+			break;
 
-			fprintf(file, "// Sampler[%d]: %s\n", i, name);
-		}
+		AppendFormat(out, "// Sampler[%d]: %s\n", i, name);
+	}
 
-		fprintf(file, "\n");
+	out.append("\n");
 
-		DumpCBuffer(file, &m_Shader->m_PerTechnique, PerTec, 0);// Constant buffer 0 : register(b0)
-		DumpCBuffer(file, &m_Shader->m_PerMaterial, PerMat, 1); // Constant buffer 1 : register(b1)
-		DumpCBuffer(file, &m_Shader->m_PerGeometry, PerGeo, 2); // Constant buffer 2 : register(b2)
+	DumpCBuffer(out, PerTec, 0);// Constant buffer 0 : register(b0)
+	DumpCBuffer(out, PerMat, 1);// Constant buffer 1 : register(b1)
+	DumpCBuffer(out, PerGeo, 2);// Constant buffer 2 : register(b2)
 
-		// Dump undefined variables
-		for (auto& entry : Undefined)
-			fprintf(file, "// UNDEFINED PARAMETER: Index: %02d Offset: 0x%04X Name: %s\n", entry.Index, m_Shader->m_ConstantOffsets[entry.Index] * 4, entry.Name);
+	// Dump undefined variables
+	for (auto& entry : Undefined)
+		AppendFormat(out, "// UNDEFINED PARAMETER: Index: %02d Offset: 0x%04X Name: %s\n", entry.Index, m_ConstantOffsets[entry.Index] * 4, entry.Name);
 
-		fclose(file);
-	}
+	WriteOutput(TechName, "ps.txt", out.data(), out.size(), true);
 
 	// Now write raw HLSL
 	if (m_HlslData)
+		WriteOutput(TechName, "ps.bin", m_HlslData, m_HlslDataLen, false);
+}
+
+//
+// ShaderDumpQueue
+//
+namespace ShaderDumpQueue
+{
+	std::mutex QueueLock;
+	std::condition_variable QueueAdded;
+	std::vector<std::unique_ptr<ShaderDecoder>> Pending;
+
+	void Worker()
 	{
-		sprintf_s(buf, "%s\\%s\\%s_%s_%X.ps.bin", SHADER_DUMP_PATH, m_LoaderType, m_LoaderType, TechName, m_Shader->m_TechniqueID);
+		std::vector<std::unique_ptr<ShaderDecoder>> batch;
 
-		if (FILE *file; fopen_s(&file, buf, "wb") == 0)
+		for (std::unique_lock<std::mutex> lock(QueueLock);;)
 		{
-			fwrite(m_HlslData, 1, m_HlslDataLen, file);
-			fclose(file);
+			QueueAdded.wait(lock, [] { return !Pending.empty(); });
+
+			// Grab everything queued so far in one go
+			batch.swap(Pending);
+			lock.unlock();
+
+			for (auto& decoder : batch)
+				decoder->DumpShader();
+
+			batch.clear();
+			lock.lock();
 		}
 	}
+
+	void Enqueue(std::unique_ptr<ShaderDecoder> Decoder)
+	{
+		static std::once_flag startWorkers;
+
+		std::call_once(startWorkers, []()
+		{
+			for (int i = 0; i < SHADER_DUMP_THREADS; i++)
+			{
+				std::thread t(Worker);
+				SetThreadPriority(t.native_handle(), THREAD_PRIORITY_BELOW_NORMAL);
+				t.detach();
+			}
+		});
+
+		std::lock_guard<std::mutex> lock(QueueLock);
+		Pending.push_back(std::move(Decoder));
+		QueueAdded.notify_one();
+	}
 }
\ No newline at end of file
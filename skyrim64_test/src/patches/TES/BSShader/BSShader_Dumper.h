@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include "BSShaderManager.h"
 
 class ShaderDecoder
@@ -11,24 +12,29 @@ protected:
 		const char *Name;
 	};
 
-	uint8_t *m_HlslData;
+	// Decoders only hold copies of the shader's metadata, so they can be dumped on any thread after the game
+	// replaced or released the original
+	const uint8_t *m_HlslData;
 	size_t m_HlslDataLen;
 
 	BSShaderManager::ShaderEnum m_Type;
 	char m_LoaderType[256];
 	BSSM_SHADER_TYPE m_CodeType;
+	uint32_t m_TechniqueID;
+	uint32_t m_BufferSizes[3];			// PerTechnique, PerMaterial, PerGeometry. 0 if there's no D3D buffer.
 
 public:
-	ShaderDecoder(const char *Type, BSSM_SHADER_TYPE CodeType);
+	ShaderDecoder(const char *Type, BSSM_SHADER_TYPE CodeType, uint32_t TechniqueID, const BSGraphics::Buffer *ConstantGroups);
 	virtual ~ShaderDecoder();
 
-	void SetShaderData(void *Buffer, size_t BufferSize);
+	// Not copied. Bytecode from the renderer's registry is never freed.
+	void SetShaderData(const void *Buffer, size_t BufferSize);
 	void DumpShader();
 
 protected:
-	void DumpCBuffer(FILE *File, BSGraphics::Buffer *Buffer, std::vector<ParamIndexPair> Params, int GroupIndex);
+	void DumpCBuffer(std::string& Out, std::vector<ParamIndexPair> Params, int GroupIndex);
+	void WriteOutput(const char *TechName, const char *Extension, const void *Data, size_t Length, bool Text);
 
-	virtual uint32_t GetTechnique() = 0;
 	virtual const uint8_t *GetConstantArray() = 0;
 	virtual size_t GetConstantArraySize() = 0;
 	virtual void DumpShaderSpecific(const char *TechName, std::vector<ParamIndexPair>& PerGeo, std::vector<ParamIndexPair>& PerMat, std::vector<ParamIndexPair>& PerTec, std::vector<ParamIndexPair>& Undefined) = 0;
@@ -43,13 +49,13 @@ protected:
 class VertexShaderDecoder : public ShaderDecoder
 {
 private:
-	BSGraphics::VertexShader *m_Shader;
+	uint64_t m_VertexDescription;
+	uint8_t m_ConstantOffsets[ARRAYSIZE(BSGraphics::VertexShader::m_ConstantOffsets)];
 
 public:
-	VertexShaderDecoder(const char *Type, BSGraphics::VertexShader *Shader);
+	VertexShaderDecoder(const char *Type, const BSGraphics::VertexShader *Shader);
 
 private:
-	virtual uint32_t GetTechnique() override;
 	virtual const uint8_t *GetConstantArray() override;
 	virtual size_t GetConstantArraySize() override;
 	virtual void DumpShaderSpecific(const char *TechName, std::vector<ParamIndexPair>& PerGeo, std::vector<ParamIndexPair>& PerMat, std::vector<ParamIndexPair>& PerTec, std::vector<ParamIndexPair>& Undefined) override;
@@ -58,14 +64,22 @@ private:
 class PixelShaderDecoder : public ShaderDecoder
 {
 private:
-	BSGraphics::PixelShader *m_Shader;
+	uint8_t m_ConstantOffsets[ARRAYSIZE(BSGraphics::PixelShader::m_ConstantOffsets)];
 
 public:
-	PixelShaderDecoder(const char *Type, BSGraphics::PixelShader *Shader);
+	PixelShaderDecoder(const char *Type, const BSGraphics::PixelShader *Shader);
 
 private:
-	virtual uint32_t GetTechnique() override;
 	virtual const uint8_t *GetConstantArray() override;
 	virtual size_t GetConstantArraySize() override;
 	virtual void DumpShaderSpecific(const char *TechName, std::vector<ParamIndexPair>& PerGeo, std::vector<ParamIndexPair>& PerMat, std::vector<ParamIndexPair>& PerTec, std::vector<ParamIndexPair>& Undefined) override;
-};
\ No newline at end of file
+};
+
+//
+// Background dump pipeline. The loading thread only queues decoders; worker threads take everything queued so far
+// as one batch, then build each output file in memory and write it with a single call.
+//
+namespace ShaderDumpQueue
+{
+	void Enqueue(std::unique_ptr<ShaderDecoder> Decoder);
+}
\ No newline at end of file
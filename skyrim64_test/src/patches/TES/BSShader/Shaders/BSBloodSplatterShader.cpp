@@ -151,6 +151,15 @@ void BSBloodSplatterShader::RestoreGeometry(BSRenderPass *Pass, uint32_t RenderF
 
 void BSBloodSplatterShader::CreateAllShaders()
 {
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets =
+	{
+		GetSourceDefines(RAW_TECHNIQUE_SPLATTER),
+		GetSourceDefines(RAW_TECHNIQUE_FLARE),
+	};
+
+	PrecompileShaders(ShaderConfigBloodSplatter.Type, defineSets, "vs_5_0");
+	PrecompileShaders(ShaderConfigBloodSplatter.Type, defineSets, "ps_5_0");
+
 	CreatePixelShader(RAW_TECHNIQUE_SPLATTER);
 	CreateVertexShader(RAW_TECHNIQUE_SPLATTER);
 	CreatePixelShader(RAW_TECHNIQUE_FLARE);
@@ -174,6 +174,17 @@ void BSDistantTreeShader::RestoreGeometry(BSRenderPass *Pass, uint32_t RenderFla
 
 void BSDistantTreeShader::CreateAllShaders()
 {
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets =
+	{
+		GetSourceDefines(RAW_TECHNIQUE_BLOCK),
+		GetSourceDefines(RAW_TECHNIQUE_BLOCK | RAW_FLAG_DO_ALPHA),
+		GetSourceDefines(RAW_TECHNIQUE_DEPTH),
+		GetSourceDefines(RAW_TECHNIQUE_DEPTH | RAW_FLAG_DO_ALPHA),
+	};
+
+	PrecompileShaders(ShaderConfigDistantTree.Type, defineSets, "vs_5_0");
+	PrecompileShaders(ShaderConfigDistantTree.Type, defineSets, "ps_5_0");
+
 	CreatePixelShader(RAW_TECHNIQUE_BLOCK);
 	CreateVertexShader(RAW_TECHNIQUE_BLOCK);
 	CreatePixelShader(RAW_TECHNIQUE_BLOCK | RAW_FLAG_DO_ALPHA);
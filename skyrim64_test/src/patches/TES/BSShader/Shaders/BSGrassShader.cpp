@@ -289,6 +289,18 @@ void BSGrassShader::CreateAllShaders()
 	static_assert(RAW_TECHNIQUE_VERTEXL == 0, "Please update this function to match the enum");
 	static_assert(RAW_TECHNIQUE_RENDERDEPTH == 8, "Please update this function to match the enum");
 
+	// Compile every permutation up front on all cores, the loop below only creates the D3D objects
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets;
+
+	for (int i = RAW_TECHNIQUE_VERTEXL; i <= RAW_TECHNIQUE_RENDERDEPTH; i++)
+	{
+		defineSets.push_back(GetSourceDefines(i));
+		defineSets.push_back(GetSourceDefines(i | RAW_FLAG_DO_ALPHA));
+	}
+
+	PrecompileShaders(ShaderConfigRunGrass.Type, defineSets, "vs_5_0");
+	PrecompileShaders(ShaderConfigRunGrass.Type, defineSets, "ps_5_0");
+
 	for (int i = RAW_TECHNIQUE_VERTEXL; i <= RAW_TECHNIQUE_RENDERDEPTH; i++)
 	{
 		CreateVertexShader(i);
@@ -1,4 +1,7 @@
+#include <fstream>
 #include "../../../rendering/common.h"
+#include "../../../rendering/LightTransform.h"
+#include "../../../rendering/SetupKeyUsage.h"
 #include "../../../../common.h"
 #include "../../NiMain/NiSourceTexture.h"
 #include "../../BSGraphics/BSGraphicsUtility.h"
@@ -92,6 +95,7 @@ DEFINE_SHADER_DESCRIPTOR(
 // - "Bones" and "IndexScale" vertex constants are not used in the game (undefined types)
 // - AmbientSpecularTintAndFresnelPower has a bug where it's set in SetupMaterial() rather than SetupGeometry()
 // - An unknown/redundant global variable edit was removed in GeometrySetupConstantLandBlendParams (BSShaderManager::St.kOldGridArrayCenter)
+// - Setup functions are instantiated once per technique key listed in BSLightingShaderTechniques.inl
 //
 using namespace DirectX;
 using namespace BSGraphics;
@@ -136,6 +140,23 @@ DefineIniSetting(iShadowMaskQuarter, Display);
 thread_local uint32_t TLS_m_CurrentRawTechnique;
 thread_local DepthStencilDepthMode TLS_dword_141E35280;
 thread_local uint32_t TLS_dword_141E3527C;
+thread_local BSGraphics::VertexShader *TLS_InstancingRestoreShader;
+
+// Last set of transformed point lights. A shape drawn in several passes with the same lights reuses them.
+struct PointLightCacheEntry
+{
+	const BSGeometry *Geometry;
+	uint32_t FrameCount;
+	uint32_t LightCount;
+	float RadiusDivisor;
+	BSLight *Lights[7];
+	XMFLOAT4X4A Transform;
+	XMVECTORF32 Positions[7];
+};
+
+thread_local PointLightCacheEntry TLS_PointLightCache;
+
+std::unordered_map<uint32_t, BSGraphics::VertexShader *> InstancedVertexShaders;
 
 char hookbuffer[50];
 
@@ -173,6 +194,32 @@ BSLightingShader::~BSLightingShader()
 
 extern D3D_PRIMITIVE_TOPOLOGY TopoOverride;
 
+//
+// Technique bits as seen by a setup specialization. Bits inside SetupKeyMask are taken from the key and fold into
+// constants; everything else (light counts, vertex colors, alpha test...) is still read from the raw technique.
+//
+template<uint32_t Key>
+struct BSLightingShader::SetupBits
+{
+	const uint32_t Raw;
+
+	__forceinline bool Has(uint32_t Flags) const
+	{
+		if constexpr (Key == GenericSetupKey)
+			return (Raw & Flags) != 0;
+		else
+			return (((Raw & ~SetupKeyMask) | Key) & Flags) != 0;
+	}
+
+	__forceinline uint32_t Base() const
+	{
+		if constexpr (Key == GenericSetupKey)
+			return (Raw >> 24) & 0x3F;
+		else
+			return (Key >> 24) & 0x3F;
+	}
+};
+
 bool BSLightingShader::SetupTechnique(uint32_t Technique)
 {
 	BSSHADER_FORWARD_CALL(TECHNIQUE, &BSLightingShader::SetupTechnique, Technique);
@@ -185,6 +232,16 @@ bool BSLightingShader::SetupTechnique(uint32_t Technique)
 
 	//m_CurrentRawTechnique = rawTechnique;
 	TLS_m_CurrentRawTechnique = rawTechnique;
+	CurrentSetup = GetSetupFunctions(rawTechnique);
+
+	(this->*CurrentSetup->Technique)(rawTechnique);
+	return true;
+}
+
+template<uint32_t Key>
+void BSLightingShader::SetupTechnique_Impl(uint32_t RawTechnique)
+{
+	const SetupBits<Key> bits { RawTechnique };
 
 	auto renderer = BSGraphics::Renderer::QInstance();
 	auto state = renderer->GetRendererShadowState();
@@ -195,7 +252,7 @@ bool BSLightingShader::SetupTechnique(uint32_t Technique)
 	renderer->SetTextureFilterMode(0, 3);
 	renderer->SetTextureFilterMode(1, 3);
 
-	switch ((rawTechnique >> 24) & 0x3F)
+	switch (bits.Base())
 	{
 	case RAW_TECHNIQUE_ENVMAP:
 	case RAW_TECHNIQUE_EYE:
@@ -265,8 +322,8 @@ bool BSLightingShader::SetupTechnique(uint32_t Technique)
 		colourOutputClamp.f[3] = 0.0f;
 	}
 
-	bool shadowed = (rawTechnique & RAW_FLAG_SHADOW_DIR) || (rawTechnique & (RAW_FLAG_LIGHTCOUNT6 | RAW_FLAG_LIGHTCOUNT5 | RAW_FLAG_LIGHTCOUNT4));
-	bool defShadow = (rawTechnique & RAW_FLAG_DEFSHADOW);
+	bool shadowed = bits.Has(RAW_FLAG_SHADOW_DIR) || bits.Has(RAW_FLAG_LIGHTCOUNT6 | RAW_FLAG_LIGHTCOUNT5 | RAW_FLAG_LIGHTCOUNT4);
+	bool defShadow = bits.Has(RAW_FLAG_DEFSHADOW);
 
 	// NOTE: A use-after-free has been eliminated. Constants are flushed AFTER this code block now.
 	if (shadowed && defShadow)
@@ -290,7 +347,6 @@ bool BSLightingShader::SetupTechnique(uint32_t Technique)
 
 	renderer->FlushConstantGroupVSPS(&vertexCG, &pixelCG);
 	renderer->ApplyConstantGroupVSPS(&vertexCG, &pixelCG, BSGraphics::CONSTANT_GROUP_LEVEL_TECHNIQUE);
-	return true;
 }
 
 void BSLightingShader::RestoreTechnique(uint32_t Technique)
@@ -315,14 +371,20 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 {
 	BSSHADER_FORWARD_CALL(MATERIAL, &BSLightingShader::SetupMaterial, Material);
 
+	(this->*CurrentSetup->Material)(Material, TLS_m_CurrentRawTechnique);
+}
+
+template<uint32_t Key>
+void BSLightingShader::SetupMaterial_Impl(const BSShaderMaterial *Material, uint32_t RawTechnique)
+{
 	auto renderer = BSGraphics::Renderer::QInstance();
 	auto state = renderer->GetRendererShadowState();
 
 	auto vertexCG = renderer->GetShaderConstantGroup(state->m_CurrentVertexShader, BSGraphics::CONSTANT_GROUP_LEVEL_MATERIAL);
 	auto pixelCG = renderer->GetShaderConstantGroup(state->m_CurrentPixelShader, BSGraphics::CONSTANT_GROUP_LEVEL_MATERIAL);
 
-	const uint32_t rawTechnique = TLS_m_CurrentRawTechnique;
-	const uint32_t baseTechniqueID = (rawTechnique >> 24) & 0x3F;
+	const SetupBits<Key> bits { RawTechnique };
+	const uint32_t baseTechniqueID = bits.Base();
 	bool setDiffuseNormalSamplers = true;
 
 	const uintptr_t v5 = (uintptr_t)this;
@@ -453,7 +515,7 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 			landscapeTexture5to6IsSpecPower.f[3] = 0.0f;
 		}
 
-		if (rawTechnique & RAW_FLAG_SNOW)
+		if (bits.Has(RAW_FLAG_SNOW))
 		{
 			// PS: p30 float4 LandscapeTexture1to4IsSnow
 			XMVECTORF32& landscapeTexture1to4IsSnow = pixelCG.ParamPS<XMVECTORF32, 30>();
@@ -598,7 +660,7 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 		texcoordOffset.f[3] = lightingMaterial->kTexCoordScale[BSShaderManager::St.uiTextureTransformCurrentBuffer].y;
 	}
 
-	if (rawTechnique & RAW_FLAG_SPECULAR)
+	if (bits.Has(RAW_FLAG_SPECULAR))
 	{
 		// PS: p25 float4 SpecularColor
 		XMVECTORF32& specularColor = pixelCG.ParamPS<XMVECTORF32, 25>();
@@ -608,7 +670,7 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 		specularColor.f[2] = lightingMaterial->kSpecularColor.b * lightingMaterial->fSpecularColorScale;
 		specularColor.f[3] = lightingMaterial->fSpecularPower;
 
-		if (rawTechnique & RAW_FLAG_MODELSPACENORMALS)
+		if (bits.Has(RAW_FLAG_MODELSPACENORMALS))
 		{
 			MatSetTextureSlot(2, lightingMaterial->spSpecularBackLightingTexture, lightingMaterial);
 
@@ -617,14 +679,14 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 		}
 	}
 
-	if (rawTechnique & RAW_FLAG_AMBIENT_SPECULAR)
+	if (bits.Has(RAW_FLAG_AMBIENT_SPECULAR))
 	{
 		// PS: p6 float4 AmbientSpecularTintAndFresnelPower
 		BSGraphics::Utility::CopyNiColorAToFloat(&pixelCG.ParamPS<XMVECTOR, 6>(), BSShaderManager::St.AmbientSpecular);
 	}
 
 	// These two conditions were originally separate code blocks
-	if ((rawTechnique & RAW_FLAG_SOFT_LIGHTING) || (rawTechnique & RAW_FLAG_RIM_LIGHTING))
+	if (bits.Has(RAW_FLAG_SOFT_LIGHTING) || bits.Has(RAW_FLAG_RIM_LIGHTING))
 	{
 		renderer->SetTexture(12, lightingMaterial->spRimSoftLightingTexture);
 		renderer->SetTextureAddressMode(12, lightingMaterial->eTextureClampMode);
@@ -636,13 +698,13 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 		lightingEffectParams.f[1] = lightingMaterial->fRimLightPower;
 	}
 
-	if (rawTechnique & RAW_FLAG_BACK_LIGHTING)
+	if (bits.Has(RAW_FLAG_BACK_LIGHTING))
 	{
 		renderer->SetTexture(9, lightingMaterial->spSpecularBackLightingTexture);
 		renderer->SetTextureAddressMode(9, lightingMaterial->eTextureClampMode);
 	}
 
-	if (rawTechnique & RAW_FLAG_SNOW)
+	if (bits.Has(RAW_FLAG_SNOW))
 	{
 		// PS: p34 float4 SnowRimLightParameters
 		XMVECTORF32& snowRimLightParameters = pixelCG.ParamPS<XMVECTORF32, 34>();
@@ -686,7 +748,7 @@ void BSLightingShader::SetupMaterial(BSShaderMaterial const *Material)
 		iblParams.f[3] = thing.f[2];
 	}
 
-	if (rawTechnique & RAW_FLAG_CHARACTER_LIGHT)
+	if (bits.Has(RAW_FLAG_CHARACTER_LIGHT))
 	{
 		if (dword_141E33BA0 >= 0)
 		{
@@ -733,6 +795,12 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 {
 	BSSHADER_FORWARD_CALL(GEOMETRY, &BSLightingShader::SetupGeometry, Pass, RenderFlags);
 
+	(this->*CurrentSetup->Geometry)(Pass, RenderFlags, TLS_m_CurrentRawTechnique);
+}
+
+template<uint32_t Key>
+void BSLightingShader::SetupGeometry_Impl(BSRenderPass *Pass, uint32_t RenderFlags, uint32_t RawTechnique)
+{
 	auto renderer = BSGraphics::Renderer::QInstance();
 	auto state = renderer->GetRendererShadowState();
 
@@ -740,10 +808,10 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 	auto vertexCG = renderer->GetShaderConstantGroup(state->m_CurrentVertexShader, BSGraphics::CONSTANT_GROUP_LEVEL_GEOMETRY);
 	auto pixelCG = renderer->GetShaderConstantGroup(state->m_CurrentPixelShader, BSGraphics::CONSTANT_GROUP_LEVEL_GEOMETRY);
 
-	const uint32_t rawTechnique = TLS_m_CurrentRawTechnique;
-	const uint32_t baseTechniqueID = (rawTechnique >> 24) & 0x3F;
+	const SetupBits<Key> bits { RawTechnique };
+	const uint32_t baseTechniqueID = bits.Base();
 
-	bool isSkinned = (rawTechnique & RAW_FLAG_SKINNED) != 0;
+	bool isSkinned = bits.Has(RAW_FLAG_SKINNED);
 	bool isLOD = false;
 	bool updateEyePosition = false;
 	auto renderSpace = isSkinned ? Space::World : Space::Model;
@@ -831,8 +899,8 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 
 	GeometrySetupEmitColorConstants(pixelCG, property);
 
-	uint32_t lightCount = (rawTechnique >> 3) & 0b111;		// 0 - 7
-	uint32_t shadowLightCount = (rawTechnique >> 6) & 0b111;// 0 - 7
+	uint32_t lightCount = (RawTechnique >> 3) & 0b111;		// 0 - 7
+	uint32_t shadowLightCount = (RawTechnique >> 6) & 0b111;// 0 - 7
 
 	// PS: p0 float2 NumLightNumShadowLight
 	{
@@ -868,7 +936,7 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 		GeometrySetupConstantPointLights(pixelCG, Pass, inverseWorldMatrix, lightCount, shadowLightCount, specularScale, renderSpace);
 	}
 
-	if (rawTechnique & RAW_FLAG_SPECULAR)
+	if (bits.Has(RAW_FLAG_SPECULAR))
 	{
 		// PS: p7 float4 MaterialData (Write #2)
 		XMVECTORF32& materialData = pixelCG.ParamPS<XMVECTORF32, 7>();
@@ -877,10 +945,10 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 		updateEyePosition = true;
 	}
 
-	if (rawTechnique & (RAW_FLAG_SOFT_LIGHTING | RAW_FLAG_RIM_LIGHTING | RAW_FLAG_BACK_LIGHTING | RAW_FLAG_AMBIENT_SPECULAR))
+	if (bits.Has(RAW_FLAG_SOFT_LIGHTING | RAW_FLAG_RIM_LIGHTING | RAW_FLAG_BACK_LIGHTING | RAW_FLAG_AMBIENT_SPECULAR))
 		updateEyePosition = true;
 
-	if ((rawTechnique & RAW_FLAG_PROJECTED_UV) && (baseTechniqueID != RAW_TECHNIQUE_HAIR))
+	if (bits.Has(RAW_FLAG_PROJECTED_UV) && (baseTechniqueID != RAW_TECHNIQUE_HAIR))
 	{
 		bool enableProjectedUvNormals = bEnableProjecteUVDiffuseNormals->uValue.b && (!(RenderFlags & 0x8) || !bEnableProjecteUVDiffuseNormalsOnCubemap->uValue.b);
 		XMMATRIX textureProjectionTemp;
@@ -915,7 +983,7 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 		BSShaderUtil::TransposeStoreMatrix3x4(&vertexCG.ParamVS<float, 6>(), textureProjectionTemp);
 	}
 
-	if (rawTechnique & RAW_FLAG_WORLD_MAP)
+	if (bits.Has(RAW_FLAG_WORLD_MAP))
 	{
 		renderer->SetTexture(12, WorldMapOverlayNormalTexture);
 		renderer->SetTextureAddressMode(12, 3);
@@ -991,7 +1059,7 @@ void BSLightingShader::SetupGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 		float v98 = 0.0f;
 		float v99 = 0.0f;
 
-		if (rawTechnique & RAW_FLAG_SPECULAR)
+		if (bits.Has(RAW_FLAG_SPECULAR))
 			v99 = property->fSpecularLODFade;
 
 		if ((RenderFlags & 0x2) == 0)
@@ -1026,25 +1094,183 @@ void BSLightingShader::RestoreGeometry(BSRenderPass *Pass, uint32_t RenderFlags)
 	}
 }
 
+#define LIGHTING_SETUP_SPECIALIZATION(Key) \
+	{ Key, &BSLightingShader::SetupTechnique_Impl<Key>, &BSLightingShader::SetupMaterial_Impl<Key>, &BSLightingShader::SetupGeometry_Impl<Key> },
+
+const BSLightingShader::SetupFunctions BSLightingShader::SpecializedSetups[] =
+{
+#include "BSLightingShaderTechniques.inl"
+};
+
+const BSLightingShader::SetupFunctions BSLightingShader::GenericSetup =
+{
+	GenericSetupKey,
+	&BSLightingShader::SetupTechnique_Impl<GenericSetupKey>,
+	&BSLightingShader::SetupMaterial_Impl<GenericSetupKey>,
+	&BSLightingShader::SetupGeometry_Impl<GenericSetupKey>,
+};
+
+#undef LIGHTING_SETUP_SPECIALIZATION
+
+thread_local const BSLightingShader::SetupFunctions *BSLightingShader::CurrentSetup = &BSLightingShader::GenericSetup;
+
+// Technique switches per setup key, written out by WriteSetupSpecializations(). A key is recorded as soon as a thread
+// switches to it; further switches to the same key are counted locally and added when the thread moves on.
+SRWLOCK RecordedSetupKeysLock = SRWLOCK_INIT;
+SetupKeyUsage RecordedSetupKeys;
+thread_local uint32_t TLS_LastSetupKey = 0xFFFFFFFF;
+thread_local uint64_t TLS_PendingSetupUses = 0;
+
+void RecordSetupKey(uint32_t Key)
+{
+	if (TLS_LastSetupKey == Key)
+	{
+		TLS_PendingSetupUses++;
+		return;
+	}
+
+	AcquireSRWLockExclusive(&RecordedSetupKeysLock);
+	{
+		if (TLS_PendingSetupUses > 0)
+			RecordedSetupKeys.Record(TLS_LastSetupKey, TLS_PendingSetupUses);
+
+		RecordedSetupKeys.Record(Key);
+	}
+	ReleaseSRWLockExclusive(&RecordedSetupKeysLock);
+
+	TLS_LastSetupKey = Key;
+	TLS_PendingSetupUses = 0;
+}
+
+const BSLightingShader::SetupFunctions *BSLightingShader::FindSpecializedSetup(uint32_t Key)
+{
+	auto end = SpecializedSetups + ARRAYSIZE(SpecializedSetups);
+	auto itr = std::lower_bound(SpecializedSetups, end, Key, [](const SetupFunctions& Entry, uint32_t Key) { return Entry.Key < Key; });
+
+	if (itr != end && itr->Key == Key)
+		return itr;
+
+	return nullptr;
+}
+
+const BSLightingShader::SetupFunctions *BSLightingShader::GetSetupFunctions(uint32_t RawTechnique)
+{
+	const uint32_t key = RawTechnique & SetupKeyMask;
+	RecordSetupKey(key);
+
+	if (!ui::opt::SpecializeLightingSetup)
+		return &GenericSetup;
+
+	if (auto setup = FindSpecializedSetup(key))
+		return setup;
+
+	ProfileCounterInc("Lighting Setup Fallbacks");
+	return &GenericSetup;
+}
+
+BSLightingShader::SetupStats BSLightingShader::GetSetupStats()
+{
+	SetupStats stats;
+	stats.SpecializedKeys = ARRAYSIZE(SpecializedSetups);
+	stats.RecordedKeys = 0;
+	stats.FallbackKeys = 0;
+
+	AcquireSRWLockShared(&RecordedSetupKeysLock);
+	{
+		for (uint32_t key : RecordedSetupKeys.GetKeys())
+		{
+			stats.RecordedKeys++;
+
+			if (!FindSpecializedSetup(key))
+				stats.FallbackKeys++;
+		}
+	}
+	ReleaseSRWLockShared(&RecordedSetupKeysLock);
+
+	return stats;
+}
+
+bool BSLightingShader::WriteSetupSpecializations(const char *Path)
+{
+	// Counts from the sessions that wrote this file before, then the compiled in list (which may have been edited by
+	// hand) and everything recorded since the last write
+	SetupKeyUsage list;
+	std::ifstream previous(Path);
+
+	if (previous && !list.Read(previous))
+		list = SetupKeyUsage();
+
+	previous.close();
+
+	for (auto& entry : SpecializedSetups)
+		list.Record(entry.Key, 0);
+
+	AcquireSRWLockShared(&RecordedSetupKeysLock);
+	list.Merge(RecordedSetupKeys);
+	ReleaseSRWLockShared(&RecordedSetupKeysLock);
+
+	// Every entry instantiates three setup functions, rarely used keys stay on the generic path
+	list.Trim(MaxSetupSpecializations);
+
+	std::ofstream file(Path, std::ios::trunc);
+
+	bool written = file && list.Write(file, [](uint32_t Key)
+	{
+		std::string defines;
+
+		for (auto& [name, value] : GetSourceDefines(Key))
+			defines += defines.empty() ? name : std::string(" ") + name;
+
+		return defines;
+	});
+
+	// The written counts include this session now, later writes only add what was recorded after this one
+	if (written)
+	{
+		AcquireSRWLockExclusive(&RecordedSetupKeysLock);
+		RecordedSetupKeys.ClearUses();
+		ReleaseSRWLockExclusive(&RecordedSetupKeysLock);
+	}
+
+	return written;
+}
+
 void BSLightingShader::CreateAllShaders()
 {
-	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
+	auto isLandTechnique = [](uint32_t Technique)
 	{
 		// Apply to parallax shaders only
-		//if (((itr->m_TechniqueID >> 24) & 0x3F) != RAW_TECHNIQUE_PARALLAX)
-		//	continue;
+		//return ((Technique >> 24) & 0x3F) == RAW_TECHNIQUE_PARALLAX;
 
-		switch ((itr->m_TechniqueID >> 24) & 0x3F)
+		switch ((Technique >> 24) & 0x3F)
 		{
 		case RAW_TECHNIQUE_MTLAND:
 		case RAW_TECHNIQUE_MTLANDLODBLEND:
 		case RAW_TECHNIQUE_LODLAND:
 		case RAW_TECHNIQUE_LODLANDNOISE:
-			break;
+			return true;
+		}
+
+		return false;
+	};
+
+	// Compile every permutation up front on all cores, the loop below only creates the D3D objects
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets;
 
-		default:
+	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
+	{
+		if (isLandTechnique(itr->m_TechniqueID))
+			defineSets.push_back(GetSourceDefines(itr->m_TechniqueID));
+	}
+
+	PrecompileShaders("Lighting", defineSets, "vs_5_0");
+	PrecompileShaders("Lighting", defineSets, "hs_5_0");
+	PrecompileShaders("Lighting", defineSets, "ds_5_0");
+
+	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
+	{
+		if (!isLandTechnique(itr->m_TechniqueID))
 			continue;
-		}
 
 		auto defines = GetSourceDefines(itr->m_TechniqueID);
 		auto getConstant = [](int i) { return ShaderConfigLighting.ByConstantIndexVS.count(i) ? ShaderConfigLighting.ByConstantIndexVS.at(i)->Name : nullptr; };
@@ -1055,6 +1281,196 @@ void BSLightingShader::CreateAllShaders()
 	}
 }
 
+void BSLightingShader::CreateInstancedShaders()
+{
+	auto getConstant = [](int i) { return ShaderConfigLighting.ByConstantIndexVS.count(i) ? ShaderConfigLighting.ByConstantIndexVS.at(i)->Name : nullptr; };
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets;
+
+	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
+	{
+		if (!IsInstancedTechnique(itr->m_TechniqueID))
+			continue;
+
+		defineSets.push_back(GetSourceDefines(itr->m_TechniqueID));
+		defineSets.back().emplace_back("INSTANCED", "");
+	}
+
+	PrecompileShaders("Lighting", defineSets, "vs_5_0");
+
+	for (auto itr = m_VertexShaderTable.begin(); itr != m_VertexShaderTable.end(); itr++)
+	{
+		if (!IsInstancedTechnique(itr->m_TechniqueID))
+			continue;
+
+		auto defines = GetSourceDefines(itr->m_TechniqueID);
+		defines.emplace_back("INSTANCED", "");
+
+		// No shader source available
+		BSGraphics::VertexShader *vertexShader = CreateVertexShaderVariant(itr->m_TechniqueID, "Lighting", defines, getConstant);
+
+		if (!vertexShader)
+		{
+			ui::log::Add("Geometry instancing unavailable: Lighting.hlsl couldn't be compiled with INSTANCED\n");
+			return;
+		}
+
+		// Sources without instancing support still compile, they just ignore the define. Instancing stays disabled.
+		ID3D11ShaderReflection *reflector = BSGraphics::Renderer::QInstance()->GetShaderReflection(vertexShader->m_Shader);
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+
+		if (FAILED(reflector->GetResourceBindingDescByName("PerInstance", &bindDesc)) || bindDesc.BindPoint != BSGraphics::CONSTANT_GROUP_LEVEL_INSTANCE)
+		{
+			// CompileVertexShader() allocates with malloc() + placement new
+			vertexShader->m_Shader->Release();
+			vertexShader->~VertexShader();
+			free(vertexShader);
+
+			ui::log::Add("Geometry instancing unavailable: Lighting.hlsl doesn't read PerInstance under INSTANCED (see Shaders/ShaderCommon.h)\n");
+			return;
+		}
+
+		InstancedVertexShaders[itr->m_TechniqueID] = vertexShader;
+	}
+}
+
+bool BSLightingShader::HasInstancedShaders()
+{
+	return !InstancedVertexShaders.empty();
+}
+
+bool BSLightingShader::SupportsInstancing(uint32_t Technique)
+{
+	uint32_t rawTechnique = GetRawTechnique(Technique);
+
+	return IsInstancedTechnique(rawTechnique) && InstancedVertexShaders.count(GetVertexTechnique(rawTechnique)) > 0;
+}
+
+void BSLightingShader::SetupGeometryInstances(BSRenderPass **Passes, uint32_t Count, uint32_t RenderFlags)
+{
+	AssertDebug(Count <= MaxGeometryInstances);
+
+	auto renderer = BSGraphics::Renderer::QInstance();
+	auto state = renderer->GetRendererShadowState();
+
+	auto instanceCG = renderer->GetShaderConstantGroup(Count * sizeof(GeometryInstance), BSGraphics::CONSTANT_GROUP_LEVEL_INSTANCE);
+	auto instances = static_cast<GeometryInstance *>(instanceCG.RawData());
+
+	// Same transforms as GeometrySetupConstantWorld() in SetupGeometry(), one set per instance
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const NiTransform& world = Passes[i]->m_Geometry->GetWorldTransform();
+		const NiTransform& previous = (RenderFlags & 0x10) ? world : Passes[i]->m_Geometry->GetPreviousWorldTransform();
+
+		BSShaderUtil::TransposeStoreMatrix3x4(&instances[i].World[0][0], BSShaderUtil::GetXMFromNi(world));
+		BSShaderUtil::TransposeStoreMatrix3x4(&instances[i].PreviousWorld[0][0], BSShaderUtil::GetXMFromNiPosAdjust(previous, state->m_PreviousPosAdjust));
+	}
+
+	renderer->FlushConstantGroup(&instanceCG);
+	renderer->ApplyConstantGroupVS(&instanceCG, BSGraphics::CONSTANT_GROUP_LEVEL_INSTANCE);
+
+	// Swap in the permutation. The technique stays set up, so the original must be restored before the next pass.
+	TLS_InstancingRestoreShader = state->m_CurrentVertexShader;
+	renderer->SetVertexShader(InstancedVertexShaders.at(state->m_CurrentVertexShader->m_TechniqueID));
+}
+
+void BSLightingShader::RestoreGeometryInstances()
+{
+	BSGraphics::Renderer::QInstance()->SetVertexShader(TLS_InstancingRestoreShader);
+	TLS_InstancingRestoreShader = nullptr;
+}
+
+bool BSLightingShader::IsInstanceCandidate(const BSRenderPass *Pass)
+{
+	if (!Pass->m_ShaderProperty)
+		return false;
+
+	// Fade node values are per object (stencil fade and single level LOD alpha)
+	if (Pass->m_AccumulationHint == 10 || Pass->m_LODMode.SingleLevel)
+		return false;
+
+	if (Pass->QAlphaProperty() && Pass->QAlphaProperty()->GetAlphaBlending())
+		return false;
+
+	return true;
+}
+
+bool BSLightingShader::IsInstanceCompatible(const BSRenderPass *First, const BSRenderPass *Pass)
+{
+	//
+	// Everything SetupGeometry() writes besides World/PreviousWorld has to match, otherwise the pass is drawn
+	// separately. Lighting is done in model space, so instances may only differ by translation.
+	//
+	auto firstProperty = static_cast<const BSLightingShaderProperty *>(First->m_ShaderProperty);
+	auto property = static_cast<const BSLightingShaderProperty *>(Pass->m_ShaderProperty);
+
+	if (First->m_PassEnum != Pass->m_PassEnum || First->m_AccumulationHint != Pass->m_AccumulationHint)
+		return false;
+
+	if (firstProperty->pMaterial != property->pMaterial)
+		return false;
+
+	const NiTransform& firstWorld = First->m_Geometry->GetWorldTransform();
+	const NiTransform& world = Pass->m_Geometry->GetWorldTransform();
+
+	if (memcmp(&firstWorld.m_Rotate, &world.m_Rotate, sizeof(NiMatrix3)) != 0 || firstWorld.m_fScale != world.m_fScale)
+		return false;
+
+	// Directional light
+	if (First->m_NumLights != Pass->m_NumLights || (First->m_NumLights > 0 && First->m_SceneLights[0] != Pass->m_SceneLights[0]))
+		return false;
+
+	if (firstProperty->GetAlpha() != property->GetAlpha())
+		return false;
+
+	if (firstProperty->fEmitColorScale != property->fEmitColorScale || memcmp(firstProperty->pEmitColor, property->pEmitColor, sizeof(NiColor)) != 0)
+		return false;
+
+	if (firstProperty->GetFlag(BSShaderProperty::BSSP_FLAG_ZBUFFER_WRITE) != property->GetFlag(BSShaderProperty::BSSP_FLAG_ZBUFFER_WRITE) ||
+		firstProperty->GetFlag(BSShaderProperty::BSSP_FLAG_ZBUFFER_TEST) != property->GetFlag(BSShaderProperty::BSSP_FLAG_ZBUFFER_TEST))
+		return false;
+
+	// Alpha test reference
+	const NiAlphaProperty *firstAlpha = First->QAlphaProperty();
+	const NiAlphaProperty *alpha = Pass->QAlphaProperty();
+
+	if (!firstAlpha || !alpha)
+		return firstAlpha == alpha;
+
+	return firstAlpha->GetAlphaTesting() == alpha->GetAlphaTesting() && firstAlpha->GetTestRef() == alpha->GetTestRef();
+}
+
+bool BSLightingShader::IsInstancedTechnique(uint32_t RawTechnique)
+{
+	switch ((RawTechnique >> 24) & 0x3F)
+	{
+	case RAW_TECHNIQUE_NONE:
+	case RAW_TECHNIQUE_GLOWMAP:
+	case RAW_TECHNIQUE_PARALLAX:
+	case RAW_TECHNIQUE_PARALLAXOCC:
+	case RAW_TECHNIQUE_SNOW:
+		break;
+
+	default:
+		return false;
+	}
+
+	// Point lights and anything using the eye position are computed per object in model space
+	const uint32_t perObjectFlags =
+		RAW_FLAG_SKINNED |
+		RAW_FLAG_LIGHTCOUNT1 | RAW_FLAG_LIGHTCOUNT2 | RAW_FLAG_LIGHTCOUNT3 |
+		RAW_FLAG_LIGHTCOUNT4 | RAW_FLAG_LIGHTCOUNT5 | RAW_FLAG_LIGHTCOUNT6 |
+		RAW_FLAG_SPECULAR |
+		RAW_FLAG_SOFT_LIGHTING |
+		RAW_FLAG_RIM_LIGHTING |
+		RAW_FLAG_BACK_LIGHTING |
+		RAW_FLAG_PROJECTED_UV |
+		RAW_FLAG_ANISO_LIGHTING |
+		RAW_FLAG_AMBIENT_SPECULAR |
+		RAW_FLAG_CHARACTER_LIGHT;
+
+	return (RawTechnique & perObjectFlags) == 0;
+}
+
 uint32_t BSLightingShader::GetRawTechnique(uint32_t Technique)
 {
 	uint32_t outputTech = Technique - 0x4800002D;
@@ -1490,14 +1906,34 @@ void BSLightingShader::GeometrySetupConstantPointLights(const BSGraphics::PixelC
 	auto& pointLightColor = PixelCG.ParamPS<XMVECTORF32[7], 2>();	// PS: p2 float4[7] PointLightColor
 	auto& shadowLightMaskSelect = PixelCG.ParamPS<float[4], 10>();	// PS: p10 float4 ShadowLightMaskSelect
 
+	// Everything here except the position transform is plain copies. Positions and radii are gathered SoA for
+	// LightTransform::Transform().
+	BSLight **passLights = &Pass->QLights()[1];
+	LightTransform::LightsSoA lights = {};
+	XMFLOAT4X4A transform;
+	float radiusDivisor;
+
+	if (RenderSpace == Space::Model)
+	{
+		XMStoreFloat4x4A(&transform, Transform);
+		radiusDivisor = WorldScale;
+	}
+	else
+	{
+		const NiPoint3& posAdjust = BSGraphics::Renderer::QInstance()->GetRendererShadowState()->m_PosAdjust;
+
+		XMStoreFloat4x4A(&transform, XMMatrixTranslation(-posAdjust.x, -posAdjust.y, -posAdjust.z));
+		radiusDivisor = 1.0f;
+	}
+
 	for (uint32_t i = 0; i < LightCount; i++)
 	{
-		BSLight *screenSpaceLight = Pass->QLights()[i + 1];
+		BSLight *screenSpaceLight = passLights[i];
 		NiLight *niLight = screenSpaceLight->GetLight();
 
 		AssertMsgDebug(niLight, "If the SSL is non-null, the NiLight should also be non-null.");
 
-		NiPoint3 worldPos = niLight->GetWorldTranslate();
+		const NiPoint3& worldPos = niLight->GetWorldTranslate();
 		float dimmer = niLight->GetDimmer() * screenSpaceLight->GetLODDimmer();
 
 		if (BSShaderManager::St.bLiteBrite)
@@ -1507,22 +1943,40 @@ void BSLightingShader::GeometrySetupConstantPointLights(const BSGraphics::PixelC
 		pointLightColor[i].f[1] = dimmer * niLight->GetDiffuseColor().g;
 		pointLightColor[i].f[2] = dimmer * niLight->GetDiffuseColor().b;
 
-		if (RenderSpace == Space::Model)
-		{
-			pointLightPosition[i].v = DirectX::XMVector3TransformCoord(worldPos.AsXmm(), Transform);
-			pointLightPosition[i].f[3] = niLight->GetSpecularColor().r / WorldScale;
-		}
-		else
-		{
-			worldPos = worldPos - BSGraphics::Renderer::QInstance()->GetRendererShadowState()->m_PosAdjust;
-
-			pointLightPosition[i].v = worldPos.AsXmm();
-			pointLightPosition[i].f[3] = niLight->GetSpecularColor().r;
-		}
+		lights.X[i] = worldPos.x;
+		lights.Y[i] = worldPos.y;
+		lights.Z[i] = worldPos.z;
+		lights.Radius[i] = niLight->GetSpecularColor().r;
 
 		if (i < ShadowLightCount)
 			shadowLightMaskSelect[i] = (float)static_cast<BSShadowLight *>(screenSpaceLight)->UnkDword520;
 	}
+
+	PointLightCacheEntry& cache = TLS_PointLightCache;
+
+	if (ui::opt::CachePointLightTransforms &&
+		cache.Geometry == Pass->m_Geometry &&
+		cache.FrameCount == BSGraphics::gState.uiFrameCount &&
+		cache.LightCount == LightCount &&
+		cache.RadiusDivisor == radiusDivisor &&
+		!memcmp(cache.Lights, passLights, LightCount * sizeof(BSLight *)) &&
+		!memcmp(&cache.Transform, &transform, sizeof(transform)))
+	{
+		ProfileCounterInc("Point Light Cache Hits");
+
+		memcpy(&pointLightPosition, cache.Positions, LightCount * sizeof(XMVECTORF32));
+		return;
+	}
+
+	LightTransform::Transform(transform.m, lights, LightCount, radiusDivisor, reinterpret_cast<float(*)[4]>(&pointLightPosition));
+
+	cache.Geometry = Pass->m_Geometry;
+	cache.FrameCount = BSGraphics::gState.uiFrameCount;
+	cache.LightCount = LightCount;
+	cache.RadiusDivisor = radiusDivisor;
+	memcpy(cache.Lights, passLights, LightCount * sizeof(BSLight *));
+	cache.Transform = transform;
+	memcpy(cache.Positions, &pointLightPosition, LightCount * sizeof(XMVECTORF32));
 }
 
 void BSLightingShader::GeometrySetupConstantProjectedUVData(const BSGraphics::PixelCGroup& PixelCG, BSMultiIndexTriShape *Shape, BSLightingShaderProperty *Property, bool EnableProjectedNormals)
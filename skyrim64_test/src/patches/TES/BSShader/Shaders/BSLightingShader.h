@@ -90,6 +90,27 @@ public:
 
 	void CreateAllShaders();
 
+	//
+	// Geometry instancing: identical static meshes drawn with one DrawIndexedInstanced() call. World transforms go to
+	// CONSTANT_GROUP_LEVEL_INSTANCE and are read by vertex shader permutations compiled with INSTANCED.
+	//
+	const static uint32_t MaxGeometryInstances = 256;
+
+	struct GeometryInstance
+	{
+		float World[3][4];
+		float PreviousWorld[3][4];
+	};
+
+	void CreateInstancedShaders();
+	static bool HasInstancedShaders();		// False until the Lighting.hlsl source reads PerInstance
+	bool SupportsInstancing(uint32_t Technique);
+	void SetupGeometryInstances(BSRenderPass **Passes, uint32_t Count, uint32_t RenderFlags);
+	void RestoreGeometryInstances();
+
+	static bool IsInstanceCandidate(const BSRenderPass *Pass);
+	static bool IsInstanceCompatible(const BSRenderPass *First, const BSRenderPass *Pass);
+
 	static uint32_t GetRawTechnique(uint32_t Technique);
 	static uint32_t GetVertexTechnique(uint32_t RawTechnique);
 	static uint32_t GetPixelTechnique(uint32_t RawTechnique);
@@ -97,7 +118,68 @@ public:
 	static std::vector<std::pair<const char *, const char *>> GetSourceDefines(uint32_t Technique);
 	static std::string GetTechniqueString(uint32_t Technique);
 
+	struct SetupStats
+	{
+		uint32_t SpecializedKeys;	// Entries in BSLightingShaderTechniques.inl
+		uint32_t RecordedKeys;		// Keys used since startup
+		uint32_t FallbackKeys;		// Recorded keys without a specialization
+	};
+
+	static SetupStats GetSetupStats();
+	static bool WriteSetupSpecializations(const char *Path);
+
 private:
+	//
+	// Setup specializations. SetupTechnique/SetupMaterial/SetupGeometry only branch on the bits in SetupKeyMask, so
+	// every key listed in BSLightingShaderTechniques.inl gets its own copy of the three functions with those branches
+	// resolved at compile time. The key is looked up once per technique change and the per-draw calls go through the
+	// cached entry. Keys missing from the table use the generic copy, which tests the bits at run time.
+	//
+	constexpr static uint32_t SetupKeyMask =
+		0x3F000000 |
+		RAW_FLAG_SKINNED |
+		RAW_FLAG_MODELSPACENORMALS |
+		RAW_FLAG_SPECULAR |
+		RAW_FLAG_SOFT_LIGHTING |
+		RAW_FLAG_RIM_LIGHTING |
+		RAW_FLAG_BACK_LIGHTING |
+		RAW_FLAG_SHADOW_DIR |
+		RAW_FLAG_DEFSHADOW |
+		RAW_FLAG_PROJECTED_UV |
+		RAW_FLAG_AMBIENT_SPECULAR |
+		RAW_FLAG_WORLD_MAP |
+		RAW_FLAG_SNOW |
+		RAW_FLAG_CHARACTER_LIGHT;
+
+	constexpr static uint32_t GenericSetupKey = 0xFFFFFFFF;
+
+	template<uint32_t Key>
+	struct SetupBits;
+
+	struct SetupFunctions
+	{
+		uint32_t Key;
+		void (BSLightingShader::*Technique)(uint32_t RawTechnique);
+		void (BSLightingShader::*Material)(const BSShaderMaterial *Material, uint32_t RawTechnique);
+		void (BSLightingShader::*Geometry)(BSRenderPass *Pass, uint32_t RenderFlags, uint32_t RawTechnique);
+	};
+
+	static const SetupFunctions GenericSetup;
+	static const SetupFunctions SpecializedSetups[];
+	static thread_local const SetupFunctions *CurrentSetup;
+
+	// WriteSetupSpecializations() keeps the most used keys
+	constexpr static size_t MaxSetupSpecializations = 256;
+
+	static const SetupFunctions *FindSpecializedSetup(uint32_t Key);
+	static const SetupFunctions *GetSetupFunctions(uint32_t RawTechnique);
+
+	template<uint32_t Key> void SetupTechnique_Impl(uint32_t RawTechnique);
+	template<uint32_t Key> void SetupMaterial_Impl(const BSShaderMaterial *Material, uint32_t RawTechnique);
+	template<uint32_t Key> void SetupGeometry_Impl(BSRenderPass *Pass, uint32_t RenderFlags, uint32_t RawTechnique);
+
+	static bool IsInstancedTechnique(uint32_t RawTechnique);
+
 	static void TechUpdateHighDetailRangeConstants(BSGraphics::VertexCGroup& VertexCG);
 	static void TechUpdateFogConstants(BSGraphics::VertexCGroup& VertexCG, BSGraphics::PixelCGroup& PixelCG);
 
@@ -0,0 +1,93 @@
+// clang-format off
+//
+// Hand-written seed list of common permutations with no recorded uses. Pressing "Write lighting setup
+// specializations" in Frame Statistics replaces it through BSLightingShader::WriteSetupSpecializations(), which
+// records every technique switch and keeps the most used keys. One entry per raw technique masked with SetupKeyMask,
+// sorted by key, followed by the source defines those bits select.
+//
+LIGHTING_SETUP_SPECIALIZATION(0x00000000)	// (none)
+LIGHTING_SETUP_SPECIALIZATION(0x00000002)	// SKINNED
+LIGHTING_SETUP_SPECIALIZATION(0x00000006)	// SKINNED MODELSPACENORMALS
+LIGHTING_SETUP_SPECIALIZATION(0x00000200)	// SPECULAR
+LIGHTING_SETUP_SPECIALIZATION(0x00000202)	// SKINNED SPECULAR
+LIGHTING_SETUP_SPECIALIZATION(0x00000206)	// SKINNED MODELSPACENORMALS SPECULAR
+LIGHTING_SETUP_SPECIALIZATION(0x00000606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00000A06)	// SKINNED MODELSPACENORMALS SPECULAR RIM_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00000C00)	// SOFT_LIGHTING RIM_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00001000)	// BACK_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00001200)	// SPECULAR BACK_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00006000)	// SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006002)	// SKINNED SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006006)	// SKINNED MODELSPACENORMALS SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006200)	// SPECULAR SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006202)	// SKINNED SPECULAR SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006206)	// SKINNED MODELSPACENORMALS SPECULAR SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING SHADOW_DIR DEFSHADOW
+LIGHTING_SETUP_SPECIALIZATION(0x00006A06)	// SKINNED MODELSPACENORMALS SPECULAR SHADOW_DIR DEFSHADOW RIM_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00006C00)	// SOFT_LIGHTING SHADOW_DIR DEFSHADOW RIM_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00007000)	// SHADOW_DIR DEFSHADOW BACK_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00007200)	// SPECULAR SHADOW_DIR DEFSHADOW BACK_LIGHTING
+LIGHTING_SETUP_SPECIALIZATION(0x00008000)	// PROJECTED_UV
+LIGHTING_SETUP_SPECIALIZATION(0x00008200)	// SPECULAR PROJECTED_UV
+LIGHTING_SETUP_SPECIALIZATION(0x0000E000)	// SHADOW_DIR DEFSHADOW PROJECTED_UV
+LIGHTING_SETUP_SPECIALIZATION(0x0000E200)	// SPECULAR SHADOW_DIR DEFSHADOW PROJECTED_UV
+LIGHTING_SETUP_SPECIALIZATION(0x00200000)	// SNOW
+LIGHTING_SETUP_SPECIALIZATION(0x00206000)	// SHADOW_DIR DEFSHADOW SNOW
+LIGHTING_SETUP_SPECIALIZATION(0x00400006)	// SKINNED MODELSPACENORMALS CHARACTER_LIGHT
+LIGHTING_SETUP_SPECIALIZATION(0x00400206)	// SKINNED MODELSPACENORMALS SPECULAR CHARACTER_LIGHT
+LIGHTING_SETUP_SPECIALIZATION(0x00406006)	// SKINNED MODELSPACENORMALS SHADOW_DIR DEFSHADOW CHARACTER_LIGHT
+LIGHTING_SETUP_SPECIALIZATION(0x00406206)	// SKINNED MODELSPACENORMALS SPECULAR SHADOW_DIR DEFSHADOW CHARACTER_LIGHT
+LIGHTING_SETUP_SPECIALIZATION(0x01000000)	// ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x01000200)	// SPECULAR ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x01000206)	// SKINNED MODELSPACENORMALS SPECULAR ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x01006000)	// SHADOW_DIR DEFSHADOW ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x01006200)	// SPECULAR SHADOW_DIR DEFSHADOW ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x01006206)	// SKINNED MODELSPACENORMALS SPECULAR SHADOW_DIR DEFSHADOW ENVMAP
+LIGHTING_SETUP_SPECIALIZATION(0x02000000)	// GLOWMAP
+LIGHTING_SETUP_SPECIALIZATION(0x02000006)	// SKINNED MODELSPACENORMALS GLOWMAP
+LIGHTING_SETUP_SPECIALIZATION(0x02006000)	// SHADOW_DIR DEFSHADOW GLOWMAP
+LIGHTING_SETUP_SPECIALIZATION(0x02006006)	// SKINNED MODELSPACENORMALS SHADOW_DIR DEFSHADOW GLOWMAP
+LIGHTING_SETUP_SPECIALIZATION(0x03000000)	// PARALLAX
+LIGHTING_SETUP_SPECIALIZATION(0x03000200)	// SPECULAR PARALLAX
+LIGHTING_SETUP_SPECIALIZATION(0x03006000)	// SHADOW_DIR DEFSHADOW PARALLAX
+LIGHTING_SETUP_SPECIALIZATION(0x03006200)	// SPECULAR SHADOW_DIR DEFSHADOW PARALLAX
+LIGHTING_SETUP_SPECIALIZATION(0x04000606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING FACEGEN
+LIGHTING_SETUP_SPECIALIZATION(0x04006606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING SHADOW_DIR DEFSHADOW FACEGEN
+LIGHTING_SETUP_SPECIALIZATION(0x04400606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING CHARACTER_LIGHT FACEGEN
+LIGHTING_SETUP_SPECIALIZATION(0x04406606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING SHADOW_DIR DEFSHADOW CHARACTER_LIGHT FACEGEN
+LIGHTING_SETUP_SPECIALIZATION(0x05000606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING FACEGEN_RGB_TINT
+LIGHTING_SETUP_SPECIALIZATION(0x05006606)	// SKINNED MODELSPACENORMALS SPECULAR SOFT_LIGHTING SHADOW_DIR DEFSHADOW FACEGEN_RGB_TINT
+LIGHTING_SETUP_SPECIALIZATION(0x06001200)	// SPECULAR BACK_LIGHTING HAIR
+LIGHTING_SETUP_SPECIALIZATION(0x06001202)	// SKINNED SPECULAR BACK_LIGHTING HAIR
+LIGHTING_SETUP_SPECIALIZATION(0x06007200)	// SPECULAR SHADOW_DIR DEFSHADOW BACK_LIGHTING HAIR
+LIGHTING_SETUP_SPECIALIZATION(0x06007202)	// SKINNED SPECULAR SHADOW_DIR DEFSHADOW BACK_LIGHTING HAIR
+LIGHTING_SETUP_SPECIALIZATION(0x08000000)	// MULTI_TEXTURE LANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x08006000)	// SHADOW_DIR DEFSHADOW MULTI_TEXTURE LANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x08200000)	// SNOW MULTI_TEXTURE LANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x08206000)	// SHADOW_DIR DEFSHADOW SNOW MULTI_TEXTURE LANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x09000000)	// LODLANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x09006000)	// SHADOW_DIR DEFSHADOW LODLANDSCAPE
+LIGHTING_SETUP_SPECIALIZATION(0x0C000000)	// TREE_ANIM
+LIGHTING_SETUP_SPECIALIZATION(0x0C001000)	// BACK_LIGHTING TREE_ANIM
+LIGHTING_SETUP_SPECIALIZATION(0x0C006000)	// SHADOW_DIR DEFSHADOW TREE_ANIM
+LIGHTING_SETUP_SPECIALIZATION(0x0C007000)	// SHADOW_DIR DEFSHADOW BACK_LIGHTING TREE_ANIM
+LIGHTING_SETUP_SPECIALIZATION(0x0D000000)	// LODOBJECTS
+LIGHTING_SETUP_SPECIALIZATION(0x0D006000)	// SHADOW_DIR DEFSHADOW LODOBJECTS
+LIGHTING_SETUP_SPECIALIZATION(0x0E008000)	// PROJECTED_UV MULTI_INDEX SPARKLE
+LIGHTING_SETUP_SPECIALIZATION(0x0E008200)	// SPECULAR PROJECTED_UV MULTI_INDEX SPARKLE
+LIGHTING_SETUP_SPECIALIZATION(0x0E00E000)	// SHADOW_DIR DEFSHADOW PROJECTED_UV MULTI_INDEX SPARKLE
+LIGHTING_SETUP_SPECIALIZATION(0x0E00E200)	// SPECULAR SHADOW_DIR DEFSHADOW PROJECTED_UV MULTI_INDEX SPARKLE
+LIGHTING_SETUP_SPECIALIZATION(0x0F000000)	// LODOBJECTSHD
+LIGHTING_SETUP_SPECIALIZATION(0x0F006000)	// SHADOW_DIR DEFSHADOW LODOBJECTSHD
+LIGHTING_SETUP_SPECIALIZATION(0x0F008000)	// PROJECTED_UV LODOBJECTSHD
+LIGHTING_SETUP_SPECIALIZATION(0x0F00E000)	// SHADOW_DIR DEFSHADOW PROJECTED_UV LODOBJECTSHD
+LIGHTING_SETUP_SPECIALIZATION(0x10000202)	// SKINNED SPECULAR EYE
+LIGHTING_SETUP_SPECIALIZATION(0x10000206)	// SKINNED MODELSPACENORMALS SPECULAR EYE
+LIGHTING_SETUP_SPECIALIZATION(0x10006202)	// SKINNED SPECULAR SHADOW_DIR DEFSHADOW EYE
+LIGHTING_SETUP_SPECIALIZATION(0x10006206)	// SKINNED MODELSPACENORMALS SPECULAR SHADOW_DIR DEFSHADOW EYE
+LIGHTING_SETUP_SPECIALIZATION(0x12000000)	// LODLANDSCAPE LODLANDNOISE
+LIGHTING_SETUP_SPECIALIZATION(0x12006000)	// SHADOW_DIR DEFSHADOW LODLANDSCAPE LODLANDNOISE
+LIGHTING_SETUP_SPECIALIZATION(0x13000000)	// MULTI_TEXTURE LANDSCAPE LOD_LAND_BLEND
+LIGHTING_SETUP_SPECIALIZATION(0x13006000)	// SHADOW_DIR DEFSHADOW MULTI_TEXTURE LANDSCAPE LOD_LAND_BLEND
+LIGHTING_SETUP_SPECIALIZATION(0x13200000)	// SNOW MULTI_TEXTURE LANDSCAPE LOD_LAND_BLEND
+LIGHTING_SETUP_SPECIALIZATION(0x13206000)	// SHADOW_DIR DEFSHADOW SNOW MULTI_TEXTURE LANDSCAPE LOD_LAND_BLEND
\ No newline at end of file
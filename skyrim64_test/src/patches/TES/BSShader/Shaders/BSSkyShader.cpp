@@ -324,6 +324,15 @@ void BSSkyShader::CreateAllShaders()
 	static_assert(RAW_TECHNIQUE_SUNOCCLUDE == 0, "Please update this function to match the enum");
 	static_assert(RAW_TECHNIQUE_SKY == 8, "Please update this function to match the enum");
 
+	// Compile every permutation up front on all cores, the loop below only creates the D3D objects
+	std::vector<std::vector<std::pair<const char *, const char *>>> defineSets;
+
+	for (int i = RAW_TECHNIQUE_SUNOCCLUDE; i <= RAW_TECHNIQUE_SKY; i++)
+		defineSets.push_back(GetSourceDefines(i));
+
+	PrecompileShaders(ShaderConfigSky.Type, defineSets, "vs_5_0");
+	PrecompileShaders(ShaderConfigSky.Type, defineSets, "ps_5_0");
+
 	for (int i = RAW_TECHNIQUE_SUNOCCLUDE; i <= RAW_TECHNIQUE_SKY; i++)
 	{
 		CreateVertexShader(i);
@@ -0,0 +1,38 @@
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "BSTLocklessQueue.h"
+
+namespace BSTLocklessQueueOverflow
+{
+	std::mutex OverflowLock;
+	std::unordered_map<std::atomic<uint32_t> *, std::deque<void *>> OverflowLists;
+
+	void Push(std::atomic<uint32_t> *Counter, void *Item)
+	{
+		std::lock_guard<std::mutex> lock(OverflowLock);
+
+		OverflowLists[Counter].push_back(Item);
+		Counter->fetch_add(1, std::memory_order_release);
+	}
+
+	void *Pop(std::atomic<uint32_t> *Counter)
+	{
+		std::lock_guard<std::mutex> lock(OverflowLock);
+
+		// Another consumer took the last one
+		auto itr = OverflowLists.find(Counter);
+
+		if (itr == OverflowLists.end())
+			return nullptr;
+
+		void *item = itr->second.front();
+		itr->second.pop_front();
+		Counter->fetch_sub(1, std::memory_order_relaxed);
+
+		if (itr->second.empty())
+			OverflowLists.erase(itr);
+
+		return item;
+	}
+}
\ No newline at end of file
@@ -1,15 +1,154 @@
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+//
+// Side storage for pointers that don't fit into a full PtrMultiProdCons ring. Lists are keyed by the queue's overflow
+// counter and released once they run empty. No platform dependencies.
+//
+namespace BSTLocklessQueueOverflow
+{
+	void Push(std::atomic<uint32_t> *Counter, void *Item);
+	void *Pop(std::atomic<uint32_t> *Counter);
+}
+
 struct BSTLocklessQueue
 {
+	constexpr static uint32_t Log2(size_t Value)
+	{
+		return Value <= 1 ? 0 : 1 + Log2(Value / 2);
+	}
+
+	//
+	// Bounded MPMC ring ("Bounded MPMC queue", Dmitry Vyukov) inside the engine's layout: Count pointer slots followed by
+	// four 32-bit words. Every slot carries its sequence in the 17 bits above the pointer, the lap of the position it
+	// belongs to plus a full bit, so producers and consumers only contend on their own position word. Zeroed memory
+	// (how the engine constructs these) is an empty ring at position 0.
+	//
+	// Truncated sequences can only make a thread that slept through 65536 laps misjudge a slot. It then either loses the
+	// position CAS or rechecks the position word before reporting full/empty, so results stay exact.
+	//
+	// A push into a full ring goes to BSTLocklessQueueOverflow instead. Overflowed items are popped once the ring runs
+	// dry, so ordering is FIFO per ring lap but not across an overflow. Items have to be user mode pointers (below 2^47).
+	//
 	template<typename T, size_t Count, size_t Unknown>
 	struct PtrMultiProdCons
 	{
-		T *QueueA[Count];
-		volatile unsigned int uiQueueStart;		// Assumed
-		volatile unsigned int uiQueueFetched;	// Assumed
-		volatile unsigned int uiQueueEnd;		// Assumed
-		volatile unsigned int uiQueueAlloced;	// Assumed
+		static_assert(Count >= 2 && Count <= 65536 && (Count & (Count - 1)) == 0, "Laps must wrap together with the 32-bit positions");
+
+		constexpr static uint32_t PointerBits = 47;
+		constexpr static uint64_t PointerMask = (1ull << PointerBits) - 1;
+		constexpr static uint32_t StateBits = 64 - PointerBits;
+		constexpr static uint32_t LapShift = Log2(Count);
+
+		std::atomic<uint64_t> QueueA[Count];	// T * | sequence << PointerBits
+		std::atomic<uint32_t> uiQueueStart;		// Next position to pop
+		std::atomic<uint32_t> uiQueueFetched;	// Items in the overflow list
+		std::atomic<uint32_t> uiQueueEnd;		// Next position to push
+		std::atomic<uint32_t> uiQueueAlloced;	// Unused, the engine's reserve counter
+
+		// Always succeeds
+		void Push(T *Item)
+		{
+			uint32_t position = uiQueueEnd.load(std::memory_order_relaxed);
+
+			for (;;)
+			{
+				auto& slot = QueueA[position & (Count - 1)];
+				int32_t diff = StateDiff(slot.load(std::memory_order_acquire) >> PointerBits, EmptyState(position));
+
+				if (diff == 0)
+				{
+					if (uiQueueEnd.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						slot.store(((uint64_t)(EmptyState(position) | 1) << PointerBits) | ((uint64_t)Item & PointerMask), std::memory_order_release);
+						return;
+					}
+				}
+				else if (diff < 0)
+				{
+					// The slot still holds last lap's item
+					uint32_t current = uiQueueEnd.load(std::memory_order_relaxed);
+
+					if (current == position)
+					{
+						BSTLocklessQueueOverflow::Push(&uiQueueFetched, Item);
+						return;
+					}
+
+					position = current;
+				}
+				else
+				{
+					position = uiQueueEnd.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Returns nullptr if the queue is empty
+		T *Pop()
+		{
+			uint32_t position = uiQueueStart.load(std::memory_order_relaxed);
+
+			for (;;)
+			{
+				auto& slot = QueueA[position & (Count - 1)];
+				uint64_t value = slot.load(std::memory_order_acquire);
+				int32_t diff = StateDiff(value >> PointerBits, EmptyState(position) | 1);
+
+				if (diff == 0)
+				{
+					if (uiQueueStart.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						slot.store((uint64_t)EmptyState(position + Count) << PointerBits, std::memory_order_release);
+						return (T *)(value & PointerMask);
+					}
+				}
+				else if (diff < 0)
+				{
+					// Nothing pushed to this slot yet
+					uint32_t current = uiQueueStart.load(std::memory_order_relaxed);
+
+					if (current == position)
+					{
+						if (uiQueueFetched.load(std::memory_order_acquire) == 0)
+							return nullptr;
+
+						return (T *)BSTLocklessQueueOverflow::Pop(&uiQueueFetched);
+					}
+
+					position = current;
+				}
+				else
+				{
+					position = uiQueueStart.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Not thread safe. Zeroed memory is the same as Reset(0).
+		void Reset(uint32_t Position)
+		{
+			for (uint32_t i = 0; i < Count; i++)
+				QueueA[(Position + i) & (Count - 1)].store((uint64_t)EmptyState(Position + i) << PointerBits, std::memory_order_relaxed);
+
+			uiQueueStart.store(Position, std::memory_order_relaxed);
+			uiQueueEnd.store(Position, std::memory_order_relaxed);
+		}
+
+	private:
+		// Empty slot waiting for the push at Position. The full state is one higher, the next empty state two.
+		static uint32_t EmptyState(uint32_t Position)
+		{
+			return ((Position >> LapShift) << 1) & ((1u << StateBits) - 1);
+		}
+
+		static int32_t StateDiff(uint64_t State, uint32_t Expected)
+		{
+			return (int32_t)(((uint32_t)State - Expected) << (32 - StateBits)) >> (32 - StateBits);
+		}
 	};
 
 	template<typename QueueContainer, typename T, size_t Count, size_t Unknown>
@@ -24,4 +163,6 @@ struct BSTLocklessQueue
 	struct ObjMultiProdCons : ObjQueueBase<PtrMultiProdCons<T, Count * 2, Unknown>, T, Count, Unknown>
 	{
 	};
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(BSTLocklessQueue::PtrMultiProdCons<void, 8192, 0>) == 8192 * sizeof(void *) + 0x10);
\ No newline at end of file
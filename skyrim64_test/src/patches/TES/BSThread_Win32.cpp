@@ -1,5 +1,6 @@
 #include <atomic>
 #include "../../common.h"
+#include "../threadplacement.h"
 
 std::atomic<const char *> NextThreadName;
 std::atomic<int> NextTaskletIndex;
@@ -27,9 +28,13 @@ DWORD WINAPI hk_BSThreadEntryFunc(LPVOID lpArg)
         XUtil::SetThreadName(tid, name);
 
     ui::log::Add("Created thread \"%s\" (ID %d)\n", name, tid);
+    ThreadPlacement::RegisterCurrentThread(name);
 
 	AutoFunc(LPTHREAD_START_ROUTINE, sub_140C0D1C0, 0xC0D1C0);
-    return sub_140C0D1C0(lpArg);
+    DWORD result = sub_140C0D1C0(lpArg);
+
+    ThreadPlacement::UnregisterCurrentThread();
+    return result;
 }
 
 LPTHREAD_START_ROUTINE TaskletEntryFunc;
@@ -40,8 +45,12 @@ DWORD WINAPI hk_TaskletEntryFunc(LPVOID lpArg)
 
     XUtil::SetThreadName(GetCurrentThreadId(), name);
 	ui::log::Add("Created thread \"%s\" (ID %d)\n", name, GetCurrentThreadId());
+    ThreadPlacement::RegisterCurrentThread(name);
 
-    return TaskletEntryFunc(lpArg);
+    DWORD result = TaskletEntryFunc(lpArg);
+
+    ThreadPlacement::UnregisterCurrentThread();
+    return result;
 }
 
 void PatchBSThread()
@@ -48,7 +48,10 @@ public:
 	NiTransform m_kPreviousWorld;
 	NiBound m_kWorldBound;
 	uint32_t m_uFlags;
-	char _pad2[0x18];
+	char _pad2[0x10];
+	uint8_t m_ucCurrentMeshLODLevel;	// Assumed, written from BSRenderPass::m_LODMode before drawing
+	uint8_t m_ucRenderFlags;			// Assumed, 0x8 = needs custom render (BSBatchRenderer::RenderPassImmediately_Custom)
+	char _pad3[0x6];
 
 	const NiTransform& GetWorldTransform() const
 	{
@@ -65,6 +68,11 @@ public:
 		return m_kWorld.m_Translate;
 	}
 
+	bool QNeedsCustomRender() const
+	{
+		return (m_ucRenderFlags & 8) != 0;
+	}
+
 	bool QAppCulled() const
 	{
 		return (m_uFlags & APP_CULLED) != 0;
@@ -155,6 +163,8 @@ static_assert_offset(NiAVObject, m_kWorld, 0x7C);
 static_assert_offset(NiAVObject, m_kPreviousWorld, 0xB0);
 static_assert_offset(NiAVObject, m_kWorldBound, 0xE4);
 static_assert_offset(NiAVObject, m_uFlags, 0xF4);
+static_assert_offset(NiAVObject, m_ucCurrentMeshLODLevel, 0x108);
+static_assert_offset(NiAVObject, m_ucRenderFlags, 0x109);
 
 STATIC_CONSTRUCTOR(CheckNiAVObject, []
 {
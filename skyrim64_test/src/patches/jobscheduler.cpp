@@ -0,0 +1,415 @@
+#include <chrono>
+#include <algorithm>
+#include "jobscheduler.h"
+
+namespace JobScheduler
+{
+	WorkStealingDeque::WorkStealingDeque() : m_Top(0), m_Bottom(0), m_Mask(-1)
+	{
+	}
+
+	void WorkStealingDeque::Reserve(uint32_t Count)
+	{
+		// Not thread safe: only called between graphs
+		int64_t capacity = 64;
+
+		while (capacity < Count)
+			capacity *= 2;
+
+		if (capacity - 1 > m_Mask)
+		{
+			m_Buffer.reset(new std::atomic<uint32_t>[capacity]);
+			m_Mask = capacity - 1;
+		}
+
+		m_Top.store(0, std::memory_order_relaxed);
+		m_Bottom.store(0, std::memory_order_relaxed);
+	}
+
+	bool WorkStealingDeque::Push(uint32_t Value)
+	{
+		int64_t b = m_Bottom.load(std::memory_order_relaxed);
+		int64_t t = m_Top.load(std::memory_order_acquire);
+
+		if (b - t > m_Mask)
+			return false;
+
+		m_Buffer[b & m_Mask].store(Value, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	uint32_t WorkStealingDeque::Pop()
+	{
+		int64_t b = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = m_Top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			// Already empty
+			m_Bottom.store(b + 1, std::memory_order_relaxed);
+			return EMPTY;
+		}
+
+		uint32_t value = m_Buffer[b & m_Mask].load(std::memory_order_relaxed);
+
+		if (t == b)
+		{
+			// Last element: race against thieves
+			if (!m_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				value = EMPTY;
+
+			m_Bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return value;
+	}
+
+	uint32_t WorkStealingDeque::Steal()
+	{
+		int64_t t = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = m_Bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return EMPTY;
+
+		uint32_t value = m_Buffer[t & m_Mask].load(std::memory_order_relaxed);
+
+		if (!m_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return EMPTY;
+
+		return value;
+	}
+
+	uint32_t JobGraph::AddJob(JobFunction Function, void *Parameter)
+	{
+		uint32_t index = (uint32_t)m_Nodes.size();
+		m_Nodes.push_back({ Function, Parameter, 0, {} });
+
+		// Everything after a sync point waits for it
+		if (m_LastSyncPoint != INVALID_NODE)
+			AddDependency(m_LastSyncPoint, index);
+
+		return index;
+	}
+
+	uint32_t JobGraph::AddSyncPoint()
+	{
+		uint32_t index = (uint32_t)m_Nodes.size();
+		m_Nodes.push_back({ nullptr, nullptr, 0, {} });
+
+		// Wait for the whole stage, or the previous sync point if the stage was empty
+		for (uint32_t i = m_StageStart; i < index; i++)
+			AddDependency(i, index);
+
+		if (m_StageStart == index && m_LastSyncPoint != INVALID_NODE)
+			AddDependency(m_LastSyncPoint, index);
+
+		m_LastSyncPoint = index;
+		m_StageStart = index + 1;
+		return index;
+	}
+
+	void JobGraph::AddJobList(const JobListEntry *Entries, uint32_t Count, bool(*IsSync)(JobFunction), JobFunction Dispatch)
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			const JobListEntry& entry = Entries[i];
+			const bool sync = IsSync && IsSync(entry.Function);
+
+			if (sync)
+				AddSyncPoint();
+
+			if (Dispatch)
+				AddJob(Dispatch, (void *)&entry);
+			else
+				AddJob(entry.Function, entry.Parameter);
+
+			if (sync)
+				AddSyncPoint();
+		}
+	}
+
+	void JobGraph::AddDependency(uint32_t Before, uint32_t After)
+	{
+		m_Nodes[Before].Dependents.push_back(After);
+		m_Nodes[After].DependencyCount++;
+	}
+
+	void JobGraph::Clear()
+	{
+		m_Nodes.clear();
+		m_StageStart = 0;
+		m_LastSyncPoint = INVALID_NODE;
+	}
+
+	uint32_t JobGraph::GetNodeCount() const
+	{
+		return (uint32_t)m_Nodes.size();
+	}
+
+	Scheduler::Scheduler(uint32_t ThreadCount) : m_ThreadCount(std::max<uint32_t>(ThreadCount, 1)), m_WorkEpoch(0), m_ParkedWorkers(0), m_Remaining(0), m_ActiveWorkers(0)
+	{
+		m_Workers.reset(new Worker[m_ThreadCount]);
+		ResetWorkerStats();
+
+		for (uint32_t i = 1; i < m_ThreadCount; i++)
+			m_Threads.emplace_back(&Scheduler::WorkerThread, this, i);
+	}
+
+	Scheduler::~Scheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeLock);
+			m_Terminate = true;
+		}
+
+		m_WakeCondition.notify_all();
+
+		for (auto& thread : m_Threads)
+			thread.join();
+	}
+
+	void Scheduler::Run(JobGraph& Graph)
+	{
+		const uint32_t nodeCount = Graph.GetNodeCount();
+
+		if (nodeCount == 0)
+			return;
+
+		// Workers are parked at this point, so the shared state can be rebuilt without atomics
+		if (nodeCount > m_PendingCapacity)
+		{
+			m_Pending.reset(new std::atomic<uint32_t>[nodeCount]);
+			m_PendingCapacity = nodeCount;
+		}
+
+		for (uint32_t i = 0; i < nodeCount; i++)
+			m_Pending[i].store(Graph.m_Nodes[i].DependencyCount, std::memory_order_relaxed);
+
+		for (uint32_t i = 0; i < m_ThreadCount; i++)
+			m_Workers[i].Deque.Reserve(nodeCount);
+
+		m_Graph = &Graph;
+		m_Remaining.store(nodeCount, std::memory_order_relaxed);
+		m_ActiveWorkers.store(m_ThreadCount, std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> lock(m_WakeLock);
+			m_Generation++;
+		}
+
+		m_WakeCondition.notify_all();
+		ExecuteGraph(0);
+
+		// Deques and counters get reused by the next Run(), so wait for every worker to leave
+		{
+			std::unique_lock<std::mutex> lock(m_WakeLock);
+			m_DoneCondition.wait(lock, [&] { return m_ActiveWorkers.load(std::memory_order_acquire) == 0; });
+		}
+
+		m_Graph = nullptr;
+	}
+
+	void Scheduler::WorkerThread(uint32_t Index)
+	{
+		uint64_t lastGeneration = 0;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_WakeLock);
+				m_WakeCondition.wait(lock, [&] { return m_Terminate || m_Generation != lastGeneration; });
+
+				if (m_Terminate)
+					return;
+
+				lastGeneration = m_Generation;
+			}
+
+			ExecuteGraph(Index);
+		}
+	}
+
+	void Scheduler::ExecuteGraph(uint32_t Index)
+	{
+		using clock = std::chrono::steady_clock;
+
+		Worker& self = m_Workers[Index];
+		const auto& nodes = m_Graph->m_Nodes;
+
+		// Distribute the initial (dependency free) jobs round-robin. Each worker only pushes its own
+		// share because a Chase-Lev deque has a single producer.
+		for (uint32_t i = 0, root = 0; i < (uint32_t)nodes.size(); i++)
+		{
+			if (nodes[i].DependencyCount != 0)
+				continue;
+
+			if (root++ % m_ThreadCount == Index)
+				self.Deque.Push(i);
+		}
+
+		auto lastTransition = clock::now();
+		bool idle = false;
+		uint32_t misses = 0;
+
+		while (m_Remaining.load(std::memory_order_acquire) != 0)
+		{
+			// Read before looking for work: anything pushed after this changes the epoch and cancels parking
+			uint64_t epoch = m_WorkEpoch.load(std::memory_order_seq_cst);
+			bool executed = TryExecuteOne(Index);
+
+			// Only take a timestamp when switching between busy and idle states
+			if (executed == idle)
+			{
+				auto now = clock::now();
+				uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastTransition).count();
+
+				(idle ? self.Stats.IdleNanoseconds : self.Stats.BusyNanoseconds).fetch_add(elapsed, std::memory_order_relaxed);
+				lastTransition = now;
+				idle = !executed;
+			}
+
+			// A few more attempts catch jobs that are about to be released, then the worker sleeps
+			if (executed)
+				misses = 0;
+			else if (++misses >= SpinsBeforePark)
+				Park(epoch);
+		}
+
+		uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - lastTransition).count();
+		(idle ? self.Stats.IdleNanoseconds : self.Stats.BusyNanoseconds).fetch_add(elapsed, std::memory_order_relaxed);
+
+		if (m_ActiveWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_WakeLock);
+			m_DoneCondition.notify_one();
+		}
+	}
+
+	void Scheduler::Park(uint64_t Epoch)
+	{
+		std::unique_lock<std::mutex> lock(m_ParkLock);
+
+		m_ParkedWorkers.fetch_add(1, std::memory_order_seq_cst);
+		m_ParkCondition.wait(lock, [&]
+		{
+			return m_WorkEpoch.load(std::memory_order_seq_cst) != Epoch || m_Remaining.load(std::memory_order_acquire) == 0;
+		});
+		m_ParkedWorkers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void Scheduler::WakeParked(uint32_t ReadyCount)
+	{
+		// Either a parking worker sees the new epoch, or it's registered as parked before this reads the count
+		m_WorkEpoch.fetch_add(1, std::memory_order_seq_cst);
+
+		if (m_ParkedWorkers.load(std::memory_order_seq_cst) == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_ParkLock);
+
+		if (ReadyCount == 1)
+			m_ParkCondition.notify_one();
+		else
+			m_ParkCondition.notify_all();
+	}
+
+	bool Scheduler::TryExecuteOne(uint32_t Index)
+	{
+		Worker& self = m_Workers[Index];
+		uint32_t node = WorkStealingDeque::EMPTY;
+
+		if (!self.Spilled.empty())
+		{
+			node = self.Spilled.back();
+			self.Spilled.pop_back();
+		}
+
+		if (node == WorkStealingDeque::EMPTY)
+			node = self.Deque.Pop();
+
+		// Steal starting from the next worker so thieves don't all hammer worker 0
+		for (uint32_t i = 1; node == WorkStealingDeque::EMPTY && i < m_ThreadCount; i++)
+		{
+			node = m_Workers[(Index + i) % m_ThreadCount].Deque.Steal();
+
+			if (node != WorkStealingDeque::EMPTY)
+				self.Stats.Steals.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (node == WorkStealingDeque::EMPTY)
+			return false;
+
+		auto& entry = m_Graph->m_Nodes[node];
+
+		if (entry.Function)
+		{
+			entry.Function(entry.Parameter);
+			self.Stats.JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		CompleteNode(Index, node);
+		return true;
+	}
+
+	void Scheduler::CompleteNode(uint32_t Index, uint32_t Node)
+	{
+		Worker& self = m_Workers[Index];
+
+		uint32_t ready = 0;
+
+		// Newly ready jobs go to the worker that released them (they're likely to share data)
+		for (uint32_t dependent : m_Graph->m_Nodes[Node].Dependents)
+		{
+			if (m_Pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				if (self.Deque.Push(dependent))
+					ready++;
+				else
+					self.Spilled.push_back(dependent);
+			}
+		}
+
+		// The last node lets every parked worker leave. Spilled jobs can't be stolen, so nobody is woken for them.
+		if (m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			WakeParked(m_ThreadCount);
+		else if (ready > 0)
+			WakeParked(ready);
+	}
+
+	uint32_t Scheduler::GetWorkerCount() const
+	{
+		return m_ThreadCount;
+	}
+
+	WorkerStats Scheduler::GetWorkerStats(uint32_t Index) const
+	{
+		const WorkerCounters& counters = m_Workers[Index].Stats;
+
+		WorkerStats stats;
+		stats.BusyNanoseconds = counters.BusyNanoseconds.load(std::memory_order_relaxed);
+		stats.IdleNanoseconds = counters.IdleNanoseconds.load(std::memory_order_relaxed);
+		stats.JobsExecuted = counters.JobsExecuted.load(std::memory_order_relaxed);
+		stats.Steals = counters.Steals.load(std::memory_order_relaxed);
+
+		return stats;
+	}
+
+	void Scheduler::ResetWorkerStats()
+	{
+		for (uint32_t i = 0; i < m_ThreadCount; i++)
+		{
+			WorkerCounters& counters = m_Workers[i].Stats;
+
+			counters.BusyNanoseconds.store(0, std::memory_order_relaxed);
+			counters.IdleNanoseconds.store(0, std::memory_order_relaxed);
+			counters.JobsExecuted.store(0, std::memory_order_relaxed);
+			counters.Steals.store(0, std::memory_order_relaxed);
+		}
+	}
+}
\ No newline at end of file
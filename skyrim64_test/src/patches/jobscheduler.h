@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+//
+// Work-stealing job scheduler intended to sit underneath BSJobs job lists. Jobs are spread over
+// per-worker Chase-Lev deques; idle workers steal from the others instead of waiting for a long
+// job to finish its stage, and sleep once there's nothing left to steal. No Windows dependencies.
+//
+namespace JobScheduler
+{
+	using JobFunction = void(*)(void *);
+
+	// One entry of a BSJobs job list, stored the way the engine's dispatch loop reads it
+	struct JobListEntry
+	{
+		JobFunction Function;
+		void *Parameter;
+	};
+
+	//
+	// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli)
+	//
+	// Only the owning worker calls Push()/Pop(). Any worker may call Steal(). The capacity is fixed
+	// while a graph is running, see Reserve().
+	//
+	class WorkStealingDeque
+	{
+	private:
+		std::atomic<int64_t> m_Top;
+		std::atomic<int64_t> m_Bottom;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_Buffer;
+		int64_t m_Mask;
+
+	public:
+		constexpr static uint32_t EMPTY = 0xFFFFFFFF;
+
+		WorkStealingDeque();
+
+		void Reserve(uint32_t Count);
+		bool Push(uint32_t Value);
+		uint32_t Pop();
+		uint32_t Steal();
+	};
+
+	class JobGraph
+	{
+		friend class Scheduler;
+
+	private:
+		struct Node
+		{
+			JobFunction Function;			// nullptr for sync points
+			void *Parameter;
+			uint32_t DependencyCount;
+			std::vector<uint32_t> Dependents;
+		};
+
+		constexpr static uint32_t INVALID_NODE = 0xFFFFFFFF;
+
+		std::vector<Node> m_Nodes;
+		uint32_t m_StageStart = 0;
+		uint32_t m_LastSyncPoint = INVALID_NODE;
+
+	public:
+		uint32_t AddJob(JobFunction Function, void *Parameter);
+		uint32_t AddSyncPoint();
+
+		// Entries where IsSync() returns true (the engine's signal/sync jobs) run on their own, after everything
+		// before them and before everything after them. Every job runs through Dispatch(&Entries[i]) if it's given,
+		// otherwise the entry's function is called directly.
+		void AddJobList(const JobListEntry *Entries, uint32_t Count, bool(*IsSync)(JobFunction), JobFunction Dispatch = nullptr);
+		void AddDependency(uint32_t Before, uint32_t After);
+		void Clear();
+
+		uint32_t GetNodeCount() const;
+	};
+
+	// Snapshot returned by Scheduler::GetWorkerStats()
+	struct WorkerStats
+	{
+		uint64_t BusyNanoseconds;
+		uint64_t IdleNanoseconds;
+		uint64_t JobsExecuted;
+		uint64_t Steals;
+	};
+
+	class Scheduler
+	{
+	private:
+		// Only the owning worker adds to these, but any thread may read or reset them while a graph runs
+		struct WorkerCounters
+		{
+			std::atomic<uint64_t> BusyNanoseconds;
+			std::atomic<uint64_t> IdleNanoseconds;
+			std::atomic<uint64_t> JobsExecuted;
+			std::atomic<uint64_t> Steals;
+		};
+
+		struct alignas(64) Worker
+		{
+			WorkStealingDeque Deque;
+			WorkerCounters Stats;
+			std::vector<uint32_t> Spilled;
+		};
+
+		// Failed attempts to find a job before an idle worker parks
+		constexpr static uint32_t SpinsBeforePark = 64;
+
+		uint32_t m_ThreadCount;
+		std::vector<std::thread> m_Threads;
+		std::unique_ptr<Worker[]> m_Workers;
+
+		std::mutex m_WakeLock;
+		std::condition_variable m_WakeCondition;
+		std::condition_variable m_DoneCondition;	// Last worker left ExecuteGraph()
+		uint64_t m_Generation = 0;
+		bool m_Terminate = false;
+
+		// Workers without anything to run or steal sleep here until a job becomes ready or the graph is done
+		std::mutex m_ParkLock;
+		std::condition_variable m_ParkCondition;
+		std::atomic<uint64_t> m_WorkEpoch;
+		std::atomic<uint32_t> m_ParkedWorkers;
+
+		JobGraph *m_Graph = nullptr;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_Pending;
+		uint32_t m_PendingCapacity = 0;
+		std::atomic<uint32_t> m_Remaining;
+		std::atomic<uint32_t> m_ActiveWorkers;
+
+		void WorkerThread(uint32_t Index);
+		void ExecuteGraph(uint32_t Index);
+		bool TryExecuteOne(uint32_t Index);
+		void CompleteNode(uint32_t Index, uint32_t Node);
+		void Park(uint64_t Epoch);
+		void WakeParked(uint32_t ReadyCount);
+
+	public:
+		// The thread calling Run() participates as worker 0, so ThreadCount - 1 threads are created
+		Scheduler(uint32_t ThreadCount);
+		~Scheduler();
+
+		void Run(JobGraph& Graph);
+
+		uint32_t GetWorkerCount() const;
+		WorkerStats GetWorkerStats(uint32_t Index) const;
+		void ResetWorkerStats();
+	};
+}
\ No newline at end of file
@@ -90,6 +90,9 @@ void Patch_TESV()
 	//
 	//Detours::X64::DetourFunctionClass((PBYTE)(g_ModuleBase + 0xD50310), &BSCullingProcess::hk_Process);
 
+	// m_CullQueue's rings (BSTLocklessQueue::PtrMultiProdCons) accept the zeroed memory the engine constructs them in. The
+	// engine's push/pop routines haven't been located yet; they get detoured to PtrMultiProdCons::Push/Pop once they are.
+
 	//Detours::X64::DetourFunctionClass((PBYTE)(g_ModuleBase + 0x12F93B1), &test1, Detours::X64Option::USE_REL32_JUMP);
 	//XUtil::PatchMemory(g_ModuleBase + 0x12F93B1, (PBYTE)"\xE8", 1);
 
@@ -0,0 +1,112 @@
+#include <string.h>
+#include <algorithm>
+#include "radixsort.h"
+
+namespace RadixSort
+{
+	// Below RadixThreshold a merge sort over insertion sorted runs wins: the radix sort has a fixed
+	// cost for clearing and walking 8 histograms
+	constexpr size_t RunLength = 32;
+	constexpr size_t RadixThreshold = 768;
+
+	void InsertionSort(KeyValue *Data, size_t Count)
+	{
+		for (size_t i = 1; i < Count; i++)
+		{
+			KeyValue temp = Data[i];
+			size_t j = i;
+
+			for (; j > 0 && Data[j - 1].Key > temp.Key; j--)
+				Data[j] = Data[j - 1];
+
+			Data[j] = temp;
+		}
+	}
+
+	void MergeSort(KeyValue *Data, KeyValue *Scratch, size_t Count)
+	{
+		for (size_t i = 0; i < Count; i += RunLength)
+			InsertionSort(&Data[i], std::min(RunLength, Count - i));
+
+		KeyValue *source = Data;
+		KeyValue *dest = Scratch;
+
+		for (size_t width = RunLength; width < Count; width *= 2)
+		{
+			for (size_t start = 0; start < Count; start += width * 2)
+			{
+				size_t mid = std::min(start + width, Count);
+				size_t end = std::min(start + width * 2, Count);
+				size_t a = start;
+				size_t b = mid;
+				size_t out = start;
+
+				// <= keeps equal keys in their original order
+				while (a < mid && b < end)
+					dest[out++] = (source[a].Key <= source[b].Key) ? source[a++] : source[b++];
+
+				while (a < mid)
+					dest[out++] = source[a++];
+
+				while (b < end)
+					dest[out++] = source[b++];
+			}
+
+			std::swap(source, dest);
+		}
+
+		if (source != Data)
+			memcpy(Data, source, Count * sizeof(KeyValue));
+	}
+
+	void Sort64(KeyValue *Data, KeyValue *Scratch, size_t Count)
+	{
+		if (Count < RadixThreshold)
+		{
+			MergeSort(Data, Scratch, Count);
+			return;
+		}
+
+		// Every histogram is built in a single read pass
+		uint32_t histograms[8][256] = {};
+
+		for (size_t i = 0; i < Count; i++)
+		{
+			uint64_t key = Data[i].Key;
+
+			for (int b = 0; b < 8; b++)
+				histograms[b][(key >> (b * 8)) & 0xFF]++;
+		}
+
+		KeyValue *source = Data;
+		KeyValue *dest = Scratch;
+
+		for (int b = 0; b < 8; b++)
+		{
+			uint32_t *histogram = histograms[b];
+
+			// All keys share this byte: ordering can't change
+			if (histogram[(source[0].Key >> (b * 8)) & 0xFF] == Count)
+				continue;
+
+			uint32_t offset = 0;
+
+			for (int i = 0; i < 256; i++)
+			{
+				uint32_t count = histogram[i];
+				histogram[i] = offset;
+				offset += count;
+			}
+
+			for (size_t i = 0; i < Count; i++)
+				dest[histogram[(source[i].Key >> (b * 8)) & 0xFF]++] = source[i];
+
+			KeyValue *temp = source;
+			source = dest;
+			dest = temp;
+		}
+
+		if (source != Data)
+			memcpy(Data, source, Count * sizeof(KeyValue));
+	}
+}
\ No newline at end of file
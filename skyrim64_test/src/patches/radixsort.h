@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Stable LSD radix sort over 64-bit keys with an attached payload. Byte positions where every key
+// is identical are skipped, so keys with mostly constant high bits (e.g. one technique per list)
+// cost only the passes that actually differ. Short inputs use a merge sort instead. No platform
+// dependencies.
+//
+namespace RadixSort
+{
+	struct KeyValue
+	{
+		uint64_t Key;
+		uint64_t Value;
+	};
+
+	// Scratch must hold Count entries. The sorted result is always written back to Data.
+	void Sort64(KeyValue *Data, KeyValue *Scratch, size_t Count);
+}
\ No newline at end of file
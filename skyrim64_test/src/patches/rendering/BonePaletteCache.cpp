@@ -0,0 +1,70 @@
+#include <string.h>
+#include "BonePaletteCache.h"
+
+BonePaletteCache::PaletteKey::PaletteKey()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+BonePaletteCache::PaletteKey::PaletteKey(const void *SkinInstance, uint32_t Generation, const void *Transform, const void *PosAdjust, const void *PreviousPosAdjust)
+{
+	this->SkinInstance = SkinInstance;
+	this->Generation = Generation;
+	this->HasTransform = Transform != nullptr;
+
+	if (Transform)
+		memcpy(this->Transform, Transform, sizeof(this->Transform));
+	else
+		memset(this->Transform, 0, sizeof(this->Transform));
+
+	memcpy(this->PosAdjust, PosAdjust, sizeof(this->PosAdjust));
+	memcpy(this->PreviousPosAdjust, PreviousPosAdjust, sizeof(this->PreviousPosAdjust));
+}
+
+bool BonePaletteCache::PaletteKey::operator==(const PaletteKey& Other) const
+{
+	// Bitwise, so -0.0f and NaNs never match something that would produce a different palette
+	return SkinInstance == Other.SkinInstance &&
+		Generation == Other.Generation &&
+		HasTransform == Other.HasTransform &&
+		memcmp(Transform, Other.Transform, sizeof(Transform)) == 0 &&
+		memcmp(PosAdjust, Other.PosAdjust, sizeof(PosAdjust)) == 0 &&
+		memcmp(PreviousPosAdjust, Other.PreviousPosAdjust, sizeof(PreviousPosAdjust)) == 0;
+}
+
+bool BonePaletteCache::PaletteKey::operator!=(const PaletteKey& Other) const
+{
+	return !(*this == Other);
+}
+
+BonePaletteCache::BonePaletteCache(uint32_t SlotCount) : m_Entries(SlotCount)
+{
+	Clear();
+}
+
+uint32_t BonePaletteCache::QSlot(const void *SkinInstance) const
+{
+	// Skin instances are heap allocated, the low bits are always zero
+	return (uint32_t)(((uintptr_t)SkinInstance >> 4) % m_Entries.size());
+}
+
+bool BonePaletteCache::Lookup(const PaletteKey& Key, uint32_t& Slot) const
+{
+	Slot = QSlot(Key.SkinInstance);
+
+	auto& entry = m_Entries[Slot];
+	return entry.Valid && entry.Key == Key;
+}
+
+void BonePaletteCache::Store(uint32_t Slot, const PaletteKey& Key)
+{
+	auto& entry = m_Entries[Slot];
+	entry.Valid = true;
+	entry.Key = Key;
+}
+
+void BonePaletteCache::Clear()
+{
+	for (auto& entry : m_Entries)
+		entry.Valid = false;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//
+// Remembers which skin instances already had their bone palettes built and uploaded in the current constant buffer
+// generation. The palette depends on more than the skin instance: the transform passed to SetBoneMatrix and the
+// camera relative PosAdjust (current and previous frame) are part of the key, compared bit for bit.
+//
+// Entries are direct mapped by skin instance address, a collision simply replaces the older entry. The cache only
+// tracks keys: callers keep whatever they need to rebind a palette (ring offsets) in their own array indexed by slot.
+// Not thread safe and no D3D dependencies.
+//
+class BonePaletteCache
+{
+public:
+	struct PaletteKey
+	{
+		const void *SkinInstance;
+		uint32_t Generation;			// Constant buffer ring generation the palette was uploaded in
+		bool HasTransform;
+		float Transform[13];			// NiTransform: rotation, translation, scale. Ignored without HasTransform.
+		float PosAdjust[3];
+		float PreviousPosAdjust[3];
+
+		PaletteKey();
+		PaletteKey(const void *SkinInstance, uint32_t Generation, const void *Transform, const void *PosAdjust, const void *PreviousPosAdjust);
+
+		bool operator==(const PaletteKey& Other) const;
+		bool operator!=(const PaletteKey& Other) const;
+	};
+
+	BonePaletteCache(uint32_t SlotCount);
+
+	uint32_t QSlot(const void *SkinInstance) const;
+
+	// Returns true when Slot holds a palette built for exactly this key. Lookups don't modify the cache, so they can
+	// share a reader lock.
+	bool Lookup(const PaletteKey& Key, uint32_t& Slot) const;
+	void Store(uint32_t Slot, const PaletteKey& Key);
+	void Clear();
+
+private:
+	struct Entry
+	{
+		bool Valid;
+		PaletteKey Key;
+	};
+
+	std::vector<Entry> m_Entries;
+};
\ No newline at end of file
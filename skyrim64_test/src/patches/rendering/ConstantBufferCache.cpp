@@ -0,0 +1,133 @@
+#include <memory>
+#include "ConstantBufferCache.h"
+#include "d3d11_capture.h"
+
+struct ThreadUploadState
+{
+	constexpr static uint32_t StagingSize = 256 * 1024;
+	constexpr static uint32_t CopySize = 1024 * 1024;
+	constexpr static uint32_t TableSize = 4096;
+
+	struct Entry
+	{
+		uint64_t Hash;
+		uint32_t Size;
+		uint32_t Offset;
+		uint32_t Generation;
+		uint32_t CopyOffset;	// Contents at Copies[CopyOffset], valid while CopyEpoch matches
+		uint32_t CopyEpoch;
+	};
+
+	alignas(16) uint8_t Staging[StagingSize];
+	uint32_t StagingOffset = 0;
+
+	// Filled linearly and reset once per frame or when full. Resetting bumps CopyEpoch, which drops every
+	// table entry at once.
+	alignas(16) uint8_t Copies[CopySize];
+	uint32_t CopyOffset = 0;
+	uint32_t CopyEpoch = 1;
+	uint32_t CopyGeneration = 0;
+
+	Entry Table[TableSize] = {};
+
+	void ResetCopies()
+	{
+		CopyOffset = 0;
+		CopyEpoch++;
+	}
+};
+
+thread_local std::unique_ptr<ThreadUploadState> ThreadUploads;
+
+ThreadUploadState *GetThreadUploads()
+{
+	if (!ThreadUploads)
+		ThreadUploads = std::make_unique<ThreadUploadState>();
+
+	return ThreadUploads.get();
+}
+
+ConstantBufferCache::ConstantBufferCache(GpuCircularBuffer *Buffer) : m_Buffer(Buffer), m_Generation(1)
+{
+}
+
+void *ConstantBufferCache::BeginUpload(uint32_t Size)
+{
+	auto state = GetThreadUploads();
+
+	// Several groups (VS/PS, multiple levels) are filled at the same time, so the staging memory only
+	// wraps once a small allocation no longer fits
+	AssertMsg(Size <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16, "Constant group exceeds the D3D11 constant buffer limit");
+
+	if (state->StagingOffset + Size > ThreadUploadState::StagingSize)
+		state->StagingOffset = 0;
+
+	void *data = &state->Staging[state->StagingOffset];
+	state->StagingOffset += (Size + 15) & ~15u;
+
+	memset(data, 0, Size);
+	return data;
+}
+
+uint32_t ConstantBufferCache::EndUpload(const void *Data, uint32_t Size)
+{
+	auto state = GetThreadUploads();
+	uint32_t generation = m_Generation.load(std::memory_order_relaxed);
+
+	ProfileCounterAdd("CB Bytes Requested", Size);
+
+	if (state->CopyGeneration != generation)
+	{
+		state->CopyGeneration = generation;
+		state->ResetCopies();
+	}
+
+	uint64_t hash = XUtil::MurmurHash64A(Data, Size);
+	auto& entry = state->Table[hash & (ThreadUploadState::TableSize - 1)];
+
+	if (entry.Generation == generation && entry.CopyEpoch == state->CopyEpoch && entry.Hash == hash && entry.Size == Size)
+	{
+		if (memcmp(&state->Copies[entry.CopyOffset], Data, Size) == 0)
+		{
+			ProfileCounterInc("CB Redundant Uploads");
+			return entry.Offset;
+		}
+
+		ProfileCounterInc("CB Hash Collisions");
+	}
+
+	uint32_t alignedSize = AlignSize(Size);
+	uint32_t offset;
+
+	memcpy(m_Buffer->Allocate(alignedSize, Alignment, &offset), Data, Size);
+	ProfileCounterAdd("CB Bytes Uploaded", Size);
+	D3D11Capture::RecordUpload(m_Buffer->D3DBuffer, Size);
+	ProfileCounterAdd("CB Bytes Wasted", alignedSize - Size);
+
+	uint32_t copySize = (Size + 15) & ~15u;
+
+	if (state->CopyOffset + copySize > ThreadUploadState::CopySize)
+		state->ResetCopies();
+
+	memcpy(&state->Copies[state->CopyOffset], Data, Size);
+
+	entry.Hash = hash;
+	entry.Size = Size;
+	entry.Offset = offset;
+	entry.Generation = generation;
+	entry.CopyOffset = state->CopyOffset;
+	entry.CopyEpoch = state->CopyEpoch;
+
+	state->CopyOffset += copySize;
+	return offset;
+}
+
+void ConstantBufferCache::NextFrame()
+{
+	m_Generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t ConstantBufferCache::QGeneration() const
+{
+	return m_Generation.load(std::memory_order_relaxed);
+}
\ No newline at end of file
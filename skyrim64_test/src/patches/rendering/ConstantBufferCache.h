@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include "GpuCircularBuffer.h"
+
+//
+// Sits between the shaders and GpuCircularBuffer. Constant groups are filled in CPU memory first, then
+// hashed: contents identical to an earlier upload in the same frame reuse that ring offset and skip the
+// copy. Everything else goes to the calling thread's ring chunk, each group aligned to the 256 byte
+// (16 constant) granularity required by *SetConstantBuffers1 offsets.
+//
+// Every thread gets its own staging memory and lookup table. Uploads are also copied to a per-thread
+// CPU arena, and a hash + size match is only reused after comparing against that copy. Reading back
+// the write-combined ring memory instead would cost more than the upload being skipped.
+//
+class ConstantBufferCache
+{
+public:
+	constexpr static uint32_t Alignment = 256;
+
+	ConstantBufferCache(GpuCircularBuffer *Buffer);
+
+	// Returns zeroed staging memory for Size bytes. Stays valid for the next few allocations only.
+	void *BeginUpload(uint32_t Size);
+
+	// Returns the byte offset of Data's contents in the ring buffer
+	uint32_t EndUpload(const void *Data, uint32_t Size);
+
+	// Ring memory from older frames can be reused by the GPU allocator, so cached offsets expire here
+	void NextFrame();
+
+	// Offsets returned by EndUpload() stay valid while this value doesn't change
+	uint32_t QGeneration() const;
+
+	static uint32_t AlignSize(uint32_t Size)
+	{
+		return (Size + Alignment - 1) & ~(Alignment - 1);
+	}
+
+private:
+	GpuCircularBuffer *m_Buffer;
+	std::atomic_uint32_t m_Generation;
+};
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include "../../common.h"
+#include "../../timebase.h"
+#include "DynamicBufferRing.h"
+
+void DynamicBufferRing::Adopt(ID3D11Device *Device, ID3D11Buffer *const *Buffers, ID3D11Query *const *Queries, uint32_t Count)
+{
+	AssertMsg(Count > 0 && Count <= MaxBuffers, "Unexpected number of dynamic buffers");
+
+	D3D11_BUFFER_DESC desc;
+	Buffers[0]->GetDesc(&desc);
+
+	m_Device = Device;
+	m_Count = Count;
+	m_BufferSize = desc.ByteWidth;
+	m_Current = 0;
+	m_Offset = 0;
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		m_Slots[i].Buffer = Buffers[i];
+		m_Slots[i].Query = Queries[i];
+		m_Slots[i].Pending = false;
+		m_Slots[i].FenceDeferred = false;
+
+		m_Slots[i].Buffer->AddRef();
+		m_Slots[i].Query->AddRef();
+	}
+
+	m_LastStats.BufferCount = m_Count;
+	m_LastStats.BufferSize = m_BufferSize;
+}
+
+bool DynamicBufferRing::IsInitialized() const
+{
+	return m_Count > 0;
+}
+
+void *DynamicBufferRing::Allocate(ID3D11DeviceContext *Context, uint32_t Size, uint32_t *Offset)
+{
+	AssertMsg(Size > 0 && Size <= MaxBufferSize, "Dynamic geometry buffer overflow.");
+	ProfileCounterAdd("VIB Bytes Requested", Size);
+
+	m_LargestAllocation = std::max(m_LargestAllocation, Size);
+
+	if (Size > m_BufferSize)
+	{
+		uint32_t size = m_BufferSize;
+
+		while (size < Size)
+			size *= 2;
+
+		Resize(Context, std::min(m_Count, MemoryBudget / size), std::min(size, MaxBufferSize));
+	}
+
+	//
+	// Check if this request would exceed the current buffer. If it does, we end the current query and move on to the
+	// next buffer.
+	//
+	if (m_Offset + Size > m_BufferSize)
+	{
+		m_FrameBytes += m_BufferSize - m_Offset;
+
+		Fence(Context, m_Slots[m_Current]);
+
+		m_Current = (m_Current + 1) % m_Count;
+		m_Offset = 0;
+	}
+
+	// Commands using this buffer haven't been submitted yet, there's nothing to wait on
+	if (m_Slots[m_Current].FenceDeferred)
+		GrowForDeferred(Context);
+
+	Slot& slot = m_Slots[m_Current];
+
+	if (slot.Pending)
+		WaitForSlot(Context, slot);
+
+	D3D11_MAPPED_SUBRESOURCE resource;
+	Assert(SUCCEEDED(Context->Map(slot.Buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &resource)));
+
+	*Offset = m_Offset;
+	m_Offset += Size;
+	m_FrameBytes += Size;
+
+	return (void *)((uintptr_t)resource.pData + *Offset);
+}
+
+void DynamicBufferRing::Unmap(ID3D11DeviceContext *Context)
+{
+	Context->Unmap(m_Slots[m_Current].Buffer, 0);
+}
+
+ID3D11Buffer *DynamicBufferRing::QCurrentBuffer() const
+{
+	return m_Slots[m_Current].Buffer;
+}
+
+void DynamicBufferRing::EndFrame(ID3D11DeviceContext *Context)
+{
+	if (!IsInitialized())
+		return;
+
+	m_PeakHistory[m_FrameIndex++ % PeakWindow] = m_FrameBytes;
+	uint32_t peak = *std::max_element(std::begin(m_PeakHistory), std::end(m_PeakHistory));
+
+	m_LastStats.FrameBytes = m_FrameBytes;
+	m_LastStats.PeakFrameBytes = peak;
+	m_LastStats.FrameStalls = m_FrameStalls;
+	m_LastStats.FrameStallTime = Timebase::TicksToMilliseconds(m_FrameStallTicks);
+	m_LastStats.TotalStalls += m_FrameStalls;
+
+	uint64_t capacity = (uint64_t)m_Count * m_BufferSize;
+	uint64_t needed = (uint64_t)peak * FramesInFlight;
+
+	if (m_FrameStalls > 0)
+	{
+		// Prefer more buffers (more frames of latency absorbed), then bigger ones
+		m_CalmFrames = 0;
+
+		if (m_Count < MaxBuffers && capacity + m_BufferSize <= MemoryBudget)
+			Resize(Context, m_Count + 1, m_BufferSize);
+		else if (m_BufferSize < MaxBufferSize && capacity * 2 <= MemoryBudget)
+			Resize(Context, m_Count, m_BufferSize * 2);
+	}
+	else if (++m_CalmFrames >= ShrinkDelay)
+	{
+		m_CalmFrames = 0;
+
+		uint32_t halfSize = m_BufferSize / 2;
+
+		if (m_Count > MinBuffers && capacity - m_BufferSize >= needed)
+			Resize(Context, m_Count - 1, m_BufferSize);
+		else if (halfSize >= std::max(MinBufferSize, m_LargestAllocation) && capacity / 2 >= needed)
+			Resize(Context, m_Count, halfSize);
+	}
+
+	m_FrameBytes = 0;
+	m_FrameStalls = 0;
+	m_FrameStallTicks = 0;
+}
+
+void DynamicBufferRing::BeginDeferredFences()
+{
+	m_DeferFences = true;
+}
+
+void DynamicBufferRing::EndDeferredFences(ID3D11DeviceContext *Context)
+{
+	m_DeferFences = false;
+
+	for (uint32_t i = 0; i < m_Count; i++)
+	{
+		if (m_Slots[i].FenceDeferred)
+			Fence(Context, m_Slots[i]);
+	}
+
+	// Executed command lists hold their own references
+	for (ID3D11Buffer *buffer : m_Retired)
+		buffer->Release();
+
+	m_Retired.clear();
+}
+
+DynamicBufferRing::Stats DynamicBufferRing::GetStats() const
+{
+	return m_LastStats;
+}
+
+void DynamicBufferRing::Fence(ID3D11DeviceContext *Context, Slot& Target)
+{
+	if (m_DeferFences)
+	{
+		Target.FenceDeferred = true;
+		return;
+	}
+
+	Context->End(Target.Query);
+	Target.Pending = true;
+	Target.FenceDeferred = false;
+}
+
+void DynamicBufferRing::WaitForSlot(ID3D11DeviceContext *Context, Slot& Target)
+{
+	BOOL data;
+	HRESULT hr = Context->GetData(Target.Query, &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+	if (hr != S_OK || data == FALSE)
+	{
+		//
+		// This will suspend execution until the buffer we want is no longer in use. The query waits on a list of
+		// commands using said buffer.
+		//
+		uint64_t start = Timebase::ReadTicks();
+
+		for (hr = Context->GetData(Target.Query, &data, sizeof(data), 0); FAILED(hr) || data == FALSE; hr = Context->GetData(Target.Query, &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH))
+			Sleep(1);
+
+		m_FrameStalls++;
+		m_FrameStallTicks += Timebase::ReadTicks() - start;
+	}
+
+	Target.Pending = false;
+}
+
+void DynamicBufferRing::GrowForDeferred(ID3D11DeviceContext *Context)
+{
+	if (m_Count < MaxBuffers && (uint64_t)(m_Count + 1) * m_BufferSize <= MemoryBudget)
+	{
+		// The new buffer goes in front of the one we wrapped into, which keeps the rest of the ring order
+		for (uint32_t i = m_Count; i > m_Current; i--)
+			m_Slots[i] = m_Slots[i - 1];
+
+		m_Slots[m_Current] = {};
+		CreateSlot(m_Slots[m_Current], m_BufferSize);
+		m_Count++;
+
+		m_LastStats.BufferCount = m_Count;
+	}
+	else
+	{
+		// Out of slots: replace every buffer with bigger ones, the old ones stay alive until the lists are executed
+		AssertMsg(m_BufferSize < MaxBufferSize, "Dynamic geometry ring is full while recording command lists");
+
+		uint32_t size = std::min(m_BufferSize * 2, MaxBufferSize);
+		Resize(Context, std::max<uint32_t>(MemoryBudget / size, 1), size);
+	}
+
+	m_LastStats.DeferredGrowths++;
+}
+
+void DynamicBufferRing::Resize(ID3D11DeviceContext *Context, uint32_t Count, uint32_t Size)
+{
+	Count = std::clamp<uint32_t>(Count, 1, MaxBuffers);
+
+	if (Count == m_Count && Size == m_BufferSize)
+		return;
+
+	// Commands already submitted keep referencing the current buffer, so it's fenced like any other switch
+	Fence(Context, m_Slots[m_Current]);
+
+	// D3D keeps released buffers alive until the GPU is done with them
+	for (uint32_t i = 0; i < m_Count; i++)
+	{
+		if (i < Count && Size == m_BufferSize)
+			continue;
+
+		ReleaseBuffer(m_Slots[i]);
+
+		if (i >= Count)
+		{
+			m_Slots[i].Query->Release();
+			m_Slots[i].Query = nullptr;
+		}
+	}
+
+	for (uint32_t i = 0; i < Count; i++)
+		CreateSlot(m_Slots[i], Size);
+
+	m_Current = (m_Current + 1) % Count;
+	m_Offset = 0;
+	m_Count = Count;
+	m_BufferSize = Size;
+
+	m_LastStats.BufferCount = m_Count;
+	m_LastStats.BufferSize = m_BufferSize;
+	m_LastStats.ResizeCount++;
+}
+
+void DynamicBufferRing::CreateSlot(Slot& Target, uint32_t Size)
+{
+	if (!Target.Buffer)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = Size;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		Assert(SUCCEEDED(m_Device->CreateBuffer(&desc, nullptr, &Target.Buffer)));
+		Target.Buffer->SetPrivateData(WKPDID_D3DDebugObjectName, strlen("DynamicBufferRing"), "DynamicBufferRing");
+	}
+
+	if (!Target.Query)
+	{
+		D3D11_QUERY_DESC desc;
+		desc.Query = D3D11_QUERY_EVENT;
+		desc.MiscFlags = 0;
+
+		Assert(SUCCEEDED(m_Device->CreateQuery(&desc, &Target.Query)));
+		Target.Pending = false;
+		Target.FenceDeferred = false;
+	}
+}
+
+void DynamicBufferRing::ReleaseBuffer(Slot& Target)
+{
+	// Recording threads may still bind the buffer through their copy of the renderer globals
+	if (m_DeferFences)
+		m_Retired.push_back(Target.Buffer);
+	else
+		Target.Buffer->Release();
+
+	Target.Buffer = nullptr;
+	Target.Pending = false;
+	Target.FenceDeferred = false;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <d3d11.h>
+#include <stdint.h>
+#include <vector>
+
+//
+// Dynamic vertex/index data for particles, skinned CPU geometry and other per-draw uploads. Allocations are linear
+// in the current buffer. Once it's full, an event query marks the last commands using it and the next buffer in the
+// ring is used, waiting on its query if the GPU hasn't caught up yet.
+//
+// The game created three 4MB buffers for this. They're adopted as the initial set, then the buffer count and size
+// follow measured usage: stalls grow the ring, a long run of stall-free frames with low peak usage shrinks it. Total
+// memory stays within MemoryBudget.
+//
+// While command lists are recorded on other threads, their draws only reach the GPU once the lists are executed.
+// Ending a query at that point would let it complete before the data was read, so fences and buffer releases are
+// held back until EndDeferredFences(). Wrapping into a buffer that's still waiting for its fence adds a buffer
+// instead.
+//
+class DynamicBufferRing
+{
+public:
+	struct Stats
+	{
+		uint32_t BufferCount;
+		uint32_t BufferSize;
+		uint32_t FrameBytes;		// Last frame, including skipped buffer remainders
+		uint32_t PeakFrameBytes;	// Highest FrameBytes over the last PeakWindow frames
+		uint32_t FrameStalls;		// Last frame
+		double FrameStallTime;		// Milliseconds spent waiting on queries last frame
+		uint64_t TotalStalls;
+		uint64_t ResizeCount;
+		uint64_t DeferredGrowths;	// Buffers added because the ring wrapped while recording command lists
+	};
+
+	constexpr static uint32_t MinBuffers = 2;
+	constexpr static uint32_t MaxBuffers = 8;
+	constexpr static uint32_t MinBufferSize = 2 * 1024 * 1024;
+	constexpr static uint32_t MaxBufferSize = 32 * 1024 * 1024;
+	constexpr static uint32_t MemoryBudget = 64 * 1024 * 1024;
+	constexpr static uint32_t FramesInFlight = 3;	// Frames of peak usage that must fit without waiting
+	constexpr static uint32_t PeakWindow = 120;		// Frames
+	constexpr static uint32_t ShrinkDelay = 600;	// Stall-free frames before the ring may shrink
+
+	// Uses existing buffers and their event queries as the initial set. The ring adds its own references, so whoever
+	// created them keeps valid pointers after the ring resizes.
+	void Adopt(ID3D11Device *Device, ID3D11Buffer *const *Buffers, ID3D11Query *const *Queries, uint32_t Count);
+	bool IsInitialized() const;
+
+	// Context must be the immediate context
+	void *Allocate(ID3D11DeviceContext *Context, uint32_t Size, uint32_t *Offset);
+	void Unmap(ID3D11DeviceContext *Context);
+	ID3D11Buffer *QCurrentBuffer() const;
+
+	// Records usage and applies resize decisions
+	void EndFrame(ID3D11DeviceContext *Context);
+
+	// Called around parallel command recording. End must come after the command lists were executed.
+	void BeginDeferredFences();
+	void EndDeferredFences(ID3D11DeviceContext *Context);
+	Stats GetStats() const;
+
+private:
+	struct Slot
+	{
+		ID3D11Buffer *Buffer;
+		ID3D11Query *Query;
+		bool Pending;			// Query was issued and hasn't been seen completed yet
+		bool FenceDeferred;		// Filled while recording, the query is issued in EndDeferredFences()
+	};
+
+	void Fence(ID3D11DeviceContext *Context, Slot& Target);
+	void WaitForSlot(ID3D11DeviceContext *Context, Slot& Target);
+	void GrowForDeferred(ID3D11DeviceContext *Context);
+	void Resize(ID3D11DeviceContext *Context, uint32_t Count, uint32_t Size);
+	void CreateSlot(Slot& Target, uint32_t Size);
+	void ReleaseBuffer(Slot& Target);
+
+	ID3D11Device *m_Device = nullptr;
+	Slot m_Slots[MaxBuffers] = {};
+	uint32_t m_Count = 0;
+	uint32_t m_BufferSize = 0;
+	uint32_t m_Current = 0;
+	uint32_t m_Offset = 0;
+	bool m_DeferFences = false;
+	std::vector<ID3D11Buffer *> m_Retired;	// Released in EndDeferredFences()
+
+	uint32_t m_FrameBytes = 0;
+	uint32_t m_FrameStalls = 0;
+	uint64_t m_FrameStallTicks = 0;
+	uint32_t m_PeakHistory[PeakWindow] = {};
+	uint32_t m_FrameIndex = 0;
+	uint32_t m_LargestAllocation = 0;
+	uint32_t m_CalmFrames = 0;
+
+	Stats m_LastStats = {};
+};
\ No newline at end of file
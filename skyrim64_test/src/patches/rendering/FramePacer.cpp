@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <string.h>
+#include "FramePacer.h"
+
+FrameTimeHistogram::FrameTimeHistogram()
+{
+	Reset();
+}
+
+void FrameTimeHistogram::Add(double Milliseconds)
+{
+	Milliseconds = std::max(Milliseconds, 0.0);
+
+	uint32_t bucket = std::min((uint32_t)(Milliseconds / BucketWidth), BucketCount - 1);
+
+	m_Buckets[bucket]++;
+	m_Count++;
+	m_Sum += Milliseconds;
+	m_Max = std::max(m_Max, Milliseconds);
+}
+
+void FrameTimeHistogram::Reset()
+{
+	memset(m_Buckets, 0, sizeof(m_Buckets));
+	m_Count = 0;
+	m_Sum = 0.0;
+	m_Max = 0.0;
+}
+
+uint64_t FrameTimeHistogram::QCount() const
+{
+	return m_Count;
+}
+
+double FrameTimeHistogram::QMean() const
+{
+	return m_Count ? m_Sum / m_Count : 0.0;
+}
+
+double FrameTimeHistogram::QMax() const
+{
+	return m_Max;
+}
+
+double FrameTimeHistogram::QPercentile(double Fraction) const
+{
+	if (m_Count == 0)
+		return 0.0;
+
+	uint64_t threshold = (uint64_t)(std::clamp(Fraction, 0.0, 1.0) * m_Count);
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < BucketCount - 1; i++)
+	{
+		total += m_Buckets[i];
+
+		if (total > threshold || total == m_Count)
+			return (i + 1) * BucketWidth;
+	}
+
+	return m_Max;
+}
+
+const uint32_t *FrameTimeHistogram::QBuckets() const
+{
+	return m_Buckets;
+}
+
+FramePacer::FramePacer(ClockFunc Clock, SleepFunc Sleep) : m_Clock(std::move(Clock)), m_Sleep(std::move(Sleep))
+{
+	m_TargetFrameTime = 0.0;
+	m_NextDeadline = 0.0;
+	m_LastRelease = 0.0;
+	m_SpinMargin = 2.0;
+	m_LastWait = 0.0;
+	m_MissedDeadlines = 0;
+	m_Resyncs = 0;
+}
+
+void FramePacer::SetTargetFrameTime(double Milliseconds)
+{
+	Milliseconds = std::max(Milliseconds, 0.0);
+
+	if (Milliseconds != m_TargetFrameTime)
+	{
+		m_TargetFrameTime = Milliseconds;
+		m_NextDeadline = 0.0;
+	}
+}
+
+double FramePacer::WaitForDeadline()
+{
+	double now = m_Clock();
+	double release = now;
+
+	if (m_TargetFrameTime > 0.0)
+	{
+		if (m_NextDeadline == 0.0 || now - m_NextDeadline > m_TargetFrameTime)
+		{
+			// First frame or too far behind: start a new schedule from here
+			if (m_NextDeadline != 0.0)
+				m_Resyncs++;
+
+			m_NextDeadline = now;
+		}
+		else if (now < m_NextDeadline)
+		{
+			SleepAndSpin(m_NextDeadline);
+			release = m_Clock();
+		}
+		else
+		{
+			m_MissedDeadlines++;
+		}
+
+		// Deadlines stay on the original grid while the frame is less than one interval late
+		m_NextDeadline += m_TargetFrameTime;
+	}
+
+	if (m_LastRelease != 0.0)
+		m_FrameTimes.Add(release - m_LastRelease);
+
+	m_LastWait = release - now;
+	m_LastRelease = release;
+	return release;
+}
+
+void FramePacer::SleepAndSpin(double Deadline)
+{
+	double sleepTime = (Deadline - m_Clock()) - m_SpinMargin;
+
+	if (sleepTime > 0.0)
+	{
+		double start = m_Clock();
+		m_Sleep(sleepTime);
+		double overshoot = (m_Clock() - start) - sleepTime;
+
+		// React to long sleeps immediately, relax slowly when the timer behaves
+		if (overshoot * 1.5 > m_SpinMargin)
+			m_SpinMargin = overshoot * 1.5;
+		else
+			m_SpinMargin = m_SpinMargin * 0.99 + overshoot * 1.5 * 0.01;
+
+		m_SpinMargin = std::clamp(m_SpinMargin, MinSpinMargin, MaxSpinMargin);
+	}
+
+	while (m_Clock() < Deadline)
+	{
+		// Spin
+	}
+}
+
+void FramePacer::AddLatencySample(double Milliseconds)
+{
+	m_Latencies.Add(Milliseconds);
+}
+
+const FrameTimeHistogram& FramePacer::QFrameTimes() const
+{
+	return m_FrameTimes;
+}
+
+const FrameTimeHistogram& FramePacer::QLatencies() const
+{
+	return m_Latencies;
+}
+
+FramePacer::Stats FramePacer::GetStats() const
+{
+	Stats stats;
+	stats.TargetFrameTime = m_TargetFrameTime;
+	stats.SpinMargin = m_SpinMargin;
+	stats.LastWait = m_LastWait;
+	stats.MissedDeadlines = m_MissedDeadlines;
+	stats.Resyncs = m_Resyncs;
+
+	return stats;
+}
+
+void FramePacer::ResetHistograms()
+{
+	m_FrameTimes.Reset();
+	m_Latencies.Reset();
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+//
+// Fixed-width histogram of millisecond values. The last bucket collects everything beyond the range.
+//
+class FrameTimeHistogram
+{
+public:
+	constexpr static uint32_t BucketCount = 100;
+	constexpr static double BucketWidth = 0.5;		// Milliseconds, 0-50ms range
+
+	FrameTimeHistogram();
+
+	void Add(double Milliseconds);
+	void Reset();
+
+	uint64_t QCount() const;
+	double QMean() const;
+	double QMax() const;
+	double QPercentile(double Fraction) const;		// Upper bound of the bucket holding the given fraction of samples
+	const uint32_t *QBuckets() const;
+
+private:
+	uint32_t m_Buckets[BucketCount];
+	uint64_t m_Count;
+	double m_Sum;
+	double m_Max;
+};
+
+//
+// Paces Present() calls to a target frame time. Each frame gets a deadline one target interval after the previous one;
+// the CPU sleeps until shortly before it and spins the rest of the way. The spin margin follows the measured sleep
+// overshoot, so a coarse OS timer costs CPU time instead of missed deadlines. Frames that are more than one interval
+// late restart the schedule instead of being followed by a burst of catch-up frames.
+//
+// Time is supplied by the caller in milliseconds, which keeps the math platform independent and lets synthetic traces
+// drive it (see /tests/pacing_simulator).
+//
+class FramePacer
+{
+public:
+	using ClockFunc = std::function<double()>;				// Monotonic time in milliseconds
+	using SleepFunc = std::function<void(double)>;			// Sleeps for roughly the given milliseconds, may overshoot
+
+	constexpr static double MinSpinMargin = 0.2;
+	constexpr static double MaxSpinMargin = 4.0;
+
+	struct Stats
+	{
+		double TargetFrameTime;
+		double SpinMargin;
+		double LastWait;				// Time WaitForDeadline() blocked for on the last frame
+		uint64_t MissedDeadlines;
+		uint64_t Resyncs;
+	};
+
+	FramePacer(ClockFunc Clock, SleepFunc Sleep);
+
+	// 0 disables pacing, frames are only measured
+	void SetTargetFrameTime(double Milliseconds);
+
+	// Call immediately before presenting. Returns the time at which the frame is released.
+	double WaitForDeadline();
+
+	// Time between a frame's Present() and the GPU finishing it, measured by the caller
+	void AddLatencySample(double Milliseconds);
+
+	const FrameTimeHistogram& QFrameTimes() const;
+	const FrameTimeHistogram& QLatencies() const;
+	Stats GetStats() const;
+	void ResetHistograms();
+
+private:
+	void SleepAndSpin(double Deadline);
+
+	ClockFunc m_Clock;
+	SleepFunc m_Sleep;
+
+	double m_TargetFrameTime;
+	double m_NextDeadline;
+	double m_LastRelease;
+	double m_SpinMargin;
+	double m_LastWait;
+	uint64_t m_MissedDeadlines;
+	uint64_t m_Resyncs;
+
+	FrameTimeHistogram m_FrameTimes;
+	FrameTimeHistogram m_Latencies;
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Per-thread cache of freed list nodes that go back to a shared free list in batches instead of one lock acquisition
+// per node. Nodes are chained through their m_pkNext member and handed to the return function as a single chain when
+// MaxNodes are cached, when a node for a different pool comes in, on Flush() and when the cache is destroyed. Declared
+// thread_local, the last one happens at thread exit, so nodes held by a thread that goes away still reach the pool.
+// Not thread safe, every thread keeps its own. No D3D dependencies.
+//
+template<typename Node>
+class FreeNodeCache
+{
+public:
+	using ReturnFunc = void(*)(void *Pool, Node *Head, Node *Tail);
+
+	struct Stats
+	{
+		uint64_t CachedFrees;		// Nodes put in the cache
+		uint64_t Returns;			// Chains given back to a pool
+		uint64_t ReturnedNodes;
+	};
+
+	FreeNodeCache(ReturnFunc Return, uint32_t MaxNodes = 64) : m_Return(Return), m_MaxNodes(MaxNodes)
+	{
+	}
+
+	~FreeNodeCache()
+	{
+		Flush();
+	}
+
+	FreeNodeCache(const FreeNodeCache&) = delete;
+	FreeNodeCache& operator=(const FreeNodeCache&) = delete;
+
+	// Returns true if cached nodes were returned to a pool
+	bool Free(void *Pool, Node *Item)
+	{
+		bool returned = false;
+
+		if (m_Pool != Pool)
+		{
+			returned = Flush();
+			m_Pool = Pool;
+		}
+
+		Item->m_pkNext = m_Head;
+		m_Head = Item;
+
+		if (!m_Tail)
+			m_Tail = Item;
+
+		m_Stats.CachedFrees++;
+
+		if (++m_Count >= m_MaxNodes)
+			returned = Flush() || returned;
+
+		return returned;
+	}
+
+	bool Flush()
+	{
+		if (!m_Head)
+			return false;
+
+		m_Return(m_Pool, m_Head, m_Tail);
+
+		m_Stats.Returns++;
+		m_Stats.ReturnedNodes += m_Count;
+
+		m_Head = nullptr;
+		m_Tail = nullptr;
+		m_Count = 0;
+		return true;
+	}
+
+	uint32_t QCount() const
+	{
+		return m_Count;
+	}
+
+	const Stats& QStats() const
+	{
+		return m_Stats;
+	}
+
+private:
+	const ReturnFunc m_Return;
+	const uint32_t m_MaxNodes;
+	void *m_Pool = nullptr;
+	Node *m_Head = nullptr;
+	Node *m_Tail = nullptr;
+	uint32_t m_Count = 0;
+	Stats m_Stats = {};
+};
\ No newline at end of file
@@ -1,7 +1,101 @@
 #include "GpuCircularBuffer.h"
+#include "d3d11_deferred.h"
 
-GpuCircularBuffer::GpuCircularBuffer(ID3D11Device *Device, uint32_t Type, uint32_t BufferSize, uint32_t MaxFrames)
+struct ThreadChunk
 {
+	uint32_t Offset;		// Ring offset of the chunk
+	uint32_t Used;
+	uint32_t Size;
+	uint32_t Generation;
+};
+
+thread_local ThreadChunk ThreadChunks[GpuCircularBuffer::MaxBuffers];
+std::atomic_uint32_t NextBufferIndex;
+
+D3D11EventFence::D3D11EventFence(ID3D11Device *Device, ID3D11DeviceContext2 *Context) : m_Context(Context)
+{
+	for (uint32_t i = 0; i < MaxPending; i++)
+	{
+		D3D11_QUERY_DESC desc;
+		desc.Query = D3D11_QUERY_EVENT;
+		desc.MiscFlags = 0;
+
+		Assert(SUCCEEDED(Device->CreateQuery(&desc, &m_Queries[i])));
+	}
+}
+
+D3D11EventFence::~D3D11EventFence()
+{
+	for (uint32_t i = 0; i < MaxPending; i++)
+		m_Queries[i]->Release();
+}
+
+uint64_t D3D11EventFence::Signal()
+{
+	// The query slot for this value is reused from MaxPending values ago
+	if (m_NextValue > m_CompletedValue + MaxPending)
+		Wait(m_NextValue - MaxPending);
+
+	auto context = DC_LockUploadContext(m_Context);
+	context->End(m_Queries[m_NextValue % MaxPending]);
+	DC_UnlockUploadContext();
+
+	return m_NextValue++;
+}
+
+uint64_t D3D11EventFence::GetCompletedValue()
+{
+	auto context = DC_LockUploadContext(m_Context);
+
+	while (m_CompletedValue + 1 < m_NextValue && PollNext(context, D3D11_ASYNC_GETDATA_DONOTFLUSH))
+		/* Nothing */;
+
+	DC_UnlockUploadContext();
+	return m_CompletedValue;
+}
+
+void D3D11EventFence::Wait(uint64_t Value)
+{
+	AssertMsg(Value < m_NextValue, "Waiting on a fence value that was never signaled");
+
+	auto context = DC_LockUploadContext(m_Context);
+
+	// The first poll flushes the command buffer so the queries are guaranteed to complete eventually
+	for (UINT flags = 0; m_CompletedValue < Value;)
+	{
+		if (!PollNext(context, flags))
+		{
+			flags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+			Sleep(1);
+		}
+	}
+
+	DC_UnlockUploadContext();
+}
+
+bool D3D11EventFence::PollNext(ID3D11DeviceContext *Context, UINT Flags)
+{
+	BOOL data;
+	HRESULT hr = Context->GetData(m_Queries[(m_CompletedValue + 1) % MaxPending], &data, sizeof(data), Flags);
+
+	if (hr != S_OK || data == FALSE)
+		return false;
+
+	m_CompletedValue++;
+	return true;
+}
+
+GpuCircularBuffer::GpuCircularBuffer(ID3D11Device *Device, ID3D11DeviceContext2 *Context, uint32_t Type, uint32_t BufferSize, uint32_t ChunkSize) :
+	m_Index(NextBufferIndex++),
+	m_ChunkSize(ChunkSize),
+	m_Context(Context),
+	m_Fence(Device, Context),
+	m_Ring(BufferSize, &m_Fence),
+	m_Generation(1)
+{
+	AssertMsg(m_Index < MaxBuffers, "Too many GpuCircularBuffers for the per-thread chunk table");
+	AssertMsg(ChunkSize > 0 && ChunkSize % ChunkAlignment == 0, "Chunk size must be a multiple of the chunk alignment");
+
 	memset(&Map, 0, sizeof(Map));
 	memset(&Description, 0, sizeof(Description));
 
@@ -14,9 +108,6 @@ GpuCircularBuffer::GpuCircularBuffer(ID3D11Device *Device, uint32_t Type, uint32
 	Description.StructureByteStride = 0;
 	Assert(SUCCEEDED(Device->CreateBuffer(&Description, nullptr, &D3DBuffer)));
 
-	FrameUtilizedAmounts = new uint32_t[MaxFrames];
-	CurrentAvailable = BufferSize;
-
 	D3DBuffer->SetPrivateData(WKPDID_D3DDebugObjectName, strlen("GpuCircularBuffer"), "GpuCircularBuffer");
 }
 
@@ -28,61 +119,96 @@ GpuCircularBuffer::~GpuCircularBuffer()
 		D3DBuffer->Release();
 		D3DBuffer = nullptr;
 	}
-
-	delete[] FrameUtilizedAmounts;
-	FrameUtilizedAmounts = nullptr;
 }
 
-void *GpuCircularBuffer::MapData(ID3D11DeviceContext *Context, uint32_t AllocationSize, uint32_t *AllocationOffset, bool ForceRemap)
+void *GpuCircularBuffer::Allocate(uint32_t Size, uint32_t Alignment, uint32_t *AllocationOffset)
 {
-	Assert(AllocationSize % 16 == 0);
-
-	//
-	// Allocation boundaries are linear - they don't wrap around to the beginning:
-	//
-	// <START> ||Free   ||F1 In Use||F2 In Use||F3 In Use||Free     || <END>
-	//
-	if (CurrentOffset + AllocationSize >= Description.ByteWidth)
+	AssertMsg(Alignment > 0 && Alignment <= ChunkAlignment && (Alignment & (Alignment - 1)) == 0, "Unsupported allocation alignment");
+
+	// Requests bigger than a chunk bypass the thread's chunk entirely
+	if (Size > m_ChunkSize)
+		return AllocateChunk((Size + ChunkAlignment - 1) & ~(ChunkAlignment - 1), AllocationOffset);
+
+	auto& chunk = ThreadChunks[m_Index];
+	uint32_t generation = m_Generation.load(std::memory_order_relaxed);
+
+	if (chunk.Generation != generation)
+	{
+		// Leftovers from last frame's chunk were already retired with last frame's fence
+		ProfileCounterAdd("Ring Bytes Wasted", chunk.Size - chunk.Used);
+
+		chunk.Used = 0;
+		chunk.Size = 0;
+		chunk.Generation = generation;
+	}
+
+	// Chunks start on a ChunkAlignment boundary so aligning the chunk-relative offset is enough
+	uint32_t start = (chunk.Used + Alignment - 1) & ~(Alignment - 1);
+
+	if (start + Size > chunk.Size)
 	{
-		// We exceeded <END> so let's try an allocation from <START>
-		CurrentUtilized += Description.ByteWidth - CurrentOffset;
-		CurrentOffset = 0;
+		ProfileCounterAdd("Ring Bytes Wasted", chunk.Size - chunk.Used);
+
+		AllocateChunk(m_ChunkSize, &chunk.Offset);
+		chunk.Used = 0;
+		chunk.Size = m_ChunkSize;
+		start = 0;
 	}
 
-	uint32_t newSize = CurrentUtilized + AllocationSize;
-	uint32_t allocBase = CurrentOffset;
-	AssertMsg(newSize <= CurrentAvailable, "Allocation would exceed available free data for this frame");
+	ProfileCounterAdd("Ring Bytes Wasted", start - chunk.Used);
+	chunk.Used = start + Size;
+
+	if (AllocationOffset)
+		*AllocationOffset = chunk.Offset + start;
+
+	return (void *)((uintptr_t)Map.pData + chunk.Offset + start);
+}
+
+void *GpuCircularBuffer::AllocateChunk(uint32_t Size, uint32_t *AllocationOffset)
+{
+	// The ring may wait on the fence, which takes the upload lock while m_RingLock is held
+	std::lock_guard<std::mutex> lock(m_RingLock);
+
+	uint32_t offset = m_Ring.Allocate(Size);
+	AssertMsg(offset != GpuRingAllocator::InvalidOffset, "Allocation would exceed available free data for this frame");
 
 	// Allow the buffer to stay mapped across multiple function calls
-	if (ForceRemap || !Map.pData)
-		Assert(SUCCEEDED(Context->Map(D3DBuffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &Map)));
+	if (!Map.pData)
+	{
+		auto context = DC_LockUploadContext(m_Context);
+		Assert(SUCCEEDED(context->Map(D3DBuffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &Map)));
+		DC_UnlockUploadContext();
+	}
 
-	CurrentUtilized = newSize;
-	CurrentOffset += AllocationSize;
+	ProfileCounterInc("Ring Chunks Allocated");
 
 	if (AllocationOffset)
-		*AllocationOffset = allocBase;
+		*AllocationOffset = offset;
 
-	return (void *)((uintptr_t)Map.pData + allocBase);
+	return (void *)((uintptr_t)Map.pData + offset);
 }
 
-void GpuCircularBuffer::UnmapData(ID3D11DeviceContext *Context)
+void GpuCircularBuffer::UnmapData()
 {
+	std::lock_guard<std::mutex> lock(m_RingLock);
+
 	if (!Map.pData)
 		return;
 
-	Context->Unmap(D3DBuffer, 0);
+	auto context = DC_LockUploadContext(m_Context);
+	context->Unmap(D3DBuffer, 0);
+	DC_UnlockUploadContext();
+
 	memset(&Map, 0, sizeof(Map));
+	m_Generation.fetch_add(1, std::memory_order_relaxed);
 }
 
-void GpuCircularBuffer::SwapFrame(uint32_t FrameIndex)
+void GpuCircularBuffer::EndFrame()
 {
-	FrameUtilizedAmounts[FrameIndex] = CurrentUtilized;
-	CurrentAvailable -= CurrentUtilized;
-	CurrentUtilized = 0;
-}
+	std::lock_guard<std::mutex> lock(m_RingLock);
 
-void GpuCircularBuffer::FreeOldFrame(uint32_t FrameIndex)
-{
-	CurrentAvailable += FrameUtilizedAmounts[FrameIndex];
-}
+	// Everything handed out this frame is retired with a single fence value, including the unused parts of
+	// thread chunks. Bumping the generation makes every thread grab a fresh chunk next frame.
+	m_Ring.EndFrame();
+	m_Generation.fetch_add(1, std::memory_order_relaxed);
+}
\ No newline at end of file
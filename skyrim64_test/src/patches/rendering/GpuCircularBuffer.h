@@ -1,28 +1,74 @@
 #pragma once
 
+#include <mutex>
+#include <atomic>
 #include "../../common.h"
+#include "GpuRingAllocator.h"
+
+//
+// GpuFence implemented with D3D11 event queries. Queries are issued and polled on the immediate context, even when
+// called from a command recording thread.
+//
+class D3D11EventFence : public GpuFence
+{
+public:
+	constexpr static uint32_t MaxPending = GpuRingAllocator::MaxFramesInFlight;
+
+	D3D11EventFence(ID3D11Device *Device, ID3D11DeviceContext2 *Context);
+	virtual ~D3D11EventFence();
+
+	virtual uint64_t Signal() override;
+	virtual uint64_t GetCompletedValue() override;
+	virtual void Wait(uint64_t Value) override;
+
+private:
+	bool PollNext(ID3D11DeviceContext *Context, UINT Flags);
+
+	ID3D11DeviceContext2 *m_Context;
+	ID3D11Query *m_Queries[MaxPending];
+	uint64_t m_NextValue = 1;
+	uint64_t m_CompletedValue = 0;
+};
 
 //
 // Idea implemented from http://gamedevs.org/uploads/efficient-buffer-management.pdf
-// "Dont Throw it all Away: Efficient Buffer Management"
+// "Don't Throw it all Away: Efficient Buffer Management"
+//
+// Two levels: the shared ring hands out large chunks under a lock, then every thread bump allocates from its own
+// chunk without any synchronization. Chunks are dropped at the end of a frame because all memory handed out in a
+// frame is retired with that frame's fence.
+//
+// Lock order: m_RingLock, then the DC upload lock (taken by Map/Unmap and by every fence Signal/Poll/Wait). Never
+// call Allocate() or UnmapData() while holding the upload lock.
 //
 class GpuCircularBuffer
 {
 public:
+	constexpr static uint32_t MaxBuffers = 8;			// Number of per-thread chunk slots
+	constexpr static uint32_t ChunkAlignment = 256;		// Largest alignment Allocate() supports
+
 	D3D11_MAPPED_SUBRESOURCE Map;
 	D3D11_BUFFER_DESC Description;
 	ID3D11Buffer *D3DBuffer = nullptr;
 
-	uint32_t *FrameUtilizedAmounts = nullptr;	// History tracker for how many bytes each frame is using
-	uint32_t CurrentOffset = 0;					// Byte offset into the buffer
-	uint32_t CurrentUtilized = 0;				// Number of bytes possibly in use by GPU (cannot be written)
-	uint32_t CurrentAvailable = 0;				// Number of unused bytes (as guaranteed by Initialize()/FreeOldFrame())
-
-	GpuCircularBuffer(ID3D11Device *Device, uint32_t Type, uint32_t BufferSize, uint32_t MaxFrames);
+	GpuCircularBuffer(ID3D11Device *Device, ID3D11DeviceContext2 *Context, uint32_t Type, uint32_t BufferSize, uint32_t ChunkSize);
 	~GpuCircularBuffer();
 
-	void *MapData(ID3D11DeviceContext *Context, uint32_t AllocationSize, uint32_t *AllocationOffset, bool ForceRemap);
-	void UnmapData(ID3D11DeviceContext *Context);
-	void SwapFrame(uint32_t FrameIndex);
-	void FreeOldFrame(uint32_t FrameIndex);
+	// Returns mapped memory for Size bytes and its byte offset in D3DBuffer. Alignment must be a power of two.
+	void *Allocate(uint32_t Size, uint32_t Alignment, uint32_t *AllocationOffset);
+	void UnmapData();
+
+	// Only valid while no thread is allocating, i.e. once per frame from the render thread
+	void EndFrame();
+
+private:
+	void *AllocateChunk(uint32_t Size, uint32_t *AllocationOffset);
+
+	const uint32_t m_Index;
+	const uint32_t m_ChunkSize;
+	ID3D11DeviceContext2 *m_Context;
+	D3D11EventFence m_Fence;
+	GpuRingAllocator m_Ring;
+	std::mutex m_RingLock;				// Acquired before DC_LockUploadContext(), see above
+	std::atomic_uint32_t m_Generation;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "GpuRingAllocator.h"
+
+GpuRingAllocator::GpuRingAllocator(uint32_t Size, GpuFence *Fence) : m_Fence(Fence), m_Size(Size)
+{
+	m_Offset = 0;
+	m_Utilized = 0;
+	m_Available = Size;
+	m_StallCount = 0;
+	m_RetiredHead = 0;
+	m_RetiredCount = 0;
+}
+
+uint32_t GpuRingAllocator::TryAllocate(uint32_t Size)
+{
+	uint32_t offset = m_Offset;
+	uint32_t cost = Size;
+
+	if (offset + Size > m_Size)
+	{
+		// We exceeded <END> so let's try an allocation from <START>
+		cost += m_Size - offset;
+		offset = 0;
+	}
+
+	if (m_Utilized + cost > m_Available)
+		return InvalidOffset;
+
+	m_Utilized += cost;
+	m_Offset = offset + Size;
+	return offset;
+}
+
+uint32_t GpuRingAllocator::Allocate(uint32_t Size)
+{
+	if (Size > m_Size)
+		return InvalidOffset;
+
+	for (uint32_t offset = TryAllocate(Size);; offset = TryAllocate(Size))
+	{
+		if (offset != InvalidOffset)
+			return offset;
+
+		// Polling is free, waiting isn't
+		uint32_t framesInFlight = m_RetiredCount;
+		Reclaim();
+
+		if (m_RetiredCount != framesInFlight)
+			continue;
+
+		if (m_RetiredCount == 0)
+			return InvalidOffset;
+
+		WaitForOldestFrame();
+	}
+}
+
+void GpuRingAllocator::EndFrame()
+{
+	if (m_RetiredCount >= MaxFramesInFlight)
+	{
+		Reclaim();
+
+		if (m_RetiredCount >= MaxFramesInFlight)
+			WaitForOldestFrame();
+	}
+
+	uint32_t index = (m_RetiredHead + m_RetiredCount) % MaxFramesInFlight;
+	m_Retired[index].FenceValue = m_Fence->Signal();
+	m_Retired[index].Bytes = m_Utilized;
+	m_RetiredCount++;
+
+	m_Available -= m_Utilized;
+	m_Utilized = 0;
+
+	Reclaim();
+}
+
+void GpuRingAllocator::Reclaim()
+{
+	if (m_RetiredCount == 0)
+		return;
+
+	uint64_t completedValue = m_Fence->GetCompletedValue();
+
+	while (m_RetiredCount > 0 && m_Retired[m_RetiredHead].FenceValue <= completedValue)
+	{
+		m_Available += m_Retired[m_RetiredHead].Bytes;
+		m_RetiredHead = (m_RetiredHead + 1) % MaxFramesInFlight;
+		m_RetiredCount--;
+	}
+}
+
+void GpuRingAllocator::WaitForOldestFrame()
+{
+	m_StallCount++;
+	m_Fence->Wait(m_Retired[m_RetiredHead].FenceValue);
+
+	Reclaim();
+}
+
+uint32_t GpuRingAllocator::QSize() const
+{
+	return m_Size;
+}
+
+uint32_t GpuRingAllocator::QAvailable() const
+{
+	return m_Available - m_Utilized;
+}
+
+uint32_t GpuRingAllocator::QFrameUtilized() const
+{
+	return m_Utilized;
+}
+
+uint32_t GpuRingAllocator::QFramesInFlight() const
+{
+	return m_RetiredCount;
+}
+
+uint32_t GpuRingAllocator::QStallCount() const
+{
+	return m_StallCount;
+}
\ No newline at end of file
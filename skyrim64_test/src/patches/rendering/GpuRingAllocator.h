@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Monotonic GPU fence. Values returned by Signal() increase by one each call and complete in the same order.
+//
+class GpuFence
+{
+public:
+	virtual ~GpuFence() = default;
+
+	virtual uint64_t Signal() = 0;				// Marks the end of all work submitted so far
+	virtual uint64_t GetCompletedValue() = 0;	// Highest value the GPU finished, never blocks
+	virtual void Wait(uint64_t Value) = 0;		// Blocks until Value is complete
+};
+
+//
+// Offset bookkeeping for a ring of GPU memory. Allocations are linear and never straddle the end of the ring; the
+// remainder is skipped and charged to the current frame:
+//
+// <START> ||Free   ||F1 In Use||F2 In Use||F3 In Use||Free     || <END>
+//
+// Everything allocated between two EndFrame() calls is tagged with a single fence value and becomes writable again
+// once the GPU passes it. Not thread safe. No D3D dependencies, a fake fence is enough to drive it.
+//
+class GpuRingAllocator
+{
+public:
+	constexpr static uint32_t MaxFramesInFlight = 8;
+	constexpr static uint32_t InvalidOffset = 0xFFFFFFFF;
+
+	GpuRingAllocator(uint32_t Size, GpuFence *Fence);
+
+	// Returns InvalidOffset if the memory is still in use by the GPU
+	uint32_t TryAllocate(uint32_t Size);
+
+	// Waits on the fence for older frames until Size bytes are free. Returns InvalidOffset only if the current frame
+	// alone would overflow the ring.
+	uint32_t Allocate(uint32_t Size);
+
+	void EndFrame();
+	void Reclaim();
+
+	uint32_t QSize() const;
+	uint32_t QAvailable() const;		// Bytes neither used by the current frame nor in flight
+	uint32_t QFrameUtilized() const;	// Bytes used by the current frame, including skipped remainders
+	uint32_t QFramesInFlight() const;
+	uint32_t QStallCount() const;		// Number of times Allocate()/EndFrame() had to wait on the GPU
+
+private:
+	struct RetiredFrame
+	{
+		uint64_t FenceValue;
+		uint32_t Bytes;
+	};
+
+	void WaitForOldestFrame();
+
+	GpuFence *m_Fence;
+	uint32_t m_Size;
+	uint32_t m_Offset;					// Byte offset of the next allocation
+	uint32_t m_Utilized;				// Number of bytes used by the current frame
+	uint32_t m_Available;				// Number of bytes not in use by the current frame or the GPU
+	uint32_t m_StallCount;
+
+	RetiredFrame m_Retired[MaxFramesInFlight];
+	uint32_t m_RetiredHead;
+	uint32_t m_RetiredCount;
+};
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "GpuScopeProfiler.h"
+
+GpuScopeProfiler::GpuScopeProfiler(GpuTimestampSource *Source) : m_Source(Source), m_Frames(), m_Stats()
+{
+	m_FrameIndex = 0;
+	m_Recording = false;
+	m_QueryCount = 0;
+
+	TreeNode root = {};
+	root.Name = m_Names.emplace_back("Frame").c_str();
+	root.Parent = InvalidIndex;
+	m_Tree.push_back(root);
+}
+
+void GpuScopeProfiler::BeginFrame(bool Record)
+{
+	m_Recording = false;
+
+	if (!Record)
+		return;
+
+	uint32_t slot = m_FrameIndex % MaxFramesInFlight;
+	FrameRecord& record = m_Frames[slot];
+
+	if (record.Pending)
+	{
+		m_Stats.SkippedFrames++;
+		return;
+	}
+
+	record.Frame = m_FrameIndex;
+	record.Scopes.clear();
+	m_ScopeStack.clear();
+	m_Recording = true;
+
+	m_Source->BeginFrame(slot);
+	BeginScope(nullptr);
+}
+
+void GpuScopeProfiler::EndFrame()
+{
+	if (m_Recording)
+	{
+		// Scopes still open at the end of the frame are cut off here, including the frame itself
+		while (!m_ScopeStack.empty())
+			CloseScope();
+
+		uint32_t slot = m_FrameIndex % MaxFramesInFlight;
+
+		m_Source->EndFrame(slot);
+		m_Frames[slot].Pending = true;
+		m_Recording = false;
+		m_Stats.RecordedFrames++;
+	}
+
+	m_FrameIndex++;
+
+	// Oldest first, the GPU finishes frames in order
+	for (uint32_t i = 0; i < MaxFramesInFlight; i++)
+	{
+		uint32_t slot = (m_FrameIndex + i) % MaxFramesInFlight;
+
+		if (m_Frames[slot].Pending && !Resolve(slot))
+			break;
+	}
+}
+
+void GpuScopeProfiler::BeginScope(const wchar_t *Name)
+{
+	if (!m_Recording)
+		return;
+
+	FrameRecord& record = m_Frames[m_FrameIndex % MaxFramesInFlight];
+	uint32_t beginQuery = AllocateQuery();
+	uint32_t endQuery = (beginQuery != InvalidIndex) ? AllocateQuery() : InvalidIndex;
+
+	if (endQuery == InvalidIndex)
+	{
+		if (beginQuery != InvalidIndex)
+			m_FreeQueries.push_back(beginQuery);
+
+		m_Stats.DroppedScopes++;
+		m_ScopeStack.push_back(InvalidIndex);
+		return;
+	}
+
+	// Children of dropped scopes attach to the closest measured one
+	uint32_t parent = InvalidIndex;
+
+	for (auto itr = m_ScopeStack.rbegin(); itr != m_ScopeStack.rend() && parent == InvalidIndex; itr++)
+		parent = *itr;
+
+	ScopeRecord scope;
+	scope.Name = Name ? InternName(Name) : 0;
+	scope.Parent = parent;
+	scope.BeginQuery = beginQuery;
+	scope.EndQuery = endQuery;
+
+	m_ScopeStack.push_back((uint32_t)record.Scopes.size());
+	record.Scopes.push_back(scope);
+	m_Source->WriteTimestamp(beginQuery);
+}
+
+void GpuScopeProfiler::EndScope()
+{
+	if (!m_Recording)
+		return;
+
+	// The frame scope itself is only closed by EndFrame()
+	if (m_ScopeStack.size() <= 1)
+	{
+		m_Stats.UnbalancedScopes++;
+		return;
+	}
+
+	CloseScope();
+}
+
+const std::vector<GpuScopeProfiler::TreeNode>& GpuScopeProfiler::GetTree() const
+{
+	return m_Tree;
+}
+
+GpuScopeProfiler::Stats GpuScopeProfiler::GetStats() const
+{
+	Stats stats = m_Stats;
+	stats.PooledQueries = m_QueryCount;
+
+	return stats;
+}
+
+uint32_t GpuScopeProfiler::InternName(const wchar_t *Name)
+{
+	if (auto itr = m_NameIds.find(Name); itr != m_NameIds.end())
+		return itr->second;
+
+	auto& storage = m_NameStorage.emplace_back(Name);
+	auto& printable = m_Names.emplace_back();
+
+	// ImGui wants UTF-8 and event names are plain ASCII in practice
+	for (wchar_t c : storage)
+		printable.push_back((c > 0 && c < 0x80) ? (char)c : '?');
+
+	uint32_t id = (uint32_t)m_Names.size() - 1;
+	m_NameIds.emplace(storage, id);
+
+	return id;
+}
+
+uint32_t GpuScopeProfiler::AllocateQuery()
+{
+	if (!m_FreeQueries.empty())
+	{
+		uint32_t index = m_FreeQueries.back();
+		m_FreeQueries.pop_back();
+
+		return index;
+	}
+
+	if (m_QueryCount >= MaxQueries || !m_Source->CreateQuery(m_QueryCount))
+		return InvalidIndex;
+
+	return m_QueryCount++;
+}
+
+void GpuScopeProfiler::CloseScope()
+{
+	uint32_t index = m_ScopeStack.back();
+	m_ScopeStack.pop_back();
+
+	if (index != InvalidIndex)
+		m_Source->WriteTimestamp(m_Frames[m_FrameIndex % MaxFramesInFlight].Scopes[index].EndQuery);
+}
+
+bool GpuScopeProfiler::Resolve(uint32_t Slot)
+{
+	FrameRecord& record = m_Frames[Slot];
+	uint64_t frequency;
+
+	if (!m_Source->ReadFrequency(Slot, &frequency))
+		return false;
+
+	m_Timestamps.resize(record.Scopes.size() * 2);
+
+	for (size_t i = 0; i < record.Scopes.size(); i++)
+	{
+		if (!m_Source->ReadTimestamp(record.Scopes[i].BeginQuery, &m_Timestamps[i * 2]) ||
+			!m_Source->ReadTimestamp(record.Scopes[i].EndQuery, &m_Timestamps[i * 2 + 1]))
+			return false;
+	}
+
+	if (frequency != 0)
+	{
+		for (auto& node : m_Tree)
+		{
+			node.InclusiveTime = 0.0;
+			node.ExclusiveTime = 0.0;
+			node.Calls = 0;
+		}
+
+		// Parents are always recorded before their children
+		double invFrequencyMS = 1000.0 / frequency;
+		m_ScopeNodes.resize(record.Scopes.size());
+
+		for (size_t i = 0; i < record.Scopes.size(); i++)
+		{
+			auto& scope = record.Scopes[i];
+			uint32_t node = (scope.Parent == InvalidIndex) ? 0 : GetTreeChild(m_ScopeNodes[scope.Parent], scope.Name);
+			double time = (m_Timestamps[i * 2 + 1] >= m_Timestamps[i * 2]) ? (m_Timestamps[i * 2 + 1] - m_Timestamps[i * 2]) * invFrequencyMS : 0.0;
+
+			m_ScopeNodes[i] = node;
+			m_Tree[node].InclusiveTime += time;
+			m_Tree[node].ExclusiveTime += time;
+			m_Tree[node].Calls++;
+
+			if (scope.Parent != InvalidIndex)
+				m_Tree[m_ScopeNodes[scope.Parent]].ExclusiveTime -= time;
+		}
+
+		m_Stats.ReadbackLatency = (uint32_t)(m_FrameIndex - record.Frame);
+	}
+	else
+	{
+		m_Stats.DisjointFrames++;
+	}
+
+	for (auto& scope : record.Scopes)
+	{
+		m_FreeQueries.push_back(scope.BeginQuery);
+		m_FreeQueries.push_back(scope.EndQuery);
+	}
+
+	record.Scopes.clear();
+	record.Pending = false;
+	return true;
+}
+
+uint32_t GpuScopeProfiler::GetTreeChild(uint32_t Parent, uint32_t Name)
+{
+	uint64_t key = ((uint64_t)Parent << 32) | Name;
+
+	if (auto itr = m_TreeChildren.find(key); itr != m_TreeChildren.end())
+		return itr->second;
+
+	TreeNode node = {};
+	node.Name = m_Names[Name].c_str();
+	node.Parent = Parent;
+
+	uint32_t index = (uint32_t)m_Tree.size();
+	m_Tree.push_back(node);
+	m_Tree[Parent].Children.push_back(index);
+	m_TreeChildren.emplace(key, index);
+
+	return index;
+}
\ No newline at end of file
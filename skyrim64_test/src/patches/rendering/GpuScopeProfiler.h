@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//
+// Timestamp queries backing GpuScopeProfiler. Query indices are handed out by the profiler and the implementation
+// creates each one the first time its index is used. Reads never block.
+//
+class GpuTimestampSource
+{
+public:
+	virtual ~GpuTimestampSource() = default;
+
+	virtual bool CreateQuery(uint32_t Index) = 0;
+	virtual void WriteTimestamp(uint32_t Index) = 0;
+	virtual bool ReadTimestamp(uint32_t Index, uint64_t *Value) = 0;
+
+	// One disjoint query per frame slot. Frequency is set to 0 when the frame's timestamps are unreliable.
+	virtual void BeginFrame(uint32_t Slot) = 0;
+	virtual void EndFrame(uint32_t Slot) = 0;
+	virtual bool ReadFrequency(uint32_t Slot, uint64_t *Frequency) = 0;
+};
+
+//
+// Places a timestamp pair around every BeginScope()/EndScope() (the context proxy forwards BeginEvent/EndEvent) and
+// merges the results into a persistent call tree, the GPU counterpart of Profiler::GetTreeFrame(). Scopes with the same
+// name under the same parent share a node.
+//
+// Frames are read back up to MaxFramesInFlight frames after they were recorded without ever waiting on the GPU. When a
+// slot is still busy by the time it comes around again, that frame simply isn't recorded. Queries are pooled and
+// reused after readback; once MaxQueries exist, further scopes are dropped for the frame. Not thread safe, only the
+// immediate context may record.
+//
+class GpuScopeProfiler
+{
+public:
+	constexpr static uint32_t MaxFramesInFlight = 4;
+	constexpr static uint32_t MaxQueries = 4096;
+	constexpr static uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	struct TreeNode
+	{
+		const char *Name;
+		uint32_t Parent;
+		std::vector<uint32_t> Children;
+		double InclusiveTime;		// Milliseconds
+		double ExclusiveTime;		// Milliseconds
+		uint32_t Calls;
+	};
+
+	struct Stats
+	{
+		uint64_t RecordedFrames;
+		uint64_t SkippedFrames;		// Slot was still waiting for the GPU
+		uint64_t DisjointFrames;	// Read back, but the timestamps were unusable
+		uint64_t DroppedScopes;		// Query pool exhausted
+		uint64_t UnbalancedScopes;	// EndScope() without a matching BeginScope() in the same frame
+		uint32_t ReadbackLatency;	// Frames between recording and readback of the current tree
+		uint32_t PooledQueries;
+	};
+
+	GpuScopeProfiler(GpuTimestampSource *Source);
+
+	// Record is checked once per frame so scopes are never half measured
+	void BeginFrame(bool Record);
+	void EndFrame();
+
+	void BeginScope(const wchar_t *Name);
+	void EndScope();
+
+	// Node 0 is the whole frame. Nodes are never removed; ones that didn't run in the last frame have no calls.
+	const std::vector<TreeNode>& GetTree() const;
+	Stats GetStats() const;
+
+private:
+	struct ScopeRecord
+	{
+		uint32_t Name;
+		uint32_t Parent;			// Index into FrameRecord::Scopes
+		uint32_t BeginQuery;
+		uint32_t EndQuery;
+	};
+
+	struct FrameRecord
+	{
+		bool Pending;
+		uint64_t Frame;
+		std::vector<ScopeRecord> Scopes;
+	};
+
+	uint32_t InternName(const wchar_t *Name);
+	uint32_t AllocateQuery();
+	void CloseScope();
+	bool Resolve(uint32_t Slot);
+	uint32_t GetTreeChild(uint32_t Parent, uint32_t Name);
+
+	GpuTimestampSource *m_Source;
+
+	FrameRecord m_Frames[MaxFramesInFlight];
+	uint64_t m_FrameIndex;
+	bool m_Recording;
+	std::vector<uint32_t> m_ScopeStack;					// Scope record indices, InvalidIndex for dropped scopes
+
+	std::vector<uint32_t> m_FreeQueries;
+	uint32_t m_QueryCount;
+
+	std::deque<std::wstring> m_NameStorage;
+	std::deque<std::string> m_Names;					// Printable copies, index is the name id
+	std::unordered_map<std::wstring_view, uint32_t> m_NameIds;
+
+	std::vector<TreeNode> m_Tree;
+	std::unordered_map<uint64_t, uint32_t> m_TreeChildren;	// Parent node << 32 | name id -> node
+	std::vector<uint64_t> m_Timestamps;
+	std::vector<uint32_t> m_ScopeNodes;
+
+	Stats m_Stats;
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "GpuTimer.h"
 
 GPUTimer g_GPUTimers;
+GPUScopeQueries g_GPUScopeQueries;
+GpuScopeProfiler g_GPUScopes(&g_GPUScopeQueries);
 
 void GPUTimer::Create(ID3D11Device *D3DDevice, uint32_t NumTimers)
 {
@@ -113,4 +115,64 @@ void GPUTimer::StopTimer(ID3D11DeviceContext *DeviceContext, uint32_t Id)
 float GPUTimer::GetGPUTimeInMS(uint32_t Id)
 {
 	return m_Timers.at(Id).GPUTimeInMS;
+}
+
+void GPUScopeQueries::Create(ID3D11Device *D3DDevice, ID3D11DeviceContext *DeviceContext)
+{
+	m_Device = D3DDevice;
+	m_DeviceContext = DeviceContext;
+
+	D3D11_QUERY_DESC queryDesc;
+	memset(&queryDesc, 0, sizeof(D3D11_QUERY_DESC));
+	queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+	for (ID3D11Query *& query : m_DisjointQueries)
+		Assert(SUCCEEDED(D3DDevice->CreateQuery(&queryDesc, &query)));
+}
+
+bool GPUScopeQueries::CreateQuery(uint32_t Index)
+{
+	D3D11_QUERY_DESC queryDesc;
+	memset(&queryDesc, 0, sizeof(D3D11_QUERY_DESC));
+	queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+	ID3D11Query *query;
+
+	if (!m_Device || FAILED(m_Device->CreateQuery(&queryDesc, &query)))
+		return false;
+
+	m_Queries.resize(std::max<size_t>(m_Queries.size(), Index + 1));
+	m_Queries[Index] = query;
+	return true;
+}
+
+void GPUScopeQueries::WriteTimestamp(uint32_t Index)
+{
+	m_DeviceContext->End(m_Queries[Index]);
+}
+
+bool GPUScopeQueries::ReadTimestamp(uint32_t Index, uint64_t *Value)
+{
+	return m_DeviceContext->GetData(m_Queries[Index], Value, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+}
+
+void GPUScopeQueries::BeginFrame(uint32_t Slot)
+{
+	m_DeviceContext->Begin(m_DisjointQueries[Slot]);
+}
+
+void GPUScopeQueries::EndFrame(uint32_t Slot)
+{
+	m_DeviceContext->End(m_DisjointQueries[Slot]);
+}
+
+bool GPUScopeQueries::ReadFrequency(uint32_t Slot, uint64_t *Frequency)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointTimestampValue;
+
+	if (m_DeviceContext->GetData(m_DisjointQueries[Slot], &disjointTimestampValue, sizeof(disjointTimestampValue), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	*Frequency = disjointTimestampValue.Disjoint ? 0 : disjointTimestampValue.Frequency;
+	return true;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../common.h"
+#include "GpuScopeProfiler.h"
 
 class GPUTimer
 {
@@ -33,4 +34,31 @@ protected:
 	std::vector<GPUTimerState> m_Timers;
 };
 
-extern GPUTimer g_GPUTimers;
\ No newline at end of file
+extern GPUTimer g_GPUTimers;
+
+//
+// D3D11 timestamp queries for GpuScopeProfiler. They're issued on the real immediate context so captures and the state
+// cache never see them.
+//
+class GPUScopeQueries : public GpuTimestampSource
+{
+public:
+	void Create(ID3D11Device *D3DDevice, ID3D11DeviceContext *DeviceContext);
+
+	virtual bool CreateQuery(uint32_t Index) override;
+	virtual void WriteTimestamp(uint32_t Index) override;
+	virtual bool ReadTimestamp(uint32_t Index, uint64_t *Value) override;
+
+	virtual void BeginFrame(uint32_t Slot) override;
+	virtual void EndFrame(uint32_t Slot) override;
+	virtual bool ReadFrequency(uint32_t Slot, uint64_t *Frequency) override;
+
+protected:
+	ID3D11Device *m_Device;
+	ID3D11DeviceContext *m_DeviceContext;
+	std::vector<ID3D11Query *> m_Queries;
+	ID3D11Query *m_DisjointQueries[GpuScopeProfiler::MaxFramesInFlight];
+};
+
+extern GPUScopeQueries g_GPUScopeQueries;
+extern GpuScopeProfiler g_GPUScopes;
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include <immintrin.h>
+#include "LightTransform.h"
+
+namespace LightTransform
+{
+	void Transform(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4])
+	{
+		TransformSSE(Matrix, Lights, Count, RadiusDivisor, Out);
+	}
+
+	void TransformScalar(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4])
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			float result[4];
+
+			for (int j = 0; j < 4; j++)
+				result[j] = ((Lights.Z[i] * Matrix[2][j] + Matrix[3][j]) + Lights.Y[i] * Matrix[1][j]) + Lights.X[i] * Matrix[0][j];
+
+			Out[i][0] = result[0] / result[3];
+			Out[i][1] = result[1] / result[3];
+			Out[i][2] = result[2] / result[3];
+			Out[i][3] = Lights.Radius[i] / RadiusDivisor;
+		}
+	}
+
+	void TransformSSE(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4])
+	{
+		__m128 divisor = _mm_set1_ps(RadiusDivisor);
+
+		for (uint32_t i = 0; i < Count; i += 4)
+		{
+			__m128 x = _mm_load_ps(&Lights.X[i]);
+			__m128 y = _mm_load_ps(&Lights.Y[i]);
+			__m128 z = _mm_load_ps(&Lights.Z[i]);
+			__m128 r = _mm_load_ps(&Lights.Radius[i]);
+
+			__m128 column[4];
+
+			for (int j = 0; j < 4; j++)
+			{
+				__m128 v = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(Matrix[2][j])), _mm_set1_ps(Matrix[3][j]));
+				v = _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(Matrix[1][j])), v);
+				column[j] = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(Matrix[0][j])), v);
+			}
+
+			__m128 outX = _mm_div_ps(column[0], column[3]);
+			__m128 outY = _mm_div_ps(column[1], column[3]);
+			__m128 outZ = _mm_div_ps(column[2], column[3]);
+			__m128 outW = _mm_div_ps(r, divisor);
+
+			// SoA -> one float4 per light
+			_MM_TRANSPOSE4_PS(outX, outY, outZ, outW);
+
+			__m128 lights[4] = { outX, outY, outZ, outW };
+
+			for (uint32_t j = 0; j < 4 && i + j < Count; j++)
+				_mm_storeu_ps(Out[i + j], lights[j]);
+		}
+	}
+}
\ No newline at end of file
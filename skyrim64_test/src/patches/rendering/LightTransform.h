@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Batched point light transform for BSLightingShader. Lights are laid out SoA so every SIMD lane handles one light:
+//
+// Out[i].xyz = TransformCoord(Position[i], Matrix)
+// Out[i].w   = Radius[i] / RadiusDivisor
+//
+// Matrix uses the XMMATRIX row vector convention (translation in row 3) and the math is ordered exactly like the
+// non-FMA XMVector3TransformCoord, so all paths produce the same bits as the scalar DirectXMath code they replace.
+// Transform() uses the SSE path, the scalar version is the reference lighttransform_test compares against. An 8-wide AVX
+// version was measured slower than SSE for the usual 1-7 lights (the 256-bit divides and lane extracts cost more than
+// the second SSE pass saves) and was dropped.
+//
+namespace LightTransform
+{
+	constexpr uint32_t MaxLights = 8;
+
+	struct LightsSoA
+	{
+		alignas(16) float X[MaxLights];
+		alignas(16) float Y[MaxLights];
+		alignas(16) float Z[MaxLights];
+		alignas(16) float Radius[MaxLights];
+	};
+
+	using TransformFunc = void(*)(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4]);
+
+	// Only the first Count entries of Out are written
+	void Transform(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4]);
+
+	void TransformScalar(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4]);
+	void TransformSSE(const float Matrix[4][4], const LightsSoA& Lights, uint32_t Count, float RadiusDivisor, float(*Out)[4]);
+}
\ No newline at end of file
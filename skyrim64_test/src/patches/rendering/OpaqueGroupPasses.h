@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// The opaque geometry group passes at the start of FinishAccumulating_Standard_PreResolveDepth, in the game's
+// submission order, as recorded by RenderOpaqueGroupsDeferred(). Wildcard passes (GeometryGroup -1) walk the
+// accumulator's own batch renderer and remove nodes from its active pass index list, so two of them can never be
+// recorded at the same time: a later wildcard pass depends on the one before it. Command lists are still executed in
+// table order. Technique constants are spelled out to keep this free of game headers and are checked against the
+// BSSM_ values where the table is used. No D3D dependencies.
+//
+struct OpaqueGroupPass
+{
+	const char *Name;
+	uint32_t StartTechnique;
+	uint32_t EndTechnique;
+	int GeometryGroup;			// -1 renders every group through the accumulator's batch renderer
+	uint32_t DependsOn;			// Pass that must finish recording first, or OpaqueGroupNoDependency
+};
+
+constexpr uint32_t OpaqueGroupNoDependency = 0xFFFFFFFF;
+constexpr uint32_t OpaqueGroupPassCount = 6;
+
+constexpr OpaqueGroupPass OpaqueGroupPasses[OpaqueGroupPassCount] =
+{
+	{ "RenderBatches", 1, 0x5C00002F, -1, OpaqueGroupNoDependency },			// BSSM_DISTANTTREE_DEPTH
+	{ "LowAniso", 1, 0x5C006074, 9, OpaqueGroupNoDependency },				// BSSM_BLOOD_SPLATTER
+	{ "RenderGrass", 0x5C000030, 0x5C00005C, -1, 0 },						// BSSM_GRASS_DIRONLY_LF
+	{ "RenderNoShadowGroup", 1, 0x5C006074, 8, OpaqueGroupNoDependency },
+	{ "RenderLODObjects", 1, 0x5C006074, 1, OpaqueGroupNoDependency },
+	{ "RenderLODLand", 1, 0x5C006074, 0, OpaqueGroupNoDependency },
+};
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include <math.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include "PassSortKey.h"
+
+namespace PassSortKey
+{
+	// Far beyond anything a frame submits, only here to reject broken files
+	constexpr uint32_t MaxListPasses = 1 << 24;
+
+	// Fibonacci hashing: the top bits of the product depend on every input bit, including the zero low bits of pointers
+	static uint64_t HashBits(uint64_t Value, uint32_t Bits)
+	{
+		return (Value * 0x9E3779B97F4A7C15ull) >> (64 - Bits);
+	}
+
+	uint32_t DepthBucket(float Distance)
+	{
+		// 64 buckets per doubling of distance, which covers about 16 doublings
+		return (uint32_t)std::min(log2f(std::max(Distance, 0.0f) + 1.0f) * 64.0f, 1023.0f);
+	}
+
+	uint64_t Pack(const PassState& State, ListType Type)
+	{
+		uint64_t depth = DepthBucket(State.Distance);
+
+		// The technique is the same for every pass in a batch group, so those bits go to the material and texture set
+		if (Type == LIST_BATCH_GROUP)
+		{
+			return (HashBits(State.Shader, 4) << 60) |
+				(HashBits(State.Material, 22) << 38) |
+				(HashBits(State.TextureSet, 16) << 22) |
+				(HashBits(State.VertexDesc, 12) << 10) |
+				depth;
+		}
+
+		return (HashBits(HashBits(State.Shader, 64) ^ State.Technique, 8) << 56) |
+			(HashBits(State.Material, 18) << 38) |
+			(HashBits(State.TextureSet, 14) << 24) |
+			(HashBits(State.VertexDesc, 14) << 10) |
+			depth;
+	}
+
+	void SortList(RadixSort::KeyValue *Data, RadixSort::KeyValue *Scratch, const uint8_t *Fixed, size_t Count)
+	{
+		if (!Fixed)
+		{
+			RadixSort::Sort64(Data, Scratch, Count);
+			return;
+		}
+
+		size_t runStart = 0;
+
+		for (size_t i = 0; i <= Count; i++)
+		{
+			if (i < Count && !Fixed[i])
+				continue;
+
+			if (i - runStart > 1)
+				RadixSort::Sort64(&Data[runStart], &Scratch[runStart], i - runStart);
+
+			runStart = i + 1;
+		}
+	}
+
+	ChangeCounts CountChanges(const PassState *States, const uint32_t *Order, size_t Count)
+	{
+		ChangeCounts counts = {};
+		const PassState *last = nullptr;
+
+		for (size_t i = 0; i < Count; i++)
+		{
+			const PassState *state = &States[Order ? Order[i] : i];
+
+			if (!last || state->Technique != last->Technique || state->Shader != last->Shader)
+				counts.Techniques++;
+
+			if (!last || state->Material != last->Material)
+				counts.Materials++;
+
+			last = state;
+		}
+
+		return counts;
+	}
+
+	void Capture::RequestFrames(uint32_t FrameCount)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (!m_Active)
+			m_FramesRequested = FrameCount;
+	}
+
+	bool Capture::IsActive() const
+	{
+		return m_Active.load(std::memory_order_relaxed);
+	}
+
+	void Capture::RecordList(ListType Type, const PassState *Passes, uint32_t Count)
+	{
+		if (!IsActive() || Count == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		// Raced with the last EndFrame()
+		if (!m_Active)
+			return;
+
+		m_Lists.push_back({ m_Frame, Type, m_Passes.size(), Count });
+		m_Passes.insert(m_Passes.end(), Passes, Passes + Count);
+	}
+
+	bool Capture::EndFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (m_Active)
+		{
+			m_Frame++;
+
+			if (--m_FramesRemaining > 0)
+				return false;
+
+			m_Active = false;
+			return true;
+		}
+
+		if (m_FramesRequested == 0)
+			return false;
+
+		m_FramesRemaining = m_FramesRequested;
+		m_FramesRequested = 0;
+		m_Frame = 0;
+		m_Lists.clear();
+		m_Passes.clear();
+		m_Active = true;
+		return false;
+	}
+
+	bool Capture::Write(std::ostream& Stream) const
+	{
+		FileHeader header;
+		header.Magic = FileMagic;
+		header.Version = FileVersion;
+		header.FrameCount = m_Frame;
+		header.ListCount = (uint32_t)m_Lists.size();
+
+		Stream.write((const char *)&header, sizeof(header));
+
+		for (auto& list : m_Lists)
+		{
+			ListHeader listHeader = { list.Frame, list.Type, list.Count, 0 };
+
+			Stream.write((const char *)&listHeader, sizeof(listHeader));
+			Stream.write((const char *)&m_Passes[list.First], list.Count * sizeof(PassState));
+		}
+
+		return Stream.good();
+	}
+
+	bool Capture::Read(std::istream& Stream)
+	{
+		FileHeader header;
+
+		if (!Stream.read((char *)&header, sizeof(header)) || header.Magic != FileMagic || header.Version != FileVersion)
+			return false;
+
+		m_Frame = header.FrameCount;
+		m_Lists.clear();
+		m_Passes.clear();
+
+		for (uint32_t i = 0; i < header.ListCount; i++)
+		{
+			ListHeader listHeader;
+
+			if (!Stream.read((char *)&listHeader, sizeof(listHeader)) || listHeader.Type > LIST_PERSISTENT || listHeader.Count > MaxListPasses)
+				return false;
+
+			size_t first = m_Passes.size();
+			m_Passes.resize(first + listHeader.Count);
+
+			if (!Stream.read((char *)&m_Passes[first], listHeader.Count * sizeof(PassState)))
+				return false;
+
+			m_Lists.push_back({ listHeader.Frame, (ListType)listHeader.Type, first, listHeader.Count });
+		}
+
+		return true;
+	}
+
+	uint32_t Capture::QFrameCount() const
+	{
+		return m_Frame;
+	}
+
+	const std::vector<Capture::List>& Capture::QLists() const
+	{
+		return m_Lists;
+	}
+
+	const std::vector<PassState>& Capture::QPasses() const
+	{
+		return m_Passes;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+#include "../radixsort.h"
+
+//
+// Packed 64-bit state keys for BSBatchRenderer passes and a recorder for the per-list pass state, so the key streams of
+// real frames can be replayed with tests/passkey_analyzer. Two key layouts, most significant field first:
+//
+// Batch groups (one technique per list):    shader 4 | material 22 | texture set 16 | vertex format 12 | depth 10
+// Persistent lists (any technique):         shader/technique 8 | material 18 | texture set 14 | vertex format 14 | depth 10
+//
+// Identities are hashed into their fields, so a collision only costs an extra state change. Depth buckets are
+// logarithmic, front to back. No D3D dependencies.
+//
+namespace PassSortKey
+{
+	enum ListType : uint32_t
+	{
+		LIST_BATCH_GROUP,						// RenderBatches()
+		LIST_PERSISTENT,						// RenderPersistentPassList()
+	};
+
+	enum PassFlags : uint32_t
+	{
+		PASS_BLENDED = 1,						// Alpha blended, keeps its position in the list
+	};
+
+	// Pointers are only used as identities
+	struct PassState
+	{
+		uint64_t Shader;
+		uint64_t Material;
+		uint64_t TextureSet;
+		uint64_t VertexDesc;
+		uint32_t Technique;
+		float Distance;							// From the eye
+		uint32_t Flags;
+		uint32_t Reserved;
+	};
+
+	static_assert(sizeof(PassState) == 48);
+
+	struct ChangeCounts
+	{
+		uint64_t Techniques;
+		uint64_t Materials;
+	};
+
+	uint32_t DepthBucket(float Distance);
+	uint64_t Pack(const PassState& State, ListType Type);
+
+	// Stable. Entries with Fixed[i] != 0 keep their position and split the list into runs that are sorted on their own.
+	// Fixed may be null.
+	void SortList(RadixSort::KeyValue *Data, RadixSort::KeyValue *Scratch, const uint8_t *Fixed, size_t Count);
+
+	// Counted like BSBatchRenderer::SetupPass(): a technique change when the technique or shader differs from the previous
+	// pass, a material change when the material does. The first pass changes both.
+	ChangeCounts CountChanges(const PassState *States, const uint32_t *Order, size_t Count);
+
+	//
+	// File:  FileHeader, then ListHeader + Count PassState entries in submission order, repeated ListCount times.
+	//
+	constexpr uint32_t FileMagic = 0x4B535350;	// "PSSK"
+	constexpr uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t FrameCount;
+		uint32_t ListCount;
+	};
+
+	struct ListHeader
+	{
+		uint32_t Frame;
+		uint32_t Type;
+		uint32_t Count;
+		uint32_t Reserved;
+	};
+
+	class Capture
+	{
+	public:
+		struct List
+		{
+			uint32_t Frame;
+			ListType Type;
+			size_t First;						// Index into QPasses()
+			uint32_t Count;
+		};
+
+		// Recording starts with the next EndFrame() call
+		void RequestFrames(uint32_t FrameCount);
+		bool IsActive() const;
+
+		// Thread safe
+		void RecordList(ListType Type, const PassState *Passes, uint32_t Count);
+
+		// Returns true when the last requested frame was recorded. The capture stays readable until the next request.
+		bool EndFrame();
+
+		bool Write(std::ostream& Stream) const;
+		bool Read(std::istream& Stream);
+
+		uint32_t QFrameCount() const;
+		const std::vector<List>& QLists() const;
+		const std::vector<PassState>& QPasses() const;
+
+	private:
+		std::atomic_bool m_Active = false;
+		std::mutex m_Lock;
+		uint32_t m_FramesRequested = 0;
+		uint32_t m_FramesRemaining = 0;
+		uint32_t m_Frame = 0;
+		std::vector<List> m_Lists;
+		std::vector<PassState> m_Passes;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include "SetupKeyUsage.h"
+
+static const char EntryPrefix[] = "LIGHTING_SETUP_SPECIALIZATION(";
+static const char UsesSuffix[] = " uses";
+
+void SetupKeyUsage::Record(uint32_t Key, uint64_t Uses)
+{
+	m_Uses[Key] += Uses;
+}
+
+void SetupKeyUsage::Merge(const SetupKeyUsage& Other)
+{
+	for (auto& [key, uses] : Other.m_Uses)
+		Record(key, uses);
+}
+
+void SetupKeyUsage::ClearUses()
+{
+	for (auto& [key, uses] : m_Uses)
+		uses = 0;
+}
+
+void SetupKeyUsage::Trim(size_t MaxKeys)
+{
+	if (m_Uses.size() <= MaxKeys)
+		return;
+
+	std::vector<std::pair<uint32_t, uint64_t>> entries(m_Uses.begin(), m_Uses.end());
+
+	std::stable_sort(entries.begin(), entries.end(), [](const auto& A, const auto& B)
+	{
+		return A.second > B.second;
+	});
+
+	entries.resize(MaxKeys);
+	m_Uses = std::map<uint32_t, uint64_t>(entries.begin(), entries.end());
+}
+
+bool SetupKeyUsage::Read(std::istream& Stream)
+{
+	std::string line;
+
+	while (std::getline(Stream, line))
+	{
+		size_t start = line.find_first_not_of(" \t");
+
+		if (start == std::string::npos || line.compare(start, 2, "//") == 0)
+			continue;
+
+		if (line.compare(start, sizeof(EntryPrefix) - 1, EntryPrefix) != 0)
+			return false;
+
+		const char *keyText = line.c_str() + start + sizeof(EntryPrefix) - 1;
+		char *end;
+		unsigned long long key = strtoull(keyText, &end, 16);
+
+		if (end == keyText || *end != ')' || key > 0xFFFFFFFF)
+			return false;
+
+		// "...; N uses" at the end of the comment, if there is one
+		uint64_t uses = 0;
+		size_t separator = line.rfind("; ");
+
+		if (separator != std::string::npos && line.size() > sizeof(UsesSuffix) - 1 &&
+			line.compare(line.size() - (sizeof(UsesSuffix) - 1), std::string::npos, UsesSuffix) == 0)
+		{
+			const char *usesText = line.c_str() + separator + 2;
+			uses = strtoull(usesText, &end, 10);
+
+			if (end == usesText || strcmp(end, UsesSuffix) != 0)
+				return false;
+		}
+
+		Record((uint32_t)key, uses);
+	}
+
+	return true;
+}
+
+bool SetupKeyUsage::Write(std::ostream& Stream, const DescribeFunc& Describe) const
+{
+	Stream << "// clang-format off\n";
+	Stream << "//\n";
+	Stream << "// Written by BSLightingShader::WriteSetupSpecializations() from recorded technique switches, merged with the\n";
+	Stream << "// previously written list. One entry per raw technique masked with SetupKeyMask, sorted by key, followed by the\n";
+	Stream << "// source defines those bits select and the number of recorded uses.\n";
+	Stream << "//\n";
+
+	for (auto& [key, uses] : m_Uses)
+	{
+		char entry[64];
+		snprintf(entry, sizeof(entry), "%s0x%08X)", EntryPrefix, key);
+
+		std::string description = Describe ? Describe(key) : std::string();
+		Stream << entry << "\t// " << (description.empty() ? "(none)" : description) << "; " << uses << UsesSuffix << "\n";
+	}
+
+	return Stream.good();
+}
+
+size_t SetupKeyUsage::QKeyCount() const
+{
+	return m_Uses.size();
+}
+
+uint64_t SetupKeyUsage::QUses(uint32_t Key) const
+{
+	auto itr = m_Uses.find(Key);
+	return itr != m_Uses.end() ? itr->second : 0;
+}
+
+std::vector<uint32_t> SetupKeyUsage::GetKeys() const
+{
+	std::vector<uint32_t> keys;
+
+	for (auto& [key, uses] : m_Uses)
+		keys.push_back(key);
+
+	return keys;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+//
+// Recorded usage of BSLightingShader setup keys and the reader/writer for BSLightingShaderTechniques.inl, the list of
+// keys that get specialized setup functions. Every entry line is
+//
+// LIGHTING_SETUP_SPECIALIZATION(0x00000206)	// SKINNED MODELSPACENORMALS SPECULAR; 1234 uses
+//
+// where uses counts the technique switches recorded for the key. Counts are kept in the file so reading a written
+// list back and merging the next session's recording accumulates them. Lines without a count (hand-written entries)
+// read as zero uses. No D3D dependencies.
+//
+class SetupKeyUsage
+{
+public:
+	using DescribeFunc = std::function<std::string(uint32_t Key)>;
+
+	void Record(uint32_t Key, uint64_t Uses = 1);
+	void Merge(const SetupKeyUsage& Other);
+	void ClearUses();							// Keys stay listed with zero uses
+
+	// Keeps the MaxKeys most used keys, ties are broken by the lower key
+	void Trim(size_t MaxKeys);
+
+	// Returns false if a LIGHTING_SETUP_SPECIALIZATION line can't be parsed. Comments and blank lines are skipped.
+	bool Read(std::istream& Stream);
+	bool Write(std::ostream& Stream, const DescribeFunc& Describe) const;
+
+	size_t QKeyCount() const;
+	uint64_t QUses(uint32_t Key) const;
+	std::vector<uint32_t> GetKeys() const;		// Sorted
+
+private:
+	std::map<uint32_t, uint64_t> m_Uses;
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <d3dcompiler.h>
+#include "../../common.h"
+#include "ShaderBytecodeRegistry.h"
+
+ShaderBytecodeRegistry::BlobId ShaderBytecodeRegistry::Register(void *Shader, const void *Bytecode, size_t Length)
+{
+	AssertMsg(Bytecode && Length > 0, "Registering empty shader bytecode");
+
+	uint64_t hash = HashBytecode((const uint8_t *)Bytecode, Length);
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	BlobId id = InvalidBlob;
+
+	for (auto [itr, end] = m_BlobsByHash.equal_range(hash); itr != end; itr++)
+	{
+		const BlobEntry& entry = m_Blobs[itr->second];
+
+		if (entry.Length == Length && !memcmp(entry.Data, Bytecode, Length))
+		{
+			id = itr->second;
+			break;
+		}
+	}
+
+	if (id == InvalidBlob)
+	{
+		id = (BlobId)m_Blobs.size();
+		m_Blobs.push_back({ CopyToArena(Bytecode, Length), Length, nullptr });
+		m_BlobsByHash.emplace(hash, id);
+		m_BytesStored += Length;
+	}
+
+	m_Shaders.insert_or_assign(Shader, id);
+	m_BytesRegistered += Length;
+	return id;
+}
+
+ShaderBytecodeRegistry::BlobId ShaderBytecodeRegistry::Find(void *Shader)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (auto itr = m_Shaders.find(Shader); itr != m_Shaders.end())
+		return itr->second;
+
+	return InvalidBlob;
+}
+
+ShaderBytecodeRegistry::Blob ShaderBytecodeRegistry::GetBlob(BlobId Id)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	AssertMsg(Id < m_Blobs.size(), "Invalid shader blob id");
+	return { m_Blobs[Id].Data, m_Blobs[Id].Length };
+}
+
+ID3D11ShaderReflection *ShaderBytecodeRegistry::GetReflection(BlobId Id)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	AssertMsg(Id < m_Blobs.size(), "Invalid shader blob id");
+	BlobEntry& entry = m_Blobs[Id];
+
+	if (!entry.Reflection)
+		Assert(SUCCEEDED(D3DReflect(entry.Data, entry.Length, IID_PPV_ARGS(&entry.Reflection))));
+
+	return entry.Reflection.Get();
+}
+
+ShaderBytecodeRegistry::Stats ShaderBytecodeRegistry::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	Stats stats;
+	stats.Shaders = (uint32_t)m_Shaders.size();
+	stats.UniqueBlobs = (uint32_t)m_Blobs.size();
+	stats.BytesRegistered = m_BytesRegistered;
+	stats.BytesStored = m_BytesStored;
+
+	return stats;
+}
+
+uint64_t ShaderBytecodeRegistry::HashBytecode(const uint8_t *Data, size_t Length)
+{
+	// "DXBC" followed by the container checksum
+	if (Length >= 20 && !memcmp(Data, "DXBC", 4))
+	{
+		uint64_t checksum[2];
+		memcpy(checksum, Data + 4, sizeof(checksum));
+
+		return checksum[0] ^ checksum[1] ^ Length;
+	}
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (size_t i = 0; i < Length; i++)
+	{
+		hash ^= Data[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+const uint8_t *ShaderBytecodeRegistry::CopyToArena(const void *Data, size_t Length)
+{
+	uint8_t *dest;
+
+	if (Length > ArenaPageSize / 4)
+	{
+		// Big blobs get a dedicated page so they don't waste the tail of the current one
+		m_ArenaPages.push_back(std::make_unique<uint8_t[]>(Length));
+		dest = m_ArenaPages.back().get();
+	}
+	else
+	{
+		size_t offset = (m_ArenaPageUsed + 15) & ~15ull;
+
+		if (offset + Length > ArenaPageSize)
+		{
+			m_ArenaPages.push_back(std::make_unique<uint8_t[]>(ArenaPageSize));
+			m_ArenaCurrentPage = m_ArenaPages.back().get();
+			offset = 0;
+		}
+
+		dest = m_ArenaCurrentPage + offset;
+		m_ArenaPageUsed = offset + Length;
+	}
+
+	memcpy(dest, Data, Length);
+	return dest;
+}
\ No newline at end of file
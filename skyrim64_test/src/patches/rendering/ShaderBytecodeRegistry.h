@@ -0,0 +1,70 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11shader.h>
+#include <wrl/client.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//
+// Bytecode for every shader object created through the device proxy or compiled by us. Many permutations produce
+// byte-identical blobs, so blobs are deduplicated by content and stored once in an append-only arena; shader objects
+// only map to a blob id. Reflection is parsed lazily, once per unique blob.
+//
+// DXBC containers carry an MD5 of their contents at bytes 4..19, which doubles as the content hash. Anything else
+// falls back to hashing the full blob. Candidates with equal hashes are always compared byte for byte.
+//
+class ShaderBytecodeRegistry
+{
+public:
+	using BlobId = uint32_t;
+	constexpr static BlobId InvalidBlob = 0xFFFFFFFF;
+
+	struct Blob
+	{
+		const uint8_t *Data;	// Stable for the lifetime of the registry
+		size_t Length;
+	};
+
+	struct Stats
+	{
+		uint32_t Shaders;
+		uint32_t UniqueBlobs;
+		uint64_t BytesRegistered;	// Sum over every Register() call
+		uint64_t BytesStored;		// Arena memory actually used
+	};
+
+	// A shader object that gets released and has its address reused is simply remapped
+	BlobId Register(void *Shader, const void *Bytecode, size_t Length);
+
+	BlobId Find(void *Shader);
+	Blob GetBlob(BlobId Id);
+	ID3D11ShaderReflection *GetReflection(BlobId Id);
+	Stats GetStats();
+
+private:
+	constexpr static size_t ArenaPageSize = 1 * 1024 * 1024;
+
+	struct BlobEntry
+	{
+		const uint8_t *Data;
+		size_t Length;
+		Microsoft::WRL::ComPtr<ID3D11ShaderReflection> Reflection;
+	};
+
+	static uint64_t HashBytecode(const uint8_t *Data, size_t Length);
+	const uint8_t *CopyToArena(const void *Data, size_t Length);
+
+	std::mutex m_Lock;
+	std::unordered_map<void *, BlobId> m_Shaders;					// Shader object -> blob
+	std::unordered_multimap<uint64_t, BlobId> m_BlobsByHash;		// Content hash -> candidate blobs
+	std::vector<BlobEntry> m_Blobs;
+	std::vector<std::unique_ptr<uint8_t[]>> m_ArenaPages;
+	uint8_t *m_ArenaCurrentPage = nullptr;
+	size_t m_ArenaPageUsed = ArenaPageSize;						// Forces a new page on first use
+	uint64_t m_BytesRegistered = 0;
+	uint64_t m_BytesStored = 0;
+};
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "ShaderCache.h"
+
+namespace fs = std::filesystem;
+
+struct Fnv64
+{
+	uint64_t Value = 0xCBF29CE484222325ull;
+
+	void Add(const void *Data, size_t Length)
+	{
+		auto bytes = static_cast<const uint8_t *>(Data);
+
+		for (size_t i = 0; i < Length; i++)
+		{
+			Value ^= bytes[i];
+			Value *= 0x100000001B3ull;
+		}
+	}
+
+	void Add(const std::string& String)
+	{
+		// Length prefix so ("AB", "C") and ("A", "BC") hash differently
+		uint64_t length = String.size();
+
+		Add(&length, sizeof(length));
+		Add(String.data(), String.size());
+	}
+
+	void Add(uint64_t Number)
+	{
+		Add(&Number, sizeof(Number));
+	}
+};
+
+ShaderCache::ShaderCache(const fs::path& Directory, ShaderCompileFunc Compiler, uint32_t ThreadCount) :
+	m_Directory(Directory),
+	m_Compiler(std::move(Compiler)),
+	m_ThreadCount(ThreadCount ? ThreadCount : std::max(1u, std::thread::hardware_concurrency())),
+	m_MemoryHits(0),
+	m_DiskHits(0),
+	m_Compiles(0),
+	m_Failures(0)
+{
+	std::error_code ec;
+	fs::create_directories(m_Directory, ec);
+}
+
+ShaderBytecode ShaderCache::Get(const ShaderCompileRequest& Request, std::string *Errors)
+{
+	uint64_t key = ComputeKey(Request);
+
+	if (auto bytecode = Lookup(key))
+		return bytecode;
+
+	return Compile(Request, key, Errors);
+}
+
+void ShaderCache::Prefetch(const std::vector<ShaderCompileRequest>& Requests)
+{
+	std::vector<std::pair<const ShaderCompileRequest *, uint64_t>> misses;
+
+	// Keys (and with them the source hashes) are computed up front on this thread
+	for (auto& request : Requests)
+	{
+		uint64_t key = ComputeKey(request);
+
+		if (Lookup(key))
+			continue;
+
+		// Identical permutations in one batch compile once
+		auto duplicate = std::find_if(misses.begin(), misses.end(), [key](const auto& Miss) { return Miss.second == key; });
+
+		if (duplicate == misses.end())
+			misses.emplace_back(&request, key);
+	}
+
+	if (misses.empty())
+		return;
+
+	std::atomic_size_t nextMiss(0);
+	auto worker = [&]()
+	{
+		for (size_t i = nextMiss++; i < misses.size(); i = nextMiss++)
+			Compile(*misses[i].first, misses[i].second, nullptr);
+	};
+
+	std::vector<std::thread> threads;
+	uint32_t threadCount = (uint32_t)std::min<size_t>(m_ThreadCount, misses.size());
+
+	for (uint32_t i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void ShaderCache::InvalidateSources()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Sources.clear();
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderCompileRequest& Request)
+{
+	Fnv64 hash;
+
+	hash.Add(FileVersion);
+	hash.Add(HashSource(Request.SourcePath, 0));
+	hash.Add(Request.Defines.size());
+
+	for (auto& [name, value] : Request.Defines)
+	{
+		hash.Add(name);
+		hash.Add(value);
+	}
+
+	hash.Add(Request.EntryPoint);
+	hash.Add(Request.Target);
+	hash.Add(Request.Flags);
+	return hash.Value;
+}
+
+ShaderCache::Stats ShaderCache::GetStats() const
+{
+	Stats stats;
+	stats.MemoryHits = m_MemoryHits.load();
+	stats.DiskHits = m_DiskHits.load();
+	stats.Compiles = m_Compiles.load();
+	stats.Failures = m_Failures.load();
+
+	return stats;
+}
+
+ShaderBytecode ShaderCache::Lookup(uint64_t Key)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (auto itr = m_Bytecode.find(Key); itr != m_Bytecode.end())
+		{
+			m_MemoryHits++;
+			return itr->second;
+		}
+	}
+
+	auto bytecode = ReadFromDisk(Key);
+
+	if (bytecode)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		m_DiskHits++;
+		m_Bytecode.try_emplace(Key, bytecode);
+	}
+
+	return bytecode;
+}
+
+ShaderBytecode ShaderCache::Compile(const ShaderCompileRequest& Request, uint64_t Key, std::string *Errors)
+{
+	std::vector<uint8_t> output;
+	std::string errors;
+
+	if (!m_Compiler(Request, output, errors) || output.empty())
+	{
+		m_Failures++;
+
+		if (Errors)
+			*Errors = errors.empty() ? "Unknown error" : errors;
+
+		return nullptr;
+	}
+
+	m_Compiles++;
+	WriteToDisk(Key, output);
+
+	auto bytecode = std::make_shared<const std::vector<uint8_t>>(std::move(output));
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Bytecode.try_emplace(Key, bytecode).first->second;
+}
+
+uint64_t ShaderCache::HashSource(const fs::path& Path, uint32_t Depth)
+{
+	std::error_code ec;
+	fs::path fullPath = fs::weakly_canonical(Path, ec);
+	std::string name = (ec ? Path : fullPath).generic_string();
+
+	std::error_code timeError;
+	std::error_code sizeError;
+	auto writeTime = fs::last_write_time(Path, timeError);
+	auto size = fs::file_size(Path, sizeError);
+
+	Fnv64 hash;
+	hash.Add(name);
+
+	if (timeError || sizeError)
+	{
+		// Missing files still get a stable hash; the compiler reports the real error
+		hash.Add(0xFFFFFFFFFFFFFFFFull);
+		return hash.Value;
+	}
+
+	uint64_t contentHash;
+	std::vector<fs::path> includes;
+	bool cached = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		if (auto itr = m_Sources.find(name); itr != m_Sources.end() && itr->second.WriteTime == writeTime && itr->second.Size == size)
+		{
+			contentHash = itr->second.ContentHash;
+			includes = itr->second.Includes;
+			cached = true;
+		}
+	}
+
+	if (!cached)
+	{
+		std::ifstream file(Path, std::ios::binary);
+
+		if (!file)
+		{
+			hash.Add(0xFFFFFFFFFFFFFFFFull);
+			return hash.Value;
+		}
+
+		std::stringstream contents;
+		contents << file.rdbuf();
+
+		std::string text = contents.str();
+		Fnv64 content;
+		content.Add(name);
+		content.Add(text);
+		contentHash = content.Value;
+
+		// Quoted includes are resolved relative to the including file, same as D3D_COMPILE_STANDARD_FILE_INCLUDE
+		std::istringstream lines(text);
+
+		for (std::string line; std::getline(lines, line);)
+		{
+			size_t directive = line.find_first_not_of(" \t");
+
+			if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+				continue;
+
+			size_t open = line.find('"', directive);
+			size_t close = (open != std::string::npos) ? line.find('"', open + 1) : std::string::npos;
+
+			if (close != std::string::npos)
+				includes.push_back(Path.parent_path() / line.substr(open + 1, close - open - 1));
+		}
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Sources[name] = { writeTime, size, contentHash, includes };
+	}
+
+	// Includes are checked every time since they can change without the including file changing
+	hash.Add(contentHash);
+
+	if (Depth < 16)
+	{
+		for (auto& include : includes)
+			hash.Add(HashSource(include, Depth + 1));
+	}
+
+	return hash.Value;
+}
+
+fs::path ShaderCache::GetCachePath(uint64_t Key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)Key);
+
+	return m_Directory / name;
+}
+
+ShaderBytecode ShaderCache::ReadFromDisk(uint64_t Key) const
+{
+	std::ifstream file(GetCachePath(Key), std::ios::binary);
+
+	if (!file)
+		return nullptr;
+
+	FileHeader header;
+
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+		return nullptr;
+
+	if (header.Magic != FileMagic || header.Version != FileVersion || header.Key != Key || header.BytecodeSize == 0)
+		return nullptr;
+
+	std::vector<uint8_t> bytecode(header.BytecodeSize);
+
+	if (!file.read(reinterpret_cast<char *>(bytecode.data()), bytecode.size()))
+		return nullptr;
+
+	// Truncated or corrupted files are treated as misses and overwritten later
+	Fnv64 hash;
+	hash.Add(bytecode.data(), bytecode.size());
+
+	if (hash.Value != header.BytecodeHash)
+		return nullptr;
+
+	return std::make_shared<const std::vector<uint8_t>>(std::move(bytecode));
+}
+
+void ShaderCache::WriteToDisk(uint64_t Key, const std::vector<uint8_t>& Bytecode) const
+{
+	Fnv64 hash;
+	hash.Add(Bytecode.data(), Bytecode.size());
+
+	FileHeader header = {};
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Key = Key;
+	header.BytecodeHash = hash.Value;
+	header.BytecodeSize = (uint32_t)Bytecode.size();
+
+	// Written under a unique name and renamed so other threads or processes never see partial files
+	std::stringstream tempName;
+	tempName << GetCachePath(Key).filename().string() << '.' << std::this_thread::get_id() << ".tmp";
+
+	fs::path tempPath = m_Directory / tempName.str();
+
+	std::error_code ec;
+	bool written;
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char *>(Bytecode.data()), Bytecode.size());
+		written = file.good();
+	}
+
+	if (written)
+		fs::rename(tempPath, GetCachePath(Key), ec);
+
+	if (!written || ec)
+		fs::remove(tempPath, ec);
+}
\ No newline at end of file
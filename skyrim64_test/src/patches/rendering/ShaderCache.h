@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderCompileRequest
+{
+	std::filesystem::path SourcePath;
+	std::vector<std::pair<std::string, std::string>> Defines;	// Passed to the compiler in this order
+	std::string EntryPoint;
+	std::string Target;											// Profile, e.g. "vs_5_0"
+	uint32_t Flags;
+};
+
+using ShaderBytecode = std::shared_ptr<const std::vector<uint8_t>>;
+using ShaderCompileFunc = std::function<bool(const ShaderCompileRequest& Request, std::vector<uint8_t>& Bytecode, std::string& Errors)>;
+
+//
+// Content-addressed shader bytecode cache. The key hashes the source text (including every file pulled in through
+// quoted #includes), the defines, entry point, target profile and compiler flags, so editing a shader or changing a
+// permutation never returns stale bytecode. Results live in memory for the session and on disk across sessions,
+// one file per key.
+//
+// Source files are only read again when their size or last write time changes, so edits made while the game runs
+// are picked up by the next Get() without rereading unchanged files for every permutation.
+//
+// Prefetch() compiles all misses of a batch on worker threads; later Get() calls for the same requests are memory
+// hits. The actual compiler is supplied by the caller, so nothing here depends on D3D or Windows.
+//
+class ShaderCache
+{
+public:
+	struct Stats
+	{
+		uint64_t MemoryHits;
+		uint64_t DiskHits;
+		uint64_t Compiles;
+		uint64_t Failures;
+	};
+
+	ShaderCache(const std::filesystem::path& Directory, ShaderCompileFunc Compiler, uint32_t ThreadCount = 0);
+
+	// Returns nullptr and fills Errors (if provided) when compilation fails
+	ShaderBytecode Get(const ShaderCompileRequest& Request, std::string *Errors = nullptr);
+	void Prefetch(const std::vector<ShaderCompileRequest>& Requests);
+
+	// Forgets every source hash, even for files whose size and write time look unchanged
+	void InvalidateSources();
+
+	uint64_t ComputeKey(const ShaderCompileRequest& Request);
+	Stats GetStats() const;
+
+private:
+	constexpr static uint32_t FileMagic = 0x53484343;	// 'CCHS'
+	constexpr static uint32_t FileVersion = 1;
+
+	struct SourceEntry
+	{
+		std::filesystem::file_time_type WriteTime;
+		uintmax_t Size;
+		uint64_t ContentHash;							// Path and text of this file only
+		std::vector<std::filesystem::path> Includes;	// Quoted #includes, resolved relative to this file
+	};
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t BytecodeHash;
+		uint32_t BytecodeSize;
+		uint32_t Reserved;
+	};
+
+	ShaderBytecode Lookup(uint64_t Key);
+	ShaderBytecode Compile(const ShaderCompileRequest& Request, uint64_t Key, std::string *Errors);
+
+	uint64_t HashSource(const std::filesystem::path& Path, uint32_t Depth);
+	std::filesystem::path GetCachePath(uint64_t Key) const;
+	ShaderBytecode ReadFromDisk(uint64_t Key) const;
+	void WriteToDisk(uint64_t Key, const std::vector<uint8_t>& Bytecode) const;
+
+	const std::filesystem::path m_Directory;
+	const ShaderCompileFunc m_Compiler;
+	const uint32_t m_ThreadCount;
+
+	std::mutex m_Lock;
+	std::unordered_map<uint64_t, ShaderBytecode> m_Bytecode;	// Key -> bytecode
+	std::unordered_map<std::string, SourceEntry> m_Sources;		// Normalized path -> contents
+
+	std::atomic_uint64_t m_MemoryHits;
+	std::atomic_uint64_t m_DiskHits;
+	std::atomic_uint64_t m_Compiles;
+	std::atomic_uint64_t m_Failures;
+};
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include "ShadowCache.h"
+
+bool ShadowCasterSignature::operator==(const ShadowCasterSignature& Other) const
+{
+	return StaticHash == Other.StaticHash && StaticCount == Other.StaticCount && DynamicCount == Other.DynamicCount;
+}
+
+bool ShadowCasterSignature::operator!=(const ShadowCasterSignature& Other) const
+{
+	return !(*this == Other);
+}
+
+ShadowCache::ShadowCache(uint32_t MaxSlots, uint32_t StableFrames, uint32_t EvictFrames) :
+	m_StableFrames(std::max(1u, StableFrames)),
+	m_EvictFrames(std::max(1u, EvictFrames)),
+	m_Slots(MaxSlots),
+	m_Frame(0),
+	m_FrameStats(),
+	m_LastStats()
+{
+	Clear();
+}
+
+uint64_t ShadowCache::HashBytes(const void *Data, size_t Length, uint64_t Seed)
+{
+	auto bytes = static_cast<const uint8_t *>(Data);
+	uint64_t hash = 0xCBF29CE484222325ull ^ Seed;
+
+	for (size_t i = 0; i < Length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+uint64_t ShadowCache::Mix(uint64_t Value)
+{
+	// splitmix64 finalizer. FNV alone leaves the low bits too similar for summing.
+	Value ^= Value >> 30;
+	Value *= 0xBF58476D1CE4E5B9ull;
+	Value ^= Value >> 27;
+	Value *= 0x94D049BB133111EBull;
+	Value ^= Value >> 31;
+	return Value;
+}
+
+void ShadowCache::AddStaticCaster(ShadowCasterSignature& Signature, uint64_t CasterHash)
+{
+	Signature.StaticHash += Mix(CasterHash);
+	Signature.StaticCount++;
+}
+
+void ShadowCache::AddDynamicCaster(ShadowCasterSignature& Signature)
+{
+	Signature.DynamicCount++;
+}
+
+ShadowCache::Decision ShadowCache::Begin(uint64_t Key, uint64_t LightHash, const ShadowCasterSignature& Casters)
+{
+	Entry *entry = (Casters.StaticCount > 0) ? FindOrAllocate(Key) : nullptr;
+
+	// Nothing worth keeping, or no memory to keep it in
+	if (!entry)
+	{
+		m_FrameStats.Rendered++;
+		return { Action::Render, InvalidSlot };
+	}
+
+	entry->LastUsedFrame = m_Frame;
+
+	if (entry->LightHash != LightHash || entry->Casters != Casters)
+	{
+		entry->Valid = false;
+		entry->LightHash = LightHash;
+		entry->Casters = Casters;
+		entry->StableFrames = 0;
+
+		m_FrameStats.Rendered++;
+		return { Action::Render, InvalidSlot };
+	}
+
+	uint32_t slot = (uint32_t)(entry - m_Slots.data());
+
+	if (entry->Valid)
+	{
+		m_FrameStats.Reused++;
+		m_FrameStats.StaticCastersSkipped += Casters.StaticCount;
+		return { Action::Reuse, slot };
+	}
+
+	if (++entry->StableFrames < m_StableFrames)
+	{
+		m_FrameStats.Rendered++;
+		return { Action::Render, InvalidSlot };
+	}
+
+	entry->Valid = true;
+
+	m_FrameStats.Rebuilt++;
+	return { Action::Rebuild, slot };
+}
+
+void ShadowCache::Invalidate(uint32_t Slot)
+{
+	if (Slot >= m_Slots.size())
+		return;
+
+	m_Slots[Slot].Valid = false;
+	m_Slots[Slot].StableFrames = 0;
+}
+
+void ShadowCache::Clear()
+{
+	for (auto& entry : m_Slots)
+	{
+		entry.Active = false;
+		entry.Valid = false;
+	}
+}
+
+void ShadowCache::EndFrame()
+{
+	uint32_t activeSlots = 0;
+
+	for (auto& entry : m_Slots)
+	{
+		if (!entry.Active)
+			continue;
+
+		if (m_Frame - entry.LastUsedFrame >= m_EvictFrames)
+		{
+			entry.Active = false;
+			entry.Valid = false;
+			m_FrameStats.Evicted++;
+			continue;
+		}
+
+		activeSlots++;
+	}
+
+	m_FrameStats.ActiveSlots = activeSlots;
+	m_LastStats = m_FrameStats;
+	m_FrameStats = {};
+	m_Frame++;
+}
+
+uint32_t ShadowCache::QMaxSlots() const
+{
+	return (uint32_t)m_Slots.size();
+}
+
+bool ShadowCache::IsSlotActive(uint32_t Slot) const
+{
+	return Slot < m_Slots.size() && m_Slots[Slot].Active;
+}
+
+ShadowCache::Stats ShadowCache::GetStats() const
+{
+	return m_LastStats;
+}
+
+ShadowCache::Entry *ShadowCache::FindOrAllocate(uint64_t Key)
+{
+	Entry *unused = nullptr;
+	Entry *oldest = nullptr;
+
+	for (auto& entry : m_Slots)
+	{
+		if (!entry.Active)
+		{
+			if (!unused)
+				unused = &entry;
+
+			continue;
+		}
+
+		if (entry.Key == Key)
+			return &entry;
+
+		if (!oldest || entry.LastUsedFrame < oldest->LastUsedFrame)
+			oldest = &entry;
+	}
+
+	// When full, take over the least recently used slot unless it was needed this or last frame. Otherwise two lights
+	// fighting over one slot would throw away each other's snapshots every frame.
+	if (!unused && oldest && oldest->LastUsedFrame + 1 < m_Frame)
+	{
+		m_FrameStats.Evicted++;
+		unused = oldest;
+	}
+
+	if (!unused)
+		return nullptr;
+
+	unused->Active = true;
+	unused->Valid = false;
+	unused->Key = Key;
+	unused->LightHash = 0;
+	unused->Casters = {};
+	unused->StableFrames = 0;
+	unused->LastUsedFrame = m_Frame;
+	return unused;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+//
+// Order independent summary of the casters registered for one shadow map. Static casters are folded into a single
+// hash (a sum of mixed per-caster hashes, so registration order and thread don't matter), dynamic casters are only
+// counted since they're redrawn every frame anyway.
+//
+struct ShadowCasterSignature
+{
+	uint64_t StaticHash;
+	uint32_t StaticCount;
+	uint32_t DynamicCount;
+
+	bool operator==(const ShadowCasterSignature& Other) const;
+	bool operator!=(const ShadowCasterSignature& Other) const;
+};
+
+//
+// Decides per shadow map (one light or cascade, identified by a caller supplied key) whether the static casters have
+// to be drawn. A slot remembers the light hash (transform, projection, viewport...) and the caster signature from the
+// last frame it was used:
+//
+// - Anything changed: draw everything, the slot starts over
+// - Unchanged for StableFrames frames: draw static casters, snapshot the depth map, then draw dynamic casters
+// - Unchanged and snapshotted: restore the snapshot and only draw dynamic casters
+//
+// Waiting a few frames keeps moving lights from paying for snapshots they never reuse. Slots not used for EvictFrames
+// frames are freed, the caller releases their memory. Not thread safe and no D3D dependencies.
+//
+class ShadowCache
+{
+public:
+	constexpr static uint32_t InvalidSlot = 0xFFFFFFFF;
+
+	enum class Action
+	{
+		Render,				// Draw all casters
+		Rebuild,			// Draw static casters, store the snapshot, draw dynamic casters
+		Reuse,				// Restore the snapshot, draw dynamic casters
+	};
+
+	struct Decision
+	{
+		Action Type;
+		uint32_t Slot;		// InvalidSlot for Action::Render
+	};
+
+	struct Stats
+	{
+		uint32_t Reused;
+		uint32_t Rebuilt;
+		uint32_t Rendered;
+		uint32_t Evicted;
+		uint32_t ActiveSlots;
+		uint64_t StaticCastersSkipped;
+	};
+
+	ShadowCache(uint32_t MaxSlots, uint32_t StableFrames = 2, uint32_t EvictFrames = 60);
+
+	static uint64_t HashBytes(const void *Data, size_t Length, uint64_t Seed = 0);
+	static uint64_t Mix(uint64_t Value);
+	static void AddStaticCaster(ShadowCasterSignature& Signature, uint64_t CasterHash);
+	static void AddDynamicCaster(ShadowCasterSignature& Signature);
+
+	Decision Begin(uint64_t Key, uint64_t LightHash, const ShadowCasterSignature& Casters);
+
+	// The snapshot couldn't be stored or restored. The slot renders normally until it's stable again.
+	void Invalidate(uint32_t Slot);
+
+	// Frees every slot
+	void Clear();
+
+	void EndFrame();
+
+	uint32_t QMaxSlots() const;
+	bool IsSlotActive(uint32_t Slot) const;
+	Stats GetStats() const;			// Totals of the last completed frame
+
+private:
+	struct Entry
+	{
+		bool Active;
+		bool Valid;					// Snapshot matches LightHash and Casters
+		uint64_t Key;
+		uint64_t LightHash;
+		ShadowCasterSignature Casters;
+		uint32_t StableFrames;		// Consecutive uses with an unchanged light and casters
+		uint64_t LastUsedFrame;
+	};
+
+	Entry *FindOrAllocate(uint64_t Key);
+
+	const uint32_t m_StableFrames;
+	const uint32_t m_EvictFrames;
+
+	std::vector<Entry> m_Slots;
+	uint64_t m_Frame;
+
+	Stats m_FrameStats;
+	Stats m_LastStats;
+};
\ No newline at end of file
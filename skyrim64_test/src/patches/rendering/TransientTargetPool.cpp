@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <fstream>
+#include "TransientTargetPool.h"
+
+TransientTargetPool::TransientTargetPool(uint32_t TargetCount) : m_Targets(TargetCount), m_Unordered(new std::atomic_bool[TargetCount])
+{
+	for (uint32_t i = 0; i < TargetCount; i++)
+	{
+		m_Targets[i].Described = false;
+		m_Targets[i].PlanKey = 0;
+		m_Targets[i].Slot = InvalidSlot;
+		m_Unordered[i] = false;
+	}
+
+	m_SlotCount = 0;
+	m_PlanActive = false;
+	ResetObservations();
+}
+
+void TransientTargetPool::SetTarget(uint32_t Target, uint64_t Key, uint64_t Bytes, bool Eligible)
+{
+	if (Target >= m_Targets.size())
+		return;
+
+	auto& target = m_Targets[Target];
+	target.Key = Key;
+	target.Bytes = Bytes;
+	target.Described = true;
+	target.Eligible = Eligible;
+
+	// Anything seen before belonged to a different resource
+	ResetFrame(target);
+	target.First = InvalidPass;
+	target.Last = 0;
+	target.FramesUsed = 0;
+	target.Persistent = false;
+
+	if (!m_SavedTargets.empty())
+		CheckLoadedPlan();
+}
+
+void TransientTargetPool::RemoveTarget(uint32_t Target)
+{
+	if (Target >= m_Targets.size())
+		return;
+
+	m_Targets[Target].Described = false;
+
+	if (!m_SavedTargets.empty())
+		CheckLoadedPlan();
+}
+
+void TransientTargetPool::CheckLoadedPlan()
+{
+	bool complete = true;
+
+	for (uint32_t i = 0; i < m_Targets.size(); i++)
+	{
+		auto& target = m_Targets[i];
+		auto& saved = m_SavedTargets[i];
+
+		if (target.Described && (!saved.Described || saved.Key != target.Key))
+		{
+			DiscardPlan();
+			return;
+		}
+
+		if (saved.Described && !target.Described)
+			complete = false;
+	}
+
+	if (complete)
+	{
+		m_PlanActive = true;
+		m_SavedTargets.clear();
+	}
+}
+
+void TransientTargetPool::DiscardPlan()
+{
+	for (auto& target : m_Targets)
+	{
+		target.PlanKey = 0;
+		target.Slot = InvalidSlot;
+	}
+
+	m_SlotCount = 0;
+	m_PlanActive = false;
+	m_SavedTargets.clear();
+}
+
+void TransientTargetPool::BeginPass()
+{
+	m_Pass++;
+}
+
+void TransientTargetPool::Read(uint32_t Target)
+{
+	Touch(Target, true, false);
+}
+
+void TransientTargetPool::Write(uint32_t Target)
+{
+	Touch(Target, true, true);
+}
+
+void TransientTargetPool::Use(uint32_t Target)
+{
+	Touch(Target, false, false);
+}
+
+void TransientTargetPool::Touch(uint32_t Target, bool Decides, bool IsWrite)
+{
+	if (Target >= m_Targets.size())
+		return;
+
+	auto& target = m_Targets[Target];
+
+	if (target.FrameFirst == InvalidPass)
+		target.FrameFirst = m_Pass;
+
+	if (Decides && !target.FrameDecided)
+	{
+		target.FrameDecided = true;
+		target.FrameWriteFirst = IsWrite;
+	}
+
+	target.FrameLast = m_Pass;
+}
+
+void TransientTargetPool::ResetFrame(TargetState& Target)
+{
+	Target.FrameFirst = InvalidPass;
+	Target.FrameLast = InvalidPass;
+	Target.FrameDecided = false;
+	Target.FrameWriteFirst = false;
+}
+
+void TransientTargetPool::MarkUnordered(uint32_t Target)
+{
+	if (Target < m_Targets.size())
+		m_Unordered[Target].store(true, std::memory_order_relaxed);
+}
+
+void TransientTargetPool::EndFrame()
+{
+	for (auto& target : m_Targets)
+	{
+		if (target.FrameFirst == InvalidPass)
+			continue;
+
+		target.First = std::min(target.First, target.FrameFirst);
+		target.Last = std::max(target.Last, target.FrameLast);
+		target.FramesUsed++;
+		target.Persistent |= !target.FrameWriteFirst;
+
+		ResetFrame(target);
+	}
+
+	m_Pass = 0;
+	m_ObservedFrames++;
+}
+
+void TransientTargetPool::ResetObservations()
+{
+	for (uint32_t i = 0; i < m_Targets.size(); i++)
+	{
+		auto& target = m_Targets[i];
+		ResetFrame(target);
+		target.First = InvalidPass;
+		target.Last = 0;
+		target.FramesUsed = 0;
+		target.Persistent = false;
+		m_Unordered[i] = false;
+	}
+
+	m_Pass = 0;
+	m_ObservedFrames = 0;
+}
+
+void TransientTargetPool::BuildPlan(uint32_t MinFrames)
+{
+	struct SlotState
+	{
+		uint64_t Key;
+		uint32_t End;	// Last pass of the most recent target placed in this slot
+	};
+
+	DiscardPlan();
+
+	std::vector<uint32_t> candidates;
+
+	for (uint32_t i = 0; i < m_Targets.size(); i++)
+	{
+		auto& target = m_Targets[i];
+
+		if (!target.Described || !target.Eligible || target.Persistent || m_Unordered[i].load(std::memory_order_relaxed))
+			continue;
+
+		if (target.FramesUsed < std::max(MinFrames, 1u))
+			continue;
+
+		candidates.push_back(i);
+	}
+
+	// Sorting by start pass makes greedy partitioning optimal for each key
+	std::sort(candidates.begin(), candidates.end(), [this](uint32_t A, uint32_t B)
+	{
+		return m_Targets[A].First < m_Targets[B].First;
+	});
+
+	std::vector<SlotState> slots;
+
+	for (uint32_t index : candidates)
+	{
+		auto& target = m_Targets[index];
+		auto slot = std::find_if(slots.begin(), slots.end(), [&target](const SlotState& Slot)
+		{
+			return Slot.Key == target.Key && Slot.End < target.First;
+		});
+
+		if (slot == slots.end())
+		{
+			slots.push_back({ target.Key, target.Last });
+			slot = slots.end() - 1;
+		}
+		else
+		{
+			slot->End = target.Last;
+		}
+
+		target.PlanKey = target.Key;
+		target.Slot = (uint32_t)(slot - slots.begin());
+	}
+
+	m_SlotCount = (uint32_t)slots.size();
+	m_PlanActive = true;
+}
+
+uint32_t TransientTargetPool::QSlot(uint32_t Target) const
+{
+	if (Target >= m_Targets.size())
+		return InvalidSlot;
+
+	return m_Targets[Target].Slot;
+}
+
+uint32_t TransientTargetPool::QAliasOf(uint32_t Target, uint64_t Key) const
+{
+	if (Target >= m_Targets.size() || !m_PlanActive)
+		return Target;
+
+	auto& target = m_Targets[Target];
+
+	if (target.Slot == InvalidSlot || target.PlanKey != Key)
+		return Target;
+
+	for (uint32_t i = 0; i < m_Targets.size(); i++)
+	{
+		auto& other = m_Targets[i];
+
+		if (i != Target && other.Described && other.Slot == target.Slot && other.PlanKey == Key && other.Key == Key)
+			return i;
+	}
+
+	return Target;
+}
+
+uint32_t TransientTargetPool::QObservedFrames() const
+{
+	return m_ObservedFrames;
+}
+
+bool TransientTargetPool::QPlanActive() const
+{
+	return m_PlanActive;
+}
+
+TransientTargetPool::Stats TransientTargetPool::GetStats() const
+{
+	Stats stats = {};
+	std::vector<bool> slotUsed(m_SlotCount, false);
+
+	for (auto& target : m_Targets)
+	{
+		if (!target.Described)
+			continue;
+
+		stats.Targets++;
+		stats.TotalBytes += target.Bytes;
+
+		if (!m_PlanActive || target.Slot == InvalidSlot || target.Slot >= m_SlotCount || target.PlanKey != target.Key)
+			continue;
+
+		stats.TransientTargets++;
+		stats.TransientBytes += target.Bytes;
+
+		if (!slotUsed[target.Slot])
+		{
+			slotUsed[target.Slot] = true;
+			stats.Slots++;
+			stats.PooledBytes += target.Bytes;
+		}
+	}
+
+	stats.ObservedFrames = m_ObservedFrames;
+	stats.PlanActive = m_PlanActive;
+	return stats;
+}
+
+bool TransientTargetPool::Save(const std::filesystem::path& Path) const
+{
+	std::ofstream file(Path, std::ios::trunc);
+
+	if (!file)
+		return false;
+
+	file << FileVersion << ' ' << m_Targets.size() << '\n';
+
+	// Every described target is listed, transient or not, so Load() can tell whether the plan still applies
+	for (uint32_t i = 0; i < m_Targets.size(); i++)
+	{
+		auto& target = m_Targets[i];
+
+		if (target.Described)
+			file << i << ' ' << target.Key << ' ' << (m_PlanActive && target.PlanKey == target.Key ? target.Slot : InvalidSlot) << '\n';
+	}
+
+	return file.good();
+}
+
+bool TransientTargetPool::Load(const std::filesystem::path& Path)
+{
+	std::ifstream file(Path);
+
+	uint32_t version = 0;
+	size_t targetCount = 0;
+
+	if (!(file >> version >> targetCount) || version != FileVersion || targetCount != m_Targets.size())
+		return false;
+
+	DiscardPlan();
+
+	std::vector<SavedTarget> saved(m_Targets.size(), SavedTarget{ false, 0 });
+	uint32_t index;
+	uint64_t key;
+	uint32_t slot;
+
+	while (file >> index >> key >> slot)
+	{
+		if (index >= m_Targets.size())
+			continue;
+
+		saved[index] = { true, key };
+
+		if (slot >= m_Targets.size())
+			continue;
+
+		m_Targets[index].PlanKey = key;
+		m_Targets[index].Slot = slot;
+		m_SlotCount = std::max(m_SlotCount, slot + 1);
+	}
+
+	// Targets that are already described are checked right away, the rest as they show up
+	m_SavedTargets = std::move(saved);
+	CheckLoadedPlan();
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+//
+// Lifetime analysis and aliasing plan for a fixed set of render targets. Every frame is split into passes (one per
+// render target change) and each target records the first and last pass it was touched in. Intervals are merged over
+// all observed frames, so two targets that overlap in any single frame also overlap in the merged result.
+//
+// A target becomes transient when it is eligible, was used in enough frames, and in every frame it was written (cleared
+// or fully overwritten) before anything read it, meaning nothing carries over from the previous frame. Uses only extend
+// the interval: a target bound for output may be blended onto, so it neither starts nor ends its lifetime there.
+// A frame that uses a target without writing it keeps the target persistent. Transient targets with the same key (size, format
+// and flags) and disjoint intervals are packed into shared slots with greedy interval partitioning.
+//
+// Plans are saved to disk together with the key of every described target. A loaded plan stays inactive until the same
+// set of targets has been described again with the same keys, and is discarded as soon as one of them differs (another
+// resolution, INI settings or mods), so aliasing never follows lifetimes observed for different targets. No D3D
+// dependencies.
+//
+class TransientTargetPool
+{
+public:
+	constexpr static uint32_t InvalidSlot = 0xFFFFFFFF;
+
+	struct Stats
+	{
+		uint32_t Targets;				// Targets that were described
+		uint32_t TransientTargets;		// Targets assigned to a slot by the last plan
+		uint32_t Slots;
+		uint64_t TotalBytes;			// All described targets
+		uint64_t TransientBytes;		// Transient targets if each had its own memory
+		uint64_t PooledBytes;			// Transient targets after sharing slots
+		uint32_t ObservedFrames;
+		bool PlanActive;				// False while a loaded plan waits for its targets, or after it was discarded
+	};
+
+	TransientTargetPool(uint32_t TargetCount);
+
+	void SetTarget(uint32_t Target, uint64_t Key, uint64_t Bytes, bool Eligible);
+	void RemoveTarget(uint32_t Target);
+
+	// Render thread only
+	void BeginPass();
+	void Read(uint32_t Target);
+	void Write(uint32_t Target);
+	void Use(uint32_t Target);
+	void EndFrame();
+	void ResetObservations();
+
+	// Any thread. The target is accessed in an order that can't be observed (e.g. deferred contexts) and is never
+	// considered transient.
+	void MarkUnordered(uint32_t Target);
+
+	void BuildPlan(uint32_t MinFrames);
+	uint32_t QSlot(uint32_t Target) const;
+	uint32_t QAliasOf(uint32_t Target, uint64_t Key) const;		// Another described target in Target's slot, or Target
+	uint32_t QObservedFrames() const;
+	bool QPlanActive() const;
+	Stats GetStats() const;
+
+	bool Save(const std::filesystem::path& Path) const;
+	bool Load(const std::filesystem::path& Path);
+
+private:
+	constexpr static uint32_t InvalidPass = 0xFFFFFFFF;
+	constexpr static uint32_t FileVersion = 2;
+
+	struct SavedTarget
+	{
+		bool Described;
+		uint64_t Key;
+	};
+
+	struct TargetState
+	{
+		uint64_t Key;
+		uint64_t Bytes;
+		bool Described;
+		bool Eligible;
+
+		// Current frame
+		uint32_t FrameFirst;
+		uint32_t FrameLast;
+		bool FrameDecided;			// A read or write happened
+		bool FrameWriteFirst;
+
+		// Merged over all frames
+		uint32_t First;
+		uint32_t Last;
+		uint32_t FramesUsed;
+		bool Persistent;
+
+		// Plan
+		uint64_t PlanKey;
+		uint32_t Slot;
+	};
+
+	void Touch(uint32_t Target, bool Decides, bool IsWrite);
+	void CheckLoadedPlan();
+	void DiscardPlan();
+	static void ResetFrame(TargetState& Target);
+
+	std::vector<TargetState> m_Targets;
+	std::unique_ptr<std::atomic_bool[]> m_Unordered;
+	uint32_t m_Pass;
+	uint32_t m_ObservedFrames;
+	uint32_t m_SlotCount;
+	bool m_PlanActive;
+	std::vector<SavedTarget> m_SavedTargets;	// Targets a loaded plan was built for, empty once it was checked
+};
\ No newline at end of file
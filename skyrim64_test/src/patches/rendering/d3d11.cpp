@@ -4,6 +4,11 @@
 #include <xbyak/xbyak.h>
 #include "d3d11_proxy.h"
 #include "GpuTimer.h"
+#include "d3d11_deferred.h"
+#include "d3d11_capture.h"
+#include "d3d11_transient.h"
+#include "d3d11_pacing.h"
+#include "d3d11_shadowcache.h"
 #include "../../ui/ui.h"
 #include "../TES/BSShader/BSShaderManager.h"
 #include "../TES/BSShader/BSShaderRenderTargets.h"
@@ -13,6 +18,7 @@
 #include "../TES/BSShader/Shaders/BSGrassShader.h"
 #include "../TES/BSGraphics/BSGraphicsRenderer.h"
 #include "../TES/BSBatchRenderer.h"
+#include "../TES/BSJobs.h"
 
 ID3D11Texture2D *g_OcclusionTexture;
 ID3D11ShaderResourceView *g_OcclusionTextureSRV;
@@ -26,8 +32,6 @@ decltype(&IDXGISwapChain::Present) ptrPresent;
 decltype(&CreateDXGIFactory) ptrCreateDXGIFactory;
 decltype(&D3D11CreateDeviceAndSwapChain) ptrD3D11CreateDeviceAndSwapChain;
 
-void DC_Init(ID3D11Device2 *Device, int DeferredContextCount);
-
 LARGE_INTEGER g_FrameStart;
 LARGE_INTEGER g_FrameEnd;
 LARGE_INTEGER g_FrameDelta;
@@ -51,20 +55,40 @@ HRESULT WINAPI hk_IDXGISwapChain_Present(IDXGISwapChain *This, UINT SyncInterval
 
 		g_FrameDelta.QuadPart = g_FrameEnd.QuadPart - g_FrameStart.QuadPart;
 		g_GPUTimers.EndFrame(g_DeviceContext);
+		g_GPUScopes.EndFrame();
 	}
 
+	Timebase::Recalibrate();
+	BSJobs::EndFrame();
+	ProfileTreeFrameEnd();
 	ui::EndFrame();
+
+	// ImGui draws with the unproxied context
+	static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_StateCache.Invalidate();
+	D3D11StateCache::SetEnabled(ui::opt::FilterRedundantBinds);
+	D3D11Capture::OnPresent();
+	BSBatchRenderer::EndPassKeyCaptureFrame();
+
+	BSGraphics::Renderer::QInstance()->UpdateTransientTargets();
+	D3D11Transient::OnPresent(ui::opt::TrackTargetLifetimes);
+	D3D11ShadowCache::OnPresent(ui::opt::CacheStaticShadows);
+
+	D3D11Pacing::BeforePresent(ui::opt::TargetFrameRate, (uint32_t)ui::opt::MaxFramesInFlight);
+
 	HRESULT hr;
 	{
 		ZoneScopedNC("Present", tracy::Color::Red);
 		hr = (This->*ptrPresent)(SyncInterval, Flags);
 	}
 
+	D3D11Pacing::AfterPresent();
+
 	//TracyDx11Collect(g_DeviceContext);
 	FrameMark;
 
 	ui::BeginFrame();
 	g_GPUTimers.BeginFrame(g_DeviceContext);
+	g_GPUScopes.BeginFrame(ui::showGpuCallTreeWindow);
 
 	g_GPUTimers.StartTimer(g_DeviceContext, 0);
 	QueryPerformanceCounter(&g_FrameStart);
@@ -263,8 +287,10 @@ HRESULT WINAPI hk_D3D11CreateDeviceAndSwapChain(
 	*(uintptr_t *)&FinishAccumulating_Standard_PreResolveDepth = Detours::X64::DetourFunctionClass(g_ModuleBase + 0x12E1960, &BSShaderAccumulator::FinishAccumulating_Standard_PreResolveDepth);
 
 	g_GPUTimers.Create(g_Device, 1);
+	g_GPUScopeQueries.Create(g_Device, static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context);
+	D3D11Pacing::Initialize(g_Device);
 	//TracyDx11Context(g_Device, g_DeviceContext);
-	//DC_Init(g_Device, 0);
+	DC_Init(g_Device, DC_MAX_CONTEXTS);
 
 	// Culling test buffers
 	CD3D11_TEXTURE2D_DESC cpuRenderTargetDescAVX
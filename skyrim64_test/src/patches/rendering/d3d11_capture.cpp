@@ -0,0 +1,304 @@
+#include <mutex>
+#include "../../common.h"
+#include "d3d11_proxy.h"
+#include "d3d11_capture.h"
+
+extern ID3D11DeviceContext2 *g_DeviceContext;
+
+namespace D3D11Capture
+{
+	std::atomic_bool CaptureActive;
+
+	std::mutex CaptureLock;
+	std::vector<uint8_t> CaptureData;
+	std::unordered_map<const void *, uint32_t> ObjectIds;
+	std::unordered_map<std::wstring, uint32_t> StringIds;
+
+	uint32_t FramesRequested;
+	uint32_t FramesRemaining;
+	uint32_t FrameIndex;
+	uint32_t RecordCount;
+	char LastFile[MAX_PATH];
+
+	void AppendRecord(Call Type, uint32_t Context, const uint32_t *Args, uint32_t ArgCount, const uint32_t *Elements, uint32_t ElementCount);
+
+	void RequestFrames(uint32_t FrameCount)
+	{
+		std::lock_guard<std::mutex> lock(CaptureLock);
+
+		if (!CaptureActive)
+			FramesRequested = FrameCount;
+	}
+
+	void Flush()
+	{
+		FileHeader header;
+		header.Magic = FileMagic;
+		header.Version = FileVersion;
+		header.FrameCount = FrameIndex;
+		header.RecordCount = RecordCount;
+
+		sprintf_s(LastFile, "D3D11Capture_%llu.bin", GetTickCount64());
+
+		if (FILE *file; fopen_s(&file, LastFile, "wb") == 0)
+		{
+			fwrite(&header, sizeof(header), 1, file);
+			fwrite(CaptureData.data(), 1, CaptureData.size(), file);
+			fclose(file);
+
+			ui::log::Add("D3D11 capture written to %s (%u frames, %u records)\n", LastFile, FrameIndex, RecordCount);
+		}
+		else
+		{
+			ui::log::Add("Unable to open %s for writing\n", LastFile);
+		}
+	}
+
+	void OnPresent()
+	{
+		if (CaptureActive)
+		{
+			if (--FramesRemaining > 0)
+			{
+				FrameIndex++;
+				Record(CALL_FRAME, nullptr, FrameIndex);
+				return;
+			}
+
+			// Late writers still inside WriteRecord() finish before the buffer is written out
+			CaptureActive = false;
+
+			std::lock_guard<std::mutex> lock(CaptureLock);
+			FrameIndex++;
+			Flush();
+
+			CaptureData.clear();
+			CaptureData.shrink_to_fit();
+			ObjectIds.clear();
+			StringIds.clear();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(CaptureLock);
+
+		if (FramesRequested == 0)
+			return;
+
+		FramesRemaining = FramesRequested;
+		FramesRequested = 0;
+		FrameIndex = 0;
+		RecordCount = 0;
+
+		CaptureData.clear();
+		CaptureData.reserve(64 * 1024 * 1024);
+		ObjectIds.clear();
+		StringIds.clear();
+
+		// Id 0 is reserved for nullptr
+		ObjectIds.emplace(nullptr, 0);
+		AppendRecord(CALL_FRAME, 0, &FrameIndex, 1, nullptr, 0);
+		CaptureActive = true;
+	}
+
+	Status GetStatus()
+	{
+		std::lock_guard<std::mutex> lock(CaptureLock);
+
+		Status status;
+		status.Active = CaptureActive;
+		status.FramesRemaining = CaptureActive ? FramesRemaining : FramesRequested;
+		status.RecordCount = RecordCount;
+		status.ByteCount = CaptureData.size();
+		strcpy_s(status.LastFile, LastFile);
+
+		return status;
+	}
+
+	uint32_t Id(const void *Object)
+	{
+		if (!Object)
+			return 0;
+
+		std::lock_guard<std::mutex> lock(CaptureLock);
+
+		// Pointers that get freed and reused by a new object end up sharing an id
+		auto [itr, inserted] = ObjectIds.try_emplace(Object, (uint32_t)ObjectIds.size());
+		return itr->second;
+	}
+
+	void AppendRecord(Call Type, uint32_t Context, const uint32_t *Args, uint32_t ArgCount, const uint32_t *Elements, uint32_t ElementCount)
+	{
+		RecordHeader header;
+		header.Call = Type;
+		header.ArgCount = (uint16_t)(ArgCount + ElementCount);
+		header.Context = Context;
+
+		AssertMsg(ArgCount + ElementCount <= UINT16_MAX, "Too many arguments for a single capture record");
+
+		size_t offset = CaptureData.size();
+		CaptureData.resize(offset + sizeof(header) + (ArgCount + ElementCount) * sizeof(uint32_t));
+
+		uint8_t *data = &CaptureData[offset];
+		memcpy(data, &header, sizeof(header));
+		memcpy(data + sizeof(header), Args, ArgCount * sizeof(uint32_t));
+		memcpy(data + sizeof(header) + ArgCount * sizeof(uint32_t), Elements, ElementCount * sizeof(uint32_t));
+
+		RecordCount++;
+	}
+
+	void WriteRecord(Call Type, const void *Context, const uint32_t *Args, uint32_t ArgCount)
+	{
+		uint32_t context = Id(Context);
+
+		std::lock_guard<std::mutex> lock(CaptureLock);
+		AppendRecord(Type, context, Args, ArgCount, nullptr, 0);
+	}
+
+	void WriteArrayRecord(Call Type, const void *Context, const uint32_t *Args, uint32_t ArgCount, const uint32_t *Elements, uint32_t ElementCount)
+	{
+		uint32_t context = Id(Context);
+		uint32_t args[16];
+
+		// Element count goes between the fixed arguments and the elements
+		Assert(ArgCount < ARRAYSIZE(args));
+		memcpy(args, Args, ArgCount * sizeof(uint32_t));
+		args[ArgCount] = ElementCount;
+
+		std::lock_guard<std::mutex> lock(CaptureLock);
+		AppendRecord(Type, context, args, ArgCount + 1, Elements, ElementCount);
+	}
+
+	void RecordEvent(const void *Context, const wchar_t *Label)
+	{
+		uint32_t context = Id(Context);
+
+		std::lock_guard<std::mutex> lock(CaptureLock);
+		auto [itr, inserted] = StringIds.try_emplace(Label ? Label : L"", (uint32_t)StringIds.size());
+
+		if (inserted)
+		{
+			// Labels are plain ASCII, so the upper byte is simply dropped
+			std::vector<uint32_t> args;
+			const std::wstring& name = itr->first;
+
+			args.push_back(itr->second);
+			args.push_back((uint32_t)name.length());
+			args.resize(2 + (name.length() + 3) / 4);
+
+			for (size_t i = 0; i < name.length(); i++)
+				args[2 + i / 4] |= (uint32_t)(name[i] & 0xFF) << ((i % 4) * 8);
+
+			AppendRecord(CALL_STRING, 0, args.data(), (uint32_t)args.size(), nullptr, 0);
+		}
+
+		AppendRecord(CALL_BEGIN_EVENT, context, &itr->second, 1, nullptr, 0);
+	}
+
+	void RecordUpload(const void *Buffer, uint32_t Bytes)
+	{
+		if (!IsActive())
+			return;
+
+		// Attribute the upload to whichever context this thread is rendering with
+		const void *context = D3D11DeviceContextProxy::ThreadContextOverride;
+
+		if (!context)
+			context = static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context;
+
+		Record(CALL_UPLOAD, context, Buffer, Bytes);
+	}
+
+	void RecordConstantBuffers(const void *Context, Stage Type, UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *Buffers, const UINT *FirstConstant, const UINT *NumConstants)
+	{
+		uint32_t elements[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT * 3];
+		const uint32_t args[] = { Type, StartSlot };
+
+		NumBuffers = std::min<UINT>(NumBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+
+		// Plain *SetConstantBuffers() binds the whole buffer: stored as 0/0
+		for (UINT i = 0; i < NumBuffers; i++)
+		{
+			elements[i * 3 + 0] = Id(Buffers ? Buffers[i] : nullptr);
+			elements[i * 3 + 1] = FirstConstant ? FirstConstant[i] : 0;
+			elements[i * 3 + 2] = NumConstants ? NumConstants[i] : 0;
+		}
+
+		WriteArrayRecord(CALL_SET_CONSTANT_BUFFERS, Context, args, ARRAYSIZE(args), elements, NumBuffers * 3);
+	}
+
+	void RecordVertexBuffers(const void *Context, UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *Buffers, const UINT *Strides, const UINT *Offsets)
+	{
+		uint32_t elements[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT * 3];
+		const uint32_t args[] = { StartSlot };
+
+		NumBuffers = std::min<UINT>(NumBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+		for (UINT i = 0; i < NumBuffers; i++)
+		{
+			elements[i * 3 + 0] = Id(Buffers ? Buffers[i] : nullptr);
+			elements[i * 3 + 1] = Strides ? Strides[i] : 0;
+			elements[i * 3 + 2] = Offsets ? Offsets[i] : 0;
+		}
+
+		WriteArrayRecord(CALL_SET_VERTEX_BUFFERS, Context, args, ARRAYSIZE(args), elements, NumBuffers * 3);
+	}
+
+	void RecordViewports(const void *Context, UINT NumViewports, const D3D11_VIEWPORT *Viewports)
+	{
+		uint32_t elements[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE * 6];
+
+		NumViewports = std::min<UINT>(NumViewports, D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
+		static_assert(sizeof(D3D11_VIEWPORT) == 6 * sizeof(uint32_t));
+
+		if (Viewports)
+			memcpy(elements, Viewports, NumViewports * sizeof(D3D11_VIEWPORT));
+
+		WriteArrayRecord(CALL_SET_VIEWPORTS, Context, nullptr, 0, elements, Viewports ? NumViewports * 6 : 0);
+	}
+
+	void RecordScissorRects(const void *Context, UINT NumRects, const D3D11_RECT *Rects)
+	{
+		uint32_t elements[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE * 4];
+
+		NumRects = std::min<UINT>(NumRects, D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
+		static_assert(sizeof(D3D11_RECT) == 4 * sizeof(uint32_t));
+
+		if (Rects)
+			memcpy(elements, Rects, NumRects * sizeof(D3D11_RECT));
+
+		WriteArrayRecord(CALL_SET_SCISSOR_RECTS, Context, nullptr, 0, elements, Rects ? NumRects * 4 : 0);
+	}
+
+	uint32_t GetBufferSize(ID3D11Resource *Resource)
+	{
+		D3D11_RESOURCE_DIMENSION dimension;
+		Resource->GetType(&dimension);
+
+		if (dimension != D3D11_RESOURCE_DIMENSION_BUFFER)
+			return 0;
+
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer *>(Resource)->GetDesc(&desc);
+
+		return desc.ByteWidth;
+	}
+
+	void RecordMap(const void *Context, ID3D11Resource *Resource, UINT Subresource, D3D11_MAP MapType)
+	{
+		Record(CALL_MAP, Context, Resource, Subresource, MapType, GetBufferSize(Resource));
+	}
+
+	void RecordUpdateSubresource(const void *Context, ID3D11Resource *Resource, UINT Subresource, const D3D11_BOX *Box, UINT RowPitch, UINT DepthPitch)
+	{
+		uint32_t bytes = 0;
+
+		if (uint32_t bufferSize = GetBufferSize(Resource); bufferSize > 0)
+			bytes = Box ? (Box->right - Box->left) : bufferSize;
+		else if (Box)
+			bytes = (Box->back - Box->front > 1) ? (Box->back - Box->front) * DepthPitch : (Box->bottom - Box->top) * RowPitch;
+		else
+			bytes = std::max(DepthPitch, RowPitch);	// Only a lower bound without the texture description
+
+		Record(CALL_UPDATE_SUBRESOURCE, Context, Resource, Subresource, bytes);
+	}
+}
\ No newline at end of file
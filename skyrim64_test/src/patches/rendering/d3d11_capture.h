@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <d3d11_2.h>
+#include "d3d11_capture_format.h"
+
+//
+// Command stream capture. While active, D3D11DeviceContextProxy serializes every call (as issued by the game, before
+// redundant binds are dropped) into memory. The file is written once the requested number of frames has been presented.
+// See d3d11_capture_format.h for the layout and /tests/capture_analyzer for a reader.
+//
+namespace D3D11Capture
+{
+	struct Status
+	{
+		bool Active;
+		uint32_t FramesRemaining;
+		uint32_t RecordCount;
+		uint64_t ByteCount;
+		char LastFile[MAX_PATH];
+	};
+
+	extern std::atomic_bool CaptureActive;
+	inline const float DefaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	inline bool IsActive()
+	{
+		return CaptureActive.load(std::memory_order_relaxed);
+	}
+
+	void RequestFrames(uint32_t FrameCount);
+	void OnPresent();
+	Status GetStatus();
+
+	uint32_t Id(const void *Object);
+	void WriteRecord(Call Type, const void *Context, const uint32_t *Args, uint32_t ArgCount);
+	void WriteArrayRecord(Call Type, const void *Context, const uint32_t *Args, uint32_t ArgCount, const uint32_t *Elements, uint32_t ElementCount);
+
+	void RecordEvent(const void *Context, const wchar_t *Label);
+	void RecordUpload(const void *Buffer, uint32_t Bytes);
+
+	template<typename T>
+	uint32_t ToArg(T Value)
+	{
+		if constexpr (std::is_pointer_v<T>)
+			return Id(Value);
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			float f = (float)Value;
+			return *(uint32_t *)&f;
+		}
+		else
+			return (uint32_t)Value;
+	}
+
+	template<typename... TArgs>
+	void Record(Call Type, const void *Context, TArgs... Args)
+	{
+		const uint32_t args[] = { 0, ToArg(Args)... };
+		WriteRecord(Type, Context, &args[1], sizeof...(Args));
+	}
+
+	// Objects is an array of Count D3D objects, written as ids after the fixed arguments
+	template<typename T, typename... TArgs>
+	void RecordObjects(Call Type, const void *Context, T *const *Objects, uint32_t Count, TArgs... Args)
+	{
+		const uint32_t args[] = { 0, ToArg(Args)... };
+		uint32_t ids[128];
+
+		Count = std::min<uint32_t>(Count, ARRAYSIZE(ids));
+
+		for (uint32_t i = 0; i < Count; i++)
+			ids[i] = Objects ? Id(Objects[i]) : 0;
+
+		WriteArrayRecord(Type, Context, &args[1], sizeof...(Args), ids, Count);
+	}
+
+	void RecordConstantBuffers(const void *Context, Stage Type, UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *Buffers, const UINT *FirstConstant, const UINT *NumConstants);
+	void RecordVertexBuffers(const void *Context, UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *Buffers, const UINT *Strides, const UINT *Offsets);
+	void RecordViewports(const void *Context, UINT NumViewports, const D3D11_VIEWPORT *Viewports);
+	void RecordScissorRects(const void *Context, UINT NumRects, const D3D11_RECT *Rects);
+	void RecordMap(const void *Context, ID3D11Resource *Resource, UINT Subresource, D3D11_MAP MapType);
+	void RecordUpdateSubresource(const void *Context, ID3D11Resource *Resource, UINT Subresource, const D3D11_BOX *Box, UINT RowPitch, UINT DepthPitch);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Binary layout of D3D11 command stream captures. Shared between the writer (d3d11_capture.cpp) and the standalone
+// analyzer in /tests/capture_analyzer, so this must not depend on Windows headers.
+//
+// File:   FileHeader, then RecordHeader + ArgCount uint32 arguments, repeated until the end of the file.
+// Args:   D3D objects are replaced by ids (0 = nullptr, assigned in order of first use). Floats are stored as raw bits.
+// Arrays: Fixed arguments first, then the element count, then the elements.
+//
+namespace D3D11Capture
+{
+	constexpr uint32_t FileMagic = 0x43443344;		// "D3DC"
+	constexpr uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t FrameCount;
+		uint32_t RecordCount;
+	};
+
+	struct RecordHeader
+	{
+		uint16_t Call;
+		uint16_t ArgCount;
+		uint32_t Context;						// Object id of the device context the call was made on
+	};
+
+	enum Call : uint16_t
+	{
+		CALL_FRAME,								// [Frame index] Present() marker, starts a new frame
+		CALL_STRING,							// [String id, Length, Chars packed 4 per argument...]
+		CALL_BEGIN_EVENT,						// [String id]
+		CALL_END_EVENT,							// []
+		CALL_UPLOAD,							// [Buffer, Bytes] Data written into a persistently mapped ring buffer
+		CALL_DRAW,								// [Vertex count, Start vertex]
+		CALL_DRAW_INDEXED,						// [Index count, Start index, Base vertex]
+		CALL_DRAW_INSTANCED,					// [Vertex count per instance, Instance count, Start vertex, Start instance]
+		CALL_DRAW_INDEXED_INSTANCED,			// [Index count per instance, Instance count, Start index, Base vertex, Start instance]
+		CALL_DRAW_INDIRECT,						// [Argument buffer, Offset]
+		CALL_DISPATCH,							// [X, Y, Z]
+		CALL_DISPATCH_INDIRECT,					// [Argument buffer, Offset]
+		CALL_SET_SHADER,						// [Stage, Shader]
+		CALL_SET_SHADER_RESOURCES,				// [Stage, Start slot, Count, Views...]
+		CALL_SET_SAMPLERS,						// [Stage, Start slot, Count, Samplers...]
+		CALL_SET_CONSTANT_BUFFERS,				// [Stage, Start slot, Count, (Buffer, First constant, Constant count)...]
+		CALL_SET_UNORDERED_ACCESS_VIEWS,		// [Stage, Start slot, Count, Views...] Pixel shader UAVs come from OMSetRenderTargetsAndUnorderedAccessViews()
+		CALL_SET_INPUT_LAYOUT,					// [Layout]
+		CALL_SET_VERTEX_BUFFERS,				// [Start slot, Count, (Buffer, Stride, Offset)...]
+		CALL_SET_INDEX_BUFFER,					// [Buffer, Format, Offset]
+		CALL_SET_PRIMITIVE_TOPOLOGY,			// [Topology]
+		CALL_SET_RENDER_TARGETS,				// [Depth stencil view, Count, Render target views...]
+		CALL_SET_BLEND_STATE,					// [State, Factor R, G, B, A, Sample mask]
+		CALL_SET_DEPTH_STENCIL_STATE,			// [State, Stencil ref]
+		CALL_SET_RASTERIZER_STATE,				// [State]
+		CALL_SET_VIEWPORTS,						// [Count, (X, Y, Width, Height, Min depth, Max depth)...]
+		CALL_SET_SCISSOR_RECTS,					// [Count, (Left, Top, Right, Bottom)...]
+		CALL_MAP,								// [Resource, Subresource, Map type, Bytes] Bytes is 0 for non-buffers
+		CALL_UNMAP,								// [Resource, Subresource]
+		CALL_UPDATE_SUBRESOURCE,				// [Resource, Subresource, Bytes]
+		CALL_COPY_RESOURCE,						// [Destination, Source]
+		CALL_COPY_SUBRESOURCE_REGION,			// [Destination, Destination subresource, Source, Source subresource]
+		CALL_CLEAR_RENDER_TARGET_VIEW,			// [View]
+		CALL_CLEAR_DEPTH_STENCIL_VIEW,			// [View, Clear flags]
+		CALL_CLEAR_UNORDERED_ACCESS_VIEW,		// [View]
+		CALL_CLEAR_STATE,						// []
+		CALL_EXECUTE_COMMAND_LIST,				// [Command list]
+		CALL_FINISH_COMMAND_LIST,				// [Command list]
+		CALL_COUNT,
+	};
+
+	enum Stage : uint32_t
+	{
+		STAGE_VS,
+		STAGE_HS,
+		STAGE_DS,
+		STAGE_GS,
+		STAGE_PS,
+		STAGE_CS,
+		STAGE_COUNT,
+	};
+
+	// D3D11_MAP_WRITE_DISCARD
+	constexpr uint32_t MapWriteDiscard = 4;
+}
\ No newline at end of file
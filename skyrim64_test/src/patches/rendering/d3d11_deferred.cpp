@@ -0,0 +1,291 @@
+#include <mutex>
+#include "common.h"
+#include "d3d11_proxy.h"
+#include "d3d11_deferred.h"
+#include "d3d11_capture.h"
+#include "../jobscheduler.h"
+#include "../TES/BSGraphics/BSGraphicsRenderer.h"
+
+extern ID3D11DeviceContext2 *g_DeviceContext;
+
+// The renderer shadow state is one of the patched globals: 0x304DEB0 in the exe
+constexpr uintptr_t ShadowStateOffset = 0x304DEB0 - BSGRAPHICS_BASE_OFFSET;
+constexpr uint32_t ConstantBufferSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+
+struct DeferredContext
+{
+	ID3D11DeviceContext2 *Context;
+	uintptr_t StateBlock;					// Private copy of the TLS renderer globals
+	ID3D11CommandList *CommandList;
+};
+
+struct RecordJob
+{
+	const DC_RecordTask *Task;
+	DeferredContext *Context;
+	uint32_t ThreadId;
+	uint64_t RecordTicks;
+};
+
+// Constant buffers bound once per frame (or per pass) aren't part of the shadow state, so they're copied
+// from the immediate context into every deferred context before recording starts
+struct InheritedBindings
+{
+	ID3D11Buffer *VSBuffers[ConstantBufferSlots];
+	UINT VSFirst[ConstantBufferSlots];
+	UINT VSCount[ConstantBufferSlots];
+	ID3D11Buffer *PSBuffers[ConstantBufferSlots];
+	UINT PSFirst[ConstantBufferSlots];
+	UINT PSCount[ConstantBufferSlots];
+	ID3D11Buffer *DSBuffers[ConstantBufferSlots];
+	UINT DSFirst[ConstantBufferSlots];
+	UINT DSCount[ConstantBufferSlots];
+};
+
+DeferredContext g_DeferredContexts[DC_MAX_CONTEXTS];
+uint32_t g_DeferredContextCount;
+ID3D11Device2 *g_DeferredDevice;
+int g_RequestedContextCount;
+std::once_flag g_CreateContextsOnce;
+std::unique_ptr<JobScheduler::Scheduler> g_RecordScheduler;
+InheritedBindings g_InheritedBindings;
+
+std::mutex g_UploadLock;
+DC_Stats g_LastStats;
+std::mutex g_StatsLock;
+
+thread_local BSGraphics::RendererShadowState *ThreadShadowState;
+
+void MarkAllStateDirty(BSGraphics::RendererShadowState *State)
+{
+	State->m_StateUpdateFlags = 0xFFFFFFFF;
+	State->m_PSResourceModifiedBits = 0xFFFF;
+	State->m_PSSamplerModifiedBits = 0xFFFF;
+	State->m_CSResourceModifiedBits = 0xFFFF;
+	State->m_CSSamplerModifiedBits = 0xFFFF;
+	State->m_CSUAVModifiedBits = 0xFF;
+}
+
+void RecordJobCallback(void *Parameter)
+{
+	auto job = (RecordJob *)Parameter;
+	auto context = job->Context;
+
+	ZoneScopedN("DC_RecordTask");
+	uint64_t start = Timebase::ReadTicks();
+
+	// Redirect both the patched engine globals and every D3D call from this thread
+	uintptr_t previousBlock = TLS_SwapThreadBlock(context->StateBlock);
+	D3D11DeviceContextProxy::ThreadContextOverride = context->Context;
+	D3D11DeviceContextProxy::ThreadStateCache.Invalidate();
+	ThreadShadowState = (BSGraphics::RendererShadowState *)(context->StateBlock + ShadowStateOffset);
+
+	const InheritedBindings& b = g_InheritedBindings;
+	context->Context->VSSetConstantBuffers1(0, ConstantBufferSlots, b.VSBuffers, b.VSFirst, b.VSCount);
+	context->Context->PSSetConstantBuffers1(0, ConstantBufferSlots, b.PSBuffers, b.PSFirst, b.PSCount);
+	context->Context->DSSetConstantBuffers1(0, ConstantBufferSlots, b.DSBuffers, b.DSFirst, b.DSCount);
+
+	if (D3D11Capture::IsActive())
+	{
+		D3D11Capture::RecordConstantBuffers(context->Context, D3D11Capture::STAGE_VS, 0, ConstantBufferSlots, b.VSBuffers, b.VSFirst, b.VSCount);
+		D3D11Capture::RecordConstantBuffers(context->Context, D3D11Capture::STAGE_PS, 0, ConstantBufferSlots, b.PSBuffers, b.PSFirst, b.PSCount);
+		D3D11Capture::RecordConstantBuffers(context->Context, D3D11Capture::STAGE_DS, 0, ConstantBufferSlots, b.DSBuffers, b.DSFirst, b.DSCount);
+	}
+
+	job->Task->Callback();
+
+	Assert(SUCCEEDED(context->Context->FinishCommandList(FALSE, &context->CommandList)));
+
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_FINISH_COMMAND_LIST, context->Context, context->CommandList);
+
+	ThreadShadowState = nullptr;
+	D3D11DeviceContextProxy::ThreadContextOverride = nullptr;
+	TLS_SwapThreadBlock(previousBlock);
+
+	job->ThreadId = GetCurrentThreadId();
+	job->RecordTicks = Timebase::ReadTicks() - start;
+}
+
+void DC_Init(ID3D11Device2 *Device, int DeferredContextCount)
+{
+	Assert(DeferredContextCount >= 0 && DeferredContextCount <= DC_MAX_CONTEXTS);
+
+	// Contexts, state blocks and worker threads are only created once parallel recording is first asked for
+	g_DeferredDevice = Device;
+	g_RequestedContextCount = DeferredContextCount;
+}
+
+void CreateDeferredContexts(ID3D11Device2 *Device, int DeferredContextCount)
+{
+	for (int i = 0; i < DeferredContextCount; i++)
+	{
+		DeferredContext& context = g_DeferredContexts[i];
+
+		Assert(SUCCEEDED(Device->CreateDeferredContext2(0, &context.Context)));
+		context.StateBlock = AllocateGuardedBlock();
+		context.CommandList = nullptr;
+	}
+
+	g_DeferredContextCount = DeferredContextCount;
+
+	if (DeferredContextCount > 0)
+	{
+		// The thread calling DC_RecordAndExecute() participates as well
+		uint32_t threadCount = std::min<uint32_t>(DeferredContextCount, std::max(std::thread::hardware_concurrency(), 1u));
+		g_RecordScheduler = std::make_unique<JobScheduler::Scheduler>(threadCount);
+	}
+}
+
+bool DC_Available(uint32_t TaskCount)
+{
+	if (DC_IsRecordingThread() || !g_DeferredDevice)
+		return false;
+
+	std::call_once(g_CreateContextsOnce, CreateDeferredContexts, g_DeferredDevice, g_RequestedContextCount);
+	return g_RecordScheduler && TaskCount <= g_DeferredContextCount;
+}
+
+void DC_RecordAndExecute(const DC_RecordTask *Tasks, uint32_t TaskCount)
+{
+	AssertMsg(DC_Available(TaskCount), "Not enough deferred contexts or called from a recording thread");
+
+	if (TaskCount <= 0)
+		return;
+
+	ZoneScopedN("DC_RecordAndExecute");
+	uint64_t start = Timebase::ReadTicks();
+
+	auto renderer = BSGraphics::Renderer::QInstance();
+	auto mainState = renderer->GetRendererShadowState();
+
+	// Anything still pending (render target clears in particular) must land on the immediate context once,
+	// not once per command list
+	BSGraphics::Renderer::SetDirtyStates(false);
+
+	// Dynamic geometry written while recording is only read once the command lists are executed
+	renderer->BeginDeferredDynamicUploads();
+
+	InheritedBindings& b = g_InheritedBindings;
+	g_DeviceContext->VSGetConstantBuffers1(0, ConstantBufferSlots, b.VSBuffers, b.VSFirst, b.VSCount);
+	g_DeviceContext->PSGetConstantBuffers1(0, ConstantBufferSlots, b.PSBuffers, b.PSFirst, b.PSCount);
+	g_DeviceContext->DSGetConstantBuffers1(0, ConstantBufferSlots, b.DSBuffers, b.DSFirst, b.DSCount);
+
+	JobScheduler::JobGraph graph;
+	RecordJob jobs[DC_MAX_CONTEXTS];
+
+	for (uint32_t i = 0; i < TaskCount; i++)
+	{
+		DeferredContext& context = g_DeferredContexts[i];
+
+		// Every task starts from the state the serial code would have at this point. Deferred contexts
+		// start out with nothing bound, so everything is marked dirty.
+		memcpy((void *)context.StateBlock, HACK_GetMainGlobals(), BSGRAPHICS_TLS_BLOCK_SIZE);
+		memcpy((void *)(context.StateBlock + ShadowStateOffset), mainState, sizeof(BSGraphics::RendererShadowState));
+		MarkAllStateDirty((BSGraphics::RendererShadowState *)(context.StateBlock + ShadowStateOffset));
+
+		jobs[i].Task = &Tasks[i];
+		jobs[i].Context = &context;
+		jobs[i].ThreadId = 0;
+		jobs[i].RecordTicks = 0;
+
+		graph.AddJob(RecordJobCallback, &jobs[i]);
+
+		if (Tasks[i].DependsOn != DC_NO_DEPENDENCY)
+		{
+			AssertMsg(Tasks[i].DependsOn < i, "Tasks can only depend on earlier tasks");
+			graph.AddDependency(Tasks[i].DependsOn, i);
+		}
+	}
+
+	g_RecordScheduler->Run(graph);
+
+	for (uint32_t i = 0; i < TaskCount; i++)
+	{
+		DeferredContext& context = g_DeferredContexts[i];
+
+		g_DeviceContext->ExecuteCommandList(context.CommandList, FALSE);
+		context.CommandList->Release();
+		context.CommandList = nullptr;
+	}
+
+	for (uint32_t i = 0; i < ConstantBufferSlots; i++)
+	{
+		if (b.VSBuffers[i])
+			b.VSBuffers[i]->Release();
+
+		if (b.PSBuffers[i])
+			b.PSBuffers[i]->Release();
+
+		if (b.DSBuffers[i])
+			b.DSBuffers[i]->Release();
+	}
+
+	// Continue from where the last task left off. ExecuteCommandList() resets the immediate context, so
+	// everything has to be bound again.
+	uintptr_t lastBlock = g_DeferredContexts[TaskCount - 1].StateBlock;
+
+	memcpy(HACK_GetMainGlobals(), (void *)lastBlock, BSGRAPHICS_TLS_BLOCK_SIZE);
+	memcpy(mainState, (void *)(lastBlock + ShadowStateOffset), sizeof(BSGraphics::RendererShadowState));
+	MarkAllStateDirty(mainState);
+
+	// Fences the dynamic geometry buffers and restores the references the copy above overwrote
+	renderer->EndDeferredDynamicUploads();
+
+	g_DeviceContext->VSSetConstantBuffers1(0, ConstantBufferSlots, b.VSBuffers, b.VSFirst, b.VSCount);
+	g_DeviceContext->PSSetConstantBuffers1(0, ConstantBufferSlots, b.PSBuffers, b.PSFirst, b.PSCount);
+	g_DeviceContext->DSSetConstantBuffers1(0, ConstantBufferSlots, b.DSBuffers, b.DSFirst, b.DSCount);
+
+	// Stats for the UI
+	DC_Stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	stats.TaskCount = TaskCount;
+	stats.ParallelTime = Timebase::TicksToMilliseconds(Timebase::ReadTicks() - start);
+
+	for (uint32_t i = 0; i < TaskCount; i++)
+	{
+		stats.TaskNames[i] = Tasks[i].Name;
+		stats.TaskThreadIds[i] = jobs[i].ThreadId;
+		stats.TaskRecordTime[i] = Timebase::TicksToMilliseconds(jobs[i].RecordTicks);
+		stats.SerialTime += stats.TaskRecordTime[i];
+	}
+
+	stats.SavedTime = stats.SerialTime - stats.ParallelTime;
+
+	g_StatsLock.lock();
+	g_LastStats = stats;
+	g_StatsLock.unlock();
+}
+
+DC_Stats DC_GetStats()
+{
+	std::lock_guard<std::mutex> lock(g_StatsLock);
+	return g_LastStats;
+}
+
+bool DC_IsRecordingThread()
+{
+	return D3D11DeviceContextProxy::ThreadContextOverride != nullptr;
+}
+
+BSGraphics::RendererShadowState *DC_GetThreadShadowState()
+{
+	return ThreadShadowState;
+}
+
+ID3D11DeviceContext2 *DC_LockUploadContext(ID3D11DeviceContext2 *Default)
+{
+	if (!DC_IsRecordingThread())
+		return Default;
+
+	// Nothing else touches the immediate context while command lists are being recorded
+	g_UploadLock.lock();
+	return static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context;
+}
+
+void DC_UnlockUploadContext()
+{
+	if (DC_IsRecordingThread())
+		g_UploadLock.unlock();
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <d3d11_2.h>
+
+namespace BSGraphics
+{
+	class RendererShadowState;
+}
+
+//
+// Parallel command recording. Each deferred context owns a private copy of the TLS renderer globals, so
+// several threads can run the regular (patched) render code at once. The command lists are executed on
+// the immediate context in task order, which keeps the GPU-side result identical to serial rendering.
+//
+#define DC_MAX_CONTEXTS		8
+#define DC_NO_DEPENDENCY	0xFFFFFFFF
+
+struct DC_RecordTask
+{
+	const char *Name;
+	std::function<void()> Callback;
+	uint32_t DependsOn;						// Task that must finish recording first (e.g. shares a batch renderer)
+};
+
+struct DC_Stats
+{
+	uint32_t TaskCount;
+	const char *TaskNames[DC_MAX_CONTEXTS];
+	uint32_t TaskThreadIds[DC_MAX_CONTEXTS];
+	double TaskRecordTime[DC_MAX_CONTEXTS];	// Milliseconds
+	double SerialTime;						// Sum of all record times, i.e. the cost on a single thread
+	double ParallelTime;					// Dispatch until the last command list was submitted
+	double SavedTime;						// SerialTime - ParallelTime
+};
+
+// Nothing is created until the first DC_Available() call, which only happens once ParallelCommandRecording is enabled
+void DC_Init(ID3D11Device2 *Device, int DeferredContextCount);
+bool DC_Available(uint32_t TaskCount);
+void DC_RecordAndExecute(const DC_RecordTask *Tasks, uint32_t TaskCount);
+DC_Stats DC_GetStats();
+
+bool DC_IsRecordingThread();
+BSGraphics::RendererShadowState *DC_GetThreadShadowState();
+
+// Dynamic buffer maps must go through the immediate context. Recording threads are serialized here,
+// everything else gets Default back untouched.
+ID3D11DeviceContext2 *DC_LockUploadContext(ID3D11DeviceContext2 *Default);
+void DC_UnlockUploadContext();
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "../../common.h"
+#include "../../timebase.h"
+#include "d3d11_proxy.h"
+#include "d3d11_pacing.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+extern ID3D11DeviceContext2 *g_DeviceContext;
+
+namespace D3D11Pacing
+{
+	// Sleep granularity while RetireOldestFrame() waits for the GPU
+	constexpr double RetireWaitStepMs = 0.5;
+
+	struct FrameQuery
+	{
+		ID3D11Query *Query;
+		double PresentTime;
+	};
+
+	HANDLE WaitTimer;
+	FrameQuery Queries[MaxQueries];
+	uint32_t QueryHead;
+	uint32_t QueriesInFlight;
+	float CurrentFrameRate;
+	double LastRelease;
+
+	double GetTimeMs()
+	{
+		return Timebase::ReadMonotonicNanoseconds() / 1000000.0;
+	}
+
+	void SleepMs(double Milliseconds)
+	{
+		// Relative due times are negative, in 100ns units
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(Milliseconds * 10000.0);
+
+		if (dueTime.QuadPart >= 0)
+			return;
+
+		if (WaitTimer && SetWaitableTimer(WaitTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+			WaitForSingleObject(WaitTimer, INFINITE);
+		else
+			Sleep((DWORD)Milliseconds);
+	}
+
+	FramePacer& GetPacer()
+	{
+		static FramePacer pacer(GetTimeMs, SleepMs);
+		return pacer;
+	}
+
+	void Initialize(ID3D11Device *Device)
+	{
+		// High resolution timers exist since Windows 10 1803. Older systems get the regular timer and the pacer's spin
+		// margin grows to cover the scheduler tick.
+		WaitTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+		if (!WaitTimer)
+			WaitTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
+		D3D11_QUERY_DESC queryDesc;
+		memset(&queryDesc, 0, sizeof(D3D11_QUERY_DESC));
+		queryDesc.Query = D3D11_QUERY_EVENT;
+
+		for (FrameQuery& frame : Queries)
+			Assert(SUCCEEDED(Device->CreateQuery(&queryDesc, &frame.Query)));
+	}
+
+	bool RetireOldestFrame(ID3D11DeviceContext *Context, bool Wait)
+	{
+		FrameQuery& frame = Queries[QueryHead];
+		BOOL completed = FALSE;
+
+		if (Wait)
+		{
+			// The first poll flushes so the query is guaranteed to complete. Waiting on the GPU can take several
+			// milliseconds, so sleep in short steps instead of keeping a core busy; the half millisecond of slack only
+			// shows up in the latency sample.
+			if (Context->GetData(frame.Query, &completed, sizeof(completed), 0) != S_OK)
+			{
+				while (Context->GetData(frame.Query, &completed, sizeof(completed), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+					SleepMs(RetireWaitStepMs);
+			}
+		}
+		else if (Context->GetData(frame.Query, &completed, sizeof(completed), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			return false;
+		}
+
+		GetPacer().AddLatencySample(GetTimeMs() - frame.PresentTime);
+
+		QueryHead = (QueryHead + 1) % MaxQueries;
+		QueriesInFlight--;
+		return true;
+	}
+
+	void PollFrames(ID3D11DeviceContext *Context)
+	{
+		while (QueriesInFlight > 0 && RetireOldestFrame(Context, false))
+		{
+		}
+	}
+
+	void BeforePresent(float TargetFrameRate, uint32_t MaxFramesInFlight)
+	{
+		ZoneScopedN("D3D11Pacing::BeforePresent");
+
+		auto context = static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context;
+		FramePacer& pacer = GetPacer();
+
+		PollFrames(context);
+
+		if (MaxFramesInFlight > 0)
+		{
+			while (QueriesInFlight >= std::min(MaxFramesInFlight, MaxQueries))
+				RetireOldestFrame(context, true);
+		}
+
+		if (TargetFrameRate != CurrentFrameRate)
+		{
+			CurrentFrameRate = TargetFrameRate;
+			pacer.SetTargetFrameTime(TargetFrameRate > 0.0f ? 1000.0 / TargetFrameRate : 0.0);
+		}
+
+		LastRelease = pacer.WaitForDeadline();
+	}
+
+	void AfterPresent()
+	{
+		auto context = static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context;
+
+		// Without a limit the ring can fill up; the driver's own queue limit keeps this from ever blocking for long
+		if (QueriesInFlight >= MaxQueries)
+			RetireOldestFrame(context, true);
+
+		FrameQuery& frame = Queries[(QueryHead + QueriesInFlight) % MaxQueries];
+		frame.PresentTime = LastRelease;
+		context->End(frame.Query);
+		QueriesInFlight++;
+
+		PollFrames(context);
+	}
+
+	FramePacer::Stats GetStats()
+	{
+		return GetPacer().GetStats();
+	}
+
+	const FrameTimeHistogram& QFrameTimes()
+	{
+		return GetPacer().QFrameTimes();
+	}
+
+	const FrameTimeHistogram& QLatencies()
+	{
+		return GetPacer().QLatencies();
+	}
+
+	void ResetHistograms()
+	{
+		GetPacer().ResetHistograms();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "FramePacer.h"
+
+//
+// Drives FramePacer from the Present() hook. Waits use a high resolution waitable timer when the OS has one. Every
+// presented frame ends an event query; the oldest query is waited on while too many frames are queued, and completed
+// queries give the Present() to GPU completion latency. Completion is only observed when the queries are polled (around
+// each Present() and while blocked on the limit), so latencies are an upper bound.
+//
+namespace D3D11Pacing
+{
+	const uint32_t MaxQueries = 8;
+
+	void Initialize(ID3D11Device *Device);
+
+	// TargetFrameRate 0 disables pacing, MaxFramesInFlight 0 disables the queue limit. Frame times are measured either way.
+	void BeforePresent(float TargetFrameRate, uint32_t MaxFramesInFlight);
+	void AfterPresent();
+
+	FramePacer::Stats GetStats();
+	const FrameTimeHistogram& QFrameTimes();
+	const FrameTimeHistogram& QLatencies();
+	void ResetHistograms();
+}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "../../common.h"
 #include "../TES/BSGraphics/BSGraphicsRenderer.h"
 #include "d3d11_proxy.h"
+#include "d3d11_capture.h"
+#include "d3d11_transient.h"
+#include "GpuTimer.h"
 
 // ***************************************** //
 //											 //
@@ -410,707 +413,1019 @@ ULONG STDMETHODCALLTYPE D3D11DeviceContextProxy::Release()
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GetDevice(ID3D11Device **ppDevice)
 {
 	AssertMsg(false, "TODO: This call must be proxied");
-	m_Context->GetDevice(ppDevice);
+	QContext()->GetDevice(ppDevice);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::GetPrivateData(REFGUID guid, UINT *pDataSize, void *pData)
 {
-	return m_Context->GetPrivateData(guid, pDataSize, pData);
+	return QContext()->GetPrivateData(guid, pDataSize, pData);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::SetPrivateData(REFGUID guid, UINT DataSize, const void *pData)
 {
-	return m_Context->SetPrivateData(guid, DataSize, pData);
+	return QContext()->SetPrivateData(guid, DataSize, pData);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::SetPrivateDataInterface(REFGUID guid, const IUnknown *pData)
 {
-	return m_Context->SetPrivateDataInterface(guid, pData);
+	return QContext()->SetPrivateDataInterface(guid, pData);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->VSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_VS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->VSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->PSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_PS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_PS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShaderResources(D3D11StateCache::STAGE_PS, StartSlot, NumViews, ppShaderResourceViews))
+		QContext()->PSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSSetShader(ID3D11PixelShader *pPixelShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->PSSetShader(pPixelShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_PS, pPixelShader);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShader(D3D11StateCache::STAGE_PS, pPixelShader, NumClassInstances))
+		QContext()->PSSetShader(pPixelShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->PSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_PS, StartSlot);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetSamplers(D3D11StateCache::STAGE_PS, StartSlot, NumSamplers, ppSamplers))
+		QContext()->PSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSSetShader(ID3D11VertexShader *pVertexShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_VS, pVertexShader);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShader(D3D11StateCache::STAGE_VS, pVertexShader, NumClassInstances))
+		QContext()->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawIndexed(UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW_INDEXED, QContext(), IndexCount, StartIndexLocation, BaseVertexLocation);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
+	QContext()->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::Draw(UINT VertexCount, UINT StartVertexLocation)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW, QContext(), VertexCount, StartVertexLocation);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->Draw(VertexCount, StartVertexLocation);
+	QContext()->Draw(VertexCount, StartVertexLocation);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::Map(ID3D11Resource *pResource, UINT Subresource, D3D11_MAP MapType, UINT MapFlags, D3D11_MAPPED_SUBRESOURCE *pMappedResource)
 {
-	return m_Context->Map(pResource, Subresource, MapType, MapFlags, pMappedResource);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordMap(QContext(), pResource, Subresource, MapType);
+
+	return QContext()->Map(pResource, Subresource, MapType, MapFlags, pMappedResource);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::Unmap(ID3D11Resource *pResource, UINT Subresource)
 {
-	m_Context->Unmap(pResource, Subresource);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_UNMAP, QContext(), pResource, Subresource);
+
+	QContext()->Unmap(pResource, Subresource);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->PSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_PS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->PSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IASetInputLayout(ID3D11InputLayout *pInputLayout)
 {
-	m_Context->IASetInputLayout(pInputLayout);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_INPUT_LAYOUT, QContext(), pInputLayout);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetInputLayout(pInputLayout))
+		QContext()->IASetInputLayout(pInputLayout);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IASetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppVertexBuffers, const UINT *pStrides, const UINT *pOffsets)
 {
-	m_Context->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordVertexBuffers(QContext(), StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+
+	QContext()->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IASetIndexBuffer(ID3D11Buffer *pIndexBuffer, DXGI_FORMAT Format, UINT Offset)
 {
-	m_Context->IASetIndexBuffer(pIndexBuffer, Format, Offset);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_INDEX_BUFFER, QContext(), pIndexBuffer, Format, Offset);
+
+	QContext()->IASetIndexBuffer(pIndexBuffer, Format, Offset);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW_INDEXED_INSTANCED, QContext(), IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+	QContext()->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW_INSTANCED, QContext(), VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+	QContext()->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->GSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_GS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->GSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSSetShader(ID3D11GeometryShader *pShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->GSSetShader(pShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_GS, pShader);
+
+	QContext()->GSSetShader(pShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology)
 {
-	m_Context->IASetPrimitiveTopology(Topology);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_PRIMITIVE_TOPOLOGY, QContext(), Topology);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetPrimitiveTopology(Topology))
+		QContext()->IASetPrimitiveTopology(Topology);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->VSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_VS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_VS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShaderResources(D3D11StateCache::STAGE_VS, StartSlot, NumViews, ppShaderResourceViews))
+		QContext()->VSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->VSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_VS, StartSlot);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetSamplers(D3D11StateCache::STAGE_VS, StartSlot, NumSamplers, ppSamplers))
+		QContext()->VSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::Begin(ID3D11Asynchronous *pAsync)
 {
-	m_Context->Begin(pAsync);
+	QContext()->Begin(pAsync);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::End(ID3D11Asynchronous *pAsync)
 {
-	m_Context->End(pAsync);
+	QContext()->End(pAsync);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::GetData(ID3D11Asynchronous *pAsync, void *pData, UINT DataSize, UINT GetDataFlags)
 {
-	return m_Context->GetData(pAsync, pData, DataSize, GetDataFlags);
+	return QContext()->GetData(pAsync, pData, DataSize, GetDataFlags);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SetPredication(ID3D11Predicate *pPredicate, BOOL PredicateValue)
 {
-	m_Context->SetPredication(pPredicate, PredicateValue);
+	QContext()->SetPredication(pPredicate, PredicateValue);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->GSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_GS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_GS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	QContext()->GSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->GSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_GS, StartSlot);
+
+	QContext()->GSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView)
 {
-	m_Context->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_RENDER_TARGETS, QContext(), ppRenderTargetViews, NumViews, pDepthStencilView);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetRenderTargets((const void *const *)ppRenderTargetViews, NumViews);
+
+	if (D3D11StateCache::IsEnabled())
+		QStateCache()->InvalidateShaderResources();
+
+	QContext()->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView, UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView *const *ppUnorderedAccessViews, const UINT *pUAVInitialCounts)
 {
-	m_Context->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	if (D3D11Capture::IsActive())
+	{
+		if (NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL)
+			D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_RENDER_TARGETS, QContext(), ppRenderTargetViews, NumRTVs, pDepthStencilView);
+
+		if (NumUAVs != D3D11_KEEP_UNORDERED_ACCESS_VIEWS)
+			D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_UNORDERED_ACCESS_VIEWS, QContext(), ppUnorderedAccessViews, NumUAVs, D3D11Capture::STAGE_PS, UAVStartSlot);
+	}
+
+	if (D3D11Transient::IsActive())
+	{
+		if (NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL)
+			D3D11Transient::OnSetRenderTargets((const void *const *)ppRenderTargetViews, NumRTVs);
+
+		if (NumUAVs != D3D11_KEEP_UNORDERED_ACCESS_VIEWS)
+			D3D11Transient::OnSetUnorderedAccessViews(D3D11Transient::BIND_OM_UAV, UAVStartSlot, (const void *const *)ppUnorderedAccessViews, NumUAVs);
+	}
+
+	if (D3D11StateCache::IsEnabled())
+		QStateCache()->InvalidateShaderResources();
+
+	QContext()->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMSetBlendState(ID3D11BlendState *pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
 {
-	m_Context->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
+	if (D3D11Capture::IsActive())
+	{
+		const FLOAT *f = BlendFactor ? BlendFactor : D3D11Capture::DefaultBlendFactor;
+		D3D11Capture::Record(D3D11Capture::CALL_SET_BLEND_STATE, QContext(), pBlendState, f[0], f[1], f[2], f[3], SampleMask);
+	}
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetBlendState(pBlendState, BlendFactor, SampleMask))
+		QContext()->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMSetDepthStencilState(ID3D11DepthStencilState *pDepthStencilState, UINT StencilRef)
 {
-	m_Context->OMSetDepthStencilState(pDepthStencilState, StencilRef);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_DEPTH_STENCIL_STATE, QContext(), pDepthStencilState, StencilRef);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetDepthStencilState(pDepthStencilState, StencilRef))
+		QContext()->OMSetDepthStencilState(pDepthStencilState, StencilRef);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SOSetTargets(UINT NumBuffers, ID3D11Buffer *const *ppSOTargets, const UINT *pOffsets)
 {
-	m_Context->SOSetTargets(NumBuffers, ppSOTargets, pOffsets);
+	if (D3D11StateCache::IsEnabled())
+		QStateCache()->InvalidateShaderResources();
+
+	QContext()->SOSetTargets(NumBuffers, ppSOTargets, pOffsets);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawAuto()
 {
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawAuto();
+	QContext()->DrawAuto();
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawIndexedInstancedIndirect(ID3D11Buffer *pBufferForArgs, UINT AlignedByteOffsetForArgs)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW_INDIRECT, QContext(), pBufferForArgs, AlignedByteOffsetForArgs);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawIndexedInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	QContext()->DrawIndexedInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DrawInstancedIndirect(ID3D11Buffer *pBufferForArgs, UINT AlignedByteOffsetForArgs)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DRAW_INDIRECT, QContext(), pBufferForArgs, AlignedByteOffsetForArgs);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDraw();
+
 	ProfileCounterInc("Draw Calls");
 
-	m_Context->DrawInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	QContext()->DrawInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DISPATCH, QContext(), ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDispatch();
+
 	ProfileCounterInc("Dispatch Calls");
 
-	m_Context->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+	QContext()->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DispatchIndirect(ID3D11Buffer *pBufferForArgs, UINT AlignedByteOffsetForArgs)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_DISPATCH_INDIRECT, QContext(), pBufferForArgs, AlignedByteOffsetForArgs);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnDispatch();
+
 	ProfileCounterInc("Dispatch Calls");
 
-	m_Context->DispatchIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	QContext()->DispatchIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSSetState(ID3D11RasterizerState *pRasterizerState)
 {
-	m_Context->RSSetState(pRasterizerState);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_RASTERIZER_STATE, QContext(), pRasterizerState);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetRasterizerState(pRasterizerState))
+		QContext()->RSSetState(pRasterizerState);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT *pViewports)
 {
-	m_Context->RSSetViewports(NumViewports, pViewports);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordViewports(QContext(), NumViewports, pViewports);
+
+	QContext()->RSSetViewports(NumViewports, pViewports);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSSetScissorRects(UINT NumRects, const D3D11_RECT *pRects)
 {
-	m_Context->RSSetScissorRects(NumRects, pRects);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordScissorRects(QContext(), NumRects, pRects);
+
+	QContext()->RSSetScissorRects(NumRects, pRects);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CopySubresourceRegion(ID3D11Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource *pSrcResource, UINT SrcSubresource, const D3D11_BOX *pSrcBox)
 {
-	m_Context->CopySubresourceRegion(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_COPY_SUBRESOURCE_REGION, QContext(), pDstResource, DstSubresource, pSrcResource, SrcSubresource);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnCopy(pDstResource, pSrcResource, false);
+
+	QContext()->CopySubresourceRegion(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CopyResource(ID3D11Resource *pDstResource, ID3D11Resource *pSrcResource)
 {
-	m_Context->CopyResource(pDstResource, pSrcResource);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_COPY_RESOURCE, QContext(), pDstResource, pSrcResource);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnCopy(pDstResource, pSrcResource, true);
+
+	QContext()->CopyResource(pDstResource, pSrcResource);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::UpdateSubresource(ID3D11Resource *pDstResource, UINT DstSubresource, const D3D11_BOX *pDstBox, const void *pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch)
 {
-	m_Context->UpdateSubresource(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordUpdateSubresource(QContext(), pDstResource, DstSubresource, pDstBox, SrcRowPitch, SrcDepthPitch);
+
+	QContext()->UpdateSubresource(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CopyStructureCount(ID3D11Buffer *pDstBuffer, UINT DstAlignedByteOffset, ID3D11UnorderedAccessView *pSrcView)
 {
-	m_Context->CopyStructureCount(pDstBuffer, DstAlignedByteOffset, pSrcView);
+	QContext()->CopyStructureCount(pDstBuffer, DstAlignedByteOffset, pSrcView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearRenderTargetView(ID3D11RenderTargetView *pRenderTargetView, const FLOAT ColorRGBA[4])
 {
-	m_Context->ClearRenderTargetView(pRenderTargetView, ColorRGBA);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_CLEAR_RENDER_TARGET_VIEW, QContext(), pRenderTargetView);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnClear(pRenderTargetView);
+
+	QContext()->ClearRenderTargetView(pRenderTargetView, ColorRGBA);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView *pUnorderedAccessView, const UINT Values[4])
 {
-	m_Context->ClearUnorderedAccessViewUint(pUnorderedAccessView, Values);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_CLEAR_UNORDERED_ACCESS_VIEW, QContext(), pUnorderedAccessView);
+
+	QContext()->ClearUnorderedAccessViewUint(pUnorderedAccessView, Values);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView *pUnorderedAccessView, const FLOAT Values[4])
 {
-	m_Context->ClearUnorderedAccessViewFloat(pUnorderedAccessView, Values);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_CLEAR_UNORDERED_ACCESS_VIEW, QContext(), pUnorderedAccessView);
+
+	QContext()->ClearUnorderedAccessViewFloat(pUnorderedAccessView, Values);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearDepthStencilView(ID3D11DepthStencilView *pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil)
 {
-	m_Context->ClearDepthStencilView(pDepthStencilView, ClearFlags, Depth, Stencil);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_CLEAR_DEPTH_STENCIL_VIEW, QContext(), pDepthStencilView, ClearFlags);
+
+	QContext()->ClearDepthStencilView(pDepthStencilView, ClearFlags, Depth, Stencil);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GenerateMips(ID3D11ShaderResourceView *pShaderResourceView)
 {
-	m_Context->GenerateMips(pShaderResourceView);
+	QContext()->GenerateMips(pShaderResourceView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SetResourceMinLOD(ID3D11Resource *pResource, FLOAT MinLOD)
 {
-	m_Context->SetResourceMinLOD(pResource, MinLOD);
+	QContext()->SetResourceMinLOD(pResource, MinLOD);
 }
 
 FLOAT STDMETHODCALLTYPE D3D11DeviceContextProxy::GetResourceMinLOD(ID3D11Resource *pResource)
 {
-	return m_Context->GetResourceMinLOD(pResource);
+	return QContext()->GetResourceMinLOD(pResource);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ResolveSubresource(ID3D11Resource *pDstResource, UINT DstSubresource, ID3D11Resource *pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
 {
-	m_Context->ResolveSubresource(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
+	QContext()->ResolveSubresource(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ExecuteCommandList(ID3D11CommandList *pCommandList, BOOL RestoreContextState)
 {
-	m_Context->ExecuteCommandList(pCommandList, RestoreContextState);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_EXECUTE_COMMAND_LIST, QContext(), pCommandList);
+
+	QStateCache()->Invalidate();
+
+	if (!RestoreContextState && D3D11Transient::IsActive())
+		D3D11Transient::OnClearState();
+
+	QContext()->ExecuteCommandList(pCommandList, RestoreContextState);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->HSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_HS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_HS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	QContext()->HSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSSetShader(ID3D11HullShader *pHullShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->HSSetShader(pHullShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_HS, pHullShader);
+
+	QContext()->HSSetShader(pHullShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->HSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_HS, StartSlot);
+
+	QContext()->HSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->HSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_HS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->HSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->DSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_DS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_DS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	QContext()->DSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSSetShader(ID3D11DomainShader *pDomainShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->DSSetShader(pDomainShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_DS, pDomainShader);
+
+	QContext()->DSSetShader(pDomainShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->DSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_DS, StartSlot);
+
+	QContext()->DSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->DSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_DS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->DSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
-	m_Context->CSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SHADER_RESOURCES, QContext(), ppShaderResourceViews, NumViews, D3D11Capture::STAGE_CS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetShaderResources(D3D11Transient::BIND_CS, StartSlot, (const void *const *)ppShaderResourceViews, NumViews);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShaderResources(D3D11StateCache::STAGE_CS, StartSlot, NumViews, ppShaderResourceViews))
+		QContext()->CSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView *const *ppUnorderedAccessViews, const UINT *pUAVInitialCounts)
 {
-	m_Context->CSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_UNORDERED_ACCESS_VIEWS, QContext(), ppUnorderedAccessViews, NumUAVs, D3D11Capture::STAGE_CS, StartSlot);
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnSetUnorderedAccessViews(D3D11Transient::BIND_CS_UAV, StartSlot, (const void *const *)ppUnorderedAccessViews, NumUAVs);
+
+	if (D3D11StateCache::IsEnabled())
+		QStateCache()->InvalidateShaderResources();
+
+	QContext()->CSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetShader(ID3D11ComputeShader *pComputeShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
-	m_Context->CSSetShader(pComputeShader, ppClassInstances, NumClassInstances);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_SET_SHADER, QContext(), D3D11Capture::STAGE_CS, pComputeShader);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetShader(D3D11StateCache::STAGE_CS, pComputeShader, NumClassInstances))
+		QContext()->CSSetShader(pComputeShader, ppClassInstances, NumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
-	m_Context->CSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordObjects(D3D11Capture::CALL_SET_SAMPLERS, QContext(), ppSamplers, NumSamplers, D3D11Capture::STAGE_CS, StartSlot);
+
+	if (!D3D11StateCache::IsEnabled() || QStateCache()->SetSamplers(D3D11StateCache::STAGE_CS, StartSlot, NumSamplers, ppSamplers))
+		QContext()->CSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers)
 {
-	m_Context->CSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_CS, StartSlot, NumBuffers, ppConstantBuffers, nullptr, nullptr);
+
+	QContext()->CSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->VSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->VSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->PSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->PSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSGetShader(ID3D11PixelShader **ppPixelShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->PSGetShader(ppPixelShader, ppClassInstances, pNumClassInstances);
+	QContext()->PSGetShader(ppPixelShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->PSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->PSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSGetShader(ID3D11VertexShader **ppVertexShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->VSGetShader(ppVertexShader, ppClassInstances, pNumClassInstances);
+	QContext()->VSGetShader(ppVertexShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->PSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->PSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IAGetInputLayout(ID3D11InputLayout **ppInputLayout)
 {
-	m_Context->IAGetInputLayout(ppInputLayout);
+	QContext()->IAGetInputLayout(ppInputLayout);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IAGetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppVertexBuffers, UINT *pStrides, UINT *pOffsets)
 {
-	m_Context->IAGetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+	QContext()->IAGetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IAGetIndexBuffer(ID3D11Buffer **pIndexBuffer, DXGI_FORMAT *Format, UINT *Offset)
 {
-	m_Context->IAGetIndexBuffer(pIndexBuffer, Format, Offset);
+	QContext()->IAGetIndexBuffer(pIndexBuffer, Format, Offset);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->GSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->GSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSGetShader(ID3D11GeometryShader **ppGeometryShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->GSGetShader(ppGeometryShader, ppClassInstances, pNumClassInstances);
+	QContext()->GSGetShader(ppGeometryShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY *pTopology)
 {
-	m_Context->IAGetPrimitiveTopology(pTopology);
+	QContext()->IAGetPrimitiveTopology(pTopology);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->VSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->VSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->VSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->VSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GetPredication(ID3D11Predicate **ppPredicate, BOOL *pPredicateValue)
 {
-	m_Context->GetPredication(ppPredicate, pPredicateValue);
+	QContext()->GetPredication(ppPredicate, pPredicateValue);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->GSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->GSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->GSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->GSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMGetRenderTargets(UINT NumViews, ID3D11RenderTargetView **ppRenderTargetViews, ID3D11DepthStencilView **ppDepthStencilView)
 {
-	m_Context->OMGetRenderTargets(NumViews, ppRenderTargetViews, ppDepthStencilView);
+	QContext()->OMGetRenderTargets(NumViews, ppRenderTargetViews, ppDepthStencilView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMGetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView **ppRenderTargetViews, ID3D11DepthStencilView **ppDepthStencilView, UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView **ppUnorderedAccessViews)
 {
-	m_Context->OMGetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, ppDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews);
+	QContext()->OMGetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, ppDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMGetBlendState(ID3D11BlendState **ppBlendState, FLOAT BlendFactor[4], UINT *pSampleMask)
 {
-	m_Context->OMGetBlendState(ppBlendState, BlendFactor, pSampleMask);
+	QContext()->OMGetBlendState(ppBlendState, BlendFactor, pSampleMask);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::OMGetDepthStencilState(ID3D11DepthStencilState **ppDepthStencilState, UINT *pStencilRef)
 {
-	m_Context->OMGetDepthStencilState(ppDepthStencilState, pStencilRef);
+	QContext()->OMGetDepthStencilState(ppDepthStencilState, pStencilRef);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SOGetTargets(UINT NumBuffers, ID3D11Buffer **ppSOTargets)
 {
-	m_Context->SOGetTargets(NumBuffers, ppSOTargets);
+	QContext()->SOGetTargets(NumBuffers, ppSOTargets);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSGetState(ID3D11RasterizerState **ppRasterizerState)
 {
-	m_Context->RSGetState(ppRasterizerState);
+	QContext()->RSGetState(ppRasterizerState);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSGetViewports(UINT *pNumViewports, D3D11_VIEWPORT *pViewports)
 {
-	m_Context->RSGetViewports(pNumViewports, pViewports);
+	QContext()->RSGetViewports(pNumViewports, pViewports);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::RSGetScissorRects(UINT *pNumRects, D3D11_RECT *pRects)
 {
-	m_Context->RSGetScissorRects(pNumRects, pRects);
+	QContext()->RSGetScissorRects(pNumRects, pRects);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->HSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->HSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSGetShader(ID3D11HullShader **ppHullShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->HSGetShader(ppHullShader, ppClassInstances, pNumClassInstances);
+	QContext()->HSGetShader(ppHullShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->HSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->HSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->HSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->HSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->DSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->DSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSGetShader(ID3D11DomainShader **ppDomainShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->DSGetShader(ppDomainShader, ppClassInstances, pNumClassInstances);
+	QContext()->DSGetShader(ppDomainShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->DSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->DSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->DSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->DSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView **ppShaderResourceViews)
 {
-	m_Context->CSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+	QContext()->CSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView **ppUnorderedAccessViews)
 {
-	m_Context->CSGetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews);
+	QContext()->CSGetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetShader(ID3D11ComputeShader **ppComputeShader, ID3D11ClassInstance **ppClassInstances, UINT *pNumClassInstances)
 {
-	m_Context->CSGetShader(ppComputeShader, ppClassInstances, pNumClassInstances);
+	QContext()->CSGetShader(ppComputeShader, ppClassInstances, pNumClassInstances);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState **ppSamplers)
 {
-	m_Context->CSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+	QContext()->CSGetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers)
 {
-	m_Context->CSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	QContext()->CSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearState()
 {
-	m_Context->ClearState();
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_CLEAR_STATE, QContext());
+
+	QStateCache()->Invalidate();
+
+	if (D3D11Transient::IsActive())
+		D3D11Transient::OnClearState();
+
+	QContext()->ClearState();
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::Flush()
 {
-	m_Context->Flush();
+	QContext()->Flush();
 }
 
 UINT STDMETHODCALLTYPE D3D11DeviceContextProxy::GetContextFlags()
 {
-	return m_Context->GetContextFlags();
+	return QContext()->GetContextFlags();
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::FinishCommandList(BOOL RestoreDeferredContextState, ID3D11CommandList **ppCommandList)
 {
-	return m_Context->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+	QStateCache()->Invalidate();
+
+	HRESULT hr = QContext()->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_FINISH_COMMAND_LIST, QContext(), SUCCEEDED(hr) ? *ppCommandList : nullptr);
+
+	return hr;
 }
 
 D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE D3D11DeviceContextProxy::GetType()
 {
-	return m_Context->GetType();
+	return QContext()->GetType();
 }
 
 // ID3D11DeviceContext1
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CopySubresourceRegion1(ID3D11Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource *pSrcResource, UINT SrcSubresource, const D3D11_BOX *pSrcBox, UINT CopyFlags)
 {
-	m_Context->CopySubresourceRegion1(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox, CopyFlags);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_COPY_SUBRESOURCE_REGION, QContext(), pDstResource, DstSubresource, pSrcResource, SrcSubresource);
+
+	QContext()->CopySubresourceRegion1(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox, CopyFlags);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::UpdateSubresource1(ID3D11Resource *pDstResource, UINT DstSubresource, const D3D11_BOX *pDstBox, const void *pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch, UINT CopyFlags)
 {
-	m_Context->UpdateSubresource1(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch, CopyFlags);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordUpdateSubresource(QContext(), pDstResource, DstSubresource, pDstBox, SrcRowPitch, SrcDepthPitch);
+
+	QContext()->UpdateSubresource1(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch, CopyFlags);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DiscardResource(ID3D11Resource *pResource)
 {
-	m_Context->DiscardResource(pResource);
+	QContext()->DiscardResource(pResource);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DiscardView(ID3D11View *pResourceView)
 {
-	m_Context->DiscardView(pResourceView);
+	QContext()->DiscardView(pResourceView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->VSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_VS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->VSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->HSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_HS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->HSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->DSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_DS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->DSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->GSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_GS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->GSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->PSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_PS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->PSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant, const UINT *pNumConstants)
 {
-	m_Context->CSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordConstantBuffers(QContext(), D3D11Capture::STAGE_CS, StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+
+	QContext()->CSSetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::VSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->VSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->VSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::HSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->HSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->HSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->DSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->DSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::GSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->GSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->GSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::PSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->PSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->PSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CSGetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer **ppConstantBuffers, UINT *pFirstConstant, UINT *pNumConstants)
 {
-	m_Context->CSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
+	QContext()->CSGetConstantBuffers1(StartSlot, NumBuffers, ppConstantBuffers, pFirstConstant, pNumConstants);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SwapDeviceContextState(ID3DDeviceContextState *pState, ID3DDeviceContextState **ppPreviousState)
 {
-	m_Context->SwapDeviceContextState(pState, ppPreviousState);
+	QStateCache()->Invalidate();
+
+	QContext()->SwapDeviceContextState(pState, ppPreviousState);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::ClearView(ID3D11View *pView, const FLOAT Color[4], const D3D11_RECT *pRect, UINT NumRects)
 {
-	m_Context->ClearView(pView, Color, pRect, NumRects);
+	QContext()->ClearView(pView, Color, pRect, NumRects);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::DiscardView1(ID3D11View *pResourceView, const D3D11_RECT *pRects, UINT NumRects)
 {
-	m_Context->DiscardView1(pResourceView, pRects, NumRects);
+	QContext()->DiscardView1(pResourceView, pRects, NumRects);
 }
 
 // ID3D11DeviceContext2
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::UpdateTileMappings(ID3D11Resource *pTiledResource, UINT NumTiledResourceRegions, const D3D11_TILED_RESOURCE_COORDINATE *pTiledResourceRegionStartCoordinates, const D3D11_TILE_REGION_SIZE *pTiledResourceRegionSizes, ID3D11Buffer *pTilePool, UINT NumRanges, const UINT *pRangeFlags, const UINT *pTilePoolStartOffsets, const UINT *pRangeTileCounts, UINT Flags)
 {
-	return m_Context->UpdateTileMappings(pTiledResource, NumTiledResourceRegions, pTiledResourceRegionStartCoordinates, pTiledResourceRegionSizes, pTilePool, NumRanges, pRangeFlags, pTilePoolStartOffsets, pRangeTileCounts, Flags);
+	return QContext()->UpdateTileMappings(pTiledResource, NumTiledResourceRegions, pTiledResourceRegionStartCoordinates, pTiledResourceRegionSizes, pTilePool, NumRanges, pRangeFlags, pTilePoolStartOffsets, pRangeTileCounts, Flags);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::CopyTileMappings(ID3D11Resource *pDestTiledResource, const D3D11_TILED_RESOURCE_COORDINATE *pDestRegionStartCoordinate, ID3D11Resource *pSourceTiledResource, const D3D11_TILED_RESOURCE_COORDINATE *pSourceRegionStartCoordinate, const D3D11_TILE_REGION_SIZE *pTileRegionSize, UINT Flags)
 {
-	return m_Context->CopyTileMappings(pDestTiledResource, pDestRegionStartCoordinate, pSourceTiledResource, pSourceRegionStartCoordinate, pTileRegionSize, Flags);
+	return QContext()->CopyTileMappings(pDestTiledResource, pDestRegionStartCoordinate, pSourceTiledResource, pSourceRegionStartCoordinate, pTileRegionSize, Flags);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::CopyTiles(ID3D11Resource *pTiledResource, const D3D11_TILED_RESOURCE_COORDINATE *pTileRegionStartCoordinate, const D3D11_TILE_REGION_SIZE *pTileRegionSize, ID3D11Buffer *pBuffer, UINT64 BufferStartOffsetInBytes, UINT Flags)
 {
-	m_Context->CopyTiles(pTiledResource, pTileRegionStartCoordinate, pTileRegionSize, pBuffer, BufferStartOffsetInBytes, Flags);
+	QContext()->CopyTiles(pTiledResource, pTileRegionStartCoordinate, pTileRegionSize, pBuffer, BufferStartOffsetInBytes, Flags);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::UpdateTiles(ID3D11Resource *pDestTiledResource, const D3D11_TILED_RESOURCE_COORDINATE *pDestTileRegionStartCoordinate, const D3D11_TILE_REGION_SIZE *pDestTileRegionSize, const void *pSourceTileData, UINT Flags)
 {
-	m_Context->UpdateTiles(pDestTiledResource, pDestTileRegionStartCoordinate, pDestTileRegionSize, pSourceTileData, Flags);
+	QContext()->UpdateTiles(pDestTiledResource, pDestTileRegionStartCoordinate, pDestTileRegionSize, pSourceTileData, Flags);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContextProxy::ResizeTilePool(ID3D11Buffer *pTilePool, UINT64 NewSizeInBytes)
 {
-	return m_Context->ResizeTilePool(pTilePool, NewSizeInBytes);
+	return QContext()->ResizeTilePool(pTilePool, NewSizeInBytes);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::TiledResourceBarrier(ID3D11DeviceChild *pTiledResourceOrViewAccessBeforeBarrier, ID3D11DeviceChild *pTiledResourceOrViewAccessAfterBarrier)
 {
-	m_Context->TiledResourceBarrier(pTiledResourceOrViewAccessBeforeBarrier, pTiledResourceOrViewAccessAfterBarrier);
+	QContext()->TiledResourceBarrier(pTiledResourceOrViewAccessBeforeBarrier, pTiledResourceOrViewAccessAfterBarrier);
 }
 
 BOOL STDMETHODCALLTYPE D3D11DeviceContextProxy::IsAnnotationEnabled()
@@ -1121,36 +1436,56 @@ BOOL STDMETHODCALLTYPE D3D11DeviceContextProxy::IsAnnotationEnabled()
 	return FALSE;
 
 #if 0
-	return m_Context->IsAnnotationEnabled();
+	return QContext()->IsAnnotationEnabled();
 #endif
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::SetMarkerInt(LPCWSTR pLabel, INT Data)
 {
+	if (ThreadContextOverride)
+		return ThreadContextOverride->SetMarkerInt(pLabel, Data);
+
 	if (m_UserAnnotation)
 		m_UserAnnotation->SetMarker(pLabel);
 
 #if 0
-	m_Context->SetMarkerInt(pLabel, Data);
+	QContext()->SetMarkerInt(pLabel, Data);
 #endif
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::BeginEventInt(LPCWSTR pLabel, INT Data)
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::RecordEvent(QContext(), pLabel);
+
+	// The annotation interface belongs to the immediate context and isn't thread safe
+	if (ThreadContextOverride)
+		return ThreadContextOverride->BeginEventInt(pLabel, Data);
+
+	g_GPUScopes.BeginScope(pLabel);
+
 	if (m_UserAnnotation)
 		m_UserAnnotation->BeginEvent(pLabel);
 
 #if 0
-	m_Context->BeginEventInt(pLabel, Data);
+	QContext()->BeginEventInt(pLabel, Data);
 #endif
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContextProxy::EndEvent()
 {
+	if (D3D11Capture::IsActive())
+		D3D11Capture::Record(D3D11Capture::CALL_END_EVENT, QContext());
+
+	if (ThreadContextOverride)
+		return ThreadContextOverride->EndEvent();
+
+	g_GPUScopes.EndScope();
+
 	if (m_UserAnnotation)
 		m_UserAnnotation->EndEvent();
 
 #if 0
-	m_Context->EndEvent();
+	QContext()->EndEvent();
 #endif
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <d3d11_2.h>
+#include "d3d11_statecache.h"
 
 struct D3D11DeviceProxy;
 struct D3D11DeviceContextProxy;
@@ -80,10 +81,26 @@ struct D3D11DeviceContextProxy : ID3D11DeviceContext2
 {
 	ID3D11DeviceContext2 *m_Context;
 	ID3DUserDefinedAnnotation *m_UserAnnotation;
+	D3D11StateCache m_StateCache;
+
+	// Set while a thread records into a deferred context (see d3d11_deferred.h). Every call made through the proxy on
+	// that thread, game code included, lands in the deferred context instead.
+	inline static thread_local ID3D11DeviceContext2 *ThreadContextOverride;
+	inline static thread_local D3D11StateCache ThreadStateCache;
 
 	D3D11DeviceContextProxy(ID3D11DeviceContext *Context);
 	D3D11DeviceContextProxy(ID3D11DeviceContext2 *Context);
 
+	ID3D11DeviceContext2 *QContext() const
+	{
+		return ThreadContextOverride ? ThreadContextOverride : m_Context;
+	}
+
+	D3D11StateCache *QStateCache()
+	{
+		return ThreadContextOverride ? &ThreadStateCache : &m_StateCache;
+	}
+
 	// IUnknown
 	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObj) override;
 	virtual ULONG STDMETHODCALLTYPE AddRef() override;
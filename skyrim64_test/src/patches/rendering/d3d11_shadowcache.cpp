@@ -0,0 +1,127 @@
+#include "../../common.h"
+#include "d3d11_shadowcache.h"
+
+namespace D3D11ShadowCache
+{
+	ID3D11Texture2D *Snapshots[MaxSlots];
+	bool Enabled;
+
+	ShadowCache& GetCache()
+	{
+		static ShadowCache cache(MaxSlots);
+		return cache;
+	}
+
+	void ReleaseSnapshot(uint32_t Slot)
+	{
+		if (Snapshots[Slot])
+		{
+			Snapshots[Slot]->Release();
+			Snapshots[Slot] = nullptr;
+		}
+	}
+
+	bool MatchesTarget(ID3D11Texture2D *Snapshot, ID3D11Texture2D *Target)
+	{
+		D3D11_TEXTURE2D_DESC snapshotDesc;
+		D3D11_TEXTURE2D_DESC targetDesc;
+		Snapshot->GetDesc(&snapshotDesc);
+		Target->GetDesc(&targetDesc);
+
+		return snapshotDesc.Width == targetDesc.Width && snapshotDesc.Height == targetDesc.Height && snapshotDesc.Format == targetDesc.Format;
+	}
+
+	bool IsEligible(ID3D11Texture2D *Target, const D3D11_VIEWPORT& Viewport)
+	{
+		if (!Target)
+			return false;
+
+		D3D11_TEXTURE2D_DESC desc;
+		Target->GetDesc(&desc);
+
+		if (desc.MipLevels != 1 || desc.SampleDesc.Count != 1)
+			return false;
+
+		return Viewport.TopLeftX == 0.0f && Viewport.TopLeftY == 0.0f && Viewport.Width == (float)desc.Width && Viewport.Height == (float)desc.Height;
+	}
+
+	ShadowCache::Decision Begin(uint64_t Key, uint64_t LightHash, const ShadowCasterSignature& Casters)
+	{
+		return GetCache().Begin(Key, LightHash, Casters);
+	}
+
+	bool Restore(uint32_t Slot, ID3D11DeviceContext *Context, ID3D11Texture2D *Target, uint32_t Slice)
+	{
+		Assert(Slot < MaxSlots);
+
+		if (!Snapshots[Slot] || !MatchesTarget(Snapshots[Slot], Target))
+		{
+			GetCache().Invalidate(Slot);
+			return false;
+		}
+
+		Context->CopySubresourceRegion(Target, D3D11CalcSubresource(0, Slice, 1), 0, 0, 0, Snapshots[Slot], 0, nullptr);
+		return true;
+	}
+
+	bool Store(uint32_t Slot, ID3D11DeviceContext *Context, ID3D11Texture2D *Target, uint32_t Slice)
+	{
+		Assert(Slot < MaxSlots);
+
+		if (Snapshots[Slot] && !MatchesTarget(Snapshots[Slot], Target))
+			ReleaseSnapshot(Slot);
+
+		if (!Snapshots[Slot])
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			Target->GetDesc(&desc);
+
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags &= D3D11_BIND_DEPTH_STENCIL;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+
+			ID3D11Device *device;
+			Target->GetDevice(&device);
+
+			HRESULT hr = device->CreateTexture2D(&desc, nullptr, &Snapshots[Slot]);
+			device->Release();
+
+			if (FAILED(hr))
+			{
+				Snapshots[Slot] = nullptr;
+				GetCache().Invalidate(Slot);
+				return false;
+			}
+		}
+
+		Context->CopySubresourceRegion(Snapshots[Slot], 0, 0, 0, 0, Target, D3D11CalcSubresource(0, Slice, 1), nullptr);
+		return true;
+	}
+
+	void OnPresent(bool Enable)
+	{
+		auto& cache = GetCache();
+
+		if (Enabled)
+			cache.EndFrame();
+
+		if (!Enable)
+			cache.Clear();
+
+		Enabled = Enable;
+
+		for (uint32_t i = 0; i < MaxSlots; i++)
+		{
+			if (!cache.IsSlotActive(i))
+				ReleaseSnapshot(i);
+		}
+	}
+
+	ShadowCache::Stats GetStats()
+	{
+		return GetCache().GetStats();
+	}
+}
\ No newline at end of file
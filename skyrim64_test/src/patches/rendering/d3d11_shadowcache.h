@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ShadowCache.h"
+
+//
+// Snapshot storage for ShadowCache. Each slot owns a copy of one depth stencil slice, created on first store. Depth
+// stencil copies can't be partial in D3D11, so only shadow maps whose viewport covers the whole slice are cached.
+// Render thread only.
+//
+namespace D3D11ShadowCache
+{
+	// Every slot may hold a full size shadow map slice, keep this small
+	const uint32_t MaxSlots = 8;
+
+	bool IsEligible(ID3D11Texture2D *Target, const D3D11_VIEWPORT& Viewport);
+
+	ShadowCache::Decision Begin(uint64_t Key, uint64_t LightHash, const ShadowCasterSignature& Casters);
+
+	// Both return false and invalidate the slot when the snapshot doesn't exist or can't be created
+	bool Restore(uint32_t Slot, ID3D11DeviceContext *Context, ID3D11Texture2D *Target, uint32_t Slice);
+	bool Store(uint32_t Slot, ID3D11DeviceContext *Context, ID3D11Texture2D *Target, uint32_t Slice);
+
+	// Ends the frame and releases snapshots of evicted slots. Disabling drops everything.
+	void OnPresent(bool Enable);
+
+	ShadowCache::Stats GetStats();
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "../../common.h"
+#include "d3d11_statecache.h"
+
+D3D11StateCache::D3D11StateCache()
+{
+	Invalidate();
+}
+
+void D3D11StateCache::Invalidate()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+void D3D11StateCache::InvalidateShaderResources()
+{
+	memset(m_KnownResources, 0, sizeof(m_KnownResources));
+}
+
+bool CountCall(bool Changed)
+{
+	if (!Changed)
+	{
+		ProfileCounterInc("State Calls Suppressed");
+		return false;
+	}
+
+	ProfileCounterInc("State Calls Issued");
+	return true;
+}
+
+bool D3D11StateCache::SetBlendState(ID3D11BlendState *State, const FLOAT BlendFactor[4], UINT SampleMask)
+{
+	// A null blend factor is the same as { 1, 1, 1, 1 }
+	const FLOAT defaultFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	if (!BlendFactor)
+		BlendFactor = defaultFactor;
+
+	bool changed = !(m_KnownState & KNOWN_BLEND) ||
+		m_BlendState != State ||
+		memcmp(m_BlendFactor, BlendFactor, sizeof(m_BlendFactor)) != 0 ||
+		m_SampleMask != SampleMask;
+
+	m_KnownState |= KNOWN_BLEND;
+	m_BlendState = State;
+	memcpy(m_BlendFactor, BlendFactor, sizeof(m_BlendFactor));
+	m_SampleMask = SampleMask;
+
+	return CountCall(changed);
+}
+
+bool D3D11StateCache::SetDepthStencilState(ID3D11DepthStencilState *State, UINT StencilRef)
+{
+	bool changed = !(m_KnownState & KNOWN_DEPTH_STENCIL) || m_DepthStencilState != State || m_StencilRef != StencilRef;
+
+	m_KnownState |= KNOWN_DEPTH_STENCIL;
+	m_DepthStencilState = State;
+	m_StencilRef = StencilRef;
+
+	return CountCall(changed);
+}
+
+bool D3D11StateCache::SetRasterizerState(ID3D11RasterizerState *State)
+{
+	bool changed = !(m_KnownState & KNOWN_RASTERIZER) || m_RasterizerState != State;
+
+	m_KnownState |= KNOWN_RASTERIZER;
+	m_RasterizerState = State;
+
+	return CountCall(changed);
+}
+
+bool D3D11StateCache::SetInputLayout(ID3D11InputLayout *Layout)
+{
+	bool changed = !(m_KnownState & KNOWN_INPUT_LAYOUT) || m_InputLayout != Layout;
+
+	m_KnownState |= KNOWN_INPUT_LAYOUT;
+	m_InputLayout = Layout;
+
+	return CountCall(changed);
+}
+
+bool D3D11StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology)
+{
+	bool changed = !(m_KnownState & KNOWN_TOPOLOGY) || m_Topology != Topology;
+
+	m_KnownState |= KNOWN_TOPOLOGY;
+	m_Topology = Topology;
+
+	return CountCall(changed);
+}
+
+bool D3D11StateCache::SetShader(Stage Type, ID3D11DeviceChild *Shader, UINT NumClassInstances)
+{
+	const uint32_t knownBit = KNOWN_SHADER << Type;
+
+	// Class instances aren't tracked (and never used by the game)
+	if (NumClassInstances > 0)
+	{
+		m_KnownState &= ~knownBit;
+		return CountCall(true);
+	}
+
+	bool changed = !(m_KnownState & knownBit) || m_Shaders[Type] != Shader;
+
+	m_KnownState |= knownBit;
+	m_Shaders[Type] = Shader;
+
+	return CountCall(changed);
+}
+
+template<typename T, uint32_t SlotCount>
+bool D3D11StateCache::UpdateSlots(T *(&Bound)[SlotCount], uint32_t& KnownBits, UINT& StartSlot, UINT& Count, T *const *& Values)
+{
+	static_assert(SlotCount <= 32);
+
+	// Slots past the tracked range are forwarded untouched
+	if (StartSlot + Count > SlotCount)
+	{
+		for (UINT i = StartSlot; i < SlotCount; i++)
+			KnownBits &= ~(1u << i);
+
+		return CountCall(true);
+	}
+
+	int first = -1;
+	int last = -1;
+
+	for (UINT i = 0; i < Count; i++)
+	{
+		UINT slot = StartSlot + i;
+
+		if ((KnownBits & (1u << slot)) && Bound[slot] == Values[i])
+			continue;
+
+		if (first == -1)
+			first = i;
+
+		last = i;
+		Bound[slot] = Values[i];
+		KnownBits |= 1u << slot;
+	}
+
+	if (first == -1)
+		return CountCall(false);
+
+	// Unchanged slots between the first and last change are re-sent: still a single call
+	StartSlot += first;
+	Count = last - first + 1;
+	Values += first;
+
+	return CountCall(true);
+}
+
+bool D3D11StateCache::SetShaderResources(Stage Type, UINT& StartSlot, UINT& NumViews, ID3D11ShaderResourceView *const *& Views)
+{
+	return UpdateSlots(m_Resources[Type], m_KnownResources[Type], StartSlot, NumViews, Views);
+}
+
+bool D3D11StateCache::SetSamplers(Stage Type, UINT& StartSlot, UINT& NumSamplers, ID3D11SamplerState *const *& Samplers)
+{
+	return UpdateSlots(m_Samplers[Type], m_KnownSamplers[Type], StartSlot, NumSamplers, Samplers);
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <d3d11_2.h>
+
+//
+// Mirror of what is currently bound on a single device context. D3D11DeviceContextProxy asks it before forwarding a
+// set call: calls that wouldn't change anything are dropped and slot ranges are narrowed to the slots that differ.
+//
+// Nothing is assumed about state that hasn't been set through the proxy yet. Raw pointers are safe to compare because
+// the context itself holds a reference to everything that is bound.
+//
+// While disabled the proxy skips the cache entirely and forwards every call. The switch only happens at Present, right
+// after the immediate context's cache was invalidated; deferred contexts invalidate theirs whenever recording starts.
+//
+class D3D11StateCache
+{
+public:
+	enum Stage
+	{
+		STAGE_VS,
+		STAGE_PS,
+		STAGE_CS,
+		STAGE_COUNT,
+	};
+
+	constexpr static uint32_t TrackedResourceSlots = 32;
+	constexpr static uint32_t TrackedSamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+
+	D3D11StateCache();
+
+	static void SetEnabled(bool Enable)
+	{
+		Enabled.store(Enable, std::memory_order_relaxed);
+	}
+
+	static bool IsEnabled()
+	{
+		return Enabled.load(std::memory_order_relaxed);
+	}
+
+	// Context state was reset or changed behind the proxy's back
+	void Invalidate();
+
+	// Binding a resource as an output silently unbinds it from every shader input slot
+	void InvalidateShaderResources();
+
+	bool SetBlendState(ID3D11BlendState *State, const FLOAT BlendFactor[4], UINT SampleMask);
+	bool SetDepthStencilState(ID3D11DepthStencilState *State, UINT StencilRef);
+	bool SetRasterizerState(ID3D11RasterizerState *State);
+	bool SetInputLayout(ID3D11InputLayout *Layout);
+	bool SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology);
+	bool SetShader(Stage Type, ID3D11DeviceChild *Shader, UINT NumClassInstances);
+
+	// Narrows [StartSlot, StartSlot + Count) down to the first and last slot that change. Returns false when none do.
+	bool SetShaderResources(Stage Type, UINT& StartSlot, UINT& NumViews, ID3D11ShaderResourceView *const *& Views);
+	bool SetSamplers(Stage Type, UINT& StartSlot, UINT& NumSamplers, ID3D11SamplerState *const *& Samplers);
+
+private:
+	inline static std::atomic_bool Enabled;
+
+	template<typename T, uint32_t SlotCount>
+	bool UpdateSlots(T *(&Bound)[SlotCount], uint32_t& KnownBits, UINT& StartSlot, UINT& Count, T *const *& Values);
+
+	enum : uint32_t
+	{
+		KNOWN_BLEND = 1 << 0,
+		KNOWN_DEPTH_STENCIL = 1 << 1,
+		KNOWN_RASTERIZER = 1 << 2,
+		KNOWN_INPUT_LAYOUT = 1 << 3,
+		KNOWN_TOPOLOGY = 1 << 4,
+		KNOWN_SHADER = 1 << 5,		// Shifted left by Stage
+	};
+
+	uint32_t m_KnownState;
+
+	ID3D11BlendState *m_BlendState;
+	FLOAT m_BlendFactor[4];
+	UINT m_SampleMask;
+
+	ID3D11DepthStencilState *m_DepthStencilState;
+	UINT m_StencilRef;
+
+	ID3D11RasterizerState *m_RasterizerState;
+	ID3D11InputLayout *m_InputLayout;
+	D3D11_PRIMITIVE_TOPOLOGY m_Topology;
+	ID3D11DeviceChild *m_Shaders[STAGE_COUNT];
+
+	uint32_t m_KnownResources[STAGE_COUNT];
+	uint32_t m_KnownSamplers[STAGE_COUNT];
+	ID3D11ShaderResourceView *m_Resources[STAGE_COUNT][TrackedResourceSlots];
+	ID3D11SamplerState *m_Samplers[STAGE_COUNT][TrackedSamplerSlots];
+};
\ No newline at end of file
@@ -23,7 +23,7 @@ uintptr_t delayedTlsBlocks[256];
 
 uintptr_t AllocateGuardedBlock()
 {
-	uintptr_t memory = (uintptr_t)VirtualAlloc(nullptr, 0x4000 + 4096 + 4096, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	uintptr_t memory = (uintptr_t)VirtualAlloc(nullptr, BSGRAPHICS_TLS_BLOCK_SIZE + 4096 + 4096, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
 	if (!memory)
 		__debugbreak();
@@ -31,7 +31,7 @@ uintptr_t AllocateGuardedBlock()
 	// Prevent bad writes to the first or last pages
 	DWORD old;
 	VirtualProtect((LPVOID)memory, 4096, PAGE_NOACCESS, &old);
-	VirtualProtect((LPVOID)(memory + 0x4000 + 4096), 4096, PAGE_NOACCESS, &old);
+	VirtualProtect((LPVOID)(memory + BSGRAPHICS_TLS_BLOCK_SIZE + 4096), 4096, PAGE_NOACCESS, &old);
 
 	return memory + 4096;
 }
@@ -183,6 +183,16 @@ void TLS_RestoreThread()
 	*(uintptr_t *)GET_TLS_BLOCK(g_TlsIndex) = GetMainTls();
 }
 
+uintptr_t TLS_SwapThreadBlock(uintptr_t Block)
+{
+	// Points the patched renderer globals for the calling thread at Block. Returns the previous block.
+	uintptr_t *currentTlsBlock = (uintptr_t *)GET_TLS_BLOCK(g_TlsIndex);
+	uintptr_t previous = *currentTlsBlock;
+
+	*currentTlsBlock = Block;
+	return previous;
+}
+
 void PageGuard_Monitor(uintptr_t VirtualAddress, size_t Size)
 {
 	g_PageGuardBase = VirtualAddress;
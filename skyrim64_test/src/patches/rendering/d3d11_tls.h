@@ -3,6 +3,7 @@
 #define BSGRAPHICS_TLS_BASE_OFFSET	0x0			// Offset into TLS data where this struct is stored
 #define BSGRAPHICS_BASE_OFFSET		0x304BEF0	// Offset from the EXE base
 #define BSGRAPHICS_PATCH_SIZE		0x2594		//0x25A0		// Size of the variable structure (block)
+#define BSGRAPHICS_TLS_BLOCK_SIZE	0x4000		// Size of each allocated per-thread block (includes variables past the patch range)
 
 #define TLS_INSTRUCTION_MEMORY_REGION_SIZE (300 * 1024)
 #define TLS_INSTRUCTION_BLOCK_SIZE 64
@@ -15,6 +16,9 @@ extern unsigned int g_TlsIndex;
 void *HACK_GetThreadedGlobals();
 void *HACK_GetMainGlobals();
 
+uintptr_t AllocateGuardedBlock();
+uintptr_t TLS_SwapThreadBlock(uintptr_t Block);
+
 void TLSPatcherInitialize();
 VOID WINAPI TLSPatcherCallback(PVOID DllHandle, DWORD Reason, PVOID Reserved);
 
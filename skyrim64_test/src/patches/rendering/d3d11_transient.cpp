@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <mutex>
+#include "../../common.h"
+#include "../TES/BSShader/BSShaderRenderTargets.h"
+#include "d3d11_proxy.h"
+#include "d3d11_transient.h"
+
+#define TRANSIENT_TARGET_PLAN_PATH "C:\\SA\\TransientTargets.txt"
+
+extern ID3D11DeviceContext2 *g_DeviceContext;
+
+namespace D3D11Transient
+{
+	// Plans only include targets seen in this many frames; rarely used targets don't have reliable lifetimes
+	const uint32_t MinObservedFrames = 60;
+	const uint32_t PlanInterval = 1000;
+
+	std::atomic_bool TrackingActive;
+
+	SRWLOCK ObjectLock = SRWLOCK_INIT;
+	std::unordered_multimap<const void *, uint32_t> ObjectTargets;
+
+	TransientTargetPool& GetPool()
+	{
+		static TransientTargetPool pool = []()
+		{
+			TransientTargetPool p(RENDER_TARGET_COUNT);
+			p.Load(TRANSIENT_TARGET_PLAN_PATH);
+
+			return p;
+		}();
+
+		return pool;
+	}
+
+	void RegisterTarget(uint32_t Target, uint64_t Key, uint64_t Bytes, bool Eligible, const void *const *Objects, uint32_t ObjectCount)
+	{
+		UnregisterTarget(Target);
+
+		AcquireSRWLockExclusive(&ObjectLock);
+		{
+			for (uint32_t i = 0; i < ObjectCount; i++)
+			{
+				if (Objects[i])
+					ObjectTargets.emplace(Objects[i], Target);
+			}
+
+			GetPool().SetTarget(Target, Key, Bytes, Eligible);
+		}
+		ReleaseSRWLockExclusive(&ObjectLock);
+	}
+
+	void UnregisterTarget(uint32_t Target)
+	{
+		AcquireSRWLockExclusive(&ObjectLock);
+		{
+			for (auto itr = ObjectTargets.begin(); itr != ObjectTargets.end();)
+			{
+				if (itr->second == Target)
+					itr = ObjectTargets.erase(itr);
+				else
+					itr++;
+			}
+
+			GetPool().RemoveTarget(Target);
+		}
+		ReleaseSRWLockExclusive(&ObjectLock);
+	}
+
+	uint32_t QAliasOf(uint32_t Target, uint64_t Key)
+	{
+		AcquireSRWLockShared(&ObjectLock);
+		uint32_t alias = GetPool().QAliasOf(Target, Key);
+		ReleaseSRWLockShared(&ObjectLock);
+
+		return alias;
+	}
+
+	template<typename T>
+	void ForEachTarget(const void *Object, T&& Callback)
+	{
+		if (!Object)
+			return;
+
+		auto range = ObjectTargets.equal_range(Object);
+
+		for (auto itr = range.first; itr != range.second; itr++)
+			Callback(itr->second);
+	}
+
+	bool IsDeferred()
+	{
+		return D3D11DeviceContextProxy::ThreadContextOverride != nullptr;
+	}
+
+	void Touch(const void *const *Objects, uint32_t Count, bool IsRead)
+	{
+		if (!Objects)
+			return;
+
+		auto& pool = GetPool();
+
+		// Deferred contexts only set atomic flags and can share the lock, everything else updates the pool
+		if (IsDeferred())
+		{
+			AcquireSRWLockShared(&ObjectLock);
+
+			for (uint32_t i = 0; i < Count; i++)
+				ForEachTarget(Objects[i], [&](uint32_t Target) { pool.MarkUnordered(Target); });
+
+			ReleaseSRWLockShared(&ObjectLock);
+			return;
+		}
+
+		AcquireSRWLockExclusive(&ObjectLock);
+
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			ForEachTarget(Objects[i], [&](uint32_t Target)
+			{
+				if (IsRead)
+					pool.Read(Target);
+				else
+					pool.Write(Target);
+			});
+		}
+
+		ReleaseSRWLockExclusive(&ObjectLock);
+	}
+
+	// Views bound on the immediate context. Render thread only.
+	const uint32_t MaxBoundSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+
+	const void *BoundViews[BIND_COUNT][MaxBoundSlots];
+	uint32_t BoundSlotEnd[BIND_COUNT];		// One past the highest slot that may be non-null
+	bool DrawRecorded;						// Bound views were recorded in this pass and haven't changed since
+	bool DispatchRecorded;
+
+	void BindViews(BindGroup Group, uint32_t StartSlot, const void *const *Views, uint32_t Count)
+	{
+		if (StartSlot >= MaxBoundSlots)
+			return;
+
+		Count = std::min(Count, MaxBoundSlots - StartSlot);
+
+		for (uint32_t i = 0; i < Count; i++)
+			BoundViews[Group][StartSlot + i] = Views ? Views[i] : nullptr;
+
+		BoundSlotEnd[Group] = std::max(BoundSlotEnd[Group], StartSlot + Count);
+		DrawRecorded = false;
+		DispatchRecorded = false;
+	}
+
+	void UnbindAll(BindGroup Group)
+	{
+		memset(BoundViews[Group], 0, BoundSlotEnd[Group] * sizeof(BoundViews[Group][0]));
+		BoundSlotEnd[Group] = 0;
+	}
+
+	void RecordBoundViews(const BindGroup *Groups, uint32_t GroupCount)
+	{
+		auto& pool = GetPool();
+
+		AcquireSRWLockExclusive(&ObjectLock);
+
+		for (uint32_t i = 0; i < GroupCount; i++)
+		{
+			BindGroup group = Groups[i];
+
+			for (uint32_t slot = 0; slot < BoundSlotEnd[group]; slot++)
+			{
+				ForEachTarget(BoundViews[group][slot], [&](uint32_t Target)
+				{
+					if (group == BIND_RTV)
+						pool.Use(Target);
+					else
+						pool.Read(Target);
+				});
+			}
+		}
+
+		ReleaseSRWLockExclusive(&ObjectLock);
+	}
+
+	template<typename T>
+	void ReleaseViews(T **Views, uint32_t Count)
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			if (Views[i])
+				Views[i]->Release();
+		}
+	}
+
+	void ReadBackBindings(ID3D11DeviceContext *Context)
+	{
+		// Get*() adds a reference to every view it returns. The context keeps its own, so only the pointers are kept.
+		ID3D11ShaderResourceView *srvs[MaxBoundSlots];
+		ID3D11UnorderedAccessView *uavs[D3D11_1_UAV_SLOT_COUNT];
+		ID3D11RenderTargetView *rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+
+		for (uint32_t group = 0; group < BIND_COUNT; group++)
+			UnbindAll((BindGroup)group);
+
+		auto readShaderResources = [&](BindGroup Group, void (STDMETHODCALLTYPE ID3D11DeviceContext::*Get)(UINT, UINT, ID3D11ShaderResourceView **))
+		{
+			(Context->*Get)(0, MaxBoundSlots, srvs);
+			BindViews(Group, 0, (const void *const *)srvs, MaxBoundSlots);
+			ReleaseViews(srvs, MaxBoundSlots);
+		};
+
+		readShaderResources(BIND_VS, &ID3D11DeviceContext::VSGetShaderResources);
+		readShaderResources(BIND_HS, &ID3D11DeviceContext::HSGetShaderResources);
+		readShaderResources(BIND_DS, &ID3D11DeviceContext::DSGetShaderResources);
+		readShaderResources(BIND_GS, &ID3D11DeviceContext::GSGetShaderResources);
+		readShaderResources(BIND_PS, &ID3D11DeviceContext::PSGetShaderResources);
+		readShaderResources(BIND_CS, &ID3D11DeviceContext::CSGetShaderResources);
+
+		Context->OMGetRenderTargetsAndUnorderedAccessViews(ARRAYSIZE(rtvs), rtvs, nullptr, 0, ARRAYSIZE(uavs), uavs);
+		BindViews(BIND_RTV, 0, (const void *const *)rtvs, ARRAYSIZE(rtvs));
+		BindViews(BIND_OM_UAV, 0, (const void *const *)uavs, ARRAYSIZE(uavs));
+		ReleaseViews(rtvs, ARRAYSIZE(rtvs));
+		ReleaseViews(uavs, ARRAYSIZE(uavs));
+
+		Context->CSGetUnorderedAccessViews(0, ARRAYSIZE(uavs), uavs);
+		BindViews(BIND_CS_UAV, 0, (const void *const *)uavs, ARRAYSIZE(uavs));
+		ReleaseViews(uavs, ARRAYSIZE(uavs));
+	}
+
+	void OnSetRenderTargets(const void *const *Views, uint32_t Count)
+	{
+		if (IsDeferred())
+		{
+			Touch(Views, Count, true);
+			return;
+		}
+
+		// Every output slot is replaced, not only the first Count
+		UnbindAll(BIND_RTV);
+		BindViews(BIND_RTV, 0, Views, Count);
+
+		AcquireSRWLockExclusive(&ObjectLock);
+		GetPool().BeginPass();
+		ReleaseSRWLockExclusive(&ObjectLock);
+	}
+
+	void OnSetShaderResources(BindGroup Group, uint32_t StartSlot, const void *const *Views, uint32_t Count)
+	{
+		if (!IsDeferred())
+			BindViews(Group, StartSlot, Views, Count);
+		else
+			Touch(Views, Count, true);
+	}
+
+	void OnSetUnorderedAccessViews(BindGroup Group, uint32_t StartSlot, const void *const *Views, uint32_t Count)
+	{
+		if (!IsDeferred())
+		{
+			// Output merger UAVs outside the given range are unbound
+			if (Group == BIND_OM_UAV)
+				UnbindAll(Group);
+
+			BindViews(Group, StartSlot, Views, Count);
+		}
+		else
+		{
+			Touch(Views, Count, true);
+		}
+	}
+
+	void OnClearState()
+	{
+		if (IsDeferred())
+			return;
+
+		for (uint32_t group = 0; group < BIND_COUNT; group++)
+			UnbindAll((BindGroup)group);
+	}
+
+	void OnDraw()
+	{
+		if (IsDeferred() || DrawRecorded)
+			return;
+
+		// UAVs can load the previous contents, so they count as reads
+		static const BindGroup groups[] = { BIND_VS, BIND_HS, BIND_DS, BIND_GS, BIND_PS, BIND_OM_UAV, BIND_RTV };
+
+		RecordBoundViews(groups, ARRAYSIZE(groups));
+		DrawRecorded = true;
+	}
+
+	void OnDispatch()
+	{
+		if (IsDeferred() || DispatchRecorded)
+			return;
+
+		static const BindGroup groups[] = { BIND_CS, BIND_CS_UAV };
+
+		RecordBoundViews(groups, ARRAYSIZE(groups));
+		DispatchRecorded = true;
+	}
+
+	void OnCopy(const void *Dest, const void *Source, bool FullCopy)
+	{
+		Touch(&Source, 1, true);
+		Touch(&Dest, 1, !FullCopy);
+	}
+
+	void OnClear(const void *View)
+	{
+		Touch(&View, 1, false);
+	}
+
+	void OnPresent(bool Track)
+	{
+		auto& pool = GetPool();
+
+		if (IsActive())
+		{
+			AcquireSRWLockExclusive(&ObjectLock);
+			{
+				pool.EndFrame();
+
+				if ((pool.QObservedFrames() % PlanInterval) == 0)
+				{
+					pool.BuildPlan(MinObservedFrames);
+					pool.Save(TRANSIENT_TARGET_PLAN_PATH);
+				}
+			}
+			ReleaseSRWLockExclusive(&ObjectLock);
+		}
+
+		if (Track && !IsActive())
+		{
+			// Observations from an earlier tracking session have gaps and can't be merged
+			AcquireSRWLockExclusive(&ObjectLock);
+			pool.ResetObservations();
+			ReleaseSRWLockExclusive(&ObjectLock);
+
+			ReadBackBindings(static_cast<D3D11DeviceContextProxy *>(g_DeviceContext)->m_Context);
+		}
+
+		// Views still bound are recorded again by the next frame's first draw
+		DrawRecorded = false;
+		DispatchRecorded = false;
+
+		TrackingActive.store(Track);
+	}
+
+	TransientTargetPool::Stats GetStats()
+	{
+		AcquireSRWLockShared(&ObjectLock);
+		auto stats = GetPool().GetStats();
+		ReleaseSRWLockShared(&ObjectLock);
+
+		return stats;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include "TransientTargetPool.h"
+
+//
+// Feeds TransientTargetPool from the device context proxy. Render targets are registered together with every D3D
+// object (texture and views) that refers to them. A new pass starts whenever the output merger targets change.
+//
+// Only a clear or a full copy starts a target's lifetime. Reads are recorded when a draw or dispatch runs with the
+// target bound as a shader resource or UAV, so a view that stays bound across several passes is read in every pass
+// that actually draws with it. Render targets bound at a draw are used (blended onto or partly covered), which extends
+// the lifetime without starting it. Bindings are only mirrored while tracking, the proxy skips every hook otherwise.
+// When tracking starts the mirror is read back from the immediate context, since views can stay bound from before.
+//
+// Calls recorded into deferred contexts execute in an order that isn't known here, so any target touched that way is
+// excluded.
+//
+namespace D3D11Transient
+{
+	enum BindGroup : uint32_t
+	{
+		BIND_VS,				// Shader resource views
+		BIND_HS,
+		BIND_DS,
+		BIND_GS,
+		BIND_PS,
+		BIND_CS,
+		BIND_OM_UAV,			// Unordered access views
+		BIND_CS_UAV,
+		BIND_RTV,
+		BIND_COUNT,
+	};
+
+	extern std::atomic_bool TrackingActive;
+
+	inline bool IsActive()
+	{
+		return TrackingActive.load(std::memory_order_relaxed);
+	}
+
+	void RegisterTarget(uint32_t Target, uint64_t Key, uint64_t Bytes, bool Eligible, const void *const *Objects, uint32_t ObjectCount);
+	void UnregisterTarget(uint32_t Target);
+	uint32_t QAliasOf(uint32_t Target, uint64_t Key);
+
+	// Only called while IsActive()
+	void OnSetRenderTargets(const void *const *Views, uint32_t Count);
+	void OnSetShaderResources(BindGroup Group, uint32_t StartSlot, const void *const *Views, uint32_t Count);
+	void OnSetUnorderedAccessViews(BindGroup Group, uint32_t StartSlot, const void *const *Views, uint32_t Count);
+	void OnClearState();
+	void OnDraw();
+	void OnDispatch();
+
+	void OnCopy(const void *Dest, const void *Source, bool FullCopy);
+	void OnClear(const void *View);
+
+	// Ends the observed frame and periodically rebuilds and saves the plan. Tracking starts or stops here so frames are
+	// never observed partially.
+	void OnPresent(bool Track);
+
+	TransientTargetPool::Stats GetStats();
+}
\ No newline at end of file
@@ -1,16 +1,251 @@
 #include "../common.h"
+#include "threadplacement.h"
 
-// Hooks that probably don't do anything
+namespace ThreadPlacement
+{
+	struct RegisteredThread
+	{
+		HANDLE Handle;
+		uint32_t ThreadId;
+		ThreadClass Class;
+		uint32_t ClassInstance;
+		std::string Name;
+	};
+
+	SRWLOCK ThreadListLock = SRWLOCK_INIT;
+	std::vector<RegisteredThread> ThreadList;
+	uint32_t ClassInstanceCounts[(uint32_t)ThreadClass::Count];
+
+	Topology SystemTopology;
+	Profile ActiveProfile = Profile::Disabled;
+	FrameStats ProfileFrameStats[(uint32_t)Profile::Count];
+
+	Topology QuerySystemTopology()
+	{
+		Topology t;
+		DWORD length = 0;
+
+		GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+
+		std::vector<uint8_t> buffer(length);
+		auto info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data();
+
+		if (length == 0 || !GetLogicalProcessorInformationEx(RelationAll, info, &length))
+			return Topology::Synthetic(std::max<DWORD>(GetActiveProcessorCount(0), 1), 1, 0, 0);
+
+		// Cores first, then map each logical processor onto its L3 cache. Only processor group 0 is handled
+		// because the game never leaves it.
+		for (DWORD offset = 0; offset < length;)
+		{
+			auto entry = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)&buffer[offset];
+			offset += entry->Size;
+
+			if (entry->Relationship != RelationProcessorCore || entry->Processor.GroupMask[0].Group != 0)
+				continue;
+
+			uint64_t mask = entry->Processor.GroupMask[0].Mask;
+			uint8_t smtIndex = 0;
+
+			for (uint32_t i = 0; i < 64; i++)
+			{
+				if (!(mask & (1ull << i)))
+					continue;
+
+				LogicalProcessor lp;
+				lp.Index = i;
+				lp.Core = t.CoreCount;
+				lp.L3Domain = 0;
+				lp.EfficiencyClass = entry->Processor.EfficiencyClass;
+				lp.SmtIndex = smtIndex++;
+
+				t.Processors.push_back(lp);
+				t.MaxEfficiencyClass = std::max(t.MaxEfficiencyClass, lp.EfficiencyClass);
+			}
+
+			t.CoreCount++;
+		}
+
+		for (DWORD offset = 0; offset < length;)
+		{
+			auto entry = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)&buffer[offset];
+			offset += entry->Size;
+
+			if (entry->Relationship != RelationCache || entry->Cache.Level != 3 || entry->Cache.GroupMask.Group != 0)
+				continue;
+
+			for (auto& lp : t.Processors)
+			{
+				if (entry->Cache.GroupMask.Mask & (1ull << lp.Index))
+					lp.L3Domain = t.L3DomainCount;
+			}
+
+			t.L3DomainCount++;
+		}
+
+		t.L3DomainCount = std::max<uint32_t>(t.L3DomainCount, 1);
+		return t;
+	}
+
+	void ApplyAssignment(const Policy& Placement, const RegisteredThread& Thread)
+	{
+		const static int priorityMap[5] =
+		{
+			THREAD_PRIORITY_LOWEST,
+			THREAD_PRIORITY_BELOW_NORMAL,
+			THREAD_PRIORITY_NORMAL,
+			THREAD_PRIORITY_ABOVE_NORMAL,
+			THREAD_PRIORITY_HIGHEST,
+		};
+
+		Assignment a = Placement.Assign(Thread.Class, Thread.ClassInstance);
+
+		// Direct kernel32 calls: only the game's imports are redirected to the hooks below
+		SetThreadAffinityMask(Thread.Handle, (DWORD_PTR)a.AffinityMask);
+		SetThreadPriority(Thread.Handle, priorityMap[std::clamp(a.Priority, -2, 2) + 2]);
+
+		if (a.IdealProcessor != -1)
+			SetThreadIdealProcessor(Thread.Handle, a.IdealProcessor);
+	}
+
+	void RemoveStaleThreads(uint32_t ThreadId)
+	{
+		// Threads that exited (including ones that never returned through the entry hooks) and earlier owners of a
+		// thread ID the OS handed out again. Caller holds ThreadListLock exclusively.
+		for (auto itr = ThreadList.begin(); itr != ThreadList.end();)
+		{
+			if (itr->ThreadId == ThreadId || WaitForSingleObject(itr->Handle, 0) == WAIT_OBJECT_0)
+			{
+				CloseHandle(itr->Handle);
+				itr = ThreadList.erase(itr);
+			}
+			else
+			{
+				itr++;
+			}
+		}
+	}
+
+	void Initialize()
+	{
+		SystemTopology = QuerySystemTopology();
+
+		ui::log::Add("Processor topology: %u logical processors, %u cores, %u L3 domains%s%s\n",
+			(uint32_t)SystemTopology.Processors.size(),
+			SystemTopology.CoreCount,
+			SystemTopology.L3DomainCount,
+			SystemTopology.HasSMT() ? ", SMT" : "",
+			SystemTopology.IsHybrid() ? ", hybrid" : "");
+
+		if (GetActiveProcessorGroupCount() > 1)
+			ui::log::Add("Processor topology: only processor group 0 (%u logical processors) is managed\n", GetActiveProcessorCount(0));
+	}
+
+	void RegisterCurrentThread(const char *Name)
+	{
+		RegisteredThread thread;
+		thread.Handle = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION | SYNCHRONIZE, FALSE, GetCurrentThreadId());
+		thread.ThreadId = GetCurrentThreadId();
+		thread.Class = ClassifyThread(Name);
+		thread.Name = Name ? Name : "";
+
+		if (!thread.Handle)
+			return;
+
+		AcquireSRWLockExclusive(&ThreadListLock);
+		{
+			RemoveStaleThreads(thread.ThreadId);
+
+			thread.ClassInstance = ClassInstanceCounts[(uint32_t)thread.Class]++;
+			ThreadList.push_back(thread);
+
+			if (ActiveProfile != Profile::Disabled)
+				ApplyAssignment(Policy(SystemTopology, ActiveProfile), thread);
+		}
+		ReleaseSRWLockExclusive(&ThreadListLock);
+	}
+
+	void UnregisterCurrentThread()
+	{
+		AcquireSRWLockExclusive(&ThreadListLock);
+		RemoveStaleThreads(GetCurrentThreadId());
+		ReleaseSRWLockExclusive(&ThreadListLock);
+	}
+
+	void SetActiveProfile(Profile Value)
+	{
+		AcquireSRWLockExclusive(&ThreadListLock);
+		{
+			if (ActiveProfile != Value)
+			{
+				ActiveProfile = Value;
+				Policy policy(SystemTopology, ActiveProfile);
+
+				for (auto& thread : ThreadList)
+					ApplyAssignment(policy, thread);
+
+				ui::log::Add("Thread placement profile set to \"%s\"\n", GetProfileName(Value));
+			}
+		}
+		ReleaseSRWLockExclusive(&ThreadListLock);
+	}
+
+	bool IsManagedThread(uint32_t ThreadId)
+	{
+		bool managed = false;
+
+		AcquireSRWLockShared(&ThreadListLock);
+		{
+			if (ActiveProfile != Profile::Disabled)
+				managed = std::any_of(ThreadList.begin(), ThreadList.end(), [ThreadId](const RegisteredThread& T) { return T.ThreadId == ThreadId; });
+		}
+		ReleaseSRWLockShared(&ThreadListLock);
+
+		return managed;
+	}
+
+	Profile GetActiveProfile()
+	{
+		return ActiveProfile;
+	}
+
+	const Topology& GetSystemTopology()
+	{
+		return SystemTopology;
+	}
+
+	void RecordFrameTime(double Milliseconds)
+	{
+		FrameStats& stats = ProfileFrameStats[(uint32_t)ActiveProfile];
+
+		stats.FrameCount++;
+		stats.TotalTime += Milliseconds;
+		stats.MaxTime = std::max(stats.MaxTime, Milliseconds);
+	}
+
+	void ResetFrameStats()
+	{
+		memset(ProfileFrameStats, 0, sizeof(ProfileFrameStats));
+	}
+
+	FrameStats GetFrameStats(Profile Value)
+	{
+		return ProfileFrameStats[(uint32_t)Value];
+	}
+}
 
 BOOL WINAPI hk_SetThreadPriority(HANDLE hThread, int nPriority)
 {
+	// Placement profiles own the priority of every thread they manage
+	if (ThreadPlacement::IsManagedThread(GetThreadId(hThread)))
+		return TRUE;
+
 	// Don't allow a priority below normal - Skyrim doesn't have many "idle" threads
 	return SetThreadPriority(hThread, std::max(THREAD_PRIORITY_NORMAL, nPriority));
 }
 
 DWORD_PTR WINAPI hk_SetThreadAffinityMask(HANDLE hThread, DWORD_PTR dwThreadAffinityMask)
 {
-	// Don't change anything
+	// Don't change anything. Placement is handled by ThreadPlacement::Policy instead.
 	return 0xFFFFFFFF;
 }
 
@@ -32,4 +267,7 @@ void PatchThreading()
 
 	SetPriorityClass(GetCurrentProcess(), ABOVE_NORMAL_PRIORITY_CLASS);
 	//timeBeginPeriod(1);
+
+	ThreadPlacement::Initialize();
+	ThreadPlacement::RegisterCurrentThread("Main Thread");
 }
\ No newline at end of file
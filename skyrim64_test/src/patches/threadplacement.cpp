@@ -0,0 +1,285 @@
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include "threadplacement.h"
+
+namespace ThreadPlacement
+{
+	uint64_t Topology::GetAllMask() const
+	{
+		uint64_t mask = 0;
+
+		for (auto& lp : Processors)
+			mask |= 1ull << lp.Index;
+
+		return mask;
+	}
+
+	uint64_t Topology::GetPerformanceMask() const
+	{
+		uint64_t mask = 0;
+
+		for (auto& lp : Processors)
+		{
+			if (lp.EfficiencyClass == MaxEfficiencyClass)
+				mask |= 1ull << lp.Index;
+		}
+
+		return mask;
+	}
+
+	uint64_t Topology::GetEfficiencyMask() const
+	{
+		return GetAllMask() & ~GetPerformanceMask();
+	}
+
+	uint64_t Topology::GetPrimaryMask() const
+	{
+		uint64_t mask = 0;
+
+		for (auto& lp : Processors)
+		{
+			if (lp.SmtIndex == 0)
+				mask |= 1ull << lp.Index;
+		}
+
+		return mask;
+	}
+
+	uint64_t Topology::GetL3DomainMask(uint32_t Domain) const
+	{
+		uint64_t mask = 0;
+
+		for (auto& lp : Processors)
+		{
+			if (lp.L3Domain == Domain)
+				mask |= 1ull << lp.Index;
+		}
+
+		return mask;
+	}
+
+	bool Topology::IsHybrid() const
+	{
+		return GetEfficiencyMask() != 0;
+	}
+
+	bool Topology::HasSMT() const
+	{
+		return GetPrimaryMask() != GetAllMask();
+	}
+
+	Topology Topology::Synthetic(uint32_t PerformanceCores, uint32_t ThreadsPerPerformanceCore, uint32_t EfficiencyCores, uint32_t CoresPerL3)
+	{
+		// Mimic Windows enumeration order: performance cores (with siblings adjacent) come first
+		Topology t;
+		uint32_t index = 0;
+
+		if (CoresPerL3 == 0)
+			CoresPerL3 = PerformanceCores + EfficiencyCores;
+
+		for (uint32_t core = 0; core < PerformanceCores + EfficiencyCores && index < 64; core++)
+		{
+			bool efficient = core >= PerformanceCores;
+			uint32_t threads = efficient ? 1 : ThreadsPerPerformanceCore;
+
+			for (uint32_t smt = 0; smt < threads && index < 64; smt++)
+			{
+				LogicalProcessor lp;
+				lp.Index = index++;
+				lp.Core = core;
+				lp.L3Domain = core / CoresPerL3;
+				lp.EfficiencyClass = (efficient || EfficiencyCores == 0) ? 0 : 1;
+				lp.SmtIndex = (uint8_t)smt;
+
+				t.Processors.push_back(lp);
+				t.L3DomainCount = std::max(t.L3DomainCount, lp.L3Domain + 1);
+				t.MaxEfficiencyClass = std::max(t.MaxEfficiencyClass, lp.EfficiencyClass);
+			}
+
+			t.CoreCount++;
+		}
+
+		return t;
+	}
+
+	Policy::Policy(const Topology& CpuTopology, Profile ActiveProfile) : m_Topology(CpuTopology), m_Profile(ActiveProfile)
+	{
+		const uint64_t all = m_Topology.GetAllMask();
+		const uint64_t efficiency = m_Topology.GetEfficiencyMask();
+		uint64_t restrictMask = all;
+
+		// Keep everything on the L3 domain that owns the first performance core
+		if (m_Profile == Profile::SingleCache)
+		{
+			for (auto& lp : m_Topology.Processors)
+			{
+				if (lp.EfficiencyClass == m_Topology.MaxEfficiencyClass)
+				{
+					restrictMask = m_Topology.GetL3DomainMask(lp.L3Domain);
+					break;
+				}
+			}
+		}
+
+		m_WorkMask = m_Topology.GetPerformanceMask() & restrictMask;
+
+		if (m_Profile == Profile::PhysicalCores)
+			m_WorkMask &= m_Topology.GetPrimaryMask();
+
+		// Background threads prefer efficiency cores, then SMT siblings (physical core profile only), then anything
+		if (efficiency & restrictMask)
+			m_BackgroundMask = efficiency & restrictMask;
+		else if (m_Profile == Profile::PhysicalCores && (restrictMask & ~m_Topology.GetPrimaryMask()))
+			m_BackgroundMask = restrictMask & ~m_Topology.GetPrimaryMask();
+		else
+			m_BackgroundMask = restrictMask;
+
+		if (!m_WorkMask)
+			m_WorkMask = restrictMask ? restrictMask : all;
+
+		if (!m_BackgroundMask)
+			m_BackgroundMask = all;
+
+		// Pick the first eligible processor on every core. Windows lists SMT siblings next to each other, so
+		// walking in order gives one processor per core.
+		std::vector<bool> coreUsed(m_Topology.CoreCount, false);
+
+		for (auto& lp : m_Topology.Processors)
+		{
+			if (!(m_WorkMask & (1ull << lp.Index)) || coreUsed[lp.Core])
+				continue;
+
+			coreUsed[lp.Core] = true;
+			m_DedicatedProcessors.push_back(lp.Index);
+		}
+	}
+
+	Assignment Policy::Assign(ThreadClass Class, uint32_t ClassInstance) const
+	{
+		Assignment a;
+		a.AffinityMask = m_Topology.GetAllMask();
+		a.IdealProcessor = -1;
+		a.Priority = 0;
+
+		if (m_Profile == Profile::Disabled || m_Topology.Processors.empty())
+			return a;
+
+		// Main and render threads get the first two cores as their ideal processors. Job workers
+		// are spread round-robin over the remaining ones so they don't stack on the same core.
+		const uint32_t dedicatedCount = (uint32_t)m_DedicatedProcessors.size();
+		const uint32_t reservedCount = dedicatedCount > 2 ? 2 : 0;
+
+		switch (Class)
+		{
+		case ThreadClass::Main:
+			a.AffinityMask = m_WorkMask;
+			a.IdealProcessor = m_DedicatedProcessors[0];
+			a.Priority = 1;
+			break;
+
+		case ThreadClass::Render:
+			a.AffinityMask = m_WorkMask;
+			a.IdealProcessor = m_DedicatedProcessors[std::min(1u, dedicatedCount - 1)];
+			a.Priority = 1;
+			break;
+
+		case ThreadClass::Job:
+			a.AffinityMask = m_WorkMask;
+			a.IdealProcessor = m_DedicatedProcessors[reservedCount + (ClassInstance % (dedicatedCount - reservedCount))];
+			break;
+
+		case ThreadClass::Audio:
+			// Audio needs consistent wakeup latency more than throughput
+			a.AffinityMask = m_WorkMask | m_BackgroundMask;
+			a.Priority = 2;
+			break;
+
+		case ThreadClass::Tasklet:
+		case ThreadClass::IO:
+			a.AffinityMask = m_BackgroundMask;
+			break;
+
+		case ThreadClass::Other:
+		default:
+			break;
+		}
+
+		return a;
+	}
+
+	ThreadClass ClassifyThread(const char *Name)
+	{
+		if (!Name)
+			return ThreadClass::Other;
+
+		char lower[256];
+		size_t i = 0;
+
+		for (; Name[i] && i < sizeof(lower) - 1; i++)
+			lower[i] = (char)tolower((unsigned char)Name[i]);
+
+		lower[i] = '\0';
+
+		// Order matters: "audio" contains "io"
+		const static struct
+		{
+			const char *Pattern;
+			ThreadClass Class;
+		} rules[] =
+		{
+			{ "main thread",	ThreadClass::Main },
+			{ "render",			ThreadClass::Render },
+			{ "d3d",			ThreadClass::Render },
+			{ "audio",			ThreadClass::Audio },
+			{ "sound",			ThreadClass::Audio },
+			{ "tasklet",		ThreadClass::Tasklet },
+			{ "job",			ThreadClass::Job },
+			{ "havok",			ThreadClass::Job },
+			{ "iomanager",		ThreadClass::IO },
+			{ "bsresource",		ThreadClass::IO },
+			{ "stream",			ThreadClass::IO },
+			{ "queuedfile",		ThreadClass::IO },
+			{ "loader",			ThreadClass::IO },
+		};
+
+		for (auto& rule : rules)
+		{
+			if (strstr(lower, rule.Pattern))
+				return rule.Class;
+		}
+
+		return ThreadClass::Other;
+	}
+
+	const char *GetThreadClassName(ThreadClass Class)
+	{
+		switch (Class)
+		{
+		case ThreadClass::Main:		return "Main";
+		case ThreadClass::Render:	return "Render";
+		case ThreadClass::Job:		return "Job";
+		case ThreadClass::Tasklet:	return "Tasklet";
+		case ThreadClass::Audio:	return "Audio";
+		case ThreadClass::IO:		return "IO";
+		case ThreadClass::Other:	return "Other";
+		default:					break;
+		}
+
+		return "Unknown";
+	}
+
+	const char *GetProfileName(Profile Value)
+	{
+		switch (Value)
+		{
+		case Profile::Disabled:			return "Disabled";
+		case Profile::Balanced:			return "Balanced";
+		case Profile::PhysicalCores:	return "Physical Cores";
+		case Profile::SingleCache:		return "Single L3 Cache";
+		default:						break;
+		}
+
+		return "Unknown";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//
+// Processor topology enumeration and thread placement policy. Everything except
+// the Register/Apply functions (threading.cpp) is platform-neutral so placement
+// decisions can be evaluated against synthetic topologies (see /threadplacement_test).
+//
+// Affinity masks are 64 bits wide and only cover processor group 0. Systems with
+// more than 64 logical processors keep the remaining groups unmanaged.
+//
+namespace ThreadPlacement
+{
+	enum class ThreadClass : uint32_t
+	{
+		Main,
+		Render,
+		Job,
+		Tasklet,
+		Audio,
+		IO,
+		Other,
+
+		Count,
+	};
+
+	enum class Profile : uint32_t
+	{
+		Disabled,		// Leave scheduling to the OS (original behavior)
+		Balanced,		// Latency-sensitive threads on performance cores, background work anywhere else
+		PhysicalCores,	// Like Balanced, but never place two engine workers on SMT siblings
+		SingleCache,	// Like Balanced, but keep everything inside one L3 domain
+
+		Count,
+	};
+
+	struct LogicalProcessor
+	{
+		uint32_t Index;				// Bit index in the affinity mask
+		uint32_t Core;				// Physical core index
+		uint32_t L3Domain;			// Shared last level cache index
+		uint8_t EfficiencyClass;	// Higher is faster (matches PROCESSOR_RELATIONSHIP::EfficiencyClass)
+		uint8_t SmtIndex;			// 0 for the first hardware thread on a core
+	};
+
+	struct Topology
+	{
+		std::vector<LogicalProcessor> Processors;
+		uint32_t CoreCount = 0;
+		uint32_t L3DomainCount = 0;
+		uint8_t MaxEfficiencyClass = 0;
+
+		uint64_t GetAllMask() const;
+		uint64_t GetPerformanceMask() const;
+		uint64_t GetEfficiencyMask() const;
+		uint64_t GetPrimaryMask() const;
+		uint64_t GetL3DomainMask(uint32_t Domain) const;
+		bool IsHybrid() const;
+		bool HasSMT() const;
+
+		static Topology Synthetic(uint32_t PerformanceCores, uint32_t ThreadsPerPerformanceCore, uint32_t EfficiencyCores, uint32_t CoresPerL3);
+	};
+
+	struct Assignment
+	{
+		uint64_t AffinityMask;	// Always non-zero
+		int32_t IdealProcessor;	// -1 if there's no preference
+		int32_t Priority;		// Relative to normal: -2 (lowest) to 2 (highest)
+	};
+
+	struct FrameStats
+	{
+		uint64_t FrameCount;
+		double TotalTime;
+		double MaxTime;
+	};
+
+	class Policy
+	{
+	private:
+		const Topology& m_Topology;
+		Profile m_Profile;
+		uint64_t m_WorkMask;						// Processors for latency-sensitive threads
+		uint64_t m_BackgroundMask;					// Processors for IO/tasklet threads
+		std::vector<uint32_t> m_DedicatedProcessors;// One processor per eligible core, best first
+
+	public:
+		Policy(const Topology& CpuTopology, Profile ActiveProfile);
+
+		Assignment Assign(ThreadClass Class, uint32_t ClassInstance) const;
+	};
+
+	ThreadClass ClassifyThread(const char *Name);
+	const char *GetThreadClassName(ThreadClass Class);
+	const char *GetProfileName(Profile Value);
+
+	// Implemented in threading.cpp
+	void Initialize();
+	void RegisterCurrentThread(const char *Name);
+	void UnregisterCurrentThread();
+	void SetActiveProfile(Profile Value);
+	bool IsManagedThread(uint32_t ThreadId);
+	Profile GetActiveProfile();
+	const Topology& GetSystemTopology();
+
+	void RecordFrameTime(double Milliseconds);
+	void ResetFrameStats();
+	FrameStats GetFrameStats(Profile Value);
+}
\ No newline at end of file
@@ -11,86 +11,6 @@ namespace Profiler
     {
         std::array<Entry, MaxEntries> GlobalCounters;
         std::unordered_map<uint32_t, Entry *> LookupMap;
-        int64_t QpcFrequency;
-		int64_t CpuFrequency;
-
-		void ReadCounters(int64_t& TSC, int64_t& QPC)
-		{
-			uint32_t unused;
-			TSC = __rdtscp(&unused);
-
-			LARGE_INTEGER p;
-			QueryPerformanceCounter(&p);
-			QPC = p.QuadPart;
-		}
-
-		void CalibrateQPC()
-		{
-			QueryPerformanceFrequency((LARGE_INTEGER *)&QpcFrequency);
-		}
-
-		void CalibrateRDTSC()
-		{
-			//
-			// Modified from: https://github.com/benvanik/xenia/issues/801#issuecomment-352202912
-			//
-
-			// Try to compute the RDTSC update frequency with the highest thread priority on a single core
-			DWORD_PTR oldAffinity = SetThreadAffinityMask(GetCurrentThread(), 1ull << GetCurrentProcessorNumber());
-			int oldPriority = GetThreadPriority(GetCurrentThread());
-
-			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
-
-			// Loop multiple times and average it. Discard any results where the interval is out of reasonable range.
-			{
-				double perfCounterFactor = 1000000.0 / (double)QpcFrequency;
-				double frequency = 0.0;
-
-				int64_t tscA;
-				int64_t pcA;
-
-				int64_t tscB;
-				int64_t pcB;
-
-				double interval;
-
-				int times = 64;
-				int retries = 10;
-
-				for (int i = 0; i < times; i++)
-				{
-					for (int j = 0; j < retries; j++)
-					{
-						ReadCounters(tscA, pcA);
-
-						do
-						{
-							ReadCounters(tscB, pcB);
-							interval = double(pcB - pcA) * perfCounterFactor;
-						} while (interval < 1000.0);
-
-						if (interval < 1001.0)
-						{
-							frequency += double(tscB - tscA) / interval;
-							break;
-						}
-					}
-				}
-
-				// Calculate average, then convert MHz to Hz
-				CpuFrequency = int64_t(ceil(frequency / double(times)));
-				CpuFrequency *= 1000000;
-			}
-
-			SetThreadPriority(GetCurrentThread(), oldPriority);
-			SetThreadAffinityMask(GetCurrentThread(), oldAffinity);
-		}
-
-		STATIC_CONSTRUCTOR(__profiler, []
-		{
-			CalibrateQPC();
-			CalibrateRDTSC();
-		});
 
         Entry *FindEntry(uint32_t CRC)
         {
@@ -140,12 +60,133 @@ namespace Profiler
 
     double GetTime(uint32_t CRC)
     {
-		return ((double)GetValue(CRC) / (double)Internal::CpuFrequency) * 1000.0;
+		return Timebase::TicksToMilliseconds(GetValue(CRC));
     }
 
 	double GetDeltaTime(uint32_t CRC)
 	{
-		return ((double)GetDeltaValue(CRC) / (double)Internal::CpuFrequency) * 1000.0;
+		return Timebase::TicksToMilliseconds(GetDeltaValue(CRC));
+	}
+
+#if SKYRIM64_USE_PROFILER_TREE
+	namespace Internal
+	{
+		thread_local ThreadTree *CurrentThreadTree;
+
+		SRWLOCK ThreadTreeListLock = SRWLOCK_INIT;
+		std::vector<ThreadTree *> ThreadTreeList;
+		std::vector<TreeFrameNode> MergedTree;
+
+		ThreadTree *RegisterThreadTree()
+		{
+			// Never freed. Trees are tiny compared to the number of threads the game creates.
+			auto tree = new ThreadTree();
+			tree->ThreadId = GetCurrentThreadId();
+			tree->Current = 0;
+			tree->Nodes[0] = { "Thread", 0, 0, 0, 0, 0, 0, 0, 0 };
+			tree->NodeCount.store(1, std::memory_order_release);
+
+			AcquireSRWLockExclusive(&ThreadTreeListLock);
+			ThreadTreeList.push_back(tree);
+			ReleaseSRWLockExclusive(&ThreadTreeListLock);
+
+			return tree;
+		}
+
+		uint32_t AddTreeNode(ThreadTree *Tree, uint32_t Parent, const char *Name)
+		{
+			uint32_t index = Tree->NodeCount.load(std::memory_order_relaxed);
+
+			if (index >= MaxTreeNodes)
+				return Parent;
+
+			Tree->Nodes[index] = { Name, Parent, 0, Tree->Nodes[Parent].FirstChild, 0, 0, 0, 0, 0 };
+			Tree->Nodes[Parent].FirstChild = index;
+
+			// Publish only after the node is fully written
+			Tree->NodeCount.store(index + 1, std::memory_order_release);
+			return index;
+		}
+
+		uint32_t FindMergedChild(uint32_t Parent, const char *Name)
+		{
+			for (uint32_t child : MergedTree[Parent].Children)
+			{
+				if (MergedTree[child].Name == Name || !strcmp(MergedTree[child].Name, Name))
+					return child;
+			}
+
+			uint32_t index = (uint32_t)MergedTree.size();
+			MergedTree.push_back({ Name, Parent, {}, 0.0, 0.0, 0 });
+			MergedTree[Parent].Children.push_back(index);
+
+			return index;
+		}
+	}
+
+	void TreeFrameEnd()
+	{
+		using namespace Internal;
+
+		// Keep the node layout between frames so the UI tree state stays stable. Only the values reset.
+		if (MergedTree.empty())
+			MergedTree.push_back({ "Frame", 0, {}, 0.0, 0.0, 0 });
+
+		for (auto& node : MergedTree)
+		{
+			node.InclusiveTime = 0.0;
+			node.ExclusiveTime = 0.0;
+			node.Calls = 0;
+		}
+
+		AcquireSRWLockShared(&ThreadTreeListLock);
+		for (ThreadTree *tree : ThreadTreeList)
+		{
+			uint32_t nodeCount = tree->NodeCount.load(std::memory_order_acquire);
+
+			// Parents always have a lower index than their children, so one pass is enough. Every
+			// thread root maps onto the merged root (index 0).
+			for (uint32_t i = 1; i < nodeCount; i++)
+			{
+				TreeNode& node = tree->Nodes[i];
+
+				if (node.MergedIndex == 0)
+					node.MergedIndex = FindMergedChild(tree->Nodes[node.Parent].MergedIndex, node.Name);
+
+				uint32_t merged = node.MergedIndex;
+
+				int64_t inclusive = node.Inclusive;
+				int64_t calls = node.Calls;
+
+				MergedTree[merged].InclusiveTime += Timebase::TicksToMilliseconds(inclusive - node.LastInclusive);
+				MergedTree[merged].Calls += calls - node.LastCalls;
+
+				node.LastInclusive = inclusive;
+				node.LastCalls = calls;
+			}
+		}
+		ReleaseSRWLockShared(&ThreadTreeListLock);
+
+		// Exclusive time is whatever the children didn't cover. Scopes still open at frame end report
+		// on the frame they close in, so clamp the occasional negative.
+		for (auto& node : MergedTree)
+		{
+			double childTime = 0.0;
+
+			for (uint32_t child : node.Children)
+				childTime += MergedTree[child].InclusiveTime;
+
+			node.ExclusiveTime = std::max(node.InclusiveTime - childTime, 0.0);
+		}
+
+		for (uint32_t child : MergedTree[0].Children)
+			MergedTree[0].InclusiveTime += MergedTree[child].InclusiveTime;
+	}
+
+	const std::vector<TreeFrameNode>& GetTreeFrame()
+	{
+		return Internal::MergedTree;
 	}
+#endif // SKYRIM64_USE_PROFILER_TREE
 }
 #endif // SKYRIM64_USE_PROFILER
\ No newline at end of file
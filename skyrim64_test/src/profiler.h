@@ -1,5 +1,9 @@
 #pragma once
 
+#if SKYRIM64_USE_PROFILER_TREE && !SKYRIM64_USE_PROFILER
+#error SKYRIM64_USE_PROFILER_TREE requires SKYRIM64_USE_PROFILER
+#endif
+
 #if !SKYRIM64_USE_PROFILER
 #define ProfileCounterInc(Name)			((void)0)
 #define ProfileCounterAdd(Name, Add)	((void)0)
@@ -9,9 +13,14 @@
 #define ProfileGetDeltaValue(Name)		(0)
 #define ProfileGetTime(Name)			(0.0)
 #define ProfileGetDeltaTime(Name)		(0.0)
+
+#define ProfileScope(Name)				((void)0)
+#define ProfileTreeFrameEnd()			((void)0)
 #else
 #include <intrin.h>
 #include <array>
+#include <atomic>
+#include <vector>
 #include <unordered_map>
 
 #define EXPAND_MACRO(x) x
@@ -26,6 +35,14 @@
 #define ProfileGetTime(Name)			Profiler::GetTime<COMPILE_TIME_CRC32_STR(Name)>()
 #define ProfileGetDeltaTime(Name)		Profiler::GetDeltaTime<COMPILE_TIME_CRC32_STR(Name)>()
 
+#if SKYRIM64_USE_PROFILER_TREE
+#define ProfileScope(Name)				Profiler::ScopedTreeNode LINEID(Name)
+#define ProfileTreeFrameEnd()			Profiler::TreeFrameEnd()
+#else
+#define ProfileScope(Name)				((void)0)
+#define ProfileTreeFrameEnd()			((void)0)
+#endif
+
 namespace Profiler
 {
 	namespace Internal
@@ -63,6 +80,64 @@ namespace Profiler
 		Internal::Entry& m_Entry = Internal::GlobalCounters[UniqueIndex];
 	};
 
+#if SKYRIM64_USE_PROFILER_TREE
+	//
+	// Attributes time to a node in the calling thread's call tree. The scope stack is implicit: each
+	// instance remembers the parent node and restores it on exit. Costs two tick reads and a short
+	// sibling walk in the common case.
+	//
+	class ScopedTreeNode
+	{
+	private:
+		ScopedTreeNode() = delete;
+		ScopedTreeNode(ScopedTreeNode&) = delete;
+
+	public:
+		__forceinline ScopedTreeNode(const char *Name)
+		{
+			m_Tree = Internal::GetThreadTree();
+			m_Parent = m_Tree->Current;
+			m_Node = Internal::FindTreeChild(m_Tree, m_Parent, Name);
+			m_Tree->Current = m_Node;
+			m_Start = Timebase::ReadTicks();
+		}
+
+		__forceinline ~ScopedTreeNode()
+		{
+			int64_t endTime = Timebase::ReadTicks();
+
+			// m_Node == m_Parent when the node pool is full
+			if (m_Node != m_Parent)
+			{
+				m_Tree->Nodes[m_Node].Inclusive += endTime - m_Start;
+				m_Tree->Nodes[m_Node].Calls++;
+			}
+
+			m_Tree->Current = m_Parent;
+		}
+
+	private:
+		Internal::ThreadTree *m_Tree;
+		uint32_t m_Parent;
+		uint32_t m_Node;
+		int64_t m_Start;
+	};
+
+	struct TreeFrameNode
+	{
+		const char *Name;
+		uint32_t Parent;
+		std::vector<uint32_t> Children;
+		double InclusiveTime;	// Milliseconds, summed over all threads
+		double ExclusiveTime;	// Milliseconds, summed over all threads
+		int64_t Calls;
+	};
+
+	// Merges every thread's tree into a single per-frame tree (node 0 is the root)
+	void TreeFrameEnd();
+	const std::vector<TreeFrameNode>& GetTreeFrame();
+#endif // SKYRIM64_USE_PROFILER_TREE
+
 	template<uint32_t UniqueIndex>
 	class ScopedTimer
 	{
@@ -74,16 +149,14 @@ namespace Profiler
 
 		__forceinline void GetTime(LARGE_INTEGER *Counter)
 		{
-#if 1
-			uint32_t temp;
-			Counter->QuadPart = __rdtscp(&temp);
-#else
-			QueryPerformanceCounter(Counter);
-#endif
+			Counter->QuadPart = Timebase::ReadTicks();
 		}
 
 	public:
 		__forceinline ScopedTimer(const char *File, const char *Function, const char *Name)
+#if SKYRIM64_USE_PROFILER_TREE
+			: m_Node(Name)
+#endif
 		{
 			if (!m_Entry.Init)
 				m_Entry = { 0, 0, File, Function, Name, true };
@@ -102,6 +175,9 @@ namespace Profiler
 	private:
 		Internal::Entry& m_Entry = Internal::GlobalCounters[UniqueIndex];
 		LARGE_INTEGER m_Start;
+#if SKYRIM64_USE_PROFILER_TREE
+		ScopedTreeNode m_Node;		// Flat timers show up in the call tree too
+#endif
 	};
 
 	int64_t GetValue(uint32_t CRC);
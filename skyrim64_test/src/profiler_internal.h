@@ -86,7 +86,63 @@ struct Entry
 constexpr int MaxEntries = 16384;
 extern std::array<Entry, MaxEntries> GlobalCounters;
 extern std::unordered_map<uint32_t, Entry *> LookupMap;
-extern int64_t CpuFrequency;
 
 #define COMPILE_TIME_CRC32_STR(x) (Profiler::Internal::XCRCCalculate<sizeof(x)-1>::crc32(x))
-#define COMPILE_TIME_CRC32_INDEX(x) (COMPILE_TIME_CRC32_STR(x) % Profiler::Internal::MaxEntries)
\ No newline at end of file
+#define COMPILE_TIME_CRC32_INDEX(x) (COMPILE_TIME_CRC32_STR(x) % Profiler::Internal::MaxEntries)
+
+#if SKYRIM64_USE_PROFILER_TREE
+//
+// Call tree for a single thread. Only the owning thread adds nodes or writes Inclusive/Calls. The frame
+// end merge reads them without locking: nodes below NodeCount never change Name/Parent, and a torn
+// timer read only skews one frame.
+//
+struct TreeNode
+{
+	const char *Name;
+	uint32_t Parent;
+	uint32_t FirstChild;	// 0 if none (node 0 is the thread root and never a child)
+	uint32_t NextSibling;
+	int64_t Inclusive;		// Ticks, owner thread only
+	int64_t Calls;			// Owner thread only
+	int64_t LastInclusive;	// Merge only
+	int64_t LastCalls;		// Merge only
+	uint32_t MergedIndex;	// Merge only, 0 until the node is first merged
+};
+
+constexpr uint32_t MaxTreeNodes = 2048;
+
+struct ThreadTree
+{
+	uint32_t ThreadId;
+	uint32_t Current;						// Innermost open scope
+	std::atomic<uint32_t> NodeCount;
+	TreeNode Nodes[MaxTreeNodes];
+};
+
+extern thread_local ThreadTree *CurrentThreadTree;
+
+ThreadTree *RegisterThreadTree();
+uint32_t AddTreeNode(ThreadTree *Tree, uint32_t Parent, const char *Name);
+
+__forceinline ThreadTree *GetThreadTree()
+{
+	if (!CurrentThreadTree)
+		CurrentThreadTree = RegisterThreadTree();
+
+	return CurrentThreadTree;
+}
+
+__forceinline uint32_t FindTreeChild(ThreadTree *Tree, uint32_t Parent, const char *Name)
+{
+	// Pointer compare only. Identical strings from different modules are combined in the merge.
+	uint32_t child = Tree->Nodes[Parent].FirstChild;
+
+	while (child != 0 && Tree->Nodes[child].Name != Name)
+		child = Tree->Nodes[child].NextSibling;
+
+	if (child == 0)
+		child = AddTreeNode(Tree, Parent, Name);
+
+	return child;
+}
+#endif // SKYRIM64_USE_PROFILER_TREE
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <cpuid.h>
+#endif
+
+#include "timebase.h"
+
+namespace Timebase
+{
+	namespace Internal
+	{
+		bool UseTSC;
+
+		// Conversion parameters are published under a sequence lock so readers never mix an old anchor
+		// with a new rate. Before Initialize() ticks are monotonic nanoseconds.
+		std::atomic<uint32_t> Sequence;
+		std::atomic<uint64_t> AnchorTicks;
+		std::atomic<uint64_t> AnchorNanoseconds;
+		std::atomic<double> NanosecondsPerTick(1.0);
+
+		std::mutex CalibrationLock;
+		bool Initialized;
+		uint64_t BaseTicks;					// First calibration sample. Later rates are measured from here.
+		uint64_t BaseNanoseconds;
+		uint64_t NextCalibration;			// Monotonic nanoseconds
+		uint64_t CalibrationInterval;
+		CalibrationStats Stats;
+
+		constexpr uint64_t InitialWindow = 10'000'000;			// 10ms busy wait at startup
+		constexpr uint64_t FirstRecalibration = 1'000'000'000;	// Then 1s, 2s, 4s, ...
+		constexpr uint64_t MaxRecalibration = 32'000'000'000;
+
+		void Sample(uint64_t& Ticks, uint64_t& Nanoseconds)
+		{
+			// Bracket the clock read with two TSC reads and keep the tightest of a few attempts, which
+			// filters out interrupts and SMIs landing in between
+			uint64_t bestWidth = UINT64_MAX;
+
+			for (int i = 0; i < 5; i++)
+			{
+				uint64_t before = __rdtsc();
+				uint64_t ns = ReadMonotonicNanoseconds();
+				uint64_t after = __rdtsc();
+
+				if (after - before < bestWidth)
+				{
+					bestWidth = after - before;
+					Ticks = before + (after - before) / 2;
+					Nanoseconds = ns;
+				}
+			}
+		}
+
+		void Publish(uint64_t Ticks, uint64_t Nanoseconds, double Frequency)
+		{
+			Sequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			AnchorTicks.store(Ticks, std::memory_order_relaxed);
+			AnchorNanoseconds.store(Nanoseconds, std::memory_order_relaxed);
+			NanosecondsPerTick.store(1e9 / Frequency, std::memory_order_relaxed);
+			Sequence.fetch_add(1, std::memory_order_release);
+
+			Stats.Frequency = Frequency;
+		}
+	}
+
+	void Initialize()
+	{
+		using namespace Internal;
+		std::lock_guard<std::mutex> lock(CalibrationLock);
+
+		if (Initialized)
+			return;
+
+		Stats.InvariantTSC = HasInvariantTSC();
+		Stats.UsingTSC = Stats.InvariantTSC;
+
+		if (Stats.UsingTSC)
+		{
+			uint64_t ticks = 0;
+			uint64_t ns = 0;
+
+			Sample(BaseTicks, BaseNanoseconds);
+
+			do
+			{
+				Sample(ticks, ns);
+			} while (ns - BaseNanoseconds < InitialWindow);
+
+			Publish(ticks, ns, (double)(ticks - BaseTicks) * 1e9 / (double)(ns - BaseNanoseconds));
+		}
+		else
+		{
+			Publish(0, 0, 1e9);
+		}
+
+		CalibrationInterval = FirstRecalibration;
+		NextCalibration = ReadMonotonicNanoseconds() + CalibrationInterval;
+
+		UseTSC = Stats.UsingTSC;
+		Initialized = true;
+	}
+
+	void Recalibrate()
+	{
+		using namespace Internal;
+		std::unique_lock<std::mutex> lock(CalibrationLock, std::try_to_lock);
+
+		if (!lock.owns_lock() || !Initialized || !UseTSC || ReadMonotonicNanoseconds() < NextCalibration)
+			return;
+
+		uint64_t ticks = 0;
+		uint64_t ns = 0;
+		Sample(ticks, ns);
+
+		// The TSC is invariant, so the rate over the whole run is the most accurate estimate. The windows
+		// grow until sampling jitter is negligible compared to their length.
+		double oldFrequency = Stats.Frequency;
+		double newFrequency = (double)(ticks - BaseTicks) * 1e9 / (double)(ns - BaseNanoseconds);
+
+		Stats.LastOffsetError = ((double)TicksToMonotonicNanoseconds(ticks) - (double)ns) / 1000.0;
+		Stats.LastDriftPPM = (newFrequency - oldFrequency) / oldFrequency * 1e6;
+		Stats.RecalibrationCount++;
+
+		Publish(ticks, ns, newFrequency);
+
+		CalibrationInterval = std::min(CalibrationInterval * 2, MaxRecalibration);
+		NextCalibration = ns + CalibrationInterval;
+	}
+
+	bool HasInvariantTSC()
+	{
+		// CPUID.80000007H:EDX[8]: the TSC runs at a constant rate in all ACPI P/C/T states and is
+		// synchronized between cores
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 0x80000000);
+
+		if ((uint32_t)regs[0] < 0x80000007)
+			return false;
+
+		__cpuid(regs, 0x80000007);
+		return (regs[3] & (1 << 8)) != 0;
+#else
+		unsigned int eax, ebx, ecx, edx;
+
+		if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+			return false;
+
+		return (edx & (1 << 8)) != 0;
+#endif
+	}
+
+	uint64_t ReadMonotonicNanoseconds()
+	{
+#if defined(_WIN32)
+		static const uint64_t frequency = []()
+		{
+			LARGE_INTEGER f;
+			QueryPerformanceFrequency(&f);
+			return (uint64_t)f.QuadPart;
+		}();
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		// Split to avoid overflowing 64 bits after a few days of uptime
+		uint64_t value = (uint64_t)counter.QuadPart;
+		return (value / frequency) * 1'000'000'000 + (value % frequency) * 1'000'000'000 / frequency;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+		return (uint64_t)ts.tv_sec * 1'000'000'000 + (uint64_t)ts.tv_nsec;
+#endif
+	}
+
+	double GetFrequency()
+	{
+		return 1e9 / Internal::NanosecondsPerTick.load(std::memory_order_relaxed);
+	}
+
+	double TicksToSeconds(int64_t Ticks)
+	{
+		return (double)Ticks * Internal::NanosecondsPerTick.load(std::memory_order_relaxed) * 1e-9;
+	}
+
+	double TicksToMilliseconds(int64_t Ticks)
+	{
+		return (double)Ticks * Internal::NanosecondsPerTick.load(std::memory_order_relaxed) * 1e-6;
+	}
+
+	double TicksToMicroseconds(int64_t Ticks)
+	{
+		return (double)Ticks * Internal::NanosecondsPerTick.load(std::memory_order_relaxed) * 1e-3;
+	}
+
+	int64_t SecondsToTicks(double Seconds)
+	{
+		return (int64_t)(Seconds * 1e9 / Internal::NanosecondsPerTick.load(std::memory_order_relaxed));
+	}
+
+	uint64_t TicksToMonotonicNanoseconds(uint64_t Ticks)
+	{
+		using namespace Internal;
+
+		uint32_t sequence;
+		uint64_t anchorTicks;
+		uint64_t anchorNanoseconds;
+		double scale;
+
+		do
+		{
+			sequence = Sequence.load(std::memory_order_acquire);
+			anchorTicks = AnchorTicks.load(std::memory_order_relaxed);
+			anchorNanoseconds = AnchorNanoseconds.load(std::memory_order_relaxed);
+			scale = NanosecondsPerTick.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((sequence & 1) || sequence != Sequence.load(std::memory_order_relaxed));
+
+		// Signed offset: readings taken just before the latest anchor are still valid
+		return anchorNanoseconds + (int64_t)((double)(int64_t)(Ticks - anchorTicks) * scale);
+	}
+
+	CalibrationStats GetCalibrationStats()
+	{
+		std::lock_guard<std::mutex> lock(Internal::CalibrationLock);
+		return Internal::Stats;
+	}
+}
\ No newline at end of file
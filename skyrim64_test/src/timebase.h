@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+//
+// Shared CPU timestamp source. Everything that timestamps with rdtsc (profiler timers, call trees, job
+// statistics) reads ticks with ReadTicks() and converts them here, so all threads agree on one
+// frequency and one origin.
+//
+// The tick rate is measured against the OS monotonic clock (QPC on Windows, CLOCK_MONOTONIC_RAW
+// elsewhere) at startup, then refined by Recalibrate() over progressively longer windows. Without an
+// invariant TSC the counter can stop or change rate between cores and power states, so ticks come
+// from the monotonic clock instead and the conversion becomes exact.
+//
+// No Windows dependencies outside timebase.cpp.
+//
+namespace Timebase
+{
+	struct CalibrationStats
+	{
+		bool InvariantTSC;
+		bool UsingTSC;				// False when ticks come from the monotonic clock
+		double Frequency;			// Ticks per second
+		double LastDriftPPM;		// Rate change applied by the last recalibration
+		double LastOffsetError;		// Microseconds the old calibration was off by at the last recalibration
+		uint64_t RecalibrationCount;
+	};
+
+	namespace Internal
+	{
+		extern bool UseTSC;
+	}
+
+	// Must be called once before any conversion. Safe to call again.
+	void Initialize();
+
+	// Cheap unless a recalibration window has elapsed. Call from a single thread, e.g. once per frame.
+	void Recalibrate();
+
+	bool HasInvariantTSC();
+	uint64_t ReadMonotonicNanoseconds();
+
+	inline uint64_t ReadTicks()
+	{
+		if (Internal::UseTSC)
+			return __rdtsc();
+
+		return ReadMonotonicNanoseconds();
+	}
+
+	double GetFrequency();
+	double TicksToSeconds(int64_t Ticks);
+	double TicksToMilliseconds(int64_t Ticks);
+	double TicksToMicroseconds(int64_t Ticks);
+	int64_t SecondsToTicks(double Seconds);
+
+	// Places an absolute tick reading on the monotonic clock's timeline (nanoseconds)
+	uint64_t TicksToMonotonicNanoseconds(uint64_t Ticks);
+
+	CalibrationStats GetCalibrationStats();
+}
\ No newline at end of file
@@ -9,10 +9,14 @@
 #include "../patches/TES/BSJobs.h"
 #include "../patches/TES/BSTaskManager.h"
 #include "../patches/TES/BSShader/BSShader.h"
+#include "../patches/TES/BSShader/Shaders/BSLightingShader.h"
 #include "../patches/TES/Setting.h"
 #include "../patches/rendering/GpuTimer.h"
 #include "../patches/TES/TESForm.h"
 #include "../patches/TES/Console.h"
+#include "../patches/threadplacement.h"
+
+extern LARGE_INTEGER g_FrameDelta;
 
 namespace ui::opt
 {
@@ -25,6 +29,18 @@ namespace ui::opt
 	bool EnableOccluderRendering = true;
 	float OccluderMaxDistance = 15000.0f;
 	float OccluderFirstLevelMinSize = 550.0f;
+	bool SortBatchedPasses = false;
+	bool ParallelCommandRecording = false;
+	bool FilterRedundantBinds = false;
+	bool InstanceStaticGeometry = false;
+	bool CachePointLightTransforms = false;
+	bool CacheBonePalettes = false;
+	bool TrackTargetLifetimes = false;
+	bool AliasTransientTargets = false;
+	bool SpecializeLightingSetup = true;
+	bool CacheStaticShadows = false;
+	float TargetFrameRate = 0.0f;
+	int MaxFramesInFlight = 0;
 }
 
 namespace ui
@@ -52,6 +68,9 @@ namespace ui
 	bool showSceneGraphReflectionsWindow;
 	bool showTaskListWindow;
 	bool showJobListWindow;
+	bool showThreadPlacementWindow;
+	bool showCallTreeWindow;
+	bool showGpuCallTreeWindow;
 
     void Initialize(HWND Wnd, ID3D11Device *Device, ID3D11DeviceContext *DeviceContext)
     {
@@ -136,6 +155,9 @@ namespace ui
 			RenderINITweaks();
 			RenderJobList();
 			RenderTaskList();
+			RenderThreadPlacement();
+			RenderCallTree();
+			RenderGpuCallTree();
 
 			if (showDemoWindow)
 				ImGui::ShowDemoWindow(&showDemoWindow);
@@ -216,6 +238,9 @@ namespace ui
 			ImGui::Separator();
 			ImGui::MenuItem("Job List", nullptr, &showJobListWindow);
 			ImGui::MenuItem("Task List", nullptr, &showTaskListWindow);
+			ImGui::MenuItem("Thread Placement", nullptr, &showThreadPlacementWindow);
+			ImGui::MenuItem("Call Tree", nullptr, &showCallTreeWindow, (SKYRIM64_USE_PROFILER && SKYRIM64_USE_PROFILER_TREE) ? true : false);
+			ImGui::MenuItem("GPU Call Tree", nullptr, &showGpuCallTreeWindow);
 			ImGui::Separator();
 			ImGui::MenuItem("Synchronization", nullptr, &showLockWindow);
 			ImGui::MenuItem("Memory", nullptr, &showMemoryWindow);
@@ -557,6 +582,24 @@ namespace ui
 
 		if (ImGui::Begin("Shader Tweaks", &showShaderTweakWindow))
 		{
+			ImGui::Checkbox("Sort batched render passes by state", &ui::opt::SortBatchedPasses);
+			ImGui::Checkbox("Record opaque groups on deferred contexts", &ui::opt::ParallelCommandRecording);
+			ImGui::Checkbox("Drop redundant D3D state binds", &ui::opt::FilterRedundantBinds);
+			ImGui::Checkbox("Instance identical static geometry", &ui::opt::InstanceStaticGeometry);
+
+			if (ui::opt::InstanceStaticGeometry && !BSLightingShader::HasInstancedShaders())
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled("(no instanced Lighting shaders, see the log)");
+			}
+
+			ImGui::Checkbox("Reuse point light transforms across passes", &ui::opt::CachePointLightTransforms);
+			ImGui::Checkbox("Reuse bone palettes across passes", &ui::opt::CacheBonePalettes);
+			ImGui::Checkbox("Track render target lifetimes", &ui::opt::TrackTargetLifetimes);
+			ImGui::Checkbox("Alias transient render targets", &ui::opt::AliasTransientTargets);
+			ImGui::Checkbox("Use specialized BSLightingShader setup functions", &ui::opt::SpecializeLightingSetup);
+			ImGui::Checkbox("Cache static shadow casters", &ui::opt::CacheStaticShadows);
+			ImGui::Spacing();
 			ImGui::Checkbox("Use original BSLightingShader::Technique", &BSShader::g_ShaderToggles[6][0]);
 			ImGui::Checkbox("Use original BSLightingShader::Material", &BSShader::g_ShaderToggles[6][1]);
 			ImGui::Checkbox("Use original BSLightingShader::Geometry", &BSShader::g_ShaderToggles[6][2]);
@@ -621,6 +664,28 @@ namespace ui
 				ImGui::EndGroupSplitter();
 			}
 
+			// Time each engine worker spent running jobs in the last frame. The rest is idle or waiting on a
+			// sync point.
+			if (ImGui::BeginGroupSplitter("Worker Utilization This Frame"))
+			{
+				LARGE_INTEGER ticksPerSecond;
+				QueryPerformanceFrequency(&ticksPerSecond);
+
+				double frameTime = 1000.0 * (double)g_FrameDelta.QuadPart / (double)ticksPerSecond.QuadPart;
+				uint32_t workerCount = std::min<uint32_t>(BSJobs::WorkerCount.load(), (uint32_t)BSJobs::Workers.size());
+
+				for (uint32_t i = 0; i < workerCount; i++)
+				{
+					auto& worker = BSJobs::Workers[i];
+					double busyTime = Timebase::TicksToMilliseconds(worker.LastBusyTicks.load());
+					double idlePercent = frameTime > 0.0 ? std::max(0.0, 100.0 - (busyTime / frameTime) * 100.0) : 0.0;
+
+					ImGui::Text("Thread %u: %.2fms busy, %.1f%% idle (%llu jobs)", worker.ThreadId, busyTime, idlePercent, worker.LastJobCount.load());
+				}
+
+				ImGui::EndGroupSplitter();
+			}
+
 			// Show history
 			if (ImGui::BeginGroupSplitter("Job Counters"))
 			{
@@ -711,6 +776,175 @@ namespace ui
 
 		ImGui::End();
 	}
+
+	void RenderThreadPlacement()
+	{
+		if (!showThreadPlacementWindow)
+			return;
+
+		if (ImGui::Begin("Thread Placement", &showThreadPlacementWindow))
+		{
+			using namespace ThreadPlacement;
+			const Topology& topology = GetSystemTopology();
+
+			if (ImGui::BeginGroupSplitter("Topology"))
+			{
+				ImGui::Text("Logical processors: %u", (uint32_t)topology.Processors.size());
+				ImGui::Text("Physical cores: %u", topology.CoreCount);
+				ImGui::Text("L3 domains: %u", topology.L3DomainCount);
+				ImGui::Text("SMT: %s", topology.HasSMT() ? "Yes" : "No");
+				ImGui::Text("Hybrid (efficiency cores): %s", topology.IsHybrid() ? "Yes" : "No");
+				ImGui::EndGroupSplitter();
+			}
+
+			if (ImGui::BeginGroupSplitter("Profile"))
+			{
+				for (uint32_t i = 0; i < (uint32_t)Profile::Count; i++)
+				{
+					if (ImGui::RadioButton(GetProfileName((Profile)i), GetActiveProfile() == (Profile)i))
+						SetActiveProfile((Profile)i);
+				}
+
+				ImGui::EndGroupSplitter();
+			}
+
+			// Frame times are only comparable when gathered in the same scene, so allow resetting them
+			if (ImGui::BeginGroupSplitter("Frame Time Per Profile"))
+			{
+				if (ImGui::Button("Reset"))
+					ResetFrameStats();
+
+				for (uint32_t i = 0; i < (uint32_t)Profile::Count; i++)
+				{
+					FrameStats stats = GetFrameStats((Profile)i);
+
+					if (stats.FrameCount > 0)
+						ImGui::Text("%s: %.3fms average, %.3fms max (%lld frames)", GetProfileName((Profile)i), stats.TotalTime / stats.FrameCount, stats.MaxTime, stats.FrameCount);
+					else
+						ImGui::Text("%s: no data", GetProfileName((Profile)i));
+				}
+
+				ImGui::EndGroupSplitter();
+			}
+		}
+
+		ImGui::End();
+	}
+
+#if SKYRIM64_USE_PROFILER && SKYRIM64_USE_PROFILER_TREE
+	void RenderCallTreeNode(const std::vector<Profiler::TreeFrameNode>& Tree, uint32_t Index)
+	{
+		auto& node = Tree[Index];
+
+		// Scopes that didn't run this frame are hidden instead of removed so the open/closed state sticks
+		if (Index != 0 && node.Calls == 0)
+			return;
+
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+
+		if (node.Children.empty())
+			flags |= ImGuiTreeNodeFlags_Leaf;
+
+		bool open = ImGui::TreeNodeEx((void *)(uintptr_t)(Index + 1), flags, "%s", node.Name);
+		ImGui::NextColumn();
+		ImGui::Text("%.3fms", node.InclusiveTime); ImGui::NextColumn();
+		ImGui::Text("%.3fms", node.ExclusiveTime); ImGui::NextColumn();
+		ImGui::Text("%lld", node.Calls); ImGui::NextColumn();
+
+		if (open)
+		{
+			for (uint32_t child : node.Children)
+				RenderCallTreeNode(Tree, child);
+
+			ImGui::TreePop();
+		}
+	}
+#endif
+
+	void RenderCallTree()
+	{
+		if (!showCallTreeWindow)
+			return;
+
+		if (ImGui::Begin("Call Tree", &showCallTreeWindow))
+		{
+#if SKYRIM64_USE_PROFILER && SKYRIM64_USE_PROFILER_TREE
+			// Times are summed over every thread, so the root can exceed the frame time
+			auto& tree = Profiler::GetTreeFrame();
+
+			if (!tree.empty())
+			{
+				ImGui::Columns(4);
+				ImGui::Text("Scope"); ImGui::NextColumn();
+				ImGui::Text("Inclusive"); ImGui::NextColumn();
+				ImGui::Text("Exclusive"); ImGui::NextColumn();
+				ImGui::Text("Calls"); ImGui::NextColumn();
+				ImGui::Separator();
+
+				RenderCallTreeNode(tree, 0);
+				ImGui::Columns(1);
+			}
+#endif
+		}
+
+		ImGui::End();
+	}
+
+	void RenderGpuCallTreeNode(const std::vector<GpuScopeProfiler::TreeNode>& Tree, uint32_t Index)
+	{
+		auto& node = Tree[Index];
+
+		if (Index != 0 && node.Calls == 0)
+			return;
+
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+
+		if (node.Children.empty())
+			flags |= ImGuiTreeNodeFlags_Leaf;
+
+		bool open = ImGui::TreeNodeEx((void *)(uintptr_t)(Index + 1), flags, "%s", node.Name);
+		ImGui::NextColumn();
+		ImGui::Text("%.3fms", node.InclusiveTime); ImGui::NextColumn();
+		ImGui::Text("%.3fms", node.ExclusiveTime); ImGui::NextColumn();
+		ImGui::Text("%u", node.Calls); ImGui::NextColumn();
+
+		if (open)
+		{
+			for (uint32_t child : node.Children)
+				RenderGpuCallTreeNode(Tree, child);
+
+			ImGui::TreePop();
+		}
+	}
+
+	void RenderGpuCallTree()
+	{
+		if (!showGpuCallTreeWindow)
+			return;
+
+		if (ImGui::Begin("GPU Call Tree", &showGpuCallTreeWindow))
+		{
+			// Scopes come from BeginEvent/EndEvent and are only recorded while this window is open
+			GpuScopeProfiler::Stats stats = g_GPUScopes.GetStats();
+			auto& tree = g_GPUScopes.GetTree();
+
+			ImGui::Text("Read back %u frames late, %u queries pooled", stats.ReadbackLatency, stats.PooledQueries);
+			ImGui::Text("%llu frames skipped, %llu disjoint, %llu scopes dropped, %llu unbalanced", stats.SkippedFrames, stats.DisjointFrames, stats.DroppedScopes, stats.UnbalancedScopes);
+			ImGui::Separator();
+
+			ImGui::Columns(4);
+			ImGui::Text("Scope"); ImGui::NextColumn();
+			ImGui::Text("Inclusive"); ImGui::NextColumn();
+			ImGui::Text("Exclusive"); ImGui::NextColumn();
+			ImGui::Text("Calls"); ImGui::NextColumn();
+			ImGui::Separator();
+
+			RenderGpuCallTreeNode(tree, 0);
+			ImGui::Columns(1);
+		}
+
+		ImGui::End();
+	}
 }
 
 namespace ui::log
@@ -13,6 +13,18 @@ namespace ui
 		extern bool EnableOccluderRendering;
 		extern float OccluderMaxDistance;
 		extern float OccluderFirstLevelMinSize;
+		extern bool SortBatchedPasses;
+		extern bool ParallelCommandRecording;
+		extern bool FilterRedundantBinds;
+		extern bool InstanceStaticGeometry;
+		extern bool CachePointLightTransforms;
+		extern bool CacheBonePalettes;
+		extern bool TrackTargetLifetimes;
+		extern bool AliasTransientTargets;
+		extern bool SpecializeLightingSetup;
+		extern bool CacheStaticShadows;
+		extern float TargetFrameRate;
+		extern int MaxFramesInFlight;
 	}
 
 	extern bool showTracyWindow;
@@ -34,6 +46,9 @@ namespace ui
 	extern bool showSceneGraphReflectionsWindow;
 	extern bool showTaskListWindow;
 	extern bool showJobListWindow;
+	extern bool showThreadPlacementWindow;
+	extern bool showCallTreeWindow;
+	extern bool showGpuCallTreeWindow;
 
 	void Initialize(HWND Wnd, ID3D11Device *Device, ID3D11DeviceContext *DeviceContext);
 	void HandleInput(HWND Wnd, UINT Msg, WPARAM wParam, LPARAM lParam);
@@ -50,6 +65,9 @@ namespace ui
 	void RenderINITweaks();
 	void RenderJobList();
 	void RenderTaskList();
+	void RenderThreadPlacement();
+	void RenderCallTree();
+	void RenderGpuCallTree();
 
 	namespace log
 	{
@@ -2,7 +2,17 @@
 #include "../patches/dinput8.h"
 #include "../patches/TES/Setting.h"
 #include "../patches/rendering/GpuTimer.h"
+#include "../patches/rendering/d3d11_deferred.h"
+#include "../patches/rendering/d3d11_capture.h"
+#include "../patches/rendering/d3d11_transient.h"
+#include "../patches/rendering/d3d11_pacing.h"
+#include "../patches/rendering/d3d11_shadowcache.h"
+#include "../patches/threadplacement.h"
+#include "../patches/TES/BSGraphics/BSGraphicsRenderer.h"
+#include "../patches/TES/BSBatchRenderer.h"
 #include "../patches/TES/BSShader/BSShaderRenderTargets.h"
+#include "../patches/TES/BSShader/BSShaderAccumulator.h"
+#include "../patches/TES/BSShader/Shaders/BSLightingShader.h"
 #include "../patches/TES/NiMain/NiNode.h"
 #include "imgui_ext.h"
 #include "ui.h"
@@ -46,6 +56,7 @@ namespace ui
 			ui::log::Add("FRAME HITCH WARNING (%g ms)\n", frameTimeMs);
 
 		LastFpsCount = detail::CalculateTrueAverageFPS();
+		ThreadPlacement::RecordFrameTime(frameTimeMs);
 
 		if (!showFrameStatsWindow)
 			return;
@@ -111,12 +122,175 @@ namespace ui
 			ImGui::Text("FPS: %.2f", LastFpsCount);
 			ImGui::Spacing();
 			ImGui::Text("CB Bytes Requested: %s", ImGui::CommaFormat(ProfileGetDeltaValue("CB Bytes Requested")));
+			ImGui::Text("CB Bytes Uploaded: %s", ImGui::CommaFormat(ProfileGetDeltaValue("CB Bytes Uploaded")));
 			ImGui::Text("CB Bytes Wasted: %s", ImGui::CommaFormat(ProfileGetDeltaValue("CB Bytes Wasted")));
+			ImGui::Text("CB Redundant Uploads: %s", ImGui::CommaFormat(ProfileGetDeltaValue("CB Redundant Uploads")));
+			ImGui::Text("Ring Chunks Allocated: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Ring Chunks Allocated")));
+			ImGui::Text("Ring Bytes Wasted: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Ring Bytes Wasted")));
 			ImGui::Text("VIB Bytes Requested: %s", ImGui::CommaFormat(ProfileGetDeltaValue("VIB Bytes Requested")));
+			ImGui::Text("Batch Technique Changes: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Batch Technique Changes")));
+			ImGui::Text("Batch Material Changes: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Batch Material Changes")));
+			ImGui::Text("State Calls Issued: %s", ImGui::CommaFormat(ProfileGetDeltaValue("State Calls Issued")));
+			ImGui::Text("State Calls Suppressed: %s", ImGui::CommaFormat(ProfileGetDeltaValue("State Calls Suppressed")));
+			ImGui::Text("Instanced Draws: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Instanced Draws")));
+			ImGui::Text("Instanced Passes: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Instanced Passes")));
+			ImGui::Text("Point Light Cache Hits: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Point Light Cache Hits")));
+			ImGui::Text("Bone Palette Cache Hits: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Bone Palette Cache Hits")));
+			ImGui::Text("Pass Node Local Frees: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Pass Node Local Frees")));
+			ImGui::Text("Pass Node Pool Returns: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Pass Node Pool Returns")));
+			ImGui::Text("Lighting Setup Fallbacks: %s", ImGui::CommaFormat(ProfileGetDeltaValue("Lighting Setup Fallbacks")));
 
 			ProfileGetValue("CB Bytes Requested");
 			ProfileGetValue("VIB Bytes Requested");
 			ProfileGetValue("CB Bytes Wasted");
+			ProfileGetValue("CB Bytes Uploaded");
+			ProfileGetValue("CB Redundant Uploads");
+			ProfileGetValue("Ring Chunks Allocated");
+			ProfileGetValue("Ring Bytes Wasted");
+			ProfileGetValue("Batch Technique Changes");
+			ProfileGetValue("Batch Material Changes");
+			ProfileGetValue("State Calls Issued");
+			ProfileGetValue("State Calls Suppressed");
+			ProfileGetValue("Instanced Draws");
+			ProfileGetValue("Instanced Passes");
+			ProfileGetValue("Point Light Cache Hits");
+			ProfileGetValue("Bone Palette Cache Hits");
+			ProfileGetValue("Pass Node Local Frees");
+			ProfileGetValue("Pass Node Pool Returns");
+			ProfileGetValue("Lighting Setup Fallbacks");
+
+			// Every CPU timer converts through the shared timebase, so drift here affects all of them equally
+			Timebase::CalibrationStats timebase = Timebase::GetCalibrationStats();
+
+			ImGui::Spacing();
+			ImGui::Text("Timebase: %s at %.3f MHz%s", timebase.UsingTSC ? "RDTSC" : "QPC", timebase.Frequency / 1000000.0, timebase.InvariantTSC ? " (invariant)" : "");
+			ImGui::Text("Timebase drift: %.3f ppm, %.3f us offset (%llu recalibrations)", timebase.LastDriftPPM, timebase.LastOffsetError, timebase.RecalibrationCount);
+
+			// Present() pacing, tuned offline with pacing_simulator
+			auto drawHistogram = [](const char *Label, const FrameTimeHistogram& Histogram)
+			{
+				ImGui::Text("%s: mean %.2f ms, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.2f ms", Label, Histogram.QMean(), Histogram.QPercentile(0.50), Histogram.QPercentile(0.95), Histogram.QPercentile(0.99), Histogram.QMax());
+				ImGui::PlotHistogram("##histogram", [](void *Data, int Index) { return (float)((const uint32_t *)Data)[Index]; }, (void *)Histogram.QBuckets(), FrameTimeHistogram::BucketCount, 0, nullptr, 0.0f, FLT_MAX, ImVec2(400, 60));
+			};
+
+			FramePacer::Stats pacing = D3D11Pacing::GetStats();
+
+			ImGui::Spacing();
+			ImGui::PushItemWidth(100);
+			ImGui::DragFloat("Target frame rate (0 = unlimited)", &ui::opt::TargetFrameRate, 0.5f, 0.0f, 500.0f, "%.1f");
+			ImGui::SliderInt("Max frames in flight (0 = driver default)", &ui::opt::MaxFramesInFlight, 0, D3D11Pacing::MaxQueries);
+			ImGui::PopItemWidth();
+
+			ui::opt::TargetFrameRate = std::clamp(ui::opt::TargetFrameRate, 0.0f, 500.0f);
+			ui::opt::MaxFramesInFlight = std::clamp(ui::opt::MaxFramesInFlight, 0, (int)D3D11Pacing::MaxQueries);
+
+			ImGui::Text("Pacing: %.3f ms waited, %.3f ms spin margin, %llu missed deadlines, %llu resyncs", pacing.LastWait, pacing.SpinMargin, pacing.MissedDeadlines, pacing.Resyncs);
+
+			ImGui::PushID("frametimes");
+			drawHistogram("Frame time", D3D11Pacing::QFrameTimes());
+			ImGui::PopID();
+			ImGui::PushID("latency");
+			drawHistogram("Present to GPU done", D3D11Pacing::QLatencies());
+			ImGui::PopID();
+
+			if (ImGui::Button("Reset histograms"))
+				D3D11Pacing::ResetHistograms();
+
+			DynamicBufferRing::Stats dynamicBuffers = BSGraphics::Renderer::QInstance()->GetDynamicVertexBufferStats();
+
+			ImGui::Spacing();
+			ImGui::Text("Dynamic VB ring: %u x %u KB (%llu resizes, %llu while recording)", dynamicBuffers.BufferCount, dynamicBuffers.BufferSize / 1024, dynamicBuffers.ResizeCount, dynamicBuffers.DeferredGrowths);
+			ImGui::Text("Dynamic VB usage: %u KB, %u KB peak", dynamicBuffers.FrameBytes / 1024, dynamicBuffers.PeakFrameBytes / 1024);
+			ImGui::Text("Dynamic VB stalls: %u, %.3f ms (%llu total)", dynamicBuffers.FrameStalls, dynamicBuffers.FrameStallTime, dynamicBuffers.TotalStalls);
+
+			ShaderCache::Stats shaderCache = BSGraphics::Renderer::GetShaderCache().GetStats();
+
+			ImGui::Text("Shader cache: %llu memory hits, %llu disk hits, %llu compiled, %llu failed", shaderCache.MemoryHits, shaderCache.DiskHits, shaderCache.Compiles, shaderCache.Failures);
+
+			ShaderBytecodeRegistry::Stats bytecode = BSGraphics::Renderer::QInstance()->GetShaderBytecodeStats();
+
+			ImGui::Text("Shader bytecode: %u shaders, %u unique, %llu KB stored (%llu KB registered)", bytecode.Shaders, bytecode.UniqueBlobs, bytecode.BytesStored / 1024, bytecode.BytesRegistered / 1024);
+
+			TransientTargetPool::Stats transient = D3D11Transient::GetStats();
+
+			ImGui::Text("Render targets: %llu MB in %u targets, %u frames of lifetimes observed", transient.TotalBytes >> 20, transient.Targets, transient.ObservedFrames);
+			if (transient.PlanActive)
+				ImGui::Text("Transient targets: %u in %u slots, %llu MB -> %llu MB (%llu MB saved%s)", transient.TransientTargets, transient.Slots, transient.TransientBytes >> 20, transient.PooledBytes >> 20, (transient.TransientBytes - transient.PooledBytes) >> 20, ui::opt::AliasTransientTargets ? "" : " when aliased");
+			else
+				ImGui::Text("Transient targets: no plan for the current targets yet");
+
+			BSShaderAccumulator::RegistrationStats registration = BSShaderAccumulator::GetRegistrationStats();
+
+			ImGui::Text("Main pass registration: %u objects, %u registered", registration.Objects, registration.Registered);
+			ImGui::Text("Object registration time: %.3f ms checks + %.3f ms registering = %.3f ms", registration.FilterTime, registration.RegisterTime, registration.FilterTime + registration.RegisterTime);
+
+			// Only the checks could be moved to workers while the registration functions are engine code
+			if (registration.FilterTime + registration.RegisterTime > 0.0)
+				ImGui::Text("Parallelizable registration work: %.1f%%", 100.0 * registration.FilterTime / (registration.FilterTime + registration.RegisterTime));
+
+			// The written list is the most used recorded keys, with counts accumulated over every write to the same file;
+			// copy it over BSLightingShaderTechniques.inl and rebuild
+			BSLightingShader::SetupStats lightingSetup = BSLightingShader::GetSetupStats();
+
+			ImGui::Text("Lighting setup: %u specialized keys, %u keys used, %u without a specialization", lightingSetup.SpecializedKeys, lightingSetup.RecordedKeys, lightingSetup.FallbackKeys);
+
+			if (ImGui::Button("Write lighting setup specializations"))
+			{
+				if (BSLightingShader::WriteSetupSpecializations("BSLightingShaderTechniques.inl"))
+					ui::log::Add("Lighting setup specializations written to BSLightingShaderTechniques.inl\n");
+				else
+					ui::log::Add("Unable to open BSLightingShaderTechniques.inl for writing\n");
+			}
+
+			if (ui::opt::CacheStaticShadows)
+			{
+				ShadowCache::Stats shadowCache = D3D11ShadowCache::GetStats();
+
+				ImGui::Text("Shadow cache: %u reused, %u rebuilt, %u rendered, %u/%u slots (%u evicted)", shadowCache.Reused, shadowCache.Rebuilt, shadowCache.Rendered, shadowCache.ActiveSlots, D3D11ShadowCache::MaxSlots, shadowCache.Evicted);
+				ImGui::Text("Shadow cache: %llu static casters skipped", shadowCache.StaticCastersSkipped);
+			}
+
+			if (ui::opt::ParallelCommandRecording)
+			{
+				DC_Stats recording = DC_GetStats();
+
+				ImGui::Spacing();
+				ImGui::Text("Deferred recording: %.3f ms serial, %.3f ms parallel, %.3f ms saved", recording.SerialTime, recording.ParallelTime, recording.SavedTime);
+
+				for (uint32_t i = 0; i < recording.TaskCount; i++)
+					ImGui::BulletText("%s: %.3f ms (thread %u)", recording.TaskNames[i], recording.TaskRecordTime[i], recording.TaskThreadIds[i]);
+			}
+
+			// Command stream capture, read with capture_analyzer
+			static int captureFrameCount = 1;
+			D3D11Capture::Status capture = D3D11Capture::GetStatus();
+
+			ImGui::Spacing();
+			ImGui::PushItemWidth(100);
+			ImGui::InputInt("##captureframes", &captureFrameCount);
+			ImGui::PopItemWidth();
+			ImGui::SameLine();
+
+			captureFrameCount = std::clamp(captureFrameCount, 1, 100);
+
+			if (capture.Active)
+				ImGui::Text("Capturing: %u frames left, %u records, %s bytes", capture.FramesRemaining, capture.RecordCount, ImGui::CommaFormat(capture.ByteCount));
+			else if (capture.FramesRemaining > 0)
+				ImGui::Text("Capture starts next frame");
+			else if (ImGui::Button("Capture D3D11 frames"))
+				D3D11Capture::RequestFrames(captureFrameCount);
+
+			if (capture.LastFile[0] != '\0')
+				ImGui::Text("Last capture: %s", capture.LastFile);
+
+			// Pass state of the sorted batch lists, read with passkey_analyzer
+			if (BSBatchRenderer::PassKeyCapture.IsActive())
+				ImGui::Text("Capturing pass keys");
+			else if (ImGui::Button("Capture pass keys"))
+				BSBatchRenderer::PassKeyCapture.RequestFrames(captureFrameCount);
+
+			if (BSBatchRenderer::LastPassKeyCaptureFile[0] != '\0')
+				ImGui::Text("Last pass keys: %s", BSBatchRenderer::LastPassKeyCaptureFile);
 		}
 		ImGui::End();
 	}
@@ -0,0 +1,214 @@
+//
+// Checks the bone palette cache used by BSShader::SetBoneMatrix: a palette is only reused for the same skin instance,
+// constant buffer generation, transform and PosAdjust, bit for bit, and colliding skin instances replace each other.
+// A random run compares it against a map of everything stored. Only depends on the standard library so cache changes
+// can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o bonepalettecache_test bonepalettecache_test.cpp ../../skyrim64_test/src/patches/rendering/BonePaletteCache.cpp
+//   cl /std:c++17 /O2 /EHsc bonepalettecache_test.cpp ../../skyrim64_test/src/patches/rendering/BonePaletteCache.cpp
+//
+// Usage: bonepalettecache_test [--lookups N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/BonePaletteCache.h"
+#include "../check.h"
+
+using PaletteKey = BonePaletteCache::PaletteKey;
+
+struct KeyInputs
+{
+	uintptr_t SkinInstance;
+	uint32_t Generation;
+	bool HasTransform;
+	float Transform[13];
+	float PosAdjust[3];
+	float PreviousPosAdjust[3];
+
+	PaletteKey Make() const
+	{
+		return PaletteKey((const void *)SkinInstance, Generation, HasTransform ? Transform : nullptr, PosAdjust, PreviousPosAdjust);
+	}
+};
+
+KeyInputs DefaultInputs(uintptr_t SkinInstance)
+{
+	KeyInputs inputs = {};
+	inputs.SkinInstance = SkinInstance;
+	inputs.Generation = 7;
+	inputs.HasTransform = true;
+
+	for (int i = 0; i < 13; i++)
+		inputs.Transform[i] = (float)i * 0.5f;
+
+	inputs.PosAdjust[0] = 100.0f;
+	inputs.PreviousPosAdjust[0] = 99.0f;
+	return inputs;
+}
+
+void TestKeys()
+{
+	BonePaletteCache cache(64);
+	KeyInputs inputs = DefaultInputs(0x10000);
+	uint32_t slot;
+
+	CHECK(!cache.Lookup(inputs.Make(), slot));
+	cache.Store(slot, inputs.Make());
+	CHECK(cache.Lookup(inputs.Make(), slot));
+
+	uint32_t storedSlot = slot;
+
+	// Every part of the key has to match
+	auto missesWith = [&](auto Modify)
+	{
+		KeyInputs changed = inputs;
+		Modify(changed);
+
+		uint32_t s;
+		bool hit = cache.Lookup(changed.Make(), s);
+		return !hit && s == cache.QSlot((const void *)changed.SkinInstance);
+	};
+
+	CHECK(missesWith([](KeyInputs& K) { K.SkinInstance += 64 * 16; }));
+	CHECK(missesWith([](KeyInputs& K) { K.Generation++; }));
+	CHECK(missesWith([](KeyInputs& K) { K.HasTransform = false; }));
+	CHECK(missesWith([](KeyInputs& K) { K.Transform[12] = 2.0f; }));
+	CHECK(missesWith([](KeyInputs& K) { K.Transform[0] = -0.0f; }));
+	CHECK(missesWith([](KeyInputs& K) { K.PosAdjust[2] = 1.0f; }));
+	CHECK(missesWith([](KeyInputs& K) { K.PreviousPosAdjust[1] = 1.0f; }));
+
+	// Without a transform its contents don't matter
+	KeyInputs noTransform = inputs;
+	noTransform.HasTransform = false;
+	cache.Store(storedSlot, noTransform.Make());
+
+	noTransform.Transform[3] = 42.0f;
+	CHECK(cache.Lookup(noTransform.Make(), slot));
+	CHECK(!cache.Lookup(inputs.Make(), slot));
+
+	cache.Clear();
+	CHECK(!cache.Lookup(noTransform.Make(), slot));
+}
+
+void TestCollisions()
+{
+	BonePaletteCache cache(16);
+	KeyInputs a = DefaultInputs(0x1000);
+	KeyInputs b = DefaultInputs(0x1000 + 16 * 16);
+	KeyInputs c = DefaultInputs(0x1010);
+	uint32_t slotA, slotB, slotC;
+
+	CHECK(cache.QSlot((const void *)a.SkinInstance) == cache.QSlot((const void *)b.SkinInstance));
+	CHECK(cache.QSlot((const void *)a.SkinInstance) != cache.QSlot((const void *)c.SkinInstance));
+
+	cache.Lookup(a.Make(), slotA);
+	cache.Store(slotA, a.Make());
+	cache.Lookup(c.Make(), slotC);
+	cache.Store(slotC, c.Make());
+
+	CHECK(!cache.Lookup(b.Make(), slotB));
+	CHECK(slotB == slotA);
+	cache.Store(slotB, b.Make());
+
+	CHECK(cache.Lookup(b.Make(), slotB));
+	CHECK(!cache.Lookup(a.Make(), slotA));
+	CHECK(cache.Lookup(c.Make(), slotC));
+}
+
+void TestRandom(uint32_t Lookups, uint64_t Seed)
+{
+	// Small value ranges so hits, collisions and near misses are all common
+	const uint32_t slotCount = 32;
+	BonePaletteCache cache(slotCount);
+	std::mt19937_64 random(Seed);
+
+	// Reference: what each slot was last stored with
+	std::map<uint32_t, std::vector<uint8_t>> stored;
+	uint32_t hits = 0;
+
+	auto keyBytes = [](const KeyInputs& K)
+	{
+		// Only the parts that matter, so a transform is ignored when there is none
+		std::vector<uint8_t> bytes((const uint8_t *)&K.SkinInstance, (const uint8_t *)&K.SkinInstance + sizeof(K.SkinInstance));
+		bytes.insert(bytes.end(), (const uint8_t *)&K.Generation, (const uint8_t *)&K.Generation + sizeof(K.Generation));
+		bytes.push_back(K.HasTransform);
+
+		if (K.HasTransform)
+			bytes.insert(bytes.end(), (const uint8_t *)K.Transform, (const uint8_t *)K.Transform + sizeof(K.Transform));
+
+		bytes.insert(bytes.end(), (const uint8_t *)K.PosAdjust, (const uint8_t *)K.PosAdjust + sizeof(K.PosAdjust));
+		bytes.insert(bytes.end(), (const uint8_t *)K.PreviousPosAdjust, (const uint8_t *)K.PreviousPosAdjust + sizeof(K.PreviousPosAdjust));
+		return bytes;
+	};
+
+	for (uint32_t i = 0; i < Lookups; i++)
+	{
+		KeyInputs inputs = DefaultInputs(0x100000 + (random() % 40) * 16);
+		inputs.Generation = (uint32_t)(random() % 2);
+		inputs.HasTransform = (random() % 4) != 0;
+
+		if ((random() % 8) == 0)
+			inputs.Transform[random() % 13] = -0.0f;
+
+		if ((random() % 8) == 0)
+			inputs.PosAdjust[random() % 3] = 1.0f;
+
+		if ((random() % 8) == 0)
+			inputs.PreviousPosAdjust[random() % 3] = 1.0f;
+
+		uint32_t slot;
+		bool hit = cache.Lookup(inputs.Make(), slot);
+		auto bytes = keyBytes(inputs);
+		auto itr = stored.find(slot);
+		bool expected = itr != stored.end() && itr->second == bytes;
+
+		CHECK(slot < slotCount);
+		CHECK(hit == expected);
+
+		if (hit)
+		{
+			hits++;
+			continue;
+		}
+
+		cache.Store(slot, inputs.Make());
+		stored[slot] = bytes;
+
+		if ((random() % 1000) == 0)
+		{
+			cache.Clear();
+			stored.clear();
+		}
+	}
+
+	printf("random: %u lookups, %u hits\n", Lookups, hits);
+	CHECK(hits > 0 && hits < Lookups);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t lookups = 200000;
+	uint64_t seed = 1234;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--lookups") && i + 1 < argc)
+			lookups = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestKeys();
+	TestCollisions();
+	TestRandom(lookups, seed);
+
+	return CheckSummary();
+}
\ No newline at end of file
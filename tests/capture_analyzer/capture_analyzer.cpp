@@ -0,0 +1,585 @@
+//
+// Reads D3D11 command stream captures written by skyrim64_test (Frame Statistics -> "Capture D3D11 frames") and prints
+// call statistics. Only depends on the standard library so captures can be evaluated on any platform:
+//
+//   g++ -std=c++17 -O2 -o capture_analyzer capture_analyzer.cpp
+//   cl /std:c++17 /O2 /EHsc capture_analyzer.cpp
+//
+// Usage: capture_analyzer <capture.bin> [--depth N]
+//
+// Redundant binds are detected the same way the D3D11 state cache in the proxy does it: a set call is redundant when
+// every value it sets is already bound on that context. State is forgotten on ClearState/command list boundaries, and
+// shader resource bindings are forgotten whenever output bindings change.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "../../skyrim64_test/src/patches/rendering/d3d11_capture_format.h"
+
+using namespace D3D11Capture;
+
+struct PassStats
+{
+	uint64_t Draws = 0;
+	uint64_t Instances = 0;
+	uint64_t Dispatches = 0;
+	uint64_t StateCalls = 0;
+	uint64_t RedundantCalls = 0;
+	uint64_t RedundantSlots = 0;
+	uint64_t BytesUploaded = 0;
+	uint64_t Maps = 0;
+	uint64_t Clears = 0;
+	uint64_t Copies = 0;
+
+	void Add(const PassStats& Other)
+	{
+		Draws += Other.Draws;
+		Instances += Other.Instances;
+		Dispatches += Other.Dispatches;
+		StateCalls += Other.StateCalls;
+		RedundantCalls += Other.RedundantCalls;
+		RedundantSlots += Other.RedundantSlots;
+		BytesUploaded += Other.BytesUploaded;
+		Maps += Other.Maps;
+		Clears += Other.Clears;
+		Copies += Other.Copies;
+	}
+};
+
+// Keys into ContextState::Bound
+enum BindingType : uint64_t
+{
+	BIND_SHADER,
+	BIND_SHADER_RESOURCE,
+	BIND_SAMPLER,
+	BIND_CONSTANT_BUFFER,
+	BIND_UNORDERED_ACCESS_VIEW,
+	BIND_INPUT_LAYOUT,
+	BIND_VERTEX_BUFFER,
+	BIND_INDEX_BUFFER,
+	BIND_TOPOLOGY,
+	BIND_RENDER_TARGETS,
+	BIND_BLEND,
+	BIND_DEPTH_STENCIL,
+	BIND_RASTERIZER,
+	BIND_VIEWPORTS,
+	BIND_SCISSOR_RECTS,
+};
+
+uint64_t BindingKey(BindingType Type, uint32_t Stage = 0, uint32_t Slot = 0)
+{
+	return ((uint64_t)Type << 40) | ((uint64_t)Stage << 32) | Slot;
+}
+
+uint64_t HashValues(const uint32_t *Values, uint32_t Count)
+{
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		for (int b = 0; b < 4; b++)
+		{
+			hash ^= (Values[i] >> (b * 8)) & 0xFF;
+			hash *= 0x100000001B3ull;
+		}
+	}
+
+	return hash ^ Count;
+}
+
+struct ContextState
+{
+	std::unordered_map<uint64_t, uint64_t> Bound;
+	std::vector<uint32_t> EventStack;
+
+	// Returns true if the value was already bound
+	bool Bind(uint64_t Key, uint64_t Value)
+	{
+		auto [itr, inserted] = Bound.try_emplace(Key, Value);
+
+		if (inserted)
+			return false;
+
+		if (itr->second == Value)
+			return true;
+
+		itr->second = Value;
+		return false;
+	}
+
+	void ForgetShaderResources()
+	{
+		for (auto itr = Bound.begin(); itr != Bound.end();)
+		{
+			if ((itr->first >> 40) == BIND_SHADER_RESOURCE)
+				itr = Bound.erase(itr);
+			else
+				itr++;
+		}
+	}
+};
+
+class Analyzer
+{
+public:
+	Analyzer(uint32_t MaxDepth) : m_MaxDepth(MaxDepth)
+	{
+	}
+
+	bool Run(const std::vector<uint8_t>& Data)
+	{
+		if (Data.size() < sizeof(FileHeader))
+		{
+			fprintf(stderr, "File is too small to be a capture\n");
+			return false;
+		}
+
+		memcpy(&m_Header, Data.data(), sizeof(FileHeader));
+
+		if (m_Header.Magic != FileMagic || m_Header.Version != FileVersion)
+		{
+			fprintf(stderr, "Not a capture file or unsupported version (magic 0x%08X, version %u)\n", m_Header.Magic, m_Header.Version);
+			return false;
+		}
+
+		size_t offset = sizeof(FileHeader);
+		std::vector<uint32_t> args;
+
+		while (offset + sizeof(RecordHeader) <= Data.size())
+		{
+			RecordHeader record;
+			memcpy(&record, &Data[offset], sizeof(record));
+			offset += sizeof(record);
+
+			if (offset + record.ArgCount * sizeof(uint32_t) > Data.size())
+			{
+				fprintf(stderr, "Truncated record at offset %zu\n", offset - sizeof(record));
+				return false;
+			}
+
+			args.resize(record.ArgCount);
+
+			if (record.ArgCount > 0)
+				memcpy(args.data(), &Data[offset], record.ArgCount * sizeof(uint32_t));
+
+			offset += record.ArgCount * sizeof(uint32_t);
+
+			if (!Process(record, args))
+			{
+				fprintf(stderr, "Malformed record (call %u, %u arguments)\n", record.Call, record.ArgCount);
+				return false;
+			}
+
+			m_RecordCount++;
+		}
+
+		return true;
+	}
+
+	void Print() const
+	{
+		uint32_t frames = std::max<uint32_t>(m_Header.FrameCount, 1);
+
+		PassStats total;
+		for (auto& [name, stats] : m_Passes)
+			total.Add(stats);
+
+		printf("Frames:            %u\n", m_Header.FrameCount);
+		printf("Records:           %llu\n", (unsigned long long)m_RecordCount);
+		printf("Contexts:          %zu\n", m_Contexts.size());
+		printf("\n");
+		printf("%-28s %14s %14s\n", "", "Total", "Per frame");
+		PrintTotal("Draws", total.Draws, frames);
+		PrintTotal("Instances", total.Instances, frames);
+		PrintTotal("Dispatches", total.Dispatches, frames);
+		PrintTotal("State calls", total.StateCalls, frames);
+		PrintTotal("Redundant state calls", total.RedundantCalls, frames);
+		PrintTotal("Redundant slots", total.RedundantSlots, frames);
+		PrintTotal("Bytes uploaded", total.BytesUploaded, frames);
+		PrintTotal("Maps", total.Maps, frames);
+		PrintTotal("Clears", total.Clears, frames);
+		PrintTotal("Copies", total.Copies, frames);
+
+		if (total.StateCalls > 0)
+			printf("\n%.1f%% of state calls are redundant\n", total.RedundantCalls * 100.0 / total.StateCalls);
+
+		printf("\nCalls by type:\n");
+
+		for (uint32_t i = 0; i < CALL_COUNT; i++)
+		{
+			if (m_CallCounts[i] > 0)
+				printf("  %-34s %12llu\n", CallName(i), (unsigned long long)m_CallCounts[i]);
+		}
+
+		// Passes with the most draws first
+		std::vector<std::pair<std::string, PassStats>> passes(m_Passes.begin(), m_Passes.end());
+
+		std::sort(passes.begin(), passes.end(), [](const auto& A, const auto& B)
+		{
+			if (A.second.Draws != B.second.Draws)
+				return A.second.Draws > B.second.Draws;
+
+			return A.first < B.first;
+		});
+
+		printf("\nPer pass (averaged over %u frames):\n", frames);
+		printf("  %10s %10s %10s %10s %12s  %s\n", "Draws", "Dispatch", "State", "Redundant", "Upload KB", "Pass");
+
+		for (auto& [name, stats] : passes)
+		{
+			printf("  %10.1f %10.1f %10.1f %10.1f %12.1f  %s\n",
+				(double)stats.Draws / frames,
+				(double)stats.Dispatches / frames,
+				(double)stats.StateCalls / frames,
+				(double)stats.RedundantCalls / frames,
+				stats.BytesUploaded / 1024.0 / frames,
+				name.c_str());
+		}
+	}
+
+private:
+	static void PrintTotal(const char *Name, uint64_t Value, uint32_t Frames)
+	{
+		printf("%-28s %14llu %14.1f\n", Name, (unsigned long long)Value, (double)Value / Frames);
+	}
+
+	static const char *CallName(uint32_t Call)
+	{
+		static const char *names[CALL_COUNT] =
+		{
+			"Frame", "String", "BeginEvent", "EndEvent", "Upload",
+			"Draw", "DrawIndexed", "DrawInstanced", "DrawIndexedInstanced", "Draw*Indirect",
+			"Dispatch", "DispatchIndirect",
+			"*SetShader", "*SetShaderResources", "*SetSamplers", "*SetConstantBuffers", "*SetUnorderedAccessViews",
+			"IASetInputLayout", "IASetVertexBuffers", "IASetIndexBuffer", "IASetPrimitiveTopology",
+			"OMSetRenderTargets", "OMSetBlendState", "OMSetDepthStencilState", "RSSetState",
+			"RSSetViewports", "RSSetScissorRects",
+			"Map", "Unmap", "UpdateSubresource", "CopyResource", "CopySubresourceRegion",
+			"ClearRenderTargetView", "ClearDepthStencilView", "ClearUnorderedAccessView", "ClearState",
+			"ExecuteCommandList", "FinishCommandList",
+		};
+
+		return names[Call];
+	}
+
+	PassStats& CurrentPass(uint32_t Context)
+	{
+		ContextState& state = m_Contexts[Context];
+		std::string name = (Context == m_ImmediateContext) ? "" : "[deferred] ";
+
+		if (state.EventStack.empty())
+			name += "<no event>";
+
+		for (size_t i = 0; i < state.EventStack.size() && i < m_MaxDepth; i++)
+		{
+			if (i > 0)
+				name += " / ";
+
+			auto itr = m_Strings.find(state.EventStack[i]);
+			name += (itr != m_Strings.end()) ? itr->second : "?";
+		}
+
+		return m_Passes[name];
+	}
+
+	// Single value binds
+	void BindState(uint32_t Context, uint64_t Key, const uint32_t *Values, uint32_t Count)
+	{
+		PassStats& pass = CurrentPass(Context);
+		pass.StateCalls++;
+
+		if (m_Contexts[Context].Bind(Key, HashValues(Values, Count)))
+		{
+			pass.RedundantCalls++;
+			pass.RedundantSlots++;
+		}
+	}
+
+	// Slot range binds: Stride values per slot
+	void BindSlots(uint32_t Context, BindingType Type, uint32_t Stage, uint32_t StartSlot, const uint32_t *Values, uint32_t SlotCount, uint32_t Stride)
+	{
+		PassStats& pass = CurrentPass(Context);
+		ContextState& state = m_Contexts[Context];
+		uint32_t redundant = 0;
+
+		for (uint32_t i = 0; i < SlotCount; i++)
+		{
+			if (state.Bind(BindingKey(Type, Stage, StartSlot + i), HashValues(&Values[i * Stride], Stride)))
+				redundant++;
+		}
+
+		pass.StateCalls++;
+		pass.RedundantSlots += redundant;
+
+		if (redundant == SlotCount)
+			pass.RedundantCalls++;
+	}
+
+	bool Process(const RecordHeader& Record, const std::vector<uint32_t>& Args)
+	{
+		const uint32_t *a = Args.data();
+		const uint32_t n = (uint32_t)Args.size();
+		const uint32_t ctx = Record.Context;
+
+		if (Record.Call >= CALL_COUNT)
+			return false;
+
+		m_CallCounts[Record.Call]++;
+
+		// The first context that presents a frame marker or executes a command list is the immediate one
+		if (Record.Call == CALL_EXECUTE_COMMAND_LIST && m_ImmediateContext == 0)
+			m_ImmediateContext = ctx;
+
+		if (m_ImmediateContext == 0 && Record.Call != CALL_FRAME && Record.Call != CALL_STRING && Record.Call != CALL_FINISH_COMMAND_LIST)
+			m_ImmediateContext = ctx;
+
+		// Array records are [fixed..., count, elements...]
+		auto arrayValid = [&](uint32_t Fixed, uint32_t Stride)
+		{
+			return n >= Fixed + 1 && n == Fixed + 1 + a[Fixed] * Stride;
+		};
+
+		switch (Record.Call)
+		{
+		case CALL_FRAME:
+			return n == 1;
+
+		case CALL_STRING:
+		{
+			if (n < 2 || n != 2 + (a[1] + 3) / 4)
+				return false;
+
+			std::string name(a[1], '\0');
+
+			for (uint32_t i = 0; i < a[1]; i++)
+				name[i] = (char)((a[2 + i / 4] >> ((i % 4) * 8)) & 0xFF);
+
+			m_Strings[a[0]] = name;
+			return true;
+		}
+
+		case CALL_BEGIN_EVENT:
+			if (n != 1)
+				return false;
+
+			m_Contexts[ctx].EventStack.push_back(a[0]);
+			return true;
+
+		case CALL_END_EVENT:
+			if (!m_Contexts[ctx].EventStack.empty())
+				m_Contexts[ctx].EventStack.pop_back();
+			return true;
+
+		case CALL_UPLOAD:
+			if (n != 2)
+				return false;
+
+			CurrentPass(ctx).BytesUploaded += a[1];
+			return true;
+
+		case CALL_DRAW:
+		case CALL_DRAW_INDEXED:
+		case CALL_DRAW_INDIRECT:
+			CurrentPass(ctx).Draws++;
+			CurrentPass(ctx).Instances++;
+			return true;
+
+		case CALL_DRAW_INSTANCED:
+		case CALL_DRAW_INDEXED_INSTANCED:
+			if (n < 2)
+				return false;
+
+			CurrentPass(ctx).Draws++;
+			CurrentPass(ctx).Instances += a[1];
+			return true;
+
+		case CALL_DISPATCH:
+		case CALL_DISPATCH_INDIRECT:
+			CurrentPass(ctx).Dispatches++;
+			return true;
+
+		case CALL_SET_SHADER:
+			if (n != 2)
+				return false;
+
+			BindState(ctx, BindingKey(BIND_SHADER, a[0]), &a[1], 1);
+			return true;
+
+		case CALL_SET_SHADER_RESOURCES:
+		case CALL_SET_SAMPLERS:
+			if (!arrayValid(2, 1))
+				return false;
+
+			BindSlots(ctx, Record.Call == CALL_SET_SAMPLERS ? BIND_SAMPLER : BIND_SHADER_RESOURCE, a[0], a[1], &a[3], a[2], 1);
+			return true;
+
+		case CALL_SET_CONSTANT_BUFFERS:
+			if (!arrayValid(2, 3))
+				return false;
+
+			BindSlots(ctx, BIND_CONSTANT_BUFFER, a[0], a[1], &a[3], a[2], 3);
+			return true;
+
+		case CALL_SET_UNORDERED_ACCESS_VIEWS:
+			if (!arrayValid(2, 1))
+				return false;
+
+			m_Contexts[ctx].ForgetShaderResources();
+			BindSlots(ctx, BIND_UNORDERED_ACCESS_VIEW, a[0], a[1], &a[3], a[2], 1);
+			return true;
+
+		case CALL_SET_INPUT_LAYOUT:
+			BindState(ctx, BindingKey(BIND_INPUT_LAYOUT), a, n);
+			return true;
+
+		case CALL_SET_VERTEX_BUFFERS:
+			if (!arrayValid(1, 3))
+				return false;
+
+			BindSlots(ctx, BIND_VERTEX_BUFFER, 0, a[0], &a[2], a[1], 3);
+			return true;
+
+		case CALL_SET_INDEX_BUFFER:
+			BindState(ctx, BindingKey(BIND_INDEX_BUFFER), a, n);
+			return true;
+
+		case CALL_SET_PRIMITIVE_TOPOLOGY:
+			BindState(ctx, BindingKey(BIND_TOPOLOGY), a, n);
+			return true;
+
+		case CALL_SET_RENDER_TARGETS:
+			if (!arrayValid(1, 1))
+				return false;
+
+			m_Contexts[ctx].ForgetShaderResources();
+			BindState(ctx, BindingKey(BIND_RENDER_TARGETS), a, n);
+			return true;
+
+		case CALL_SET_BLEND_STATE:
+			BindState(ctx, BindingKey(BIND_BLEND), a, n);
+			return true;
+
+		case CALL_SET_DEPTH_STENCIL_STATE:
+			BindState(ctx, BindingKey(BIND_DEPTH_STENCIL), a, n);
+			return true;
+
+		case CALL_SET_RASTERIZER_STATE:
+			BindState(ctx, BindingKey(BIND_RASTERIZER), a, n);
+			return true;
+
+		case CALL_SET_VIEWPORTS:
+			if (!arrayValid(0, 6))
+				return false;
+
+			BindState(ctx, BindingKey(BIND_VIEWPORTS), a, n);
+			return true;
+
+		case CALL_SET_SCISSOR_RECTS:
+			if (!arrayValid(0, 4))
+				return false;
+
+			BindState(ctx, BindingKey(BIND_SCISSOR_RECTS), a, n);
+			return true;
+
+		case CALL_MAP:
+			if (n != 4)
+				return false;
+
+			CurrentPass(ctx).Maps++;
+
+			// Persistently mapped ring buffers report their writes through CALL_UPLOAD instead
+			if (a[2] == MapWriteDiscard)
+				CurrentPass(ctx).BytesUploaded += a[3];
+			return true;
+
+		case CALL_UNMAP:
+			return true;
+
+		case CALL_UPDATE_SUBRESOURCE:
+			if (n != 3)
+				return false;
+
+			CurrentPass(ctx).BytesUploaded += a[2];
+			return true;
+
+		case CALL_COPY_RESOURCE:
+		case CALL_COPY_SUBRESOURCE_REGION:
+			CurrentPass(ctx).Copies++;
+			return true;
+
+		case CALL_CLEAR_RENDER_TARGET_VIEW:
+		case CALL_CLEAR_DEPTH_STENCIL_VIEW:
+		case CALL_CLEAR_UNORDERED_ACCESS_VIEW:
+			CurrentPass(ctx).Clears++;
+			return true;
+
+		case CALL_CLEAR_STATE:
+		case CALL_EXECUTE_COMMAND_LIST:
+		case CALL_FINISH_COMMAND_LIST:
+			// All of these leave the context with default state
+			m_Contexts[ctx].Bound.clear();
+			return true;
+		}
+
+		return false;
+	}
+
+	uint32_t m_MaxDepth;
+	FileHeader m_Header {};
+	uint64_t m_RecordCount = 0;
+	uint64_t m_CallCounts[CALL_COUNT] = {};
+	uint32_t m_ImmediateContext = 0;
+
+	std::unordered_map<uint32_t, ContextState> m_Contexts;
+	std::unordered_map<uint32_t, std::string> m_Strings;
+	std::unordered_map<std::string, PassStats> m_Passes;
+};
+
+int main(int argc, char **argv)
+{
+	const char *path = nullptr;
+	uint32_t maxDepth = UINT32_MAX;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+			maxDepth = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else
+			path = argv[i];
+	}
+
+	if (!path)
+	{
+		fprintf(stderr, "Usage: %s <capture.bin> [--depth N]\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+	{
+		fprintf(stderr, "Unable to open %s\n", path);
+		return 1;
+	}
+
+	std::vector<uint8_t> data;
+	uint8_t buffer[64 * 1024];
+
+	for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+		data.insert(data.end(), buffer, buffer + read);
+
+	fclose(file);
+
+	Analyzer analyzer(maxDepth);
+
+	if (!analyzer.Run(data))
+		return 1;
+
+	analyzer.Print();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+//
+// Shared helpers for the standalone tests in this directory. Checks don't stop at the first failure: every failed CHECK
+// is printed with its location and counted, and main() returns CheckSummary() once everything has run.
+//
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+static uint32_t FailureCount;
+
+#define CHECK(Condition) \
+	do { if (!(Condition)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #Condition); FailureCount++; } } while (0)
+
+static int CheckSummary()
+{
+	if (FailureCount > 0)
+	{
+		printf("%u check(s) failed\n", FailureCount);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
\ No newline at end of file
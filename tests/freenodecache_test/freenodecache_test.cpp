@@ -0,0 +1,170 @@
+//
+// Checks the per-thread free node cache used for BSBatchRenderer's active pass index nodes: nodes are returned as one
+// chain once the cache is full, when the pool changes and on flush, and a thread_local cache returns what it still
+// holds when its thread exits. Several threads then free into a shared locked pool and every node has to end up in it
+// exactly once. Only depends on the standard library so cache changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o freenodecache_test freenodecache_test.cpp
+//   cl /std:c++17 /O2 /EHsc freenodecache_test.cpp
+//
+// Usage: freenodecache_test [--threads N] [--nodes N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/FreeNodeCache.h"
+#include "../check.h"
+
+struct Node
+{
+	uint32_t m_item;
+	Node *m_pkNext;
+};
+
+struct Pool
+{
+	std::mutex Lock;
+	Node *Head = nullptr;
+	uint32_t Returns = 0;
+};
+
+void ReturnNodes(void *PoolPtr, Node *Head, Node *Tail)
+{
+	auto pool = (Pool *)PoolPtr;
+	std::lock_guard<std::mutex> lock(pool->Lock);
+
+	Tail->m_pkNext = pool->Head;
+	pool->Head = Head;
+	pool->Returns++;
+}
+
+uint32_t CountNodes(const Pool& Pool)
+{
+	uint32_t count = 0;
+
+	for (Node *node = Pool.Head; node; node = node->m_pkNext)
+		count++;
+
+	return count;
+}
+
+void TestBatches()
+{
+	std::vector<Node> nodes(200);
+	Pool poolA;
+	Pool poolB;
+
+	{
+		FreeNodeCache<Node> cache(ReturnNodes, 64);
+
+		// Nothing reaches the pool until the cache is full
+		for (uint32_t i = 0; i < 63; i++)
+			CHECK(!cache.Free(&poolA, &nodes[i]));
+
+		CHECK(cache.QCount() == 63);
+		CHECK(poolA.Returns == 0);
+
+		CHECK(cache.Free(&poolA, &nodes[63]));
+		CHECK(cache.QCount() == 0);
+		CHECK(poolA.Returns == 1);
+		CHECK(CountNodes(poolA) == 64);
+
+		// A different pool returns the cached nodes to the old one first
+		for (uint32_t i = 64; i < 74; i++)
+			CHECK(!cache.Free(&poolA, &nodes[i]));
+
+		CHECK(cache.Free(&poolB, &nodes[74]));
+		CHECK(poolA.Returns == 2);
+		CHECK(CountNodes(poolA) == 74);
+		CHECK(cache.QCount() == 1);
+
+		CHECK(cache.Flush());
+		CHECK(!cache.Flush());
+		CHECK(CountNodes(poolB) == 1);
+
+		// Left in the cache for the destructor
+		for (uint32_t i = 75; i < 80; i++)
+			CHECK(!cache.Free(&poolB, &nodes[i]));
+
+		CHECK(cache.QStats().CachedFrees == 80);
+		CHECK(cache.QStats().Returns == 3);
+		CHECK(cache.QStats().ReturnedNodes == 75);
+	}
+
+	CHECK(CountNodes(poolB) == 6);
+	CHECK(poolB.Returns == 2);
+}
+
+void TestThreadExit(uint32_t ThreadCount, uint32_t NodesPerThread)
+{
+	// Node counts that aren't a multiple of the batch size leave nodes in every thread's cache when it exits
+	std::vector<Node> nodes(ThreadCount * NodesPerThread);
+	std::vector<std::thread> threads;
+	std::atomic_uint32_t freed(0);
+	Pool pool;
+
+	for (uint32_t i = 0; i < nodes.size(); i++)
+		nodes[i].m_item = i;
+
+	for (uint32_t t = 0; t < ThreadCount; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			static thread_local FreeNodeCache<Node> cache(ReturnNodes, 64);
+
+			for (uint32_t i = 0; i < NodesPerThread; i++)
+			{
+				cache.Free(&pool, &nodes[t * NodesPerThread + i]);
+				freed++;
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(freed == nodes.size());
+
+	std::set<uint32_t> seen;
+	uint32_t count = 0;
+
+	for (Node *node = pool.Head; node; node = node->m_pkNext)
+	{
+		seen.insert(node->m_item);
+		count++;
+	}
+
+	if (count != nodes.size() || seen.size() != nodes.size())
+		printf("Pool holds %u nodes (%u distinct), expected %u\n", count, (uint32_t)seen.size(), (uint32_t)nodes.size());
+
+	CHECK(count == nodes.size());
+	CHECK(seen.size() == nodes.size());
+	CHECK(pool.Returns == ThreadCount * ((NodesPerThread + 63) / 64));
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t threads = 8;
+	uint32_t nodes = 100001;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--nodes") && i + 1 < argc)
+			nodes = (uint32_t)atoi(argv[++i]);
+	}
+
+	TestBatches();
+	TestThreadExit(threads, nodes);
+
+	return CheckSummary();
+}
\ No newline at end of file
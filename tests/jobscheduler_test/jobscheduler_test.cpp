@@ -0,0 +1,354 @@
+//
+// Runs multi-stage job graphs through the work-stealing JobScheduler used by skyrim64_test and checks ordering,
+// dependencies, BSJobs-style job lists with sync entries, that idle workers sleep instead of spinning, and worker
+// statistics. A second thread keeps reading and resetting the statistics while graphs run, like the UI does. Only depends on the standard library so scheduler changes can be verified on any platform (build with
+// -fsanitize=thread to check for races):
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o jobscheduler_test jobscheduler_test.cpp ../../skyrim64_test/src/patches/jobscheduler.cpp
+//   cl /std:c++17 /O2 /EHsc jobscheduler_test.cpp ../../skyrim64_test/src/patches/jobscheduler.cpp
+//
+// Usage: jobscheduler_test [--threads N] [--iterations N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../../skyrim64_test/src/patches/jobscheduler.h"
+#include "../check.h"
+
+using namespace JobScheduler;
+
+constexpr uint32_t StageCount = 4;
+constexpr uint32_t JobsPerStage = 250;
+
+struct StageState
+{
+	std::atomic<uint32_t> CurrentStage;
+	std::atomic<uint32_t> Completed[StageCount];
+	std::atomic<uint32_t> OutOfOrder;
+};
+
+struct StageJob
+{
+	StageState *State;
+	uint32_t Stage;
+	uint32_t Spin;
+};
+
+static void StageJobCallback(void *Parameter)
+{
+	auto job = static_cast<StageJob *>(Parameter);
+
+	if (job->State->CurrentStage.load() != job->Stage)
+		job->State->OutOfOrder++;
+
+	// One long job per stage so idle workers have something to steal around
+	volatile uint32_t sink = 0;
+
+	for (uint32_t i = 0; i < job->Spin; i++)
+		sink = sink + i;
+
+	if (++job->State->Completed[job->Stage] == JobsPerStage)
+		job->State->CurrentStage++;
+}
+
+static void TestStages(Scheduler& S, uint32_t Iterations)
+{
+	std::vector<StageJob> jobs(StageCount * JobsPerStage);
+	StageState state;
+
+	for (uint32_t iteration = 0; iteration < Iterations; iteration++)
+	{
+		JobGraph graph;
+
+		state.CurrentStage = 0;
+		state.OutOfOrder = 0;
+
+		for (auto& completed : state.Completed)
+			completed = 0;
+
+		for (uint32_t stage = 0; stage < StageCount; stage++)
+		{
+			for (uint32_t i = 0; i < JobsPerStage; i++)
+			{
+				StageJob& job = jobs[stage * JobsPerStage + i];
+				job = { &state, stage, i == 0 ? 200000u : 2000u };
+
+				graph.AddJob(StageJobCallback, &job);
+			}
+
+			graph.AddSyncPoint();
+		}
+
+		S.Run(graph);
+
+		CHECK(state.CurrentStage == StageCount);
+		CHECK(state.OutOfOrder == 0);
+	}
+}
+
+struct ChainJob
+{
+	std::atomic<uint32_t> *Counter;
+	uint32_t Expected;
+	bool Failed;
+};
+
+static void ChainJobCallback(void *Parameter)
+{
+	auto job = static_cast<ChainJob *>(Parameter);
+
+	// Every job only depends on the previous one, so they have to run strictly in order
+	job->Failed = job->Counter->fetch_add(1) != job->Expected;
+}
+
+static void TestDependencies(Scheduler& S)
+{
+	std::atomic<uint32_t> counter(0);
+	std::vector<ChainJob> jobs(500);
+	JobGraph graph;
+
+	for (uint32_t i = 0; i < (uint32_t)jobs.size(); i++)
+	{
+		jobs[i] = { &counter, i, true };
+		graph.AddJob(ChainJobCallback, &jobs[i]);
+
+		if (i > 0)
+			graph.AddDependency(i - 1, i);
+	}
+
+	S.Run(graph);
+
+	CHECK(counter == jobs.size());
+
+	for (auto& job : jobs)
+		CHECK(!job.Failed);
+}
+
+static void TestEmptyGraphs(Scheduler& S)
+{
+	JobGraph graph;
+	S.Run(graph);
+
+	// Sync points without any jobs in between
+	graph.AddSyncPoint();
+	graph.AddSyncPoint();
+	S.Run(graph);
+
+	CHECK(graph.GetNodeCount() == 2);
+}
+
+// Job list entries record the order they ran in. Sync entries must see every earlier entry finished and no later one
+// started.
+struct ListState
+{
+	std::atomic<uint32_t> Started;
+	std::atomic<uint32_t> Finished;
+	std::atomic<uint32_t> Dispatched;
+	std::atomic<uint32_t> Errors;
+};
+
+struct ListJob
+{
+	ListState *State;
+	uint32_t SyncsBefore;		// Sync entries earlier in the list
+	uint32_t EntriesBefore;		// All entries earlier in the list
+	uint32_t RunAfterSync;		// Value of SyncsDone seen when running
+};
+
+static std::atomic<uint32_t> SyncsDone;
+
+static void ListJobCallback(void *Parameter)
+{
+	auto job = static_cast<ListJob *>(Parameter);
+	job->State->Started++;
+	job->RunAfterSync = SyncsDone.load();
+
+	if (job->RunAfterSync != job->SyncsBefore)
+		job->State->Errors++;
+
+	job->State->Finished++;
+}
+
+static void SyncJobCallback(void *Parameter)
+{
+	auto job = static_cast<ListJob *>(Parameter);
+	job->State->Started++;
+
+	// Everything before has finished and nothing after has started
+	if (job->State->Finished.load() != job->EntriesBefore || job->State->Started.load() != job->EntriesBefore + 1)
+		job->State->Errors++;
+
+	SyncsDone++;
+	job->State->Finished++;
+}
+
+static bool IsSyncCallback(JobFunction Function)
+{
+	return Function == SyncJobCallback;
+}
+
+static void DispatchListEntry(void *Parameter)
+{
+	auto entry = static_cast<const JobListEntry *>(Parameter);
+	static_cast<ListJob *>(entry->Parameter)->State->Dispatched++;
+
+	entry->Function(entry->Parameter);
+}
+
+static void TestJobLists(Scheduler& S, uint32_t Iterations)
+{
+	// Like the engine's lists: stages of jobs separated by signal/sync entries, two syncs in a row and a sync at the end
+	const char layout[] = "JJJJJJJJSJJJSSJJJJJJJJJJJJJJJJSJS";
+	const uint32_t count = sizeof(layout) - 1;
+
+	std::vector<ListJob> jobs(count);
+	std::vector<JobListEntry> entries(count);
+
+	for (uint32_t iteration = 0; iteration < Iterations; iteration++)
+	{
+		ListState state;
+		state.Started = 0;
+		state.Finished = 0;
+		state.Dispatched = 0;
+		state.Errors = 0;
+		SyncsDone = 0;
+
+		uint32_t syncs = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			jobs[i] = { &state, syncs, i, 0 };
+			entries[i] = { layout[i] == 'S' ? SyncJobCallback : ListJobCallback, &jobs[i] };
+
+			if (layout[i] == 'S')
+				syncs++;
+		}
+
+		const bool dispatch = (iteration % 2) == 0;
+		JobGraph graph;
+		graph.AddJobList(entries.data(), count, IsSyncCallback, dispatch ? DispatchListEntry : nullptr);
+
+		S.Run(graph);
+
+		CHECK(state.Errors == 0);
+		CHECK(state.Finished == count);
+		CHECK(state.Dispatched == (dispatch ? count : 0));
+		CHECK(SyncsDone == syncs);
+	}
+}
+
+static void SleepJobCallback(void *Parameter)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(*static_cast<uint32_t *>(Parameter)));
+}
+
+static void TestParking(Scheduler& S)
+{
+	// One long job that doesn't use the CPU, every other worker has nothing to do. Spinning workers would burn close to
+	// (workers - 1) times the wall time.
+	uint32_t sleepMs = 300;
+	JobGraph graph;
+	graph.AddJob(SleepJobCallback, &sleepMs);
+	graph.AddSyncPoint();
+	graph.AddJob(SleepJobCallback, &sleepMs);
+
+	clock_t cpuStart = clock();
+	auto wallStart = std::chrono::steady_clock::now();
+
+	S.Run(graph);
+
+	double cpuMs = (double)(clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+	double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+	printf("Parking: %.1fms CPU over %.1fms with %u workers\n", cpuMs, wallMs, S.GetWorkerCount());
+
+	CHECK(wallMs >= 2 * sleepMs);
+	CHECK(cpuMs < wallMs / 4);
+}
+
+static uint64_t TotalJobsExecuted(const Scheduler& S)
+{
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < S.GetWorkerCount(); i++)
+		total += S.GetWorkerStats(i).JobsExecuted;
+
+	return total;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t threads = std::max(std::thread::hardware_concurrency(), 2u);
+	uint32_t iterations = 200;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = (uint32_t)atoi(argv[++i]);
+	}
+
+	Scheduler scheduler(threads);
+
+	// Before the stats reader below starts spinning on its own
+	TestParking(scheduler);
+
+	// Stats are only counted by the workers while nothing else touches them
+	scheduler.ResetWorkerStats();
+	TestStages(scheduler, 1);
+	CHECK(TotalJobsExecuted(scheduler) == StageCount * JobsPerStage);
+
+	scheduler.ResetWorkerStats();
+	CHECK(TotalJobsExecuted(scheduler) == 0);
+
+	// Read and reset the stats concurrently with running graphs
+	std::atomic<bool> stop(false);
+	std::thread reader([&]()
+	{
+		uint32_t reads = 0;
+
+		while (!stop.load())
+		{
+			for (uint32_t i = 0; i < scheduler.GetWorkerCount(); i++)
+				(void)scheduler.GetWorkerStats(i);
+
+			if (++reads % 64 == 0)
+				scheduler.ResetWorkerStats();
+
+			std::this_thread::yield();
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+
+	TestStages(scheduler, iterations);
+	TestDependencies(scheduler);
+	TestJobLists(scheduler, iterations);
+	TestEmptyGraphs(scheduler);
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	stop = true;
+	reader.join();
+
+	printf("%u workers, %u iterations: %.1fms\n", scheduler.GetWorkerCount(), iterations, elapsed);
+
+	for (uint32_t i = 0; i < scheduler.GetWorkerCount(); i++)
+	{
+		WorkerStats stats = scheduler.GetWorkerStats(i);
+
+		printf("  worker %u: %.2fms busy, %.2fms idle, %llu jobs, %llu steals (since the last reset)\n", i,
+			stats.BusyNanoseconds / 1e6, stats.IdleNanoseconds / 1e6, (unsigned long long)stats.JobsExecuted, (unsigned long long)stats.Steals);
+	}
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+//
+// Checks that the SSE point light transform produces the same bits as the scalar path (which is ordered like the
+// non-FMA XMVector3TransformCoord) for random affine and projective matrices and every light count, then times both.
+// Only depends on the standard library so light transform changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o lighttransform_test lighttransform_test.cpp ../../skyrim64_test/src/patches/rendering/LightTransform.cpp
+//   cl /std:c++17 /O2 /EHsc lighttransform_test.cpp ../../skyrim64_test/src/patches/rendering/LightTransform.cpp
+//
+// Usage: lighttransform_test [--iterations N] [--calls N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <random>
+#include "../../skyrim64_test/src/patches/rendering/LightTransform.h"
+#include "../check.h"
+
+using namespace LightTransform;
+
+void TestMatches(const char *Name, TransformFunc Func, uint32_t Iterations, uint64_t Seed)
+{
+	std::mt19937 rng((uint32_t)Seed);
+	std::uniform_real_distribution<float> position(-5000.0f, 5000.0f);
+	std::uniform_real_distribution<float> scale(-2.0f, 2.0f);
+	uint32_t mismatches = 0;
+	uint32_t overwrites = 0;
+
+	for (uint32_t iter = 0; iter < Iterations; iter++)
+	{
+		float matrix[4][4];
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+				matrix[i][j] = scale(rng);
+
+			matrix[i][3] = 0.0f;
+			matrix[3][i] = position(rng);
+		}
+
+		matrix[3][3] = 1.0f;
+
+		// Projective matrices divide by a w other than 1
+		if (iter % 7 == 0)
+			matrix[2][3] = scale(rng) * 0.01f;
+
+		LightsSoA lights = {};
+		uint32_t count = 1 + iter % MaxLights;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			lights.X[i] = position(rng);
+			lights.Y[i] = position(rng);
+			lights.Z[i] = position(rng);
+			lights.Radius[i] = position(rng);
+		}
+
+		float divisor = 2.5f + scale(rng) * scale(rng);
+		float expected[MaxLights][4];
+		float actual[MaxLights][4];
+
+		memset(expected, 0x7F, sizeof(expected));
+		memset(actual, 0x7F, sizeof(actual));
+
+		TransformScalar(matrix, lights, count, divisor, expected);
+		Func(matrix, lights, count, divisor, actual);
+
+		if (memcmp(expected, actual, count * sizeof(actual[0])) != 0)
+			mismatches++;
+
+		// Entries past Count belong to the caller
+		float untouched[4];
+		memset(untouched, 0x7F, sizeof(untouched));
+
+		for (uint32_t i = count; i < MaxLights; i++)
+		{
+			if (memcmp(actual[i], untouched, sizeof(untouched)) != 0)
+				overwrites++;
+		}
+	}
+
+	if (mismatches > 0 || overwrites > 0)
+		printf("%s: %u mismatch(es), %u overwrite(s) in %u iterations\n", Name, mismatches, overwrites, Iterations);
+
+	CHECK(mismatches == 0);
+	CHECK(overwrites == 0);
+}
+
+void Benchmark(const char *Name, TransformFunc Func, uint32_t Calls)
+{
+	float matrix[4][4] =
+	{
+		{ 1.0f, 0.1f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.2f, 0.0f },
+		{ 0.3f, 0.0f, 1.0f, 0.0f },
+		{ 10.0f, 20.0f, 30.0f, 1.0f },
+	};
+
+	LightsSoA lights = {};
+
+	for (uint32_t i = 0; i < 7; i++)
+	{
+		lights.X[i] = (float)i;
+		lights.Y[i] = (float)i * 2.0f;
+		lights.Z[i] = (float)i * 3.0f;
+		lights.Radius[i] = 100.0f + i;
+	}
+
+	float out[MaxLights][4];
+	float sum = 0.0f;
+	double best = 0.0;
+
+	// Best of several runs, shared machines are noisy
+	for (int run = 0; run < 5; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < Calls; i++)
+		{
+			// Changing an input every call keeps the compiler from hoisting the transform out of the loop
+			lights.X[0] = (float)(i & 255);
+			Func(matrix, lights, 7, 1.5f, out);
+			sum += out[6][0];
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		double time = std::chrono::duration<double, std::nano>(end - start).count() / Calls;
+
+		if (run == 0 || time < best)
+			best = time;
+	}
+
+	printf("%-7s %6.2f ns/call (7 lights) [%g]\n", Name, best, sum);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = 200000;
+	uint32_t calls = 5000000;
+	uint64_t seed = 1234;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--calls") && i + 1 < argc)
+			calls = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestMatches("sse", TransformSSE, iterations, seed);
+	TestMatches("dispatch", Transform, iterations, seed);
+
+	if (calls > 0)
+	{
+		Benchmark("scalar", TransformScalar, calls);
+		Benchmark("sse", TransformSSE, calls);
+	}
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,392 @@
+//
+// Stress tests the PtrMultiProdCons ring from BSTLocklessQueue.h with many producers and consumers, including rings
+// small enough to overflow constantly, sequence laps wrapping and 32-bit positions wrapping. Every pushed item has to
+// come out exactly once. Afterwards it benchmarks the ring against a reconstruction of the engine's original queue.
+// Only depends on the standard library so queue changes can be verified on any platform (build with
+// -fsanitize=thread to check for races):
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o locklessqueue_test locklessqueue_test.cpp ../../skyrim64_test/src/patches/TES/BSTLocklessQueue.cpp
+//   cl /std:c++17 /O2 /EHsc locklessqueue_test.cpp ../../skyrim64_test/src/patches/TES/BSTLocklessQueue.cpp
+//
+// Usage: locklessqueue_test [--items N] [--threads N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include "../../skyrim64_test/src/patches/TES/BSTLocklessQueue.h"
+#include "../check.h"
+
+struct Item
+{
+	uint32_t Producer;
+	uint32_t Index;
+};
+
+//
+// The engine's queue as far as the layout tells: producers reserve a slot with a CAS loop on uiQueueAlloced, fill it
+// and then publish in reservation order by moving uiQueueEnd from their slot to the next one. Consumers do the same
+// with uiQueueFetched and uiQueueStart. A thread that gets preempted between reserving and publishing stalls everyone
+// behind it.
+//
+template<size_t Count>
+struct ReferenceQueue
+{
+	std::atomic<void *> QueueA[Count] = {};
+	std::atomic<uint32_t> uiQueueStart = 0;
+	std::atomic<uint32_t> uiQueueFetched = 0;
+	std::atomic<uint32_t> uiQueueEnd = 0;
+	std::atomic<uint32_t> uiQueueAlloced = 0;
+
+	bool Push(void *Value)
+	{
+		uint32_t slot = uiQueueAlloced.load();
+
+		do
+		{
+			if (slot - uiQueueStart.load() >= Count)
+				return false;
+		} while (!uiQueueAlloced.compare_exchange_weak(slot, slot + 1));
+
+		QueueA[slot % Count].store(Value, std::memory_order_relaxed);
+		Publish(uiQueueEnd, slot);
+		return true;
+	}
+
+	void *Pop()
+	{
+		uint32_t slot = uiQueueFetched.load();
+
+		do
+		{
+			if (slot == uiQueueEnd.load())
+				return nullptr;
+		} while (!uiQueueFetched.compare_exchange_weak(slot, slot + 1));
+
+		void *value = QueueA[slot % Count].load(std::memory_order_relaxed);
+		Publish(uiQueueStart, slot);
+		return value;
+	}
+
+	static void Publish(std::atomic<uint32_t>& Word, uint32_t Slot)
+	{
+		for (uint32_t expected = Slot; !Word.compare_exchange_weak(expected, Slot + 1); expected = Slot)
+			std::this_thread::yield();
+	}
+};
+
+template<size_t Count>
+using Ring = BSTLocklessQueue::PtrMultiProdCons<Item, Count, 0>;
+
+struct FreeDeleter
+{
+	void operator()(void *Memory)
+	{
+		free(Memory);
+	}
+};
+
+// The engine allocates these inside larger objects, zeroed. Nothing here needs destructing.
+template<typename T>
+static std::unique_ptr<T, FreeDeleter> MakeZeroed()
+{
+	return std::unique_ptr<T, FreeDeleter>(new (calloc(1, sizeof(T))) T);
+}
+
+static void TestZeroedIsEmpty()
+{
+	auto zeroed = MakeZeroed<Ring<16>>();
+	auto reset = MakeZeroed<Ring<16>>();
+
+	reset->Reset(0);
+	CHECK(memcmp(zeroed.get(), reset.get(), sizeof(Ring<16>)) == 0);
+	CHECK(zeroed->Pop() == nullptr);
+
+	// The queue the culling process embeds
+	static_assert(sizeof(BSTLocklessQueue::ObjMultiProdCons<Item, 4096, 0>) == 4096 * sizeof(Item) + 2 * (8192 * 8 + 0x10));
+}
+
+static void TestFifo()
+{
+	auto queue = MakeZeroed<Ring<64>>();
+	Item items[200];
+
+	for (uint32_t round = 0; round < 10; round++)
+	{
+		for (uint32_t i = 0; i < 50; i++)
+			queue->Push(&items[i]);
+
+		for (uint32_t i = 0; i < 50; i++)
+			CHECK(queue->Pop() == &items[i]);
+
+		CHECK(queue->Pop() == nullptr);
+	}
+
+	CHECK(queue->uiQueueStart == 500 && queue->uiQueueEnd == 500);
+}
+
+static void TestOverflow()
+{
+	auto queue = MakeZeroed<Ring<8>>();
+	Item items[100];
+
+	for (auto& item : items)
+		queue->Push(&item);
+
+	CHECK(queue->uiQueueFetched == 92);
+
+	// The ring first, in order, then the overflow list in order
+	for (uint32_t i = 0; i < 100; i++)
+		CHECK(queue->Pop() == &items[i]);
+
+	CHECK(queue->Pop() == nullptr);
+	CHECK(queue->uiQueueFetched == 0);
+
+	// Works normally afterwards
+	queue->Push(&items[5]);
+	CHECK(queue->Pop() == &items[5]);
+	CHECK(queue->Pop() == nullptr);
+}
+
+static void TestWrapping()
+{
+	Item items[4];
+
+	// The 16-bit lap counter wraps every 65536 laps
+	auto small = MakeZeroed<Ring<4>>();
+
+	for (uint32_t i = 0; i < 4 * 65536 * 3; i++)
+	{
+		small->Push(&items[i % 4]);
+
+		if (i % 3 == 2)
+		{
+			while (small->Pop())
+				;
+		}
+	}
+
+	while (small->Pop())
+		;
+
+	small->Push(&items[1]);
+	small->Push(&items[2]);
+	CHECK(small->Pop() == &items[1]);
+	CHECK(small->Pop() == &items[2]);
+	CHECK(small->Pop() == nullptr);
+	CHECK(small->uiQueueFetched == 0);
+
+	// Positions wrap at 2^32
+	auto queue = MakeZeroed<Ring<16>>();
+	queue->Reset(0xFFFFFFF8);
+
+	for (uint32_t round = 0; round < 8; round++)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+			queue->Push(&items[i]);
+
+		for (uint32_t i = 0; i < 4; i++)
+			CHECK(queue->Pop() == &items[i]);
+	}
+
+	CHECK(queue->uiQueueEnd == 24 && queue->uiQueueStart == 24);
+	CHECK(queue->Pop() == nullptr);
+}
+
+template<size_t Count>
+static void TestStress(uint32_t Producers, uint32_t Consumers, uint32_t ItemsPerProducer)
+{
+	auto queue = MakeZeroed<Ring<Count>>();
+
+	std::vector<Item> items(Producers * ItemsPerProducer);
+	std::unique_ptr<std::atomic<uint32_t>[]> seen(new std::atomic<uint32_t>[items.size()]);
+	std::atomic<uint32_t> remaining((uint32_t)items.size());
+	std::atomic<uint32_t> orderErrors(0);
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		items[i] = { (uint32_t)(i / ItemsPerProducer), (uint32_t)(i % ItemsPerProducer) };
+		seen[i] = 0;
+	}
+
+	for (uint32_t p = 0; p < Producers; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			for (uint32_t i = 0; i < ItemsPerProducer; i++)
+				queue->Push(&items[p * ItemsPerProducer + i]);
+		});
+	}
+
+	for (uint32_t c = 0; c < Consumers; c++)
+	{
+		threads.emplace_back([&]()
+		{
+			while (remaining.load(std::memory_order_relaxed) > 0)
+			{
+				Item *item = queue->Pop();
+
+				if (!item)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				size_t index = item - items.data();
+
+				if (index >= items.size())
+					orderErrors++;
+				else
+					seen[index]++;
+
+				remaining--;
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	uint32_t missing = 0;
+	uint32_t duplicates = 0;
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		missing += seen[i] == 0 ? 1 : 0;
+		duplicates += seen[i] > 1 ? 1 : 0;
+	}
+
+	printf("Stress: ring of %zu, %u producers, %u consumers, %zu items: %u missing, %u duplicated\n", Count, Producers, Consumers, items.size(), missing, duplicates);
+
+	CHECK(missing == 0);
+	CHECK(duplicates == 0);
+	CHECK(orderErrors == 0);
+	CHECK(queue->Pop() == nullptr);
+	CHECK(queue->uiQueueFetched == 0);
+	CHECK(queue->uiQueueStart == queue->uiQueueEnd);
+}
+
+template<typename Queue>
+static double MeasureThroughput(Queue& Q, uint32_t Producers, uint32_t Consumers, uint32_t ItemsPerProducer, Item *Items)
+{
+	std::atomic<uint32_t> remaining(Producers * ItemsPerProducer);
+	std::atomic<bool> start(false);
+	std::vector<std::thread> threads;
+
+	for (uint32_t p = 0; p < Producers; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			while (!start.load())
+				std::this_thread::yield();
+
+			for (uint32_t i = 0; i < ItemsPerProducer; i++)
+			{
+				while (!Q.Push(&Items[p * ItemsPerProducer + i]))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	for (uint32_t c = 0; c < Consumers; c++)
+	{
+		threads.emplace_back([&]()
+		{
+			while (!start.load())
+				std::this_thread::yield();
+
+			while (remaining.load(std::memory_order_relaxed) > 0)
+			{
+				if (Q.Pop())
+					remaining--;
+			}
+		});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start = true;
+
+	for (auto& thread : threads)
+		thread.join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	return (double)(Producers * ItemsPerProducer) / seconds / 1e6;
+}
+
+// Same interface as ReferenceQueue, the ring never refuses a push
+template<size_t Count>
+struct RingAdapter
+{
+	Ring<Count> *Queue;
+
+	bool Push(Item *Value)
+	{
+		Queue->Push(Value);
+		return true;
+	}
+
+	Item *Pop()
+	{
+		return Queue->Pop();
+	}
+};
+
+static void Benchmark(uint32_t MaxThreads, uint32_t ItemsPerProducer)
+{
+	constexpr size_t Count = 8192;
+
+	for (uint32_t threads = 1; threads <= MaxThreads; threads *= 2)
+	{
+		std::vector<Item> items(threads * ItemsPerProducer);
+
+		auto reference = MakeZeroed<ReferenceQueue<Count>>();
+		auto ring = MakeZeroed<Ring<Count>>();
+		RingAdapter<Count> adapter = { ring.get() };
+
+		double referenceRate = MeasureThroughput(*reference, threads, threads, ItemsPerProducer, items.data());
+		double ringRate = MeasureThroughput(adapter, threads, threads, ItemsPerProducer, items.data());
+
+		printf("Benchmark: %2u producers, %2u consumers: original %7.2f M items/s, ring %7.2f M items/s (%.2fx)\n",
+			threads, threads, referenceRate, ringRate, ringRate / referenceRate);
+
+		CHECK(ring->Pop() == nullptr);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t itemCount = 200000;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 8u);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--items") && i + 1 < argc)
+			itemCount = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threadCount = std::max(atoi(argv[++i]), 2);
+	}
+
+	TestZeroedIsEmpty();
+	TestFifo();
+	TestOverflow();
+	TestWrapping();
+
+	TestStress<8>(threadCount, threadCount, itemCount / threadCount);
+	TestStress<64>(threadCount, 1, itemCount / threadCount);
+	TestStress<64>(1, threadCount, itemCount);
+	TestStress<8192>(threadCount, threadCount, itemCount / threadCount);
+
+	Benchmark(threadCount, itemCount / threadCount);
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+//
+// Checks the six opaque geometry group passes that RenderOpaqueGroupsDeferred() records in parallel. The table has
+// to keep the game's serial order, every pair of wildcard passes (which share the accumulator's active pass list) has
+// to be ordered by a dependency and their technique ranges can't overlap. The passes then run through the same
+// JobScheduler graph DC_RecordAndExecute() builds, against a model of the batch renderer: wildcard passes take their
+// techniques out of a shared active list while non-wildcard passes draw their own group. Concatenating the results in
+// table order, like the command lists are executed, has to give the serial draw order every time, and two passes must
+// never use the shared list at once. Only depends on the standard library so graph changes can be verified on any
+// platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o opaquegrouppasses_test opaquegrouppasses_test.cpp ../../skyrim64_test/src/patches/jobscheduler.cpp
+//   cl /std:c++17 /O2 /EHsc opaquegrouppasses_test.cpp ../../skyrim64_test/src/patches/jobscheduler.cpp
+//
+// Usage: opaquegrouppasses_test [--threads N] [--iterations N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/OpaqueGroupPasses.h"
+#include "../../skyrim64_test/src/patches/jobscheduler.h"
+#include "../check.h"
+
+using namespace JobScheduler;
+
+bool IsWildcard(uint32_t Index)
+{
+	return OpaqueGroupPasses[Index].GeometryGroup == -1;
+}
+
+// True if Before has to finish recording before After starts, directly or through other passes
+bool IsOrdered(uint32_t Before, uint32_t After)
+{
+	for (uint32_t i = OpaqueGroupPasses[After].DependsOn; i != OpaqueGroupNoDependency; i = OpaqueGroupPasses[i].DependsOn)
+	{
+		if (i == Before)
+			return true;
+	}
+
+	return false;
+}
+
+void TestTable()
+{
+	// FinishAccumulating_Standard_PreResolveDepth's serial order
+	const char *serialOrder[] = { "RenderBatches", "LowAniso", "RenderGrass", "RenderNoShadowGroup", "RenderLODObjects", "RenderLODLand" };
+	static_assert(sizeof(serialOrder) / sizeof(serialOrder[0]) == OpaqueGroupPassCount);
+
+	for (uint32_t i = 0; i < OpaqueGroupPassCount; i++)
+	{
+		const OpaqueGroupPass& pass = OpaqueGroupPasses[i];
+
+		CHECK(strcmp(pass.Name, serialOrder[i]) == 0);
+		CHECK(pass.StartTechnique <= pass.EndTechnique);
+		CHECK(pass.GeometryGroup >= -1 && pass.GeometryGroup < 16);
+		CHECK(pass.DependsOn == OpaqueGroupNoDependency || pass.DependsOn < i);
+	}
+
+	for (uint32_t i = 0; i < OpaqueGroupPassCount; i++)
+	{
+		for (uint32_t j = i + 1; j < OpaqueGroupPassCount; j++)
+		{
+			// Both walk the accumulator's active pass list
+			if (IsWildcard(i) && IsWildcard(j))
+			{
+				CHECK(IsOrdered(i, j));
+				CHECK(OpaqueGroupPasses[i].EndTechnique < OpaqueGroupPasses[j].StartTechnique ||
+					OpaqueGroupPasses[j].EndTechnique < OpaqueGroupPasses[i].StartTechnique);
+			}
+
+			// Every geometry group is drawn once
+			if (!IsWildcard(i))
+				CHECK(OpaqueGroupPasses[i].GeometryGroup != OpaqueGroupPasses[j].GeometryGroup);
+		}
+	}
+}
+
+struct Draw
+{
+	int GeometryGroup;
+	uint32_t Technique;
+
+	bool operator==(const Draw& Other) const
+	{
+		return GeometryGroup == Other.GeometryGroup && Technique == Other.Technique;
+	}
+};
+
+struct BatchRendererModel
+{
+	std::vector<uint32_t> ActiveTechniques;		// Sorted, like the active pass index list
+	std::atomic<uint32_t> Users;
+	std::atomic<uint32_t> Overlaps;
+};
+
+struct PassJob
+{
+	uint32_t Index;
+	BatchRendererModel *Batches;
+	const std::vector<std::vector<uint32_t>> *GroupTechniques;
+	std::vector<Draw> Draws;					// This pass's command list
+	uint32_t SpinMicroseconds;
+};
+
+void Render(PassJob *Job)
+{
+	const OpaqueGroupPass& pass = OpaqueGroupPasses[Job->Index];
+
+	if (pass.GeometryGroup != -1)
+	{
+		for (uint32_t technique : (*Job->GroupTechniques)[pass.GeometryGroup])
+		{
+			if (technique >= pass.StartTechnique && technique <= pass.EndTechnique)
+				Job->Draws.push_back({ pass.GeometryGroup, technique });
+		}
+
+		return;
+	}
+
+	// Removes what it renders from the shared list, like sub_14131E7B0 with m_AutoClearPasses
+	auto& active = Job->Batches->ActiveTechniques;
+
+	for (auto itr = active.begin(); itr != active.end();)
+	{
+		if (*itr >= pass.StartTechnique && *itr <= pass.EndTechnique)
+		{
+			Job->Draws.push_back({ -1, *itr });
+			itr = active.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+void PassJobCallback(void *Parameter)
+{
+	auto job = static_cast<PassJob *>(Parameter);
+
+	if (IsWildcard(job->Index) && job->Batches->Users++ != 0)
+		job->Batches->Overlaps++;
+
+	// Uneven recording times shuffle which pass finishes first
+	auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(job->SpinMicroseconds);
+
+	while (std::chrono::steady_clock::now() < end)
+		std::this_thread::yield();
+
+	Render(job);
+
+	if (IsWildcard(job->Index))
+		job->Batches->Users--;
+}
+
+void TestRecording(uint32_t Threads, uint32_t Iterations, uint64_t Seed)
+{
+	std::mt19937_64 rng(Seed);
+	Scheduler scheduler(Threads);
+
+	for (uint32_t iteration = 0; iteration < Iterations; iteration++)
+	{
+		// Random techniques in every group and the active list, inside and outside the pass ranges
+		const uint32_t techniques[] = { 1, 2, 0x5C00002F, 0x5C000030, 0x5C000040, 0x5C00005C, 0x5C00005D, 0x5C006074, 0x5C006075 };
+		std::vector<std::vector<uint32_t>> groupTechniques(16);
+		std::vector<uint32_t> activeTechniques;
+
+		for (uint32_t technique : techniques)
+		{
+			for (auto& group : groupTechniques)
+			{
+				if (rng() % 3 == 0)
+					group.push_back(technique);
+			}
+
+			if (rng() % 2 == 0)
+				activeTechniques.push_back(technique);
+		}
+
+		// Serial reference
+		BatchRendererModel serialBatches;
+		serialBatches.ActiveTechniques = activeTechniques;
+		std::vector<Draw> serialDraws;
+
+		for (uint32_t i = 0; i < OpaqueGroupPassCount; i++)
+		{
+			PassJob job = { i, &serialBatches, &groupTechniques, {}, 0 };
+			Render(&job);
+			serialDraws.insert(serialDraws.end(), job.Draws.begin(), job.Draws.end());
+		}
+
+		// Same graph as DC_RecordAndExecute()
+		BatchRendererModel batches;
+		batches.ActiveTechniques = activeTechniques;
+		batches.Users = 0;
+		batches.Overlaps = 0;
+
+		PassJob jobs[OpaqueGroupPassCount];
+		JobGraph graph;
+
+		for (uint32_t i = 0; i < OpaqueGroupPassCount; i++)
+		{
+			jobs[i] = { i, &batches, &groupTechniques, {}, (uint32_t)(rng() % 200) };
+			graph.AddJob(PassJobCallback, &jobs[i]);
+
+			if (OpaqueGroupPasses[i].DependsOn != OpaqueGroupNoDependency)
+				graph.AddDependency(OpaqueGroupPasses[i].DependsOn, i);
+		}
+
+		scheduler.Run(graph);
+
+		// Command lists are executed in table order
+		std::vector<Draw> executed;
+
+		for (auto& job : jobs)
+			executed.insert(executed.end(), job.Draws.begin(), job.Draws.end());
+
+		CHECK(batches.Overlaps == 0);
+		CHECK(executed == serialDraws);
+		CHECK(batches.ActiveTechniques == serialBatches.ActiveTechniques);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t threads = 6;
+	uint32_t iterations = 500;
+	uint64_t seed = 1234;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestTable();
+	TestRecording(threads, iterations, seed);
+
+	return CheckSummary();
+}
\ No newline at end of file
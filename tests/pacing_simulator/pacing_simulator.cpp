@@ -0,0 +1,201 @@
+//
+// Replays synthetic frame time traces through the FramePacer used by skyrim64_test's Present() hook and prints frame
+// time and latency distributions. Only depends on the standard library so pacing changes can be evaluated on any
+// platform:
+//
+//   g++ -std=c++17 -O2 -o pacing_simulator pacing_simulator.cpp ../../skyrim64_test/src/patches/rendering/FramePacer.cpp
+//   cl /std:c++17 /O2 /EHsc pacing_simulator.cpp ../../skyrim64_test/src/patches/rendering/FramePacer.cpp
+//
+// Usage: pacing_simulator [--target MS] [--max-in-flight N] [--frames N] [--seed N]
+//
+// The simulated CPU spends the trace's time on each frame, then waits for the pacer and presents. The simulated GPU
+// executes frames in order and takes its own trace time per frame; the CPU blocks once more than --max-in-flight frames
+// are queued, like the query based limit in the hook. Latency is measured from Present() to the first poll that sees
+// the GPU done. Every trace runs against a precise sleep and a coarse 1ms OS timer with random wakeup delays.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/FramePacer.h"
+
+struct Trace
+{
+	const char *Name;
+	double (*CpuTime)(std::mt19937& Random, uint32_t Frame);
+	double (*GpuTime)(std::mt19937& Random, uint32_t Frame);
+};
+
+struct SimulationResult
+{
+	FrameTimeHistogram FrameTimes;
+	FrameTimeHistogram Latencies;
+	FramePacer::Stats Pacer;
+};
+
+static double Normal(std::mt19937& Random, double Mean, double Deviation)
+{
+	return std::max(0.1, std::normal_distribution<double>(Mean, Deviation)(Random));
+}
+
+static const Trace Traces[] =
+{
+	{
+		"steady cpu 8ms, gpu 6ms",
+		[](std::mt19937& R, uint32_t) { return Normal(R, 8.0, 0.3); },
+		[](std::mt19937& R, uint32_t) { return Normal(R, 6.0, 0.2); },
+	},
+	{
+		"noisy cpu 10ms +-4, gpu 7ms",
+		[](std::mt19937& R, uint32_t) { return Normal(R, 10.0, 4.0); },
+		[](std::mt19937& R, uint32_t) { return Normal(R, 7.0, 1.0); },
+	},
+	{
+		"cpu hitch every 120 frames",
+		[](std::mt19937& R, uint32_t F) { return (F % 120 == 0) ? 45.0 : Normal(R, 7.0, 0.5); },
+		[](std::mt19937& R, uint32_t) { return Normal(R, 6.0, 0.5); },
+	},
+	{
+		"gpu bound, cpu 4ms, gpu 14ms",
+		[](std::mt19937& R, uint32_t) { return Normal(R, 4.0, 0.5); },
+		[](std::mt19937& R, uint32_t) { return Normal(R, 14.0, 1.5); },
+	},
+};
+
+static SimulationResult Simulate(const Trace& Trace, double Target, uint32_t MaxInFlight, uint32_t Frames, bool CoarseTimer, uint32_t Seed)
+{
+	std::mt19937 random(Seed);
+	std::mt19937 timerRandom(Seed ^ 0x5EED);
+
+	double now = 0.0;
+
+	// Every clock read costs a little, which is what lets the spin loop terminate
+	auto clock = [&]()
+	{
+		now += 0.0005;
+		return now;
+	};
+
+	auto sleep = [&](double Milliseconds)
+	{
+		double wake = now + Milliseconds;
+
+		if (CoarseTimer)
+			wake = (double)(int64_t)(wake + 1.0) + std::uniform_real_distribution<double>(0.0, 0.6)(timerRandom);
+		else
+			wake += std::uniform_real_distribution<double>(0.0, 0.05)(timerRandom);
+
+		now = std::max(now, wake);
+	};
+
+	FramePacer pacer(clock, sleep);
+	pacer.SetTargetFrameTime(Target);
+
+	std::deque<std::pair<double, double>> inFlight;	// Present time, GPU completion time
+	double gpuFree = 0.0;
+
+	// Completion is only noticed when the queries are polled, same as in the hook
+	auto poll = [&]()
+	{
+		while (!inFlight.empty() && inFlight.front().second <= now)
+		{
+			pacer.AddLatencySample(now - inFlight.front().first);
+			inFlight.pop_front();
+		}
+	};
+
+	for (uint32_t frame = 0; frame < Frames; frame++)
+	{
+		now += Trace.CpuTime(random, frame);
+		poll();
+
+		// Block on the oldest frame's query when too many are queued
+		while (MaxInFlight > 0 && inFlight.size() >= MaxInFlight)
+		{
+			now = std::max(now, inFlight.front().second);
+			pacer.AddLatencySample(inFlight.front().second - inFlight.front().first);
+			inFlight.pop_front();
+		}
+
+		double present = pacer.WaitForDeadline();
+
+		double gpuStart = std::max(present, gpuFree);
+		gpuFree = gpuStart + Trace.GpuTime(random, frame);
+		inFlight.emplace_back(present, gpuFree);
+		poll();
+	}
+
+	SimulationResult result;
+	result.FrameTimes = pacer.QFrameTimes();
+	result.Latencies = pacer.QLatencies();
+	result.Pacer = pacer.GetStats();
+	return result;
+}
+
+static void PrintHistogram(const char *Name, const FrameTimeHistogram& Histogram)
+{
+	printf("    %-8s mean %6.2f  p50 %6.2f  p95 %6.2f  p99 %6.2f  max %6.2f ms\n", Name, Histogram.QMean(),
+		Histogram.QPercentile(0.50), Histogram.QPercentile(0.95), Histogram.QPercentile(0.99), Histogram.QMax());
+}
+
+int main(int argc, char **argv)
+{
+	double target = 1000.0 / 60.0;
+	uint32_t maxInFlight = 2;
+	uint32_t frames = 3600;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--target") && i + 1 < argc)
+			target = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--max-in-flight") && i + 1 < argc)
+			maxInFlight = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			frames = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = (uint32_t)atoi(argv[++i]);
+		else
+		{
+			printf("Usage: %s [--target MS] [--max-in-flight N] [--frames N] [--seed N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("Target %.3f ms, max %u frames in flight, %u frames\n\n", target, maxInFlight, frames);
+
+	for (auto& trace : Traces)
+	{
+		printf("%s\n", trace.Name);
+
+		const struct
+		{
+			const char *Name;
+			double Target;
+			bool CoarseTimer;
+		} configs[] =
+		{
+			{ "unpaced", 0.0, false },
+			{ "paced, precise timer", target, false },
+			{ "paced, coarse timer", target, true },
+		};
+
+		for (auto& config : configs)
+		{
+			SimulationResult result = Simulate(trace, config.Target, maxInFlight, frames, config.CoarseTimer, seed);
+
+			printf("  %s: %llu missed, %llu resyncs, spin margin %.2f ms\n", config.Name, (unsigned long long)result.Pacer.MissedDeadlines,
+				(unsigned long long)result.Pacer.Resyncs, result.Pacer.SpinMargin);
+			PrintHistogram("frame", result.FrameTimes);
+			PrintHistogram("latency", result.Latencies);
+		}
+
+		printf("\n");
+	}
+
+	return 0;
+}
\ No newline at end of file
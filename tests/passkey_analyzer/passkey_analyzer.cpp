@@ -0,0 +1,164 @@
+//
+// Reads pass key captures written by skyrim64_test (Frame Statistics -> "Capture pass keys") and replays the state sort
+// of every recorded list. Prints technique and material changes in submission order and after sorting, plus the time
+// the sort takes on the recorded key streams. Only depends on the standard library so captures can be evaluated on any
+// platform:
+//
+//   g++ -std=c++17 -O2 -o passkey_analyzer passkey_analyzer.cpp ../../skyrim64_test/src/patches/rendering/PassSortKey.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//   cl /std:c++17 /O2 /EHsc passkey_analyzer.cpp ../../skyrim64_test/src/patches/rendering/PassSortKey.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//
+// Usage: passkey_analyzer <passkeys.bin> [--repeat N]
+//
+// Changes are counted per list, the same way BSBatchRenderer::SetupPass() counts them, with the first pass of every
+// list counting as a change. Blended passes keep their position like they do in game.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/PassSortKey.h"
+
+using namespace PassSortKey;
+
+struct ListStats
+{
+	uint64_t Lists = 0;
+	uint64_t Passes = 0;
+	uint64_t LargestList = 0;
+	ChangeCounts Submitted = {};
+	ChangeCounts Sorted = {};
+	double SortNs = 0;
+
+	void Add(const ListStats& Other)
+	{
+		Lists += Other.Lists;
+		Passes += Other.Passes;
+		LargestList = std::max(LargestList, Other.LargestList);
+		Submitted.Techniques += Other.Submitted.Techniques;
+		Submitted.Materials += Other.Submitted.Materials;
+		Sorted.Techniques += Other.Sorted.Techniques;
+		Sorted.Materials += Other.Sorted.Materials;
+		SortNs += Other.SortNs;
+	}
+};
+
+static double Percent(uint64_t Before, uint64_t After)
+{
+	return Before ? 100.0 * ((double)Before - (double)After) / (double)Before : 0.0;
+}
+
+static void Print(const char *Name, const ListStats& Stats)
+{
+	if (Stats.Lists == 0)
+		return;
+
+	printf("%-18s %8llu lists %10llu passes (largest %llu)\n", Name, (unsigned long long)Stats.Lists, (unsigned long long)Stats.Passes, (unsigned long long)Stats.LargestList);
+	printf("%-18s technique changes %10llu -> %10llu (%.1f%% fewer)\n", "", (unsigned long long)Stats.Submitted.Techniques, (unsigned long long)Stats.Sorted.Techniques, Percent(Stats.Submitted.Techniques, Stats.Sorted.Techniques));
+	printf("%-18s material changes  %10llu -> %10llu (%.1f%% fewer)\n", "", (unsigned long long)Stats.Submitted.Materials, (unsigned long long)Stats.Sorted.Materials, Percent(Stats.Submitted.Materials, Stats.Sorted.Materials));
+	printf("%-18s sort %.3f ms, %.1f ns/pass\n", "", Stats.SortNs / 1e6, Stats.Passes ? Stats.SortNs / (double)Stats.Passes : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <passkeys.bin> [--repeat N]\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t repeat = 20;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+			repeat = std::max(atoi(argv[++i]), 1);
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	Capture capture;
+
+	if (!file || !capture.Read(file))
+	{
+		printf("Unable to read %s\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<ListStats> frames(capture.QFrameCount());
+	ListStats types[2];
+
+	std::vector<RadixSort::KeyValue> keys;
+	std::vector<RadixSort::KeyValue> sorted;
+	std::vector<RadixSort::KeyValue> scratch;
+	std::vector<uint8_t> fixed;
+	std::vector<uint32_t> order;
+
+	for (auto& list : capture.QLists())
+	{
+		const PassState *passes = &capture.QPasses()[list.First];
+		ListStats stats;
+
+		keys.resize(list.Count);
+		scratch.resize(list.Count);
+		fixed.resize(list.Count);
+		order.resize(list.Count);
+
+		for (uint32_t i = 0; i < list.Count; i++)
+		{
+			keys[i] = { Pack(passes[i], list.Type), i };
+			fixed[i] = (passes[i].Flags & PASS_BLENDED) ? 1 : 0;
+		}
+
+		// Best of several runs, the key stream is sorted from scratch every time
+		double bestNs = 0;
+
+		for (uint32_t run = 0; run < repeat; run++)
+		{
+			sorted = keys;
+
+			auto start = std::chrono::steady_clock::now();
+			SortList(sorted.data(), scratch.data(), fixed.data(), sorted.size());
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+			if (run == 0 || ns < bestNs)
+				bestNs = ns;
+		}
+
+		for (uint32_t i = 0; i < list.Count; i++)
+			order[i] = (uint32_t)sorted[i].Value;
+
+		stats.Lists = 1;
+		stats.Passes = list.Count;
+		stats.LargestList = list.Count;
+		stats.Submitted = CountChanges(passes, nullptr, list.Count);
+		stats.Sorted = CountChanges(passes, order.data(), list.Count);
+		stats.SortNs = bestNs;
+
+		types[list.Type].Add(stats);
+
+		if (list.Frame < frames.size())
+			frames[list.Frame].Add(stats);
+	}
+
+	printf("%u frames\n\n", capture.QFrameCount());
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		printf("Frame %zu: technique changes %llu -> %llu, material changes %llu -> %llu\n", i,
+			(unsigned long long)frames[i].Submitted.Techniques, (unsigned long long)frames[i].Sorted.Techniques,
+			(unsigned long long)frames[i].Submitted.Materials, (unsigned long long)frames[i].Sorted.Materials);
+	}
+
+	ListStats total;
+	total.Add(types[LIST_BATCH_GROUP]);
+	total.Add(types[LIST_PERSISTENT]);
+
+	printf("\n");
+	Print("Batch groups", types[LIST_BATCH_GROUP]);
+	Print("Persistent lists", types[LIST_PERSISTENT]);
+	Print("Total", total);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,351 @@
+//
+// Checks the pass sort keys and the pass key capture used by BSBatchRenderer: sorted batch groups and persistent lists
+// need fewer technique and material changes than the submission order, passes with the same state end up front to
+// back, blended passes keep their position, equal keys keep their order, and captures survive a write/read round trip
+// while several threads record. Only depends on the standard library so key layout changes can be verified on any
+// platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o passsortkey_test passsortkey_test.cpp ../../skyrim64_test/src/patches/rendering/PassSortKey.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//   cl /std:c++17 /O2 /EHsc passsortkey_test.cpp ../../skyrim64_test/src/patches/rendering/PassSortKey.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//
+// Usage: passsortkey_test [--passes N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/PassSortKey.h"
+#include "../check.h"
+
+using namespace PassSortKey;
+
+// Every material has one texture set and vertex format, like lighting shader materials on a given mesh
+static std::vector<PassState> GeneratePasses(std::mt19937_64& Random, uint32_t Count, uint32_t Techniques, uint32_t Materials, uint32_t BlendedPercent)
+{
+	std::vector<PassState> passes(Count);
+
+	for (auto& pass : passes)
+	{
+		uint32_t technique = (uint32_t)(Random() % Techniques);
+		uint32_t material = (uint32_t)(Random() % Materials);
+
+		pass = {};
+		pass.Shader = 0x7FF600000000ull + (technique % 3) * 0x1000;
+		pass.Technique = 0x5C000000 + technique * 0x11;
+		pass.Material = 0x1D000000000ull + material * 0x90;
+		pass.TextureSet = 0x2A000000000ull + (material / 2) * 0x40;
+		pass.VertexDesc = 0x0000000300000000ull | (material % 5);
+		pass.Distance = (float)(Random() % 100000) / 10.0f;
+
+		if (Random() % 100 < BlendedPercent)
+			pass.Flags |= PASS_BLENDED;
+	}
+
+	return passes;
+}
+
+static std::vector<uint32_t> SortedOrder(const std::vector<PassState>& Passes, ListType Type, bool KeepBlended)
+{
+	std::vector<RadixSort::KeyValue> keys(Passes.size());
+	std::vector<RadixSort::KeyValue> scratch(Passes.size());
+	std::vector<uint8_t> fixed(Passes.size());
+
+	for (size_t i = 0; i < Passes.size(); i++)
+	{
+		keys[i] = { Pack(Passes[i], Type), i };
+		fixed[i] = (Passes[i].Flags & PASS_BLENDED) ? 1 : 0;
+	}
+
+	SortList(keys.data(), scratch.data(), KeepBlended ? fixed.data() : nullptr, keys.size());
+
+	std::vector<uint32_t> order;
+
+	for (auto& key : keys)
+		order.push_back((uint32_t)key.Value);
+
+	return order;
+}
+
+static void TestDepthBucket()
+{
+	CHECK(DepthBucket(0.0f) == 0);
+	CHECK(DepthBucket(-5.0f) == 0);
+	CHECK(DepthBucket(1.0f) == 64);
+	CHECK(DepthBucket(1e30f) == 1023);
+
+	uint32_t last = 0;
+
+	for (float distance = 0.0f; distance < 200000.0f; distance = distance * 1.01f + 0.1f)
+	{
+		uint32_t bucket = DepthBucket(distance);
+		CHECK(bucket >= last);
+		last = bucket;
+	}
+}
+
+static void TestCountChanges()
+{
+	PassState passes[4] = {};
+	passes[0].Technique = 1; passes[0].Material = 10;
+	passes[1].Technique = 1; passes[1].Material = 20;
+	passes[2].Technique = 2; passes[2].Material = 20;
+	passes[3].Technique = 1; passes[3].Material = 10;
+
+	ChangeCounts counts = CountChanges(passes, nullptr, 4);
+	CHECK(counts.Techniques == 3);
+	CHECK(counts.Materials == 3);
+
+	const uint32_t order[4] = { 0, 3, 1, 2 };
+	counts = CountChanges(passes, order, 4);
+	CHECK(counts.Techniques == 2);
+	CHECK(counts.Materials == 2);
+
+	// A different shader with the same technique id is still a technique change
+	passes[1].Shader = 1;
+	counts = CountChanges(passes, order, 4);
+	CHECK(counts.Techniques == 3);
+
+	counts = CountChanges(passes, nullptr, 0);
+	CHECK(counts.Techniques == 0 && counts.Materials == 0);
+}
+
+static void TestBatchGroup(std::mt19937_64& Random, uint32_t Count)
+{
+	const uint32_t materials = 40;
+	auto passes = GeneratePasses(Random, Count, 1, materials, 0);
+	auto order = SortedOrder(passes, LIST_BATCH_GROUP, true);
+
+	ChangeCounts before = CountChanges(passes.data(), nullptr, passes.size());
+	ChangeCounts after = CountChanges(passes.data(), order.data(), order.size());
+
+	printf("Batch group: %u passes, %llu -> %llu material changes\n", Count, (unsigned long long)before.Materials, (unsigned long long)after.Materials);
+
+	CHECK(after.Techniques == 1);
+	CHECK(after.Materials <= materials);
+	CHECK(after.Materials < before.Materials);
+
+	// Same state is drawn front to back
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		const PassState& a = passes[order[i - 1]];
+		const PassState& b = passes[order[i]];
+
+		if (a.Material == b.Material)
+			CHECK(DepthBucket(a.Distance) <= DepthBucket(b.Distance));
+	}
+
+	// Every pass is drawn exactly once
+	std::set<uint32_t> unique(order.begin(), order.end());
+	CHECK(unique.size() == Count);
+}
+
+static void TestPersistentList(std::mt19937_64& Random, uint32_t Count)
+{
+	const uint32_t techniques = 12;
+	auto passes = GeneratePasses(Random, Count, techniques, 30, 0);
+	auto order = SortedOrder(passes, LIST_PERSISTENT, true);
+
+	ChangeCounts before = CountChanges(passes.data(), nullptr, passes.size());
+	ChangeCounts after = CountChanges(passes.data(), order.data(), order.size());
+
+	printf("Persistent list: %u passes, %llu -> %llu technique changes, %llu -> %llu material changes\n", Count,
+		(unsigned long long)before.Techniques, (unsigned long long)after.Techniques,
+		(unsigned long long)before.Materials, (unsigned long long)after.Materials);
+
+	// The technique leads the key, so every technique/shader pair is one contiguous run
+	CHECK(after.Techniques <= techniques);
+	CHECK(after.Techniques < before.Techniques);
+	CHECK(after.Materials < before.Materials);
+
+	// The batch layout doesn't look at the technique at all
+	PassState a = passes[0];
+	PassState b = a;
+	b.Technique ^= 0x1234;
+	CHECK(Pack(a, LIST_BATCH_GROUP) == Pack(b, LIST_BATCH_GROUP));
+	CHECK(Pack(a, LIST_PERSISTENT) != Pack(b, LIST_PERSISTENT));
+}
+
+static void TestBlendedPasses(std::mt19937_64& Random, uint32_t Count)
+{
+	auto passes = GeneratePasses(Random, Count, 6, 20, 10);
+	auto order = SortedOrder(passes, LIST_PERSISTENT, true);
+
+	size_t runStart = 0;
+
+	for (size_t i = 0; i <= order.size(); i++)
+	{
+		if (i < order.size() && !(passes[i].Flags & PASS_BLENDED))
+			continue;
+
+		// Blended passes stay put
+		if (i < order.size())
+			CHECK(order[i] == i);
+
+		// Passes between them are only reordered among themselves, by key
+		for (size_t j = runStart; j < i; j++)
+		{
+			CHECK(order[j] >= runStart && order[j] < i);
+
+			if (j > runStart)
+				CHECK(Pack(passes[order[j - 1]], LIST_PERSISTENT) <= Pack(passes[order[j]], LIST_PERSISTENT));
+		}
+
+		runStart = i + 1;
+	}
+}
+
+static void TestStability(std::mt19937_64& Random)
+{
+	// Lots of duplicate keys, short and long enough for both sort paths
+	for (uint32_t count : { 5u, 100u, 5000u })
+	{
+		auto passes = GeneratePasses(Random, count, 2, 3, 0);
+
+		for (auto& pass : passes)
+			pass.Distance = 1.0f;
+
+		auto order = SortedOrder(passes, LIST_PERSISTENT, false);
+
+		for (size_t i = 1; i < order.size(); i++)
+		{
+			if (Pack(passes[order[i - 1]], LIST_PERSISTENT) == Pack(passes[order[i]], LIST_PERSISTENT))
+				CHECK(order[i - 1] < order[i]);
+		}
+	}
+}
+
+static bool SamePasses(const PassState *A, const PassState *B, size_t Count)
+{
+	return memcmp(A, B, Count * sizeof(PassState)) == 0;
+}
+
+static void TestCapture(std::mt19937_64& Random)
+{
+	Capture capture;
+	auto passes = GeneratePasses(Random, 64, 4, 10, 5);
+
+	// Nothing is recorded before the frame after the request
+	capture.RecordList(LIST_BATCH_GROUP, passes.data(), 8);
+	CHECK(!capture.EndFrame());
+	capture.RequestFrames(2);
+	CHECK(!capture.IsActive());
+	capture.RecordList(LIST_BATCH_GROUP, passes.data(), 8);
+	CHECK(!capture.EndFrame());
+	CHECK(capture.IsActive());
+	CHECK(capture.QLists().empty());
+
+	// Frame 0
+	capture.RecordList(LIST_BATCH_GROUP, passes.data(), 10);
+	capture.RecordList(LIST_PERSISTENT, passes.data() + 10, 20);
+	capture.RecordList(LIST_PERSISTENT, passes.data(), 0);
+	CHECK(!capture.EndFrame());
+
+	// Frame 1, from several threads like deferred context recording does
+	std::vector<std::thread> threads;
+
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&capture, &passes, t]()
+		{
+			for (uint32_t i = 0; i < 100; i++)
+				capture.RecordList(LIST_BATCH_GROUP, passes.data() + 30 + t, 1 + (i % 8));
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	CHECK(capture.EndFrame());
+	CHECK(!capture.IsActive());
+
+	// Late writers are dropped
+	capture.RecordList(LIST_BATCH_GROUP, passes.data(), 8);
+
+	CHECK(capture.QFrameCount() == 2);
+	CHECK(capture.QLists().size() == 2 + 400);
+	CHECK(capture.QLists()[0].Frame == 0 && capture.QLists()[0].Type == LIST_BATCH_GROUP && capture.QLists()[0].Count == 10);
+	CHECK(capture.QLists()[1].Frame == 0 && capture.QLists()[1].Type == LIST_PERSISTENT && capture.QLists()[1].Count == 20);
+	CHECK(capture.QLists().back().Frame == 1);
+	CHECK(SamePasses(&capture.QPasses()[capture.QLists()[1].First], passes.data() + 10, 20));
+
+	size_t total = 0;
+
+	for (auto& list : capture.QLists())
+	{
+		CHECK(list.First == total);
+		total += list.Count;
+	}
+
+	CHECK(total == capture.QPasses().size());
+
+	// Round trip
+	std::stringstream stream;
+	CHECK(capture.Write(stream));
+
+	std::string data = stream.str();
+	Capture read;
+	std::istringstream input(data);
+	CHECK(read.Read(input));
+	CHECK(read.QFrameCount() == 2);
+	CHECK(read.QLists().size() == capture.QLists().size());
+	CHECK(read.QPasses().size() == capture.QPasses().size());
+	CHECK(SamePasses(read.QPasses().data(), capture.QPasses().data(), capture.QPasses().size()));
+
+	for (size_t i = 0; i < read.QLists().size(); i++)
+	{
+		CHECK(read.QLists()[i].Frame == capture.QLists()[i].Frame);
+		CHECK(read.QLists()[i].Type == capture.QLists()[i].Type);
+		CHECK(read.QLists()[i].Count == capture.QLists()[i].Count);
+	}
+
+	// Truncated and foreign files are rejected
+	std::istringstream truncated(data.substr(0, data.size() - 1));
+	CHECK(!read.Read(truncated));
+
+	std::string foreign = data;
+	foreign[0] ^= 1;
+	std::istringstream foreignInput(foreign);
+	CHECK(!read.Read(foreignInput));
+
+	// A new request starts over
+	capture.RequestFrames(1);
+	CHECK(!capture.EndFrame());
+	capture.RecordList(LIST_PERSISTENT, passes.data(), 3);
+	CHECK(capture.EndFrame());
+	CHECK(capture.QFrameCount() == 1);
+	CHECK(capture.QLists().size() == 1 && capture.QPasses().size() == 3);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t passCount = 3000;
+	uint64_t seed = 1234;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--passes") && i + 1 < argc)
+			passCount = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	std::mt19937_64 random(seed);
+
+	TestDepthBucket();
+	TestCountChanges();
+	TestBatchGroup(random, passCount);
+	TestBatchGroup(random, 200);
+	TestPersistentList(random, passCount);
+	TestBlendedPasses(random, passCount);
+	TestStability(random);
+	TestCapture(random);
+
+	return CheckSummary();
+}
\ No newline at end of file
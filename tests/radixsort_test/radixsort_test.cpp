@@ -0,0 +1,149 @@
+//
+// Checks the radix sort used to order batched render passes against std::stable_sort and compares their speed.
+// Keys follow the batch group layout from PassSortKey::Pack() (shader, material, texture set, vertex format, depth
+// bucket). Only depends on the standard library so sort changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o radixsort_test radixsort_test.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//   cl /std:c++17 /O2 /EHsc radixsort_test.cpp ../../skyrim64_test/src/patches/radixsort.cpp
+//
+// Usage: radixsort_test [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../../skyrim64_test/src/patches/radixsort.h"
+#include "../check.h"
+
+using namespace RadixSort;
+
+struct KeyDistribution
+{
+	const char *Name;
+	uint64_t (*Generate)(std::mt19937_64& Random);
+};
+
+static const KeyDistribution Distributions[] =
+{
+	// One technique per list, one shader, many materials and depths - what RenderBatches() sees
+	{ "pass keys", [](std::mt19937_64& R) -> uint64_t
+	{
+		return (0x7ull << 60) | ((R() % 300) << 38) | ((R() % 200) << 22) | ((R() % 8) << 10) | (R() % 1024);
+	} },
+
+	// Lots of duplicates, checks stability
+	{ "few distinct", [](std::mt19937_64& R) -> uint64_t { return R() % 4; } },
+	{ "constant", [](std::mt19937_64&) -> uint64_t { return 0x1234567890ABCDEFull; } },
+	{ "random 64-bit", [](std::mt19937_64& R) -> uint64_t { return R(); } },
+	{ "high byte only", [](std::mt19937_64& R) -> uint64_t { return (R() % 256) << 56; } },
+};
+
+static const size_t Sizes[] = { 0, 1, 2, 5, 31, 32, 33, 40, 200, 2000, 20000 };
+
+static std::vector<KeyValue> Generate(const KeyDistribution& Distribution, std::mt19937_64& Random, size_t Count)
+{
+	std::vector<KeyValue> data(Count);
+
+	// Values are the original positions so stability can be checked
+	for (size_t i = 0; i < Count; i++)
+		data[i] = { Distribution.Generate(Random), i };
+
+	return data;
+}
+
+static void StableSortReference(std::vector<KeyValue>& Data)
+{
+	std::stable_sort(Data.begin(), Data.end(), [](const KeyValue& A, const KeyValue& B)
+	{
+		return A.Key < B.Key;
+	});
+}
+
+static void TestCorrectness(std::mt19937_64& Random)
+{
+	for (auto& distribution : Distributions)
+	{
+		for (size_t size : Sizes)
+		{
+			std::vector<KeyValue> data = Generate(distribution, Random, size);
+			std::vector<KeyValue> expected = data;
+			std::vector<KeyValue> scratch(size);
+
+			StableSortReference(expected);
+			Sort64(data.data(), scratch.data(), size);
+
+			bool matches = true;
+
+			for (size_t i = 0; i < size; i++)
+				matches &= data[i].Key == expected[i].Key && data[i].Value == expected[i].Value;
+
+			if (!matches)
+				printf("  %s, %zu entries: mismatch\n", distribution.Name, size);
+
+			CHECK(matches);
+		}
+	}
+}
+
+static void Benchmark(std::mt19937_64& Random)
+{
+	printf("%8s %14s %14s\n", "entries", "radix ns/elem", "stable ns/elem");
+
+	for (size_t size : Sizes)
+	{
+		if (size == 0)
+			continue;
+
+		std::vector<KeyValue> source = Generate(Distributions[0], Random, size);
+		std::vector<KeyValue> work(size);
+		std::vector<KeyValue> scratch(size);
+		uint32_t iterations = (uint32_t)(2000000 / size + 1);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			work = source;
+			Sort64(work.data(), scratch.data(), size);
+		}
+
+		auto middle = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			work = source;
+			StableSortReference(work);
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		double radix = std::chrono::duration<double, std::nano>(middle - start).count() / iterations / size;
+		double stable = std::chrono::duration<double, std::nano>(end - middle).count() / iterations / size;
+
+		printf("%8zu %14.1f %14.1f\n", size, radix, stable);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	std::mt19937_64 random(seed);
+
+	TestCorrectness(random);
+	Benchmark(random);
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+//
+// Drives the GpuRingAllocator behind GpuCircularBuffer with a fake fence and checks that memory is never handed out
+// while the simulated GPU may still read it. Only depends on the standard library so ring changes can be verified on
+// any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o ringallocator_test ringallocator_test.cpp ../../skyrim64_test/src/patches/rendering/GpuRingAllocator.cpp
+//   cl /std:c++17 /O2 /EHsc ringallocator_test.cpp ../../skyrim64_test/src/patches/rendering/GpuRingAllocator.cpp
+//
+// Usage: ringallocator_test [--frames N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/GpuRingAllocator.h"
+#include "../check.h"
+
+//
+// The "GPU" completes values only when told to, or when the allocator waits on them
+//
+class FakeFence : public GpuFence
+{
+public:
+	uint64_t NextValue = 1;
+	uint64_t CompletedValue = 0;
+	uint32_t WaitCount = 0;
+
+	virtual uint64_t Signal() override
+	{
+		return NextValue++;
+	}
+
+	virtual uint64_t GetCompletedValue() override
+	{
+		return CompletedValue;
+	}
+
+	virtual void Wait(uint64_t Value) override
+	{
+		CHECK(Value < NextValue);
+		WaitCount++;
+
+		if (CompletedValue < Value)
+			CompletedValue = Value;
+	}
+};
+
+static void TestBasics()
+{
+	FakeFence fence;
+	GpuRingAllocator ring(1024, &fence);
+
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.Allocate(512) == 256);
+
+	ring.EndFrame();
+	CHECK(ring.QFramesInFlight() == 1);
+	CHECK(ring.QAvailable() == 256);
+
+	// Frame 1 is still in flight
+	CHECK(ring.TryAllocate(512) == GpuRingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(256) == 768);
+	CHECK(ring.QAvailable() == 0);
+
+	// Ring is full, has to wait for frame 1
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(fence.WaitCount == 1);
+	CHECK(ring.QStallCount() == 1);
+
+	ring.EndFrame();
+	fence.CompletedValue = 2;
+	ring.Reclaim();
+
+	CHECK(ring.QAvailable() == 1024);
+	CHECK(ring.QFramesInFlight() == 0);
+}
+
+static void TestWrap()
+{
+	FakeFence fence;
+	GpuRingAllocator ring(1024, &fence);
+
+	ring.Allocate(768);
+	ring.EndFrame();
+	fence.CompletedValue = 1;
+	ring.Reclaim();
+
+	// Doesn't fit before <END>, the skipped 256 bytes are charged to this frame
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.QFrameUtilized() == 512 + 256);
+
+	// Bigger than the ring, or more than the current frame can ever get: fail without waiting
+	CHECK(ring.Allocate(2048) == GpuRingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(512) == GpuRingAllocator::InvalidOffset);
+	CHECK(fence.WaitCount == 0);
+}
+
+static void TestFrameLimit()
+{
+	FakeFence fence;
+	GpuRingAllocator ring(1 << 20, &fence);
+
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		ring.Allocate(16);
+		ring.EndFrame();
+
+		CHECK(ring.QFramesInFlight() <= GpuRingAllocator::MaxFramesInFlight);
+	}
+
+	CHECK(fence.WaitCount > 0);
+}
+
+//
+// Random allocation sizes and a GPU that lags a random number of frames behind. Every returned range is checked against
+// everything the current frame owns and everything the GPU hasn't finished yet.
+//
+struct TrackedRange
+{
+	uint32_t Offset;
+	uint32_t Size;
+	uint64_t FenceValue;	// 0 while the frame is still being recorded
+};
+
+static bool Overlaps(const TrackedRange& A, uint32_t Offset, uint32_t Size)
+{
+	return Offset < A.Offset + A.Size && A.Offset < Offset + Size;
+}
+
+static void TestRandom(uint32_t Frames, uint64_t Seed)
+{
+	constexpr uint32_t RingSize = 64 * 1024;
+
+	std::mt19937_64 random(Seed);
+	FakeFence fence;
+	GpuRingAllocator ring(RingSize, &fence);
+	std::vector<TrackedRange> live;
+	uint32_t overlaps = 0;
+	uint32_t failures = 0;
+	uint64_t allocations = 0;
+
+	for (uint32_t frame = 0; frame < Frames; frame++)
+	{
+		uint32_t count = (uint32_t)(random() % 64);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t size = 256 * (1 + (uint32_t)(random() % 8));
+			uint32_t offset = ring.Allocate(size);
+
+			if (offset == GpuRingAllocator::InvalidOffset)
+			{
+				// Only allowed when this frame alone fills the ring
+				if (ring.QFramesInFlight() != 0)
+					failures++;
+
+				break;
+			}
+
+			allocations++;
+
+			// Waiting may have completed more frames
+			for (size_t j = 0; j < live.size();)
+			{
+				if (live[j].FenceValue != 0 && live[j].FenceValue <= fence.CompletedValue)
+				{
+					live[j] = live.back();
+					live.pop_back();
+				}
+				else
+				{
+					j++;
+				}
+			}
+
+			if (offset + size > RingSize)
+				overlaps++;
+
+			for (auto& range : live)
+			{
+				if (Overlaps(range, offset, size))
+					overlaps++;
+			}
+
+			live.push_back({ offset, size, 0 });
+		}
+
+		ring.EndFrame();
+
+		for (auto& range : live)
+		{
+			if (range.FenceValue == 0)
+				range.FenceValue = fence.NextValue - 1;
+		}
+
+		// The GPU finishes somewhere between zero and all outstanding frames
+		uint64_t outstanding = fence.NextValue - 1 - fence.CompletedValue;
+
+		if (outstanding > 0)
+			fence.CompletedValue += random() % (outstanding + 1);
+
+		ring.Reclaim();
+		CHECK(ring.QFramesInFlight() <= GpuRingAllocator::MaxFramesInFlight);
+	}
+
+	printf("  %u frames, %llu allocations, %u stalls\n", Frames, (unsigned long long)allocations, ring.QStallCount());
+
+	CHECK(overlaps == 0);
+	CHECK(failures == 0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 100000;
+	uint64_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			frames = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestBasics();
+	TestWrap();
+	TestFrameLimit();
+	TestRandom(frames, seed);
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,315 @@
+//
+// Checks the recorded setup key usage behind BSLightingShaderTechniques.inl: a written list reads back to the same keys
+// and counts, writing it again gives the same text, counts accumulate over sessions, trimming keeps the most used keys
+// and malformed entries are rejected. A simulated session of technique switches goes through the same path as
+// BSLightingShader::WriteSetupSpecializations(). Only depends on the standard library so list changes can be verified
+// on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o setupkeyusage_test setupkeyusage_test.cpp ../../skyrim64_test/src/patches/rendering/SetupKeyUsage.cpp
+//   cl /std:c++17 /O2 /EHsc setupkeyusage_test.cpp ../../skyrim64_test/src/patches/rendering/SetupKeyUsage.cpp
+//
+// Usage: setupkeyusage_test [--inl path/to/BSLightingShaderTechniques.inl] [--switches N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include "../../skyrim64_test/src/patches/rendering/SetupKeyUsage.h"
+#include "../check.h"
+
+std::string Describe(uint32_t Key)
+{
+	std::string defines;
+
+	for (uint32_t bit = 0; bit < 32; bit++)
+	{
+		if (Key & (1u << bit))
+			defines += (defines.empty() ? "BIT" : " BIT") + std::to_string(bit);
+	}
+
+	return defines;
+}
+
+std::string WriteText(const SetupKeyUsage& Usage)
+{
+	std::ostringstream stream;
+	CHECK(Usage.Write(stream, Describe));
+	return stream.str();
+}
+
+bool ReadText(SetupKeyUsage& Usage, const std::string& Text)
+{
+	std::istringstream stream(Text);
+	return Usage.Read(stream);
+}
+
+bool SameUsage(const SetupKeyUsage& A, const SetupKeyUsage& B)
+{
+	if (A.GetKeys() != B.GetKeys())
+		return false;
+
+	for (uint32_t key : A.GetKeys())
+	{
+		if (A.QUses(key) != B.QUses(key))
+			return false;
+	}
+
+	return true;
+}
+
+void TestRoundTrip()
+{
+	SetupKeyUsage usage;
+	usage.Record(0x206, 1234);
+	usage.Record(0x0, 7);
+	usage.Record(0xFFFFFFFF, 1);
+	usage.Record(0x6002, 0);
+	usage.Record(0x206);
+
+	CHECK(usage.QKeyCount() == 4);
+	CHECK(usage.QUses(0x206) == 1235);
+	CHECK(usage.QUses(0x12345) == 0);
+
+	std::string text = WriteText(usage);
+	CHECK(text.find("LIGHTING_SETUP_SPECIALIZATION(0x00000206)\t// BIT1 BIT2 BIT9; 1235 uses\n") != std::string::npos);
+	CHECK(text.find("LIGHTING_SETUP_SPECIALIZATION(0x00000000)\t// (none); 7 uses\n") != std::string::npos);
+
+	// Entries are written sorted by key
+	CHECK(text.find("(0x00000000)") < text.find("(0x00000206)"));
+	CHECK(text.find("(0x00006002)") < text.find("(0xFFFFFFFF)"));
+
+	SetupKeyUsage readBack;
+	CHECK(ReadText(readBack, text));
+	CHECK(SameUsage(usage, readBack));
+	CHECK(WriteText(readBack) == text);
+
+	// Empty lists survive as well
+	SetupKeyUsage empty;
+	SetupKeyUsage emptyBack;
+	CHECK(ReadText(emptyBack, WriteText(empty)));
+	CHECK(emptyBack.QKeyCount() == 0);
+}
+
+void TestAccumulate()
+{
+	SetupKeyUsage firstSession;
+	firstSession.Record(0x2, 10);
+	firstSession.Record(0x200, 5);
+
+	std::string written = WriteText(firstSession);
+
+	// The next write reads the file back and adds what was recorded since
+	SetupKeyUsage secondSession;
+	secondSession.Record(0x2, 3);
+	secondSession.Record(0x1000, 4);
+
+	SetupKeyUsage list;
+	CHECK(ReadText(list, written));
+	list.Merge(secondSession);
+
+	CHECK(list.QKeyCount() == 3);
+	CHECK(list.QUses(0x2) == 13);
+	CHECK(list.QUses(0x200) == 5);
+	CHECK(list.QUses(0x1000) == 4);
+
+	// Writing resets the session counts but keeps its keys, so writing twice doesn't count anything twice
+	secondSession.ClearUses();
+	CHECK(secondSession.QKeyCount() == 2);
+	CHECK(secondSession.QUses(0x2) == 0);
+
+	SetupKeyUsage again;
+	CHECK(ReadText(again, WriteText(list)));
+	again.Merge(secondSession);
+	CHECK(SameUsage(again, list));
+
+	// Hand-written entries without a count read as zero uses
+	SetupKeyUsage seed;
+	CHECK(ReadText(seed, "// comment\n\nLIGHTING_SETUP_SPECIALIZATION(0x00000C00)\t// SOFT_LIGHTING RIM_LIGHTING\r\n"));
+	CHECK(seed.QKeyCount() == 1);
+	CHECK(seed.QUses(0xC00) == 0);
+}
+
+void TestTrim()
+{
+	SetupKeyUsage usage;
+	usage.Record(0x10, 5);
+	usage.Record(0x20, 50);
+	usage.Record(0x30, 5);
+	usage.Record(0x40, 0);
+	usage.Record(0x50, 20);
+
+	SetupKeyUsage untouched = usage;
+	untouched.Trim(5);
+	CHECK(SameUsage(untouched, usage));
+
+	// Ties go to the lower key
+	usage.Trim(3);
+	CHECK(usage.QKeyCount() == 3);
+	CHECK(usage.QUses(0x20) == 50);
+	CHECK(usage.QUses(0x50) == 20);
+	CHECK(usage.QUses(0x10) == 5);
+	CHECK(usage.GetKeys() == std::vector<uint32_t>({ 0x10, 0x20, 0x50 }));
+
+	usage.Trim(0);
+	CHECK(usage.QKeyCount() == 0);
+}
+
+void TestMalformed()
+{
+	const char *badLines[] =
+	{
+		"LIGHTING_SETUP_SPECIALIZATION(0x)\n",
+		"LIGHTING_SETUP_SPECIALIZATION(0x00000002\n",
+		"LIGHTING_SETUP_SPECIALIZATION(0x100000000)\n",
+		"LIGHTING_SETUP_SPECIALIZATION(zz)\n",
+		"LIGHTING_SETUP_SPECIALIZATION(0x2)\t// SKINNED; many uses\n",
+		"LIGHTING_SETUP_SPECIALIZATION(0x2)\t// SKINNED; 12x uses\n",
+		"SOMETHING_ELSE(0x2)\n",
+	};
+
+	for (const char *line : badLines)
+	{
+		SetupKeyUsage usage;
+
+		if (ReadText(usage, line))
+			printf("Accepted malformed line: %s", line);
+
+		CHECK(!ReadText(usage, line));
+	}
+}
+
+void TestSession(uint32_t Switches, uint64_t Seed)
+{
+	// Technique switches over a few hundred keys where some are far more common than others, like a real frame
+	std::mt19937_64 rng(Seed);
+	std::vector<uint32_t> keys;
+
+	for (uint32_t i = 0; i < 400; i++)
+		keys.push_back((uint32_t)rng() & 0x0007FFFE);
+
+	std::discrete_distribution<size_t> pick(keys.size(), 0.0, 1.0, [](double X) { return 1.0 / (X * X * 400.0 + 0.01); });
+	std::map<uint32_t, uint64_t> expected;
+	SetupKeyUsage recorded;
+
+	// Recorded like BSLightingShader: a key is added on the first switch, repeats are counted and added on the next
+	// change
+	uint32_t lastKey = 0xFFFFFFFF;
+	uint64_t pending = 0;
+
+	for (uint32_t i = 0; i < Switches; i++)
+	{
+		uint32_t key = keys[pick(rng)];
+		expected[key]++;
+
+		if (key == lastKey)
+		{
+			pending++;
+			continue;
+		}
+
+		if (pending > 0)
+			recorded.Record(lastKey, pending);
+
+		recorded.Record(key);
+		lastKey = key;
+		pending = 0;
+	}
+
+	recorded.Record(lastKey, pending);
+
+	CHECK(recorded.QKeyCount() == expected.size());
+
+	for (auto& [key, uses] : expected)
+		CHECK(recorded.QUses(key) == uses);
+
+	// The written list is the most used keys, and reading it back gives the same list
+	SetupKeyUsage list;
+	list.Merge(recorded);
+	list.Trim(64);
+	CHECK(list.QKeyCount() == std::min<size_t>(64, expected.size()));
+
+	uint64_t smallestKept = UINT64_MAX;
+	uint64_t largestDropped = 0;
+
+	for (auto& [key, uses] : expected)
+	{
+		if (list.QUses(key) != 0)
+			smallestKept = std::min(smallestKept, uses);
+		else
+			largestDropped = std::max(largestDropped, uses);
+	}
+
+	CHECK(smallestKept >= largestDropped);
+
+	SetupKeyUsage readBack;
+	CHECK(ReadText(readBack, WriteText(list)));
+	CHECK(SameUsage(readBack, list));
+}
+
+void TestCommittedList(const char *Path)
+{
+	std::ifstream file(Path);
+	CHECK(file.good());
+
+	if (!file)
+	{
+		printf("Unable to open %s\n", Path);
+		return;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+
+	SetupKeyUsage list;
+	CHECK(ReadText(list, text.str()));
+	CHECK(list.QKeyCount() > 0);
+
+	// Every entry is a distinct key
+	size_t entries = 0;
+
+	for (size_t pos = 0; (pos = text.str().find("LIGHTING_SETUP_SPECIALIZATION(", pos)) != std::string::npos; pos++)
+		entries++;
+
+	CHECK(entries == list.QKeyCount());
+
+	// And survives being rewritten with its counts
+	SetupKeyUsage readBack;
+	CHECK(ReadText(readBack, WriteText(list)));
+	CHECK(SameUsage(readBack, list));
+}
+
+int main(int argc, char **argv)
+{
+	const char *inlPath = nullptr;
+	uint32_t switches = 200000;
+	uint64_t seed = 1234;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--inl") && i + 1 < argc)
+			inlPath = argv[++i];
+		else if (!strcmp(argv[i], "--switches") && i + 1 < argc)
+			switches = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestRoundTrip();
+	TestAccumulate();
+	TestTrim();
+	TestMalformed();
+	TestSession(switches, seed);
+
+	if (inlPath)
+		TestCommittedList(inlPath);
+
+	return CheckSummary();
+}
\ No newline at end of file
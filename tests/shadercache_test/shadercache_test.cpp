@@ -0,0 +1,209 @@
+//
+// Runs ShaderCache against a stub compiler in a temporary directory and checks keying, prefetch deduplication, the
+// disk cache, corrupted cache files and that edited sources (including files pulled in through #include) are picked
+// up. Only depends on the standard library so cache changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o shadercache_test shadercache_test.cpp ../../skyrim64_test/src/patches/rendering/ShaderCache.cpp
+//   cl /std:c++17 /O2 /EHsc shadercache_test.cpp ../../skyrim64_test/src/patches/rendering/ShaderCache.cpp
+//
+// Usage: shadercache_test [--keep]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/ShaderCache.h"
+#include "../check.h"
+
+namespace fs = std::filesystem;
+
+static std::atomic_uint32_t CompileCount;
+
+//
+// "Bytecode" is the target followed by every define, so tests can tell which permutation they got back
+//
+bool StubCompiler(const ShaderCompileRequest& Request, std::vector<uint8_t>& Bytecode, std::string& Errors)
+{
+	CompileCount++;
+
+	if (Request.Target == "bad")
+	{
+		Errors = "error X1000: stub failure";
+		return false;
+	}
+
+	std::string output = Request.Target;
+
+	for (auto& [name, value] : Request.Defines)
+		output += name + "=" + value;
+
+	Bytecode.assign(output.begin(), output.end());
+	return true;
+}
+
+void WriteFile(const fs::path& Path, const std::string& Text)
+{
+	std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+	file << Text;
+}
+
+ShaderCompileRequest MakeRequest(const fs::path& Source, int Permutation)
+{
+	return { Source, { { "A", "1" }, { "N", std::to_string(Permutation) } }, "main", "ps_5_0", 1 };
+}
+
+void TestMemoryAndPrefetch(const fs::path& Root, const fs::path& Source)
+{
+	CompileCount = 0;
+	ShaderCache cache(Root / "cache", StubCompiler, 4);
+
+	// 64 requests, 32 unique permutations
+	std::vector<ShaderCompileRequest> batch;
+
+	for (int i = 0; i < 64; i++)
+		batch.push_back(MakeRequest(Source, i % 32));
+
+	cache.Prefetch(batch);
+	CHECK(CompileCount == 32);
+
+	auto bytecode = cache.Get(batch[5]);
+	CHECK(bytecode && std::string(bytecode->begin(), bytecode->end()) == "ps_5_0A=1N=5");
+	CHECK(cache.GetStats().MemoryHits >= 1);
+	CHECK(CompileCount == 32);
+
+	// Failures report the compiler output and aren't cached
+	std::string errors;
+	auto bad = MakeRequest(Source, 0);
+	bad.Target = "bad";
+
+	CHECK(!cache.Get(bad, &errors));
+	CHECK(errors == "error X1000: stub failure");
+	CHECK(!cache.Get(bad));
+	CHECK(cache.GetStats().Failures == 2);
+
+	// Every part of the request is part of the key, including define order
+	auto flags = batch[0];
+	flags.Flags = 2;
+	auto swapped = batch[0];
+	std::swap(swapped.Defines[0], swapped.Defines[1]);
+	auto entry = batch[0];
+	entry.EntryPoint = "main2";
+
+	CHECK(cache.ComputeKey(flags) != cache.ComputeKey(batch[0]));
+	CHECK(cache.ComputeKey(swapped) != cache.ComputeKey(batch[0]));
+	CHECK(cache.ComputeKey(entry) != cache.ComputeKey(batch[0]));
+	CHECK(cache.ComputeKey(batch[32]) == cache.ComputeKey(batch[0]));
+}
+
+void TestDisk(const fs::path& Root, const fs::path& Source)
+{
+	CompileCount = 0;
+	ShaderCache cache(Root / "cache", StubCompiler, 4);
+
+	auto bytecode = cache.Get(MakeRequest(Source, 3));
+	CHECK(bytecode && std::string(bytecode->begin(), bytecode->end()) == "ps_5_0A=1N=3");
+	CHECK(CompileCount == 0);
+	CHECK(cache.GetStats().DiskHits == 1);
+}
+
+void TestSourceEdits(const fs::path& Root, const fs::path& Source, const fs::path& Include)
+{
+	CompileCount = 0;
+	ShaderCache cache(Root / "cache", StubCompiler, 4);
+	auto request = MakeRequest(Source, 3);
+
+	CHECK(cache.Get(request) && CompileCount == 0);
+	uint64_t oldKey = cache.ComputeKey(request);
+
+	// Include edited in the same session, without InvalidateSources()
+	WriteFile(Include, "// common v2, longer than before\n");
+	CHECK(cache.ComputeKey(request) != oldKey);
+	CHECK(cache.Get(request) && CompileCount == 1);
+
+	// Main file edited
+	oldKey = cache.ComputeKey(request);
+	WriteFile(Source, "#include \"inc/common.h\"\nfloat4 main() : SV_Target { return 2; }\n");
+	CHECK(cache.ComputeKey(request) != oldKey);
+	CHECK(cache.Get(request) && CompileCount == 2);
+
+	// Same size and write time put back: only an explicit invalidation notices
+	auto writeTime = fs::last_write_time(Include);
+	oldKey = cache.ComputeKey(request);
+	WriteFile(Include, "// common v3, longer than before\n");
+	fs::last_write_time(Include, writeTime);
+
+	CHECK(cache.ComputeKey(request) == oldKey);
+	cache.InvalidateSources();
+	CHECK(cache.ComputeKey(request) != oldKey);
+
+	// Missing sources still get a key; the compiler reports the real error
+	auto missing = MakeRequest(Root / "src" / "missing.hlsl", 0);
+	CHECK(cache.ComputeKey(missing) == cache.ComputeKey(missing));
+}
+
+void TestCorruption(const fs::path& Root, const fs::path& Source)
+{
+	for (auto& entry : fs::directory_iterator(Root / "cache"))
+		std::ofstream(entry.path(), std::ios::binary | std::ios::in | std::ios::out).write("XXXX", 4);
+
+	CompileCount = 0;
+
+	{
+		ShaderCache cache(Root / "cache", StubCompiler, 4);
+		auto bytecode = cache.Get(MakeRequest(Source, 3));
+
+		CHECK(bytecode && std::string(bytecode->begin(), bytecode->end()) == "ps_5_0A=1N=3");
+		CHECK(CompileCount == 1);
+		CHECK(cache.GetStats().DiskHits == 0);
+	}
+
+	// The rewritten file is valid again and no temporary files are left behind
+	{
+		ShaderCache cache(Root / "cache", StubCompiler, 4);
+
+		CHECK(cache.Get(MakeRequest(Source, 3)) && CompileCount == 1);
+	}
+
+	uint32_t tempFiles = 0;
+
+	for (auto& entry : fs::directory_iterator(Root / "cache"))
+		tempFiles += entry.path().extension() == ".tmp";
+
+	CHECK(tempFiles == 0);
+}
+
+int main(int argc, char **argv)
+{
+	bool keep = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--keep"))
+			keep = true;
+	}
+
+	fs::path root = fs::temp_directory_path() / "shadercache_test";
+	fs::remove_all(root);
+	fs::create_directories(root / "src" / "inc");
+
+	fs::path source = root / "src" / "a.hlsl";
+	fs::path include = root / "src" / "inc" / "common.h";
+
+	WriteFile(source, "#include \"inc/common.h\"\nfloat4 main() : SV_Target { return 1; }\n");
+	WriteFile(include, "// common v1\n");
+
+	TestMemoryAndPrefetch(root, source);
+	TestDisk(root, source);
+	TestSourceEdits(root, source, include);
+	TestCorruption(root, source);
+
+	if (!keep)
+		fs::remove_all(root);
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,288 @@
+//
+// Drives ShadowCache with scripted and random frames and checks its dirty tracking: a snapshot is only reused while
+// the light and every static caster are unchanged since it was stored, slots are only taken from idle keys, and idle
+// slots are evicted. Only depends on the standard library so shadow cache changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o shadowcache_test shadowcache_test.cpp ../../skyrim64_test/src/patches/rendering/ShadowCache.cpp
+//   cl /std:c++17 /O2 /EHsc shadowcache_test.cpp ../../skyrim64_test/src/patches/rendering/ShadowCache.cpp
+//
+// Usage: shadowcache_test [--frames N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/ShadowCache.h"
+#include "../check.h"
+
+using Action = ShadowCache::Action;
+
+ShadowCasterSignature MakeSignature(std::initializer_list<uint64_t> StaticCasters, uint32_t DynamicCasters)
+{
+	ShadowCasterSignature signature = {};
+
+	for (uint64_t hash : StaticCasters)
+		ShadowCache::AddStaticCaster(signature, hash);
+
+	for (uint32_t i = 0; i < DynamicCasters; i++)
+		ShadowCache::AddDynamicCaster(signature);
+
+	return signature;
+}
+
+void TestSignatures()
+{
+	// Registration order doesn't matter, contents do
+	CHECK(MakeSignature({ 1, 2, 3 }, 1) == MakeSignature({ 3, 1, 2 }, 1));
+	CHECK(MakeSignature({ 1, 2, 3 }, 1) != MakeSignature({ 1, 2, 4 }, 1));
+	CHECK(MakeSignature({ 1, 2 }, 1) != MakeSignature({ 1, 2 }, 2));
+	CHECK(MakeSignature({ 1, 2 }, 1) != MakeSignature({ 1, 2, 2 }, 1));
+	CHECK(MakeSignature({}, 0) == MakeSignature({}, 0));
+
+	uint32_t a = 1;
+	uint32_t b = 2;
+	CHECK(ShadowCache::HashBytes(&a, sizeof(a)) != ShadowCache::HashBytes(&b, sizeof(b)));
+	CHECK(ShadowCache::HashBytes(&a, sizeof(a), 1) != ShadowCache::HashBytes(&a, sizeof(a), 2));
+}
+
+void TestLifecycle()
+{
+	ShadowCache cache(2, 2, 10);
+	auto casters = MakeSignature({ 10, 20 }, 3);
+
+	// New, stable once, stable twice: render, render, rebuild, then reuse
+	CHECK(cache.Begin(1, 100, casters).Type == Action::Render);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 100, casters).Type == Action::Render);
+	cache.EndFrame();
+
+	auto rebuild = cache.Begin(1, 100, casters);
+	CHECK(rebuild.Type == Action::Rebuild && rebuild.Slot != ShadowCache::InvalidSlot);
+	cache.EndFrame();
+
+	auto reuse = cache.Begin(1, 100, casters);
+	CHECK(reuse.Type == Action::Reuse && reuse.Slot == rebuild.Slot);
+	cache.EndFrame();
+
+	CHECK(cache.GetStats().Reused == 1);
+	CHECK(cache.GetStats().StaticCastersSkipped == 2);
+
+	// Dynamic count change, light change and caster change all dirty the slot
+	CHECK(cache.Begin(1, 100, MakeSignature({ 10, 20 }, 4)).Type == Action::Render);
+	cache.EndFrame();
+	cache.Begin(1, 100, casters);
+	cache.EndFrame();
+	cache.Begin(1, 100, casters);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 100, casters).Type == Action::Rebuild);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 100, casters).Type == Action::Reuse);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 101, casters).Type == Action::Render);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 101, MakeSignature({ 10, 21 }, 3)).Type == Action::Render);
+	cache.EndFrame();
+
+	// A snapshot that couldn't be stored starts the wait over
+	auto moved = MakeSignature({ 10, 21 }, 3);
+	cache.Begin(1, 101, moved);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 101, moved).Type == Action::Rebuild);
+	cache.EndFrame();
+	cache.Invalidate(rebuild.Slot);
+	CHECK(cache.Begin(1, 101, moved).Type == Action::Render);
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 101, moved).Type == Action::Rebuild);
+	cache.EndFrame();
+
+	// Maps without static casters never take a slot
+	CHECK(cache.Begin(2, 5, MakeSignature({}, 4)).Type == Action::Render);
+	cache.EndFrame();
+	CHECK(cache.GetStats().ActiveSlots == 1);
+
+	// Full: a third key can't take slots that were used last frame
+	cache.Begin(2, 5, casters);
+	cache.Begin(1, 101, moved);
+	CHECK(cache.Begin(3, 5, casters).Type == Action::Render);
+	cache.EndFrame();
+	CHECK(cache.GetStats().ActiveSlots == 2);
+
+	// Idle slots are evicted
+	for (int i = 0; i < 10; i++)
+	{
+		cache.Begin(1, 101, moved);
+		cache.EndFrame();
+	}
+
+	CHECK(!cache.IsSlotActive(0) || !cache.IsSlotActive(1));
+	CHECK(cache.IsSlotActive(rebuild.Slot));
+	CHECK(!cache.IsSlotActive(cache.QMaxSlots()));
+}
+
+void TestStealing()
+{
+	auto casters = MakeSignature({ 10, 20 }, 3);
+	ShadowCache cache(1, 1, 100);
+
+	cache.Begin(1, 1, casters);
+	cache.EndFrame();
+	cache.EndFrame();
+	cache.EndFrame();
+
+	// Key 1 was idle for two frames, so key 2 may take its slot
+	CHECK(cache.Begin(2, 1, casters).Type == Action::Render);
+	CHECK(cache.Begin(2, 1, casters).Type == Action::Rebuild);
+	cache.EndFrame();
+	CHECK(cache.GetStats().Evicted == 1);
+
+	// Key 1 comes back and has to start over
+	cache.EndFrame();
+	cache.EndFrame();
+	CHECK(cache.Begin(1, 1, casters).Type == Action::Render);
+
+	cache.Clear();
+	CHECK(!cache.IsSlotActive(0));
+}
+
+//
+// Random lights and casters. The test remembers what every slot was rebuilt with and checks each reuse against it.
+//
+void TestRandom(uint32_t Frames, uint64_t Seed)
+{
+	const uint32_t keyCount = 12;
+
+	struct Snapshot
+	{
+		bool Valid;
+		uint64_t LightHash;
+		ShadowCasterSignature Casters;
+	};
+
+	std::mt19937_64 rng(Seed);
+	ShadowCache cache(6, 2, 30);
+	std::vector<Snapshot> snapshots(cache.QMaxSlots());
+	std::vector<uint64_t> lightHashes(keyCount);
+	std::vector<std::vector<uint64_t>> casters(keyCount);
+	std::vector<uint32_t> dynamicCounts(keyCount);
+
+	uint32_t staleReuses = 0;
+	uint32_t badSlots = 0;
+	uint32_t reuses = 0;
+
+	for (uint32_t key = 0; key < keyCount; key++)
+	{
+		lightHashes[key] = rng();
+		casters[key].resize(1 + rng() % 6);
+
+		for (auto& hash : casters[key])
+			hash = rng();
+	}
+
+	for (uint32_t frame = 0; frame < Frames; frame++)
+	{
+		for (uint32_t key = 0; key < keyCount; key++)
+		{
+			// Most lights are still, some are drawn only now and then
+			if (rng() % 4 == 0)
+				continue;
+
+			uint32_t change = rng() % 64;
+
+			if (change == 0)
+				lightHashes[key] = rng();
+			else if (change == 1)
+				casters[key][rng() % casters[key].size()] = rng();
+			else if (change == 2)
+				casters[key].push_back(rng());
+			else if (change == 3 && casters[key].size() > 1)
+				casters[key].pop_back();
+
+			// Dynamic casters are redrawn every frame, so their count changing is rare in practice but still dirties
+			if (rng() % 128 == 0)
+				dynamicCounts[key] = rng() % 3;
+
+			// Registration order is random, the signature must not care
+			std::vector<uint64_t> order = casters[key];
+			std::shuffle(order.begin(), order.end(), rng);
+
+			ShadowCasterSignature signature = {};
+
+			for (uint64_t hash : order)
+				ShadowCache::AddStaticCaster(signature, hash);
+
+			for (uint32_t i = 0; i < dynamicCounts[key]; i++)
+				ShadowCache::AddDynamicCaster(signature);
+
+			auto decision = cache.Begin(key + 1, lightHashes[key], signature);
+
+			if (decision.Type != Action::Render && decision.Slot >= snapshots.size())
+			{
+				badSlots++;
+				continue;
+			}
+
+			if (decision.Type == Action::Rebuild)
+			{
+				// Occasionally the snapshot copy fails
+				if (rng() % 32 == 0)
+				{
+					cache.Invalidate(decision.Slot);
+					snapshots[decision.Slot] = {};
+				}
+				else
+				{
+					snapshots[decision.Slot] = { true, lightHashes[key], signature };
+				}
+			}
+			else if (decision.Type == Action::Reuse)
+			{
+				auto& snapshot = snapshots[decision.Slot];
+				reuses++;
+
+				if (!snapshot.Valid || snapshot.LightHash != lightHashes[key] || snapshot.Casters != signature)
+					staleReuses++;
+			}
+		}
+
+		cache.EndFrame();
+
+		// Evicted slots lose their contents
+		for (uint32_t slot = 0; slot < snapshots.size(); slot++)
+		{
+			if (!cache.IsSlotActive(slot))
+				snapshots[slot] = {};
+		}
+	}
+
+	printf("random: %u frames, %u reuses\n", Frames, reuses);
+	CHECK(staleReuses == 0);
+	CHECK(badSlots == 0);
+	CHECK(reuses > 0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 20000;
+	uint64_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			frames = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestSignatures();
+	TestLifecycle();
+	TestStealing();
+	TestRandom(frames, seed);
+
+	return CheckSummary();
+}
\ No newline at end of file
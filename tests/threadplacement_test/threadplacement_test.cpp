@@ -0,0 +1,201 @@
+//
+// Checks the thread placement policy used by skyrim64_test against synthetic processor topologies. Only depends on the
+// standard library so placement changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o threadplacement_test threadplacement_test.cpp ../../skyrim64_test/src/patches/threadplacement.cpp
+//   cl /std:c++17 /O2 /EHsc threadplacement_test.cpp ../../skyrim64_test/src/patches/threadplacement.cpp
+//
+// Usage: threadplacement_test
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "../../skyrim64_test/src/patches/threadplacement.h"
+#include "../check.h"
+
+using namespace ThreadPlacement;
+
+struct SyntheticCase
+{
+	const char *Name;
+	uint32_t PerformanceCores;
+	uint32_t ThreadsPerPerformanceCore;
+	uint32_t EfficiencyCores;
+	uint32_t CoresPerL3;
+};
+
+static const SyntheticCase Cases[] =
+{
+	{ "4 cores, no SMT",				4, 1, 0, 0 },
+	{ "8 cores, SMT",					8, 2, 0, 0 },
+	{ "hybrid 8P+16E, SMT",				8, 2, 16, 0 },
+	{ "16 cores in 2 L3 domains, SMT",	16, 2, 0, 8 },
+	{ "single core",					1, 1, 0, 0 },
+	{ "64+ processors (truncated)",		40, 2, 0, 0 },
+};
+
+static bool IsSubset(uint64_t Mask, uint64_t Of)
+{
+	return (Mask & ~Of) == 0;
+}
+
+static void CheckTopology(const Topology& T, const SyntheticCase& Case)
+{
+	uint32_t expected = Case.PerformanceCores * Case.ThreadsPerPerformanceCore + Case.EfficiencyCores;
+
+	CHECK(T.Processors.size() == (expected < 64 ? expected : 64));
+	CHECK(T.GetAllMask() != 0);
+	CHECK((T.GetPerformanceMask() | T.GetEfficiencyMask()) == T.GetAllMask());
+	CHECK((T.GetPerformanceMask() & T.GetEfficiencyMask()) == 0);
+	CHECK(T.IsHybrid() == (Case.EfficiencyCores > 0));
+	CHECK(T.HasSMT() == (Case.ThreadsPerPerformanceCore > 1));
+
+	uint64_t domains = 0;
+
+	for (uint32_t i = 0; i < T.L3DomainCount; i++)
+	{
+		CHECK((domains & T.GetL3DomainMask(i)) == 0);
+		domains |= T.GetL3DomainMask(i);
+	}
+
+	CHECK(domains == T.GetAllMask());
+}
+
+static void CheckProfile(const Topology& T, Profile P)
+{
+	Policy policy(T, P);
+	const uint64_t all = T.GetAllMask();
+
+	for (uint32_t c = 0; c < (uint32_t)ThreadClass::Count; c++)
+	{
+		for (uint32_t instance = 0; instance < 12; instance++)
+		{
+			Assignment a = policy.Assign((ThreadClass)c, instance);
+
+			CHECK(a.AffinityMask != 0);
+			CHECK(IsSubset(a.AffinityMask, all));
+			CHECK(a.Priority >= -2 && a.Priority <= 2);
+
+			if (a.IdealProcessor != -1)
+				CHECK(a.AffinityMask & (1ull << a.IdealProcessor));
+
+			if (P == Profile::Disabled)
+			{
+				CHECK(a.AffinityMask == all);
+				CHECK(a.IdealProcessor == -1);
+				CHECK(a.Priority == 0);
+			}
+		}
+	}
+
+	if (P == Profile::Disabled)
+		return;
+
+	Assignment main = policy.Assign(ThreadClass::Main, 0);
+	Assignment render = policy.Assign(ThreadClass::Render, 0);
+	Assignment tasklet = policy.Assign(ThreadClass::Tasklet, 0);
+
+	// Latency-sensitive threads stay on performance cores
+	CHECK(IsSubset(main.AffinityMask, T.GetPerformanceMask()));
+	CHECK(IsSubset(render.AffinityMask, T.GetPerformanceMask()));
+
+	if (T.CoreCount > 1)
+		CHECK(main.IdealProcessor != render.IdealProcessor);
+
+	// Background work prefers efficiency cores when there are any
+	if (T.IsHybrid())
+		CHECK(IsSubset(tasklet.AffinityMask, T.GetEfficiencyMask()));
+
+	if (P == Profile::PhysicalCores)
+	{
+		CHECK(IsSubset(main.AffinityMask, T.GetPrimaryMask()));
+
+		for (uint32_t i = 0; i < 4; i++)
+			CHECK(IsSubset(policy.Assign(ThreadClass::Job, i).AffinityMask, T.GetPrimaryMask()));
+	}
+
+	if (P == Profile::SingleCache)
+	{
+		uint64_t domain = T.GetL3DomainMask(T.Processors[0].L3Domain);
+
+		for (uint32_t c = 0; c < (uint32_t)ThreadClass::Count; c++)
+		{
+			if ((ThreadClass)c != ThreadClass::Other)
+				CHECK(IsSubset(policy.Assign((ThreadClass)c, 0).AffinityMask, domain));
+		}
+	}
+
+	// Job workers spread over distinct cores (all eligible ones except the main and render thread's) before any core
+	// gets a second one
+	std::vector<bool> workCores(T.CoreCount, false);
+	uint32_t workCoreCount = 0;
+
+	for (auto& lp : T.Processors)
+	{
+		if ((main.AffinityMask & (1ull << lp.Index)) && !workCores[lp.Core])
+		{
+			workCores[lp.Core] = true;
+			workCoreCount++;
+		}
+	}
+
+	uint32_t jobCores = (workCoreCount > 2) ? workCoreCount - 2 : workCoreCount;
+
+	for (uint32_t i = 0; i < jobCores; i++)
+	{
+		for (uint32_t j = i + 1; j < jobCores; j++)
+		{
+			int32_t a = policy.Assign(ThreadClass::Job, i).IdealProcessor;
+			int32_t b = policy.Assign(ThreadClass::Job, j).IdealProcessor;
+
+			CHECK(T.Processors[a].Core != T.Processors[b].Core);
+		}
+	}
+}
+
+static void CheckClassification()
+{
+	const struct
+	{
+		const char *Name;
+		ThreadClass Class;
+	} names[] =
+	{
+		{ "Main Thread",			ThreadClass::Main },
+		{ "RenderThread",			ThreadClass::Render },
+		{ "AudioThread",			ThreadClass::Audio },
+		{ "BSJobs worker 3",		ThreadClass::Job },
+		{ "TaskletThread2",			ThreadClass::Tasklet },
+		{ "QueuedFile",				ThreadClass::IO },
+		{ "BSResource streaming",	ThreadClass::IO },
+		{ "Havok worker",			ThreadClass::Job },
+		{ "SomethingElse",			ThreadClass::Other },
+		{ "",						ThreadClass::Other },
+		{ nullptr,					ThreadClass::Other },
+	};
+
+	for (auto& entry : names)
+		CHECK(ClassifyThread(entry.Name) == entry.Class);
+}
+
+int main()
+{
+	for (auto& entry : Cases)
+	{
+		Topology t = Topology::Synthetic(entry.PerformanceCores, entry.ThreadsPerPerformanceCore, entry.EfficiencyCores, entry.CoresPerL3);
+		uint32_t before = FailureCount;
+
+		CheckTopology(t, entry);
+
+		for (uint32_t p = 0; p < (uint32_t)Profile::Count; p++)
+			CheckProfile(t, (Profile)p);
+
+		printf("%-32s %2u processors, %2u cores, %u L3: %s\n", entry.Name, (uint32_t)t.Processors.size(), t.CoreCount, t.L3DomainCount, FailureCount == before ? "ok" : "FAILED");
+	}
+
+	CheckClassification();
+
+	return CheckSummary();
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+//
+// Checks the shared Timebase used by skyrim64_test against the OS monotonic clock (clock_gettime(CLOCK_MONOTONIC_RAW)
+// or std::chrono::steady_clock on Windows) while it recalibrates, and from several threads at once. Only depends on
+// the standard library so timebase changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -pthread -o timebase_test timebase_test.cpp ../../skyrim64_test/src/timebase.cpp
+//   cl /std:c++17 /O2 /EHsc timebase_test.cpp ../../skyrim64_test/src/timebase.cpp
+//
+// Usage: timebase_test [--seconds N] [--threads N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <time.h>
+#endif
+#include "../../skyrim64_test/src/timebase.h"
+#include "../check.h"
+
+static uint64_t ReferenceNanoseconds()
+{
+#if defined(_WIN32)
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void TestConversions()
+{
+	double frequency = Timebase::GetFrequency();
+
+	CHECK(frequency > 0.0);
+	CHECK(fabs(Timebase::TicksToSeconds((int64_t)frequency) - 1.0) < 1e-6);
+	CHECK(fabs(Timebase::TicksToMilliseconds(Timebase::SecondsToTicks(0.25)) - 250.0) < 1e-3);
+	CHECK(fabs(Timebase::TicksToMicroseconds(Timebase::SecondsToTicks(0.001)) - 1000.0) < 1e-1);
+	CHECK(Timebase::TicksToMilliseconds(0) == 0.0);
+}
+
+// Elapsed time measured with ticks has to track the reference clock while Recalibrate() refines the frequency
+static void TestElapsed(double Seconds)
+{
+	uint64_t startTicks = Timebase::ReadTicks();
+	uint64_t startReference = ReferenceNanoseconds();
+	uint32_t steps = std::max(1u, (uint32_t)(Seconds * 10.0));
+
+	for (uint32_t i = 1; i <= steps; i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		Timebase::Recalibrate();
+
+		if (i % 5 != 0 && i != steps)
+			continue;
+
+		uint64_t ticks = Timebase::ReadTicks();
+		uint64_t reference = ReferenceNanoseconds();
+		Timebase::CalibrationStats stats = Timebase::GetCalibrationStats();
+
+		double elapsed = Timebase::TicksToMilliseconds((int64_t)(ticks - startTicks));
+		double expected = (double)(reference - startReference) / 1e6;
+		double errorUs = (elapsed - expected) * 1000.0;
+
+		printf("  %7.1fms: error %8.2fus, drift %7.2fppm, offset %7.2fus, %llu recalibrations\n", expected, errorUs,
+			stats.LastDriftPPM, stats.LastOffsetError, (unsigned long long)stats.RecalibrationCount);
+
+		// 100ppm of the elapsed time plus a little for the two reads not being simultaneous
+		CHECK(fabs(errorUs) < expected * 0.1 + 50.0);
+	}
+}
+
+// Absolute conversions have to agree with the reference clock on every thread, and ticks may never go backwards
+// on a single thread
+static void TestThreads(uint32_t ThreadCount)
+{
+	std::atomic<uint32_t> mismatches(0);
+	std::atomic<uint32_t> backwards(0);
+	std::atomic<int64_t> worstUs(0);
+	std::vector<std::thread> threads;
+
+	for (uint32_t i = 0; i < ThreadCount; i++)
+	{
+		threads.emplace_back([&]()
+		{
+			uint64_t lastTicks = 0;
+			int64_t worst = 0;
+
+			for (uint32_t k = 0; k < 100000; k++)
+			{
+				uint64_t before = ReferenceNanoseconds();
+				uint64_t ticks = Timebase::ReadTicks();
+				uint64_t after = ReferenceNanoseconds();
+
+				if (ticks < lastTicks)
+					backwards++;
+
+				lastTicks = ticks;
+
+				// The thread was preempted between the reads, the sample doesn't say anything
+				if (after - before > 10000)
+					continue;
+
+				int64_t delta = (int64_t)Timebase::TicksToMonotonicNanoseconds(ticks) - (int64_t)(before + (after - before) / 2);
+
+				worst = std::max(worst, delta < 0 ? -delta : delta);
+
+				if (delta < -50000 || delta > 50000)
+					mismatches++;
+			}
+
+			int64_t current = worstUs.load();
+			while (worst / 1000 > current && !worstUs.compare_exchange_weak(current, worst / 1000))
+				;
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	printf("  %u threads: worst absolute difference %lldus\n", ThreadCount, (long long)worstUs.load());
+
+	CHECK(mismatches == 0);
+	CHECK(backwards == 0);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 4.5;
+	uint32_t threads = 4;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+			seconds = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = (uint32_t)atoi(argv[++i]);
+	}
+
+	Timebase::Initialize();
+	Timebase::CalibrationStats stats = Timebase::GetCalibrationStats();
+
+	printf("Invariant TSC: %s, ticks from: %s, frequency %.0fHz\n", stats.InvariantTSC ? "yes" : "no",
+		stats.UsingTSC ? "rdtsc" : "monotonic clock", stats.Frequency);
+
+	CHECK(stats.InvariantTSC == Timebase::HasInvariantTSC());
+
+	TestConversions();
+	TestElapsed(seconds);
+	TestThreads(threads);
+
+	return CheckSummary();
+}
\ No newline at end of file
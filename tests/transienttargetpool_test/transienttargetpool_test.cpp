@@ -0,0 +1,474 @@
+//
+// Feeds TransientTargetPool scripted and random frames and checks the plan: targets sharing a slot never overlap in any
+// observed frame, and targets read (or only drawn onto) before being written never become transient. Only depends on
+// the standard library so transient target changes can be verified on any platform:
+//
+//   g++ -std=c++17 -O2 -Wall -Wextra -o transienttargetpool_test transienttargetpool_test.cpp ../../skyrim64_test/src/patches/rendering/TransientTargetPool.cpp
+//   cl /std:c++17 /O2 /EHsc transienttargetpool_test.cpp ../../skyrim64_test/src/patches/rendering/TransientTargetPool.cpp
+//
+// Usage: transienttargetpool_test [--rounds N] [--seed N]
+//
+// Prints every failed check and exits with a non-zero status if there were any.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include "../../skyrim64_test/src/patches/rendering/TransientTargetPool.h"
+#include "../check.h"
+
+const uint32_t Invalid = TransientTargetPool::InvalidSlot;
+
+void TestChain()
+{
+	TransientTargetPool pool(8);
+
+	for (uint32_t i = 0; i < 6; i++)
+		pool.SetTarget(i, (i < 5) ? 1 : 2, 100, true);
+
+	pool.SetTarget(6, 1, 100, false);
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		pool.BeginPass(); pool.Write(0); pool.Write(6);
+		pool.BeginPass(); pool.Read(0); pool.Write(1);
+		pool.BeginPass(); pool.Read(1); pool.Write(2);
+		pool.BeginPass(); pool.Read(2); pool.Write(3);
+		pool.BeginPass(); pool.Read(4); pool.Write(4);	// Read before written
+		pool.Write(5); pool.Read(6);
+		pool.EndFrame();
+	}
+
+	// Not enough frames yet
+	pool.BuildPlan(11);
+	CHECK(pool.GetStats().TransientTargets == 0);
+
+	pool.BuildPlan(5);
+
+	// 0 [1, 2], 1 [2, 3], 2 [3, 4], 3 [4, 4]: 0 and 2 can share, 1 and 3 can share
+	CHECK(pool.QSlot(0) != Invalid && pool.QSlot(0) == pool.QSlot(2));
+	CHECK(pool.QSlot(1) != Invalid && pool.QSlot(1) == pool.QSlot(3));
+	CHECK(pool.QSlot(0) != pool.QSlot(1));
+	CHECK(pool.QSlot(4) == Invalid);	// Persistent
+	CHECK(pool.QSlot(6) == Invalid);	// Not eligible
+	CHECK(pool.QSlot(7) == Invalid);	// Never described
+
+	auto stats = pool.GetStats();
+	CHECK(stats.Targets == 7);
+	CHECK(stats.TransientTargets == 5);
+	CHECK(stats.TotalBytes == 700);
+	CHECK(stats.TransientBytes == 500);
+	CHECK(stats.PooledBytes == 300);	// Two key 1 slots and the key 2 target alone
+	CHECK(stats.ObservedFrames == 10);
+
+	CHECK(pool.QAliasOf(2, 1) == 0 || pool.QAliasOf(2, 1) == 1 || pool.QAliasOf(2, 1) == 3);
+	CHECK(pool.QSlot(pool.QAliasOf(2, 1)) == pool.QSlot(2));
+	CHECK(pool.QAliasOf(4, 1) == 4);
+	CHECK(pool.QAliasOf(2, 99) == 2);	// Key changed since the plan was made
+
+	// Targets touched on deferred contexts are never transient
+	pool.MarkUnordered(2);
+	pool.BuildPlan(5);
+	CHECK(pool.QSlot(2) == Invalid);
+	CHECK(pool.QSlot(0) != Invalid);
+}
+
+void TestBoundReads()
+{
+	// 0 stays bound as a shader resource and is read by draws two passes after it was last bound. 1 starts in between
+	// and must not take 0's memory.
+	TransientTargetPool pool(2);
+	pool.SetTarget(0, 1, 100, true);
+	pool.SetTarget(1, 1, 100, true);
+
+	for (int frame = 0; frame < 4; frame++)
+	{
+		pool.BeginPass(); pool.Write(0);
+		pool.BeginPass(); pool.Read(0);
+		pool.BeginPass(); pool.Write(1); pool.Read(0);
+		pool.BeginPass(); pool.Read(1);
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) != Invalid && pool.QSlot(1) != Invalid);
+	CHECK(pool.QSlot(0) != pool.QSlot(1));
+
+	// Without the late read they would share
+	pool.ResetObservations();
+
+	for (int frame = 0; frame < 4; frame++)
+	{
+		pool.BeginPass(); pool.Write(0);
+		pool.BeginPass(); pool.Read(0);
+		pool.BeginPass(); pool.Write(1);
+		pool.BeginPass(); pool.Read(1);
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) != Invalid && pool.QSlot(0) == pool.QSlot(1));
+}
+
+void TestUses()
+{
+	TransientTargetPool pool(4);
+
+	for (uint32_t i = 0; i < 4; i++)
+		pool.SetTarget(i, 1, 100, true);
+
+	for (int frame = 0; frame < 4; frame++)
+	{
+		// Bound for output, then cleared in the same pass: transient
+		pool.BeginPass(); pool.Use(0); pool.Write(0);
+
+		// Drawn onto but never cleared: contents accumulate over frames
+		pool.BeginPass(); pool.Use(1);
+
+		// Drawn onto, then read before any clear
+		pool.BeginPass(); pool.Use(2); pool.Read(2); pool.Write(2);
+
+		// Drawn onto late: the use extends the lifetime of a target written earlier
+		pool.BeginPass(); pool.Write(3);
+		pool.BeginPass(); pool.Read(0);
+		pool.BeginPass(); pool.Use(3);
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) != Invalid);
+	CHECK(pool.QSlot(1) == Invalid);
+	CHECK(pool.QSlot(2) == Invalid);
+	CHECK(pool.QSlot(3) != Invalid);
+	CHECK(pool.QSlot(0) != pool.QSlot(3));	// 0 [1, 5] and 3 [4, 6] overlap
+}
+
+void TestMerge()
+{
+	// Disjoint in most frames, overlapping in one
+	TransientTargetPool pool(2);
+	pool.SetTarget(0, 1, 100, true);
+	pool.SetTarget(1, 1, 100, true);
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		pool.BeginPass(); pool.Write(0);
+		pool.BeginPass(); pool.Write(1);
+
+		if (frame == 7)
+			pool.Read(0);
+
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) != pool.QSlot(1));
+
+	// A target that isn't written first in a single frame is persistent
+	pool.ResetObservations();
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		pool.BeginPass();
+
+		if (frame == 3)
+			pool.Read(0);
+
+		pool.Write(0);
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) == Invalid);
+
+	// Describing a target again forgets what was observed for the old resource
+	pool.SetTarget(0, 1, 100, true);
+
+	for (int frame = 0; frame < 2; frame++)
+	{
+		pool.BeginPass(); pool.Write(0);
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.QSlot(0) != Invalid);
+}
+
+void TestSaveLoad()
+{
+	auto path = std::filesystem::temp_directory_path() / "transienttargetpool_test.txt";
+
+	TransientTargetPool pool(4);
+
+	for (uint32_t i = 0; i < 4; i++)
+		pool.SetTarget(i, 1, 100, true);
+
+	for (int frame = 0; frame < 2; frame++)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			pool.BeginPass();
+			pool.Write(i);
+			pool.Read(i);
+		}
+
+		pool.EndFrame();
+	}
+
+	pool.BuildPlan(1);
+	CHECK(pool.GetStats().Slots == 1);
+	CHECK(pool.Save(path));
+
+	// Loaded plans apply before any frame was observed, but only once every target they were built for is back with the
+	// same key
+	TransientTargetPool loaded(4);
+	CHECK(loaded.Load(path));
+	CHECK(!loaded.QPlanActive());
+
+	loaded.SetTarget(0, 1, 100, true);
+	loaded.SetTarget(1, 1, 100, true);
+	CHECK(!loaded.QPlanActive());
+	CHECK(loaded.QAliasOf(1, 1) == 1);
+
+	loaded.SetTarget(2, 1, 100, true);
+	loaded.SetTarget(3, 1, 100, true);
+	CHECK(loaded.QPlanActive());
+	CHECK(loaded.GetStats().Slots == 1);
+
+	for (uint32_t i = 0; i < 4; i++)
+		CHECK(loaded.QSlot(i) == pool.QSlot(i));
+
+	CHECK(loaded.QAliasOf(1, 1) == 0);
+	CHECK(loaded.QAliasOf(1, 2) == 1);
+
+	// A target whose key changed (e.g. another resolution) discards the whole plan, even if the target itself wasn't
+	// transient
+	pool.SetTarget(3, 1, 100, false);
+	pool.BuildPlan(0);
+	CHECK(pool.QSlot(3) == TransientTargetPool::InvalidSlot);
+	CHECK(pool.Save(path));
+
+	TransientTargetPool changed(4);
+	CHECK(changed.Load(path));
+	changed.SetTarget(0, 1, 100, true);
+	changed.SetTarget(3, 2, 100, false);
+	changed.SetTarget(1, 1, 100, true);
+	changed.SetTarget(2, 1, 100, true);
+	CHECK(!changed.QPlanActive());
+	CHECK(changed.QAliasOf(1, 1) == 1);
+	CHECK(changed.GetStats().Slots == 0);
+
+	for (uint32_t i = 0; i < 4; i++)
+		CHECK(changed.QSlot(i) == TransientTargetPool::InvalidSlot);
+
+	// Targets only need to match once they're described, removing one in between is fine
+	TransientTargetPool recreated(4);
+	CHECK(recreated.Load(path));
+	recreated.RemoveTarget(3);
+	recreated.SetTarget(0, 1, 100, true);
+	recreated.SetTarget(1, 1, 100, true);
+	recreated.SetTarget(2, 1, 100, true);
+	CHECK(!recreated.QPlanActive());
+	recreated.SetTarget(3, 1, 100, false);
+	CHECK(recreated.QPlanActive());
+	CHECK(recreated.QAliasOf(1, 1) == 0);
+
+	// A target the plan never saw discards it too (once the plan is active, new targets just get their own texture)
+	TransientTargetPool fewer(5);
+
+	for (uint32_t i = 0; i < 4; i++)
+		fewer.SetTarget(i, 1, 100, true);
+
+	fewer.BuildPlan(0);
+
+	std::filesystem::path fewerPath = path;
+	fewerPath += ".5";
+	CHECK(fewer.Save(fewerPath));
+
+	TransientTargetPool extra(5);
+	CHECK(extra.Load(fewerPath));
+
+	for (uint32_t i = 5; i-- > 0;)
+		extra.SetTarget(i, 1, 100, true);
+
+	CHECK(!extra.QPlanActive());
+	CHECK(extra.QAliasOf(1, 1) == 1);
+
+	std::error_code ec;
+	std::filesystem::remove(fewerPath, ec);
+
+	// Plans for a different target count are rejected
+	TransientTargetPool other(5);
+	CHECK(!other.Load(path));
+
+	std::filesystem::remove(path, ec);
+}
+
+//
+// Random frames. The test keeps its own per frame intervals and checks every plan against all of them.
+//
+void TestRandom(uint32_t Rounds, uint64_t Seed)
+{
+	const uint32_t targetCount = 24;
+	const uint32_t passCount = 20;
+	const uint32_t frameCount = 8;
+
+	struct Interval
+	{
+		uint32_t First;
+		uint32_t Last;
+		bool Used;
+		bool Decided;
+		bool WriteFirst;
+	};
+
+	std::mt19937_64 rng(Seed);
+	uint32_t overlaps = 0;
+	uint32_t persistentAliased = 0;
+	uint32_t aliased = 0;
+
+	for (uint32_t round = 0; round < Rounds; round++)
+	{
+		TransientTargetPool pool(targetCount);
+		std::vector<uint64_t> keys(targetCount);
+		std::vector<std::vector<Interval>> frames(frameCount, std::vector<Interval>(targetCount));
+		std::vector<bool> unordered(targetCount, false);
+
+		for (uint32_t i = 0; i < targetCount; i++)
+		{
+			keys[i] = 1 + rng() % 3;
+			pool.SetTarget(i, keys[i], 100, true);
+		}
+
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			auto& intervals = frames[frame];
+
+			for (uint32_t pass = 1; pass <= passCount; pass++)
+			{
+				pool.BeginPass();
+
+				for (uint32_t op = rng() % 4; op > 0; op--)
+				{
+					uint32_t target = rng() % targetCount;
+					uint32_t kind = rng() % 8;
+					auto& interval = intervals[target];
+
+					if (!interval.Used)
+					{
+						interval.First = pass;
+						interval.Used = true;
+					}
+
+					interval.Last = pass;
+
+					if (kind < 3)
+					{
+						pool.Write(target);
+
+						if (!interval.Decided)
+							interval.WriteFirst = true;
+
+						interval.Decided = true;
+					}
+					else if (kind < 7)
+					{
+						// Reads are mostly of targets that were written, otherwise nearly everything is persistent
+						if (!interval.Decided && (rng() % 4) != 0)
+						{
+							pool.Write(target);
+							interval.WriteFirst = true;
+							interval.Decided = true;
+						}
+
+						pool.Read(target);
+						interval.Decided = true;
+					}
+					else
+					{
+						pool.Use(target);
+					}
+				}
+			}
+
+			pool.EndFrame();
+		}
+
+		if (rng() % 4 == 0)
+		{
+			uint32_t target = rng() % targetCount;
+			pool.MarkUnordered(target);
+			unordered[target] = true;
+		}
+
+		pool.BuildPlan(1 + rng() % frameCount);
+
+		for (uint32_t a = 0; a < targetCount; a++)
+		{
+			uint32_t slot = pool.QSlot(a);
+
+			if (slot == Invalid)
+				continue;
+
+			aliased++;
+
+			for (auto& intervals : frames)
+			{
+				if (intervals[a].Used && !intervals[a].WriteFirst)
+					persistentAliased++;
+			}
+
+			if (unordered[a])
+				persistentAliased++;
+
+			for (uint32_t b = a + 1; b < targetCount; b++)
+			{
+				if (pool.QSlot(b) != slot)
+					continue;
+
+				if (keys[a] != keys[b])
+					overlaps++;
+
+				for (auto& intervals : frames)
+				{
+					auto& x = intervals[a];
+					auto& y = intervals[b];
+
+					if (x.Used && y.Used && x.First <= y.Last && y.First <= x.Last)
+						overlaps++;
+				}
+			}
+		}
+	}
+
+	printf("random: %u rounds, %u targets assigned to slots\n", Rounds, aliased);
+	CHECK(overlaps == 0);
+	CHECK(persistentAliased == 0);
+	CHECK(aliased > 0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t rounds = 2000;
+	uint64_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+			rounds = (uint32_t)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	TestChain();
+	TestBoundReads();
+	TestUses();
+	TestMerge();
+	TestSaveLoad();
+	TestRandom(rounds, seed);
+
+	return CheckSummary();
+}
\ No newline at end of file